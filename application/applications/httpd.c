@@ -0,0 +1,155 @@
+#include <rtthread.h>
+
+#if defined(RT_USING_SAL) && defined(SAL_USING_POSIX)
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define DBG_TAG "httpd"
+#define DBG_LVL DBG_INFO
+#include <rtdbg.h>
+
+/*
+ * Minimal HTTP/1.0 server for the files of the SD card, one client at a
+ * time: GET only, no directory listing. The body goes out with sendfile(),
+ * straight from the file blocks into TCP segments.
+ */
+#define HTTPD_ROOT          "/sdcard"
+#define HTTPD_PORT          80
+#define HTTPD_REQ_SIZE      512
+
+static int httpd_port = HTTPD_PORT;
+static rt_thread_t httpd_tid = RT_NULL;
+
+static void httpd_reply(int client, const char *status)
+{
+    char head[64];
+    int len;
+
+    len = rt_snprintf(head, sizeof(head), "HTTP/1.0 %s\r\nContent-Length: 0\r\n\r\n", status);
+    send(client, head, len, 0);
+}
+
+static void httpd_serve(int client, char *req)
+{
+    char path[128];
+    char head[96];
+    char *uri, *end;
+    struct stat st;
+    off_t offset = 0;
+    rt_tick_t start;
+    int fd, len, sent;
+
+    if (rt_strncmp(req, "GET ", 4) != 0)
+    {
+        httpd_reply(client, "501 Not Implemented");
+        return;
+    }
+    uri = req + 4;
+    end = strchr(uri, ' ');
+    if (end == RT_NULL || uri[0] != '/' || strstr(uri, "..") != RT_NULL)
+    {
+        httpd_reply(client, "400 Bad Request");
+        return;
+    }
+    *end = '\0';
+
+    rt_snprintf(path, sizeof(path), "%s%s", HTTPD_ROOT, uri);
+    fd = open(path, O_RDONLY);
+    if (fd < 0 || fstat(fd, &st) != 0 || S_ISDIR(st.st_mode))
+    {
+        if (fd >= 0)
+        {
+            close(fd);
+        }
+        httpd_reply(client, "404 Not Found");
+        return;
+    }
+
+    len = rt_snprintf(head, sizeof(head), "HTTP/1.0 200 OK\r\nContent-Length: %ld\r\n\r\n", (long)st.st_size);
+    send(client, head, len, 0);
+
+    start = rt_tick_get();
+    sent = sendfile(client, fd, &offset, st.st_size);
+    start = rt_tick_get() - start;
+    close(fd);
+
+    LOG_I("%s: %d/%ld bytes in %d ms", uri, sent, (long)st.st_size, start * 1000 / RT_TICK_PER_SECOND);
+}
+
+static void httpd_thread_entry(void *param)
+{
+    struct sockaddr_in addr;
+    char *req;
+    int server, client, len;
+
+    req = rt_malloc(HTTPD_REQ_SIZE);
+    server = socket(AF_INET, SOCK_STREAM, 0);
+    if (req == RT_NULL || server < 0)
+    {
+        LOG_E("no memory or socket");
+        goto __exit;
+    }
+
+    rt_memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(httpd_port);
+    addr.sin_addr.s_addr = INADDR_ANY;
+    if (bind(server, (struct sockaddr *)&addr, sizeof(addr)) < 0 || listen(server, 1) < 0)
+    {
+        LOG_E("bind port %d failed", httpd_port);
+        goto __exit;
+    }
+    LOG_I("serving %s on port %d", HTTPD_ROOT, httpd_port);
+
+    while (1)
+    {
+        client = accept(server, RT_NULL, RT_NULL);
+        if (client < 0)
+        {
+            continue;
+        }
+
+        /* The request line is all that is needed, headers are not looked at */
+        len = recv(client, req, HTTPD_REQ_SIZE - 1, 0);
+        if (len > 0)
+        {
+            req[len] = '\0';
+            httpd_serve(client, req);
+        }
+        closesocket(client);
+    }
+
+__exit:
+    if (server >= 0)
+    {
+        closesocket(server);
+    }
+    rt_free(req);
+    httpd_tid = RT_NULL;
+}
+
+static void httpd(int argc, char *argv[])
+{
+    if (httpd_tid != RT_NULL)
+    {
+        rt_kprintf("httpd is running on port %d\n", httpd_port);
+        return;
+    }
+
+    httpd_port = (argc > 1) ? atoi(argv[1]) : HTTPD_PORT;
+    httpd_tid = rt_thread_create("httpd", httpd_thread_entry, RT_NULL, 4096, 20, 10);
+    if (httpd_tid == RT_NULL)
+    {
+        rt_kprintf("httpd thread create err.\n");
+        return;
+    }
+    rt_thread_startup(httpd_tid);
+}
+MSH_CMD_EXPORT(httpd, serve the SD card over HTTP: httpd [port]);
+
+#endif /* RT_USING_SAL && SAL_USING_POSIX */
@@ -0,0 +1,584 @@
+#include <rtthread.h>
+
+#ifdef BSP_USING_SPINAND
+#include <rthw.h>
+#include <fal.h>
+#include <drv_spinand.h>
+#include "ota_sink.h"
+
+#ifdef RT_USING_DFS
+#include <unistd.h>
+#include <fcntl.h>
+#endif
+#include <string.h>
+
+#define DBG_TAG "ota"
+#define DBG_LVL DBG_INFO
+#include <rtdbg.h>
+
+struct ota_sink
+{
+    const struct fal_partition *slot;
+    const struct fal_partition *param;  /* Holding para, RT_NULL when neither record is valid */
+    struct ota_paramers para;
+    struct ota_firmware_header header;
+    rt_uint32_t target;         /* OTA_APP_SLOT_* being written */
+    rt_uint32_t received;       /* Stream bytes taken */
+    rt_uint32_t programmed;     /* Slot bytes on flash, whole pages */
+    rt_uint32_t erased;         /* Slot bytes erased, whole blocks */
+    rt_uint32_t page_size;
+    rt_uint32_t blk_size;
+    rt_uint32_t fill;           /* Bytes waiting in page */
+    rt_uint32_t crc;
+    rt_uint8_t *page;
+    rt_tick_t start;
+    rt_err_t err;               /* First failure, the upload is dropped at close */
+    rt_bool_t busy;
+};
+
+extern int fal_init_check(void);
+
+static struct ota_sink sink = {0};
+static rt_uint32_t ota_crc_table[256];
+
+static void ota_crc_init(void)
+{
+    rt_uint32_t i = 0;
+    rt_uint32_t j = 0;
+    rt_uint32_t c = 0;
+
+    if (ota_crc_table[1] != 0)
+    {
+        return;
+    }
+    for (i = 0; i < 256; i++)
+    {
+        c = i;
+        for (j = 0; j < 8; j++)
+        {
+            c = (c >> 1) ^ (0xedb88320 & -(c & 1));
+        }
+        ota_crc_table[i] = c;
+    }
+}
+
+static rt_uint32_t ota_crc_update(rt_uint32_t crc, const rt_uint8_t *p, rt_uint32_t len)
+{
+    while (len--)
+    {
+        crc = (crc >> 8) ^ ota_crc_table[(crc ^ *p++) & 0xff];
+    }
+
+    return crc;
+}
+
+/* CRC the part of stream bytes [pos, pos + n) inside the image body, as boot1 checks it */
+static void ota_sink_crc(struct ota_sink *s, const rt_uint8_t *p, rt_uint32_t pos, rt_uint32_t n)
+{
+    rt_uint32_t lo = sizeof(s->header);
+    rt_uint32_t hi = lo + s->header.size;
+
+    if (pos < lo)
+    {
+        if (lo - pos >= n)
+        {
+            return;
+        }
+        p += lo - pos;
+        n -= lo - pos;
+        pos = lo;
+    }
+    if (pos >= hi)
+    {
+        return;
+    }
+    if (pos + n > hi)
+    {
+        n = hi - pos;
+    }
+
+    s->crc = ota_crc_update(s->crc, p, n);
+}
+
+static rt_uint32_t ota_param_crc(const struct ota_paramers *para)
+{
+    ota_crc_init();
+
+    return ota_crc_update(0xffffffff, (const rt_uint8_t *)para, sizeof(*para) - sizeof(para->crc32)) ^ 0xffffffff;
+}
+
+static rt_err_t ota_param_read(const struct fal_partition *param, struct ota_paramers *para)
+{
+    if (param == RT_NULL || fal_partition_read(param, 0, (rt_uint8_t *)para, sizeof(*para)) != sizeof(*para))
+    {
+        return -RT_EIO;
+    }
+    if (para->magic != OTA_PARA_MAGIC)
+    {
+        return -RT_EEMPTY;
+    }
+    /* Torn by a power cut during its save, the other record is still there */
+    if (para->crc32 != ota_param_crc(para) && (para->seq != 0 || para->crc32 != 0xffffffff))
+    {
+        return -RT_ERROR;
+    }
+
+    return RT_EOK;
+}
+
+/* The current record, as ota_param_load() in boot1 picks it; returns the partition holding it */
+static const struct fal_partition *ota_param_load(struct ota_paramers *para)
+{
+    const struct fal_partition *first = fal_partition_find(OTA_PARA_PART);
+    const struct fal_partition *second = fal_partition_find(OTA_PARA2_PART);
+    struct ota_paramers other = {0};
+    rt_err_t ret = ota_param_read(first, para);
+
+    if (ota_param_read(second, &other) == RT_EOK && (ret != RT_EOK || (rt_int32_t)(other.seq - para->seq) > 0))
+    {
+        *para = other;
+        return second;
+    }
+    if (ret != RT_EOK)
+    {
+        rt_memset(para, 0, sizeof(*para));
+        return RT_NULL;
+    }
+
+    return first;
+}
+
+/* Page out to the slot, erasing the next block as the stream reaches it */
+static rt_err_t ota_sink_flush(struct ota_sink *s)
+{
+    if (s->programmed + s->page_size > s->slot->len)
+    {
+        LOG_E("image larger than %s", s->slot->name);
+        return -RT_EFULL;
+    }
+
+    if (s->programmed + s->page_size > s->erased)
+    {
+        if (fal_partition_erase(s->slot, s->erased, s->blk_size) < 0)
+        {
+            return -RT_EIO;
+        }
+        s->erased += s->blk_size;
+    }
+
+    if (s->fill < s->page_size)
+    {
+        rt_memset(s->page + s->fill, 0xff, s->page_size - s->fill);
+    }
+    if (fal_partition_write(s->slot, s->programmed, s->page, s->page_size) < 0)
+    {
+        return -RT_EIO;
+    }
+    s->programmed += s->page_size;
+    s->fill = 0;
+
+    return RT_EOK;
+}
+
+/* Header checks as soon as it is complete, long before the slot fills */
+static rt_err_t ota_sink_header(struct ota_sink *s)
+{
+    rt_memcpy(&s->header, s->page, sizeof(s->header));
+
+    if (s->header.magic != OTA_FIRMWARE_MAGIC)
+    {
+        LOG_E("image magic 0x%08x != 0x%08x", s->header.magic, OTA_FIRMWARE_MAGIC);
+        return -RT_EINVAL;
+    }
+    if (s->header.size > s->slot->len - sizeof(s->header))
+    {
+        LOG_E("image %d bytes, %s holds %d", s->header.size, s->slot->name, (int)(s->slot->len - sizeof(s->header)));
+        return -RT_EFULL;
+    }
+
+    return RT_EOK;
+}
+
+rt_err_t ota_sink_open(void)
+{
+    struct ota_sink *s = &sink;
+    const struct fal_flash_dev *flash = RT_NULL;
+    rt_base_t level = 0;
+    rt_bool_t busy = RT_FALSE;
+
+    level = rt_hw_interrupt_disable();
+    busy = s->busy;
+    s->busy = RT_TRUE;
+    rt_hw_interrupt_enable(level);
+    if (busy)
+    {
+        LOG_W("upload already running");
+        return -RT_EBUSY;
+    }
+
+    if (!fal_init_check())
+    {
+        goto fail;
+    }
+    /* Slots addressed through a layout boot1 does not use would land in other partitions */
+    if (!spinand_layout_valid())
+    {
+        LOG_E("fal_cfg.h does not match the flash partition table");
+        goto fail;
+    }
+    if (fal_partition_find(OTA_PARA_PART) == RT_NULL)
+    {
+        goto fail;
+    }
+
+    /* The slot hgboot does not start, APP1 when Param was never written */
+    s->param = ota_param_load(&s->para);
+    s->target = s->para.active_slot == OTA_APP_SLOT_1 ? OTA_APP_SLOT_2 : OTA_APP_SLOT_1;
+
+    s->slot = fal_partition_find(s->target == OTA_APP_SLOT_1 ? OTA_APP1_PART : OTA_APP2_PART);
+    if (s->slot == RT_NULL)
+    {
+        goto fail;
+    }
+    flash = fal_flash_device_find(s->slot->flash_name);
+    if (flash == RT_NULL || flash->write_gran == 0)
+    {
+        goto fail;
+    }
+
+    s->page_size = flash->write_gran / 8;
+    s->blk_size = flash->blk_size;
+    s->page = rt_malloc(s->page_size);
+    if (s->page == RT_NULL)
+    {
+        goto fail;
+    }
+
+    ota_crc_init();
+    rt_memset(&s->header, 0, sizeof(s->header));
+    s->received = 0;
+    s->programmed = 0;
+    s->erased = 0;
+    s->fill = 0;
+    s->crc = 0xffffffff;
+    s->err = RT_EOK;
+    s->start = rt_tick_get();
+
+    LOG_I("receiving into %s", s->slot->name);
+
+    return RT_EOK;
+
+fail:
+    LOG_E("no partitions for OTA");
+    s->busy = RT_FALSE;
+
+    return -RT_ERROR;
+}
+
+rt_err_t ota_sink_write(const void *buf, rt_uint32_t len)
+{
+    struct ota_sink *s = &sink;
+    const rt_uint8_t *p = buf;
+    rt_uint32_t n = 0;
+
+    while (len > 0 && s->err == RT_EOK)
+    {
+        n = s->page_size - s->fill;
+        n = n > len ? len : n;
+        rt_memcpy(s->page + s->fill, p, n);
+
+        if (s->received >= sizeof(s->header))
+        {
+            ota_sink_crc(s, p, s->received, n);
+        }
+        else if (s->received + n >= sizeof(s->header))
+        {
+            /* The first page holds the header whole */
+            s->err = ota_sink_header(s);
+            if (s->err == RT_EOK)
+            {
+                ota_sink_crc(s, p, s->received, n);
+            }
+        }
+
+        s->fill += n;
+        s->received += n;
+        p += n;
+        len -= n;
+
+        if (s->err == RT_EOK && s->fill == s->page_size)
+        {
+            s->err = ota_sink_flush(s);
+        }
+    }
+
+    return s->err;
+}
+
+/* Read the image back from the slot, what boot1 will see */
+static rt_err_t ota_sink_verify(struct ota_sink *s)
+{
+    rt_uint32_t offset = sizeof(s->header);
+    rt_uint32_t left = s->header.size;
+    rt_uint32_t crc = 0xffffffff;
+    rt_uint32_t n = 0;
+
+    while (left > 0)
+    {
+        n = left > s->page_size ? s->page_size : left;
+        if (fal_partition_read(s->slot, offset, s->page, n) != (int)n)
+        {
+            return -RT_EIO;
+        }
+        crc = ota_crc_update(crc, s->page, n);
+        offset += n;
+        left -= n;
+    }
+
+    return (crc ^ 0xffffffff) == s->header.crc32 ? RT_EOK : -RT_ERROR;
+}
+
+/*
+ * Same record ota_update_firmware() leaves: new slot active, the old one to
+ * fall back to. Like ota_param_save() it goes to the partition not holding
+ * the current record, which a power cut here leaves in force.
+ */
+static rt_err_t ota_sink_commit(struct ota_sink *s)
+{
+    struct ota_paramers *para = &s->para;
+    const struct fal_partition *part = fal_partition_find(OTA_PARA2_PART);
+
+    if (part == RT_NULL)
+    {
+        LOG_W("no partition %s, rewriting %s in place", OTA_PARA2_PART, OTA_PARA_PART);
+        part = fal_partition_find(OTA_PARA_PART);
+    }
+    else if (s->param == part)
+    {
+        part = fal_partition_find(OTA_PARA_PART);
+    }
+    if (part == RT_NULL)
+    {
+        return -RT_ERROR;
+    }
+
+    para->can_be_back = para->magic == OTA_PARA_MAGIC ? OTA_BACKUP_FLAG : 0;
+    para->magic = OTA_PARA_MAGIC;
+    para->active_slot = s->target;
+    para->upgrade_ready = 0;
+    if (s->target == OTA_APP_SLOT_1)
+    {
+        para->app1_crc = s->header.crc32;
+    }
+    else
+    {
+        para->app2_crc = s->header.crc32;
+    }
+    para->seq++;
+    para->crc32 = ota_param_crc(para);
+
+    /* One page, programmed once */
+    rt_memset(s->page, 0xff, s->page_size);
+    rt_memcpy(s->page, para, sizeof(*para));
+    if (fal_partition_erase(part, 0, sizeof(*para)) < 0 ||
+        fal_partition_write(part, 0, s->page, s->page_size) < 0)
+    {
+        return -RT_EIO;
+    }
+    s->param = part;
+
+    return RT_EOK;
+}
+
+rt_err_t ota_sink_close(void)
+{
+    struct ota_sink *s = &sink;
+    rt_uint32_t ms = 0;
+    rt_err_t ret = s->err;
+
+    if (!s->busy)
+    {
+        return -RT_ERROR;
+    }
+
+    if (ret == RT_EOK && s->received < sizeof(s->header) + s->header.size)
+    {
+        LOG_E("upload stopped at %d of %d bytes", s->received, (int)(sizeof(s->header) + s->header.size));
+        ret = -RT_ERROR;
+    }
+    if (ret == RT_EOK && s->fill > 0)
+    {
+        ret = ota_sink_flush(s);
+    }
+    if (ret == RT_EOK && (s->crc ^ 0xffffffff) != s->header.crc32)
+    {
+        LOG_E("image crc 0x%08x != 0x%08x", s->crc ^ 0xffffffff, s->header.crc32);
+        ret = -RT_ERROR;
+    }
+    if (ret == RT_EOK && ota_sink_verify(s) != RT_EOK)
+    {
+        LOG_E("%s read back does not match", s->slot->name);
+        ret = -RT_EIO;
+    }
+    if (ret == RT_EOK)
+    {
+        ret = ota_sink_commit(s);
+    }
+
+    ms = rt_tick_get() - s->start;
+    ms = ms * 1000 / RT_TICK_PER_SECOND;
+    if (ret == RT_EOK)
+    {
+        LOG_I("%s: version 0x%08x, %d bytes in %d ms, %d KB/s, active after reset", s->slot->name,
+              s->header.version, s->received, ms, ms ? (int)(s->received / ms) : 0);
+    }
+    else
+    {
+        LOG_E("%s not switched, Param unchanged", s->slot->name);
+    }
+
+    rt_free(s->page);
+    s->page = RT_NULL;
+    s->busy = RT_FALSE;
+
+    return ret;
+}
+
+#ifdef PKG_NETUTILS_TFTP
+/* The TFTP file hooks: OTA_SINK_FILE uploads to the sink, everything else to DFS */
+static rt_bool_t ota_sink_name(const char *fname)
+{
+    const char *base = strrchr(fname, '/');
+
+    return rt_strcmp(base ? base + 1 : fname, OTA_SINK_FILE) == 0;
+}
+
+void *tftp_file_open(const char *fname, const char *mode, int is_write)
+{
+    int fd = 0;
+
+    if (rt_strcmp(mode, "octet"))
+    {
+        rt_kprintf("tftp: No support this mode(%s).", mode);
+        return RT_NULL;
+    }
+
+    if (is_write && ota_sink_name(fname))
+    {
+        return ota_sink_open() == RT_EOK ? (void *)&sink : RT_NULL;
+    }
+
+    fd = is_write ? open(fname, O_WRONLY | O_CREAT, 0) : open(fname, O_RDONLY, 0);
+
+    return (void *)fd;
+}
+
+int tftp_file_write(void *handle, int pos, void *buff, int len)
+{
+    if (handle == (void *)&sink)
+    {
+        if (pos != sink.received || ota_sink_write(buff, len) != RT_EOK)
+        {
+            return -1;
+        }
+        return len;
+    }
+
+    return write((int)handle, buff, len);
+}
+
+int tftp_file_read(void *handle, int pos, void *buff, int len)
+{
+    int fd = (int)handle;
+
+    if (handle == (void *)&sink || lseek(fd, pos, SEEK_SET) != pos)
+    {
+        return -1;
+    }
+    return read(fd, buff, len);
+}
+
+void tftp_file_close(void *handle)
+{
+    if (handle == (void *)&sink)
+    {
+        ota_sink_close();
+        return;
+    }
+
+    close((int)handle);
+}
+#endif /* PKG_NETUTILS_TFTP */
+
+#ifdef RT_USING_DFS
+/* Same path for an image already on a file system */
+static rt_err_t ota_sink_file(const char *path)
+{
+    rt_uint8_t *buf = RT_NULL;
+    rt_err_t ret = RT_EOK;
+    int fd = -1;
+    int n = 0;
+
+    fd = open(path, O_RDONLY, 0);
+    if (fd < 0)
+    {
+        rt_kprintf("ota: can't open %s\n", path);
+        return -RT_ERROR;
+    }
+    buf = rt_malloc(4096);
+    if (buf == RT_NULL || ota_sink_open() != RT_EOK)
+    {
+        rt_free(buf);
+        close(fd);
+        return -RT_ENOMEM;
+    }
+
+    while (ret == RT_EOK && (n = read(fd, buf, 4096)) > 0)
+    {
+        ret = ota_sink_write(buf, n);
+    }
+    ret = ota_sink_close();
+
+    rt_free(buf);
+    close(fd);
+
+    return ret;
+}
+#endif
+
+static void ota(int argc, char *argv[])
+{
+    const struct fal_partition *param = RT_NULL;
+    struct ota_paramers para = {0};
+
+#ifdef RT_USING_DFS
+    if (argc == 2)
+    {
+        ota_sink_file(argv[1]);
+        return;
+    }
+#endif
+
+    if (fal_init_check())
+    {
+        param = ota_param_load(&para);
+    }
+    if (param == RT_NULL)
+    {
+        rt_kprintf("Param  : no record\n");
+    }
+    else
+    {
+        rt_kprintf("%-7s: seq %d, active %s, back %s, upgrade %d\n", param->name, para.seq, para.active_slot == OTA_APP_SLOT_1 ? OTA_APP1_PART : OTA_APP2_PART,
+                   para.can_be_back == OTA_BACKUP_FLAG ? "yes" : "no", para.upgrade_ready);
+        rt_kprintf("crc    : APP1 0x%08x, APP2 0x%08x, Download 0x%08x\n", para.app1_crc, para.app2_crc, para.download_crc);
+    }
+    if (sink.busy)
+    {
+        rt_kprintf("upload : %s, %d bytes\n", sink.slot->name, sink.received);
+    }
+    rt_kprintf("Usage: tftp put <image> as %s, or ota <file>\n", OTA_SINK_FILE);
+}
+MSH_CMD_EXPORT(ota, show OTA state or flash an image file into the inactive slot);
+
+#endif /* BSP_USING_SPINAND */
@@ -0,0 +1,60 @@
+#ifndef __OTA_SINK_H__
+#define __OTA_SINK_H__
+
+#include <rtthread.h>
+
+/*
+ * Network OTA: a packed image (application/pack.py) streamed straight
+ * into the APP slot hgboot is not running, CRC checked on the way in and
+ * read back before the Param record switches to it. Records and names
+ * are the ones of boot1/hgboot/ota/ota.h.
+ */
+#define OTA_FIRMWARE_MAGIC          0x46574D47  /* 'FWMG' */
+#define OTA_PARA_MAGIC              0x50415241  /* 'PARA' */
+
+#define OTA_APP_SLOT_1              0xa1U
+#define OTA_APP_SLOT_2              0xa2U
+#define OTA_BACKUP_FLAG             0xbaU
+
+#define OTA_APP1_PART               "APP1"
+#define OTA_APP2_PART               "APP2"
+#define OTA_PARA_PART               "Param"
+#define OTA_PARA2_PART              "Param2"
+
+/* TFTP uploads of this file name, any directory, go to the sink instead of DFS */
+#define OTA_SINK_FILE               "ota.img"
+
+struct ota_firmware_header
+{
+    rt_uint32_t magic;
+    rt_uint32_t size;           /* Bytes after the header */
+    rt_uint32_t crc32;          /* CRC32 of those bytes */
+    rt_uint32_t version;
+    rt_uint32_t load_addr;
+    rt_uint32_t exec_addr;
+    rt_uint32_t seg_count;
+    rt_uint32_t seg_crc32;
+};
+
+/* One record each in Param and Param2, the valid one with the higher seq is current */
+struct ota_paramers
+{
+    rt_uint32_t magic;
+    rt_uint32_t active_slot;
+    rt_uint32_t can_be_back;
+    rt_uint32_t upgrade_ready;
+    rt_uint32_t app1_crc;
+    rt_uint32_t app2_crc;
+    rt_uint32_t download_crc;
+    rt_uint32_t seq;            /* Incremented by every save, 0 on records from before it existed */
+    rt_uint32_t crc32;          /* CRC32 of the fields above, still erased on records from before seq */
+};
+
+/* One upload at a time; bytes are taken in order, whatever the transport */
+rt_err_t ota_sink_open(void);
+rt_err_t ota_sink_write(const void *buf, rt_uint32_t len);
+
+/* Verify and switch Param to the new slot, RT_EOK once it is the one to boot */
+rt_err_t ota_sink_close(void);
+
+#endif
@@ -10,7 +10,7 @@
 #define T113_GIC_DIST_BASE      (0x03021000)
 
 #define UNCACHE_MEM_ADDR        (0x40000000)
-#define UNCACHE_MEM_SIZE        (0x00100000)
+#define UNCACHE_MEM_SIZE        (0x000FF000)    /* last page holds the boot hand-off block */
 
 /* t113 on-board gic irq sources */
 #define ARM_GIC_NR_IRQS         223
@@ -1,5 +1,6 @@
 #include <drv_clk.h>
 #include <board.h>
+#include <drv_handoff.h>
 #include <rtdbg.h>
 
 static void sdelay(unsigned int loops)
@@ -600,20 +601,37 @@ unsigned int drv_clk_get_apb1_clk(void)
 
 int drv_clk_init(void)
 {
+    const struct boot_handoff *handoff = boot_handoff_get();
+    rt_bool_t clk_valid = (handoff != RT_NULL) && (handoff->flags & HANDOFF_F_CLK);
+
+    /* domains the boot stages already left at the target rate are not touched again */
+
     /* init PLL_CPU 1200MHz */
-    init_pll_cpu(1200000000);
+    if (!clk_valid || (handoff->pll_cpu != 1200000000))
+    {
+        init_pll_cpu(1200000000);
+    }
 
     /* init PLL_PERI(2X/1X) PLL_PERI(2X) 1200MHz PLL PLL_PERI(1X) 600MHz PLL_PERI(800M) 800MHz */
     init_pll_peri();
 
     /* init high-performance buses (AHBs) 200MHz */
-    init_ahb_clk(200000000);
+    if (!clk_valid || (handoff->ahb != 200000000))
+    {
+        init_ahb_clk(200000000);
+    }
 
     /* init advanced peripheral buses (APB0) 200MHz */
-    init_apb0_clk(200000000);
+    if (!clk_valid || (handoff->apb0 != 200000000))
+    {
+        init_apb0_clk(200000000);
+    }
 
     /* init advanced peripheral buses (APB1) 24MHz */
-    init_apb1_clk(24000000);
+    if (!clk_valid || (handoff->apb1 != 24000000))
+    {
+        init_apb1_clk(24000000);
+    }
 
     /* init usb0 clk 12MHz */
     init_usb0_clk();
@@ -2,20 +2,137 @@
 #include <drv_iomux.h>
 #include <drv_clk.h>
 #include <board.h>
+#include <drv_pktbuf.h>
+#include <stdlib.h>
 #include "netif/ethernetif.h"
 
-#define EMAC_RX_FRAME_MAX    30
 #define EMAC_DMA_TX_DESC_NUM 128
 #define EMAC_DMA_RX_DESC_NUM 128
-#define RX_BUF_SIZE          1536
+#define RX_BUF_SIZE          PKTBUF_SIZE
 #define TX_BUF_SIZE          1536
 
+#define EMAC_INT_TX          (1 << 0)
+#define EMAC_INT_RX          (1 << 13)
+
+/* TX descriptor desc1 bits */
+#define TX_DESC_INT          (1 << 31)
+#define TX_DESC_LAST         (1 << 30)
+#define TX_DESC_FIRST        (1 << 29)
+#define TX_DESC_CSUM_FULL    (3 << 27)  /* IPv4 header and TCP/UDP/ICMP checksum with pseudo header */
+
+/* RX descriptor desc0 bits with RX_CTL0_CHECK_CSUM set */
+#define RX_DESC_HDR_ERR      (1 << 7)
+#define RX_DESC_PAYLOAD_ERR  (1 << 0)
+
+#define RX_CTL0_CHECK_CSUM   (1 << 27)
+
+/* RX descriptor desc0: frame fits one buffer only when both are set */
+#define RX_DESC_FIRST        (1 << 9)
+#define RX_DESC_LAST         (1 << 8)
+
+/* INT_STA error events, counted by emac_int_err() */
+#define EMAC_INT_TX_STOP     (1 << 1)
+#define EMAC_INT_TX_TIMEOUT  (1 << 3)
+#define EMAC_INT_TX_UNDERRUN (1 << 4)
+#define EMAC_INT_RX_BUF_UA   (1 << 9)
+#define EMAC_INT_RX_STOP     (1 << 10)
+#define EMAC_INT_RX_TIMEOUT  (1 << 11)
+#define EMAC_INT_RX_OVERFLOW (1 << 12)
+#define EMAC_INT_TX_ERR      (EMAC_INT_TX_STOP | EMAC_INT_TX_TIMEOUT | EMAC_INT_TX_UNDERRUN)
+#define EMAC_INT_RX_ERR      (EMAC_INT_RX_BUF_UA | EMAC_INT_RX_STOP | EMAC_INT_RX_TIMEOUT | EMAC_INT_RX_OVERFLOW)
+
+/* Clause 22 PHY registers */
+#define MII_BMCR             0x00
+#define MII_BMSR             0x01
+#define MII_ADVERTISE        0x04
+#define MII_LPA              0x05
+#define MII_CTRL1000         0x09
+#define MII_STAT1000         0x0A
+
+#define BMCR_RESET           0x8000
+#define BMCR_SPEED100        0x2000
+#define BMCR_ANENABLE        0x1000
+#define BMCR_PDOWN           0x0800
+#define BMCR_ANRESTART       0x0200
+#define BMCR_FULLDPLX        0x0100
+#define BMCR_SPEED1000       0x0040
+#define BMSR_ANEGCOMPLETE    0x0020
+#define BMSR_LSTATUS         0x0004
+
+/*
+ * The PHY is polled over MDIO by a state machine in the phy thread. The poll
+ * interval starts at PHY_POLL_FAST after every change and doubles up to
+ * PHY_POLL_SLOW while nothing happens; autonegotiation is restarted when it
+ * has not completed within PHY_AN_TIMEOUT.
+ */
+#define PHY_ADDR             0
+#define PHY_POLL_FAST        (RT_TICK_PER_SECOND / 50)
+#define PHY_POLL_SLOW        (RT_TICK_PER_SECOND / 2)
+#define PHY_AN_TIMEOUT       (RT_TICK_PER_SECOND * 5)
+#define PHY_RESET_TIMEOUT    500     /* ms */
+
+/*
+ * IRQ to t113_emac_rx() latency, measured on the 24 MHz arch timer.
+ * Bucket i counts wakeups under (8 << i) us, the last one everything longer.
+ */
+#define EMAC_TIMER_MHZ       24
+#define EMAC_LAT_BUCKETS     8
+
+/*
+ * Checksum offload: the MAC inserts IPv4, TCP, UDP and ICMP checksums and
+ * verifies them on receive, lwIP skips its own for this netif
+ * (LWIP_CHECKSUM_CTRL_PER_NETIF). Frames failing the hardware check are
+ * dropped here. The MAC does not check the payload of IP fragments and the
+ * RX descriptor cannot tell those apart, so lwIP still verifies TCP and UDP
+ * after reassembly. ICMPv6 stays in software, emac_csum switches it all off.
+ */
+#define EMAC_CSUM_NETIF_FLAGS (NETIF_CHECKSUM_CHECK_TCP | NETIF_CHECKSUM_CHECK_UDP | \
+                               NETIF_CHECKSUM_GEN_ICMP6 | NETIF_CHECKSUM_CHECK_ICMP6)
+
+/*
+ * Frames are sent straight out of their pbufs, one descriptor per segment.
+ * tx_sem counts free descriptors: the eth thread blocks on it when the ring
+ * is full and the TX-complete interrupt gives completed descriptors back.
+ * The pbufs themselves are freed by the eth thread on its next frame, not
+ * in the interrupt. Longer chains than EMAC_TX_SEG_MAX are copied into one
+ * pool buffer first, so are plain PBUF_REF segments: like etharp's queue,
+ * only PBUF_ROM and pbufs owning their memory are trusted to stay unchanged
+ * until the frame is freed.
+ */
+#define EMAC_TX_SEG_MAX      8
+#define EMAC_TX_TIMEOUT      (RT_TICK_PER_SECOND / 10)
+
+/*
+ * Receive buffers come from the packet buffer pool (drv_pktbuf.c) and are
+ * loaned to lwIP instead of being copied: the ring always holds one buffer
+ * per descriptor, a filled one is swapped for a free one and goes back to
+ * the pool when lwIP frees the pbuf. The last EMAC_RX_LOW_WATER free buffers
+ * are kept for transmit copies, below that received frames are dropped.
+ */
+#define EMAC_RX_LOW_WATER    8
+
+/*
+ * Receive runs NAPI style: the RX interrupt is masked and the eth thread
+ * polls the ring, at most rx_poll.budget frames per wakeup (completed TX
+ * descriptors count against it too) before it requeues itself. The MAC has
+ * no RX interrupt watchdog, so coalescing is done in software: above
+ * EMAC_POLL_ENTER_PPS frames per second the interrupt stays masked and a
+ * timer polls every EMAC_POLL_PERIOD ticks, below EMAC_POLL_EXIT_PPS each
+ * frame interrupts again.
+ */
+#define EMAC_RX_BUDGET       32
+#define EMAC_POLL_PERIOD     1
+#define EMAC_POLL_ENTER_PPS  10000
+#define EMAC_POLL_EXIT_PPS   3000
+#define EMAC_RATE_WINDOW     (RT_TICK_PER_SECOND / 10)
+
 typedef struct emac_device
 {
     rt_uint32_t base_addr;
     rt_uint32_t irq_num;
     volatile rt_bool_t  tx_completed;
     volatile rt_bool_t  rx_completed;
+    volatile rt_bool_t  link_up;        /* MAC programmed for the negotiated speed, TX DMA running */
     struct eth_device device;
 } *emac_dev_t;
 
@@ -31,22 +148,229 @@ typedef struct dma_desc
 struct tx_ring_desc_mgr
 {
     dma_desc_t *tx_desc_pool;
+    struct pbuf *tx_pbuf[EMAC_DMA_TX_DESC_NUM];   /* On a frame's last descriptor */
+    struct rt_semaphore tx_sem;
+    struct rt_mutex tx_lock;    /* Transmit, the pbuf clean and a drain on link loss */
     rt_uint16_t current_proc_index;
+    rt_uint16_t dirty_index;    /* Oldest descriptor the DMA may still own */
+    rt_uint16_t clean_index;    /* Oldest completed descriptor whose pbuf is held */
+    rt_uint16_t busy;           /* Handed to the DMA, not completed yet */
+    rt_uint16_t done;           /* Completed, pbuf not freed yet */
 };
 
 struct rx_ring_desc_mgr
 {
     dma_desc_t *rx_desc_pool;
+    struct pktbuf *rx_buf[EMAC_DMA_RX_DESC_NUM];
     rt_uint16_t current_proc_index;
+    volatile rt_bool_t rearm;   /* Link came up, the eth thread restarts the ring */
+};
+
+struct tx_stats
+{
+    rt_uint32_t mapped;         /* Frames sent from their own pbufs */
+    rt_uint32_t linearized;     /* Long or PBUF_REF chains, copied into a pool buffer */
+    rt_uint32_t stalled;        /* Ring still full after EMAC_TX_TIMEOUT */
+    rt_uint32_t nolink;         /* Frames offered while the link was down */
+    rt_uint32_t drained;        /* Descriptors taken back from the DMA on link loss */
+};
+
+enum phy_state
+{
+    PHY_DOWN = 0,
+    PHY_AN,                     /* Link seen, waiting for autonegotiation */
+    PHY_UP,
+};
+
+struct phy_ctl
+{
+    enum phy_state state;
+    rt_uint32_t speed;          /* Mbps */
+    rt_bool_t full_duplex;
+    rt_tick_t since;            /* Entered PHY_AN */
+    rt_tick_t interval;
+    rt_uint32_t ups;
+    rt_uint32_t downs;
+    rt_uint32_t an_restarts;
+};
+
+struct ring_stats
+{
+    rt_uint32_t frames;
+    rt_uint32_t bytes;
+    rt_uint32_t full;           /* RX: frame found no descriptor (RX_BUF_UA), TX: waited on tx_sem */
+    rt_uint32_t nomem;          /* No pool buffer for the frame */
+    rt_uint32_t oversize;       /* TX over TX_BUF_SIZE, RX spread over several descriptors */
+    rt_uint32_t hwm;            /* Most descriptors in use at once */
+};
+
+struct int_err_count
+{
+    rt_uint32_t bit;
+    const char *name;
+    rt_uint32_t count;
+};
+
+struct rx_lat_stats
+{
+    rt_uint32_t stamp;          /* Timer at the last RX interrupt, 0 once taken */
+    rt_uint32_t max_us;
+    rt_uint32_t hist[EMAC_LAT_BUCKETS];
+};
+
+struct csum_stats
+{
+    rt_uint32_t tx_offload;     /* Frames sent with checksum insertion */
+    rt_uint32_t rx_checked;     /* Frames passed by the hardware check */
+    rt_uint32_t rx_hdr_err;     /* IPv4 header checksum failures, dropped */
+    rt_uint32_t rx_payload_err; /* TCP/UDP/ICMP checksum failures, dropped */
+};
+
+struct rx_poll_ctl
+{
+    rt_uint32_t budget;
+    rt_uint32_t enter_pps;
+    rt_uint32_t exit_pps;
+    rt_uint32_t pps;            /* Rate over the last EMAC_RATE_WINDOW */
+    rt_uint32_t window_frames;
+    rt_tick_t window_start;
+    rt_bool_t poll_mode;        /* Timer driven, RX interrupt masked */
+    struct rt_timer timer;
+};
+
+struct rx_poll_stats
+{
+    rt_uint32_t irqs;           /* RX interrupts taken */
+    rt_uint32_t polls;          /* Wakeups of the eth thread that drained or spent the budget */
+    rt_uint32_t exhausted;      /* Polls that hit the budget and requeued */
+    rt_uint32_t timer_polls;    /* Wakeups from the poll timer */
+    rt_uint32_t to_poll;        /* Switches into timer polling */
+    rt_uint32_t to_irq;         /* Switches back to interrupts */
 };
 
 static rt_uint32_t rx_count = 0;
+static struct rx_poll_ctl rx_poll =
+{
+    .budget    = EMAC_RX_BUDGET,
+    .enter_pps = EMAC_POLL_ENTER_PPS,
+    .exit_pps  = EMAC_POLL_EXIT_PPS,
+};
+static struct rx_poll_stats rx_poll_stats = {0};
+static rt_bool_t csum_offload = RT_TRUE;
+static struct csum_stats csum_stats = {0};
 static struct rx_ring_desc_mgr rx_ring = {0};
 static struct tx_ring_desc_mgr tx_ring = {0};
-static rt_uint8_t tx_buffer[EMAC_DMA_TX_DESC_NUM][TX_BUF_SIZE] __attribute__((aligned(32))) = {0};
-static rt_uint8_t rx_buffer[EMAC_DMA_RX_DESC_NUM][RX_BUF_SIZE] __attribute__((aligned(32))) = {0};
+static struct tx_stats tx_stats = {0};
+static struct phy_ctl phy = {0};
+static struct ring_stats rx_ring_stats = {0};
+static struct ring_stats tx_ring_stats = {0};
+static struct rx_lat_stats rx_lat = {0};
+static struct int_err_count int_err[] =
+{
+    {EMAC_INT_TX_STOP,     "tx dma stopped",   0},
+    {EMAC_INT_TX_TIMEOUT,  "tx timeout",       0},
+    {EMAC_INT_TX_UNDERRUN, "tx underflow",     0},
+    {EMAC_INT_RX_BUF_UA,   "rx no descriptor", 0},
+    {EMAC_INT_RX_STOP,     "rx dma stopped",   0},
+    {EMAC_INT_RX_TIMEOUT,  "rx timeout",       0},
+    {EMAC_INT_RX_OVERFLOW, "rx fifo overflow", 0},
+};
 static rt_uint8_t mac_addr[6] = {0x5a, 0x02, 0x03, 0x04, 0x05, 0x06};
 
+static rt_uint32_t emac_timer(void)
+{
+    rt_uint32_t lo, hi;
+
+    asm volatile("mrrc p15, 0, %0, %1, c14" : "=r"(lo), "=r"(hi) : : "memory");
+
+    return lo;
+}
+
+/* Error events latch in INT_STA whether enabled or not, the IRQ and every poll count them */
+static void emac_int_err(rt_uint32_t status)
+{
+    int i = 0;
+
+    for (i = 0; i < sizeof(int_err) / sizeof(int_err[0]); i++)
+    {
+        if (status & int_err[i].bit)
+        {
+            int_err[i].count++;
+        }
+    }
+
+    if (status & EMAC_INT_RX_BUF_UA)
+    {
+        rx_ring_stats.full++;
+    }
+}
+
+static void emac_int_enable(emac_dev_t dev, rt_uint32_t bits, rt_bool_t en)
+{
+    rt_base_t level = 0;
+    rt_uint32_t reg_val = 0;
+
+    level = rt_hw_interrupt_disable();
+    reg_val = readl(dev->base_addr + REG_EMAC_INT_EN);
+    if (en == RT_TRUE)
+    {
+        reg_val |= bits;
+    }
+    else
+    {
+        reg_val &= ~bits;
+    }
+    writel(reg_val, dev->base_addr + REG_EMAC_INT_EN);
+    rt_hw_interrupt_enable(level);
+}
+
+/* Give descriptors the DMA has finished with back to tx_sem, from the IRQ or the eth thread */
+static rt_uint32_t emac_tx_reclaim(void)
+{
+    rt_base_t level = 0;
+    rt_uint32_t count = 0;
+
+    level = rt_hw_interrupt_disable();
+    while (tx_ring.busy > 0 && !(tx_ring.tx_desc_pool[tx_ring.dirty_index].desc0 & (1 << 31)))
+    {
+        tx_ring.dirty_index = (tx_ring.dirty_index + 1) % EMAC_DMA_TX_DESC_NUM;
+        tx_ring.busy--;
+        tx_ring.done++;
+        rt_sem_release(&tx_ring.tx_sem);
+        count++;
+    }
+    rt_hw_interrupt_enable(level);
+
+    return count;
+}
+
+/* Drop the references on completed frames, tx_lock held: etx, erx and the phy thread all get here */
+static void emac_tx_clean(void)
+{
+    rt_base_t level = 0;
+    rt_uint16_t done = 0;
+    struct pbuf *p = RT_NULL;
+
+    level = rt_hw_interrupt_disable();
+    done = tx_ring.done;
+    rt_hw_interrupt_enable(level);
+
+    while (done-- > 0)
+    {
+        p = tx_ring.tx_pbuf[tx_ring.clean_index];
+        if (p != RT_NULL)
+        {
+            tx_ring.tx_pbuf[tx_ring.clean_index] = RT_NULL;
+            pbuf_free(p);
+        }
+        tx_ring.clean_index = (tx_ring.clean_index + 1) % EMAC_DMA_TX_DESC_NUM;
+
+        level = rt_hw_interrupt_disable();
+        tx_ring.done--;
+        rt_hw_interrupt_enable(level);
+    }
+}
+
 static void emac_irq_handle(int vector, void *param)
 {
     rt_uint32_t status = 0;
@@ -54,16 +378,27 @@ static void emac_irq_handle(int vector, void *param)
 
     rt_interrupt_enter();
 
-    rt_hw_interrupt_mask(dev->irq_num);
-    writel(0x00, dev->base_addr + REG_EMAC_INT_EN);
     /* clear interrupt status */
     status = readl(dev->base_addr + REG_EMAC_INT_STA);
     writel(status, dev->base_addr + REG_EMAC_INT_STA);
 
-    rx_count = 0;
+    emac_int_err(status & (EMAC_INT_TX_ERR | EMAC_INT_RX_ERR));
 
-    if (status & (1 << 13))
+    if (status & EMAC_INT_TX)
     {
+        /* The eth thread drops the pbuf references, lwIP does not retransmit a segment still held */
+        if (emac_tx_reclaim() > 0)
+        {
+            eth_device_ready(&dev->device);
+        }
+    }
+
+    if (status & EMAC_INT_RX)
+    {
+        /* Receive runs in the eth thread until the ring is drained, TX completions keep coming */
+        emac_int_enable(dev, EMAC_INT_RX, RT_FALSE);
+        rx_poll_stats.irqs++;
+        rx_lat.stamp = emac_timer() | 1;
         eth_device_ready(&dev->device);
     }
 
@@ -76,12 +411,19 @@ static rt_err_t emac_dma_tx_desc_init(void)
     rt_err_t ret = RT_EOK;
 
     tx_ring.current_proc_index = 0;
+    tx_ring.dirty_index = 0;
+    tx_ring.clean_index = 0;
+    tx_ring.busy = 0;
+    tx_ring.done = 0;
+    rt_sem_init(&tx_ring.tx_sem, "etx", EMAC_DMA_TX_DESC_NUM, RT_IPC_FLAG_FIFO);
+    rt_mutex_init(&tx_ring.tx_lock, "etxl", RT_IPC_FLAG_PRIO);
 
     for (i = 0; i < EMAC_DMA_TX_DESC_NUM; i++)
     {
+        tx_ring.tx_pbuf[i] = RT_NULL;
         tx_ring.tx_desc_pool[i].desc0 = 0;
         tx_ring.tx_desc_pool[i].desc1 = 0;
-        tx_ring.tx_desc_pool[i].desc2 = (rt_uint32_t)&tx_buffer[i][0];
+        tx_ring.tx_desc_pool[i].desc2 = 0;
         if ((i + 1) < EMAC_DMA_TX_DESC_NUM)
         {
             tx_ring.tx_desc_pool[i].desc3 = (rt_uint32_t)&tx_ring.tx_desc_pool[i + 1];
@@ -95,6 +437,18 @@ static rt_err_t emac_dma_tx_desc_init(void)
     return ret;
 }
 
+static void emac_rx_arm(dma_desc_t *rx_p, struct pktbuf *buf)
+{
+    /* lwIP may have written into the buffer, no dirty line may land on the next frame */
+    rt_hw_cpu_dcache_ops(RT_HW_CACHE_INVALIDATE, (void *)buf->data, RX_BUF_SIZE);
+
+    rx_p->desc1  = 0x80000000;
+    rx_p->desc1 |= (RX_BUF_SIZE & 0x7ff);
+    rx_p->desc2  = (rt_uint32_t)buf->data;
+    rt_hw_dsb();
+    rx_p->desc0  = 0x80000000;
+}
+
 static rt_err_t emac_dma_rx_desc_init(void)
 {
     int i = 0;
@@ -104,10 +458,6 @@ static rt_err_t emac_dma_rx_desc_init(void)
 
     for (i = 0; i < EMAC_DMA_RX_DESC_NUM; i++)
     {
-        rx_ring.rx_desc_pool[i].desc0  = 0x80000000;
-        rx_ring.rx_desc_pool[i].desc1  = 0x80000000;
-        rx_ring.rx_desc_pool[i].desc1 |= (RX_BUF_SIZE & 0x7ff);
-        rx_ring.rx_desc_pool[i].desc2 = (rt_uint32_t)&rx_buffer[i][0];
         if ((i + 1) < EMAC_DMA_RX_DESC_NUM)
         {
             rx_ring.rx_desc_pool[i].desc3 = (rt_uint32_t)&rx_ring.rx_desc_pool[i + 1];
@@ -116,6 +466,13 @@ static rt_err_t emac_dma_rx_desc_init(void)
         {
             rx_ring.rx_desc_pool[i].desc3 = (rt_uint32_t)&(rx_ring.rx_desc_pool[0]);
         }
+        rx_ring.rx_buf[i] = pktbuf_get();
+        if (rx_ring.rx_buf[i] == RT_NULL)
+        {
+            rt_kprintf("emac: %d packet buffers, rx ring needs %d\n", PKTBUF_NUM, EMAC_DMA_RX_DESC_NUM);
+            return -RT_ENOMEM;
+        }
+        emac_rx_arm(&rx_ring.rx_desc_pool[i], rx_ring.rx_buf[i]);
     }
 
     return ret;
@@ -216,53 +573,140 @@ static void emac_fill_rx_desc(emac_dev_t dev)
     dma_rx_enable(dev, RT_TRUE);
 }
 
-static rt_err_t t113_emac_tx(rt_device_t net_dev, struct pbuf *p)
+static rt_err_t emac_tx_frame(emac_dev_t dev, struct pbuf *p)
 {
-    struct emac_device *dev = rt_container_of(net_dev, struct emac_device, device);
+    rt_base_t level = 0;
     rt_uint32_t reg_val = 0;
+    rt_uint32_t seg_num = 0;
+    rt_uint32_t i = 0;
+    rt_uint16_t index = 0;
     dma_desc_t *tx_p = RT_NULL;
-    rt_uint8_t *tx_buf = RT_NULL;
-    rt_uint32_t offset = 0;
-    rt_uint32_t time_out = 100;
+    struct pbuf *frame = RT_NULL;
     struct pbuf *q = RT_NULL;
+    rt_bool_t transient = RT_FALSE;
 
     if (p->tot_len > TX_BUF_SIZE)
     {
-        rt_kprintf("eth tx len > TX_BUF_SIZE, %d\n", p->tot_len);
+        tx_ring_stats.oversize++;
         return -RT_ERROR;
     }
 
-    tx_p = &tx_ring.tx_desc_pool[tx_ring.current_proc_index];
-    reg_val = readl(dev->base_addr + REG_EMAC_TX_DMA_STA);
-    while((tx_p->desc0 & (1 << 31)) || (reg_val != 0x00 && reg_val != 0x06))
+    for (q = p; q != RT_NULL; q = q->next)
     {
-        if (time_out > 0)
+        if (q->len > 0)
         {
-            rt_hw_us_delay(1);
-            reg_val = readl(dev->base_addr + REG_EMAC_TX_DMA_STA);
-            time_out--;
+            seg_num++;
         }
-        else
+        /* Plain PBUF_REF points at caller memory (UDP sendto) reused once we return, ROM stays put */
+        if (q->type == PBUF_REF && !(q->flags & PBUF_FLAG_IS_CUSTOM))
+        {
+            transient = RT_TRUE;
+        }
+    }
+
+    /* The frame is held until its descriptors complete, lwIP may free its own reference right after */
+    if (seg_num > EMAC_TX_SEG_MAX || transient == RT_TRUE)
+    {
+        frame = pktbuf_alloc(p->tot_len);
+        if (frame == RT_NULL)
+        {
+            tx_ring_stats.nomem++;
+            return -RT_ENOMEM;
+        }
+        pbuf_copy(frame, p);
+        seg_num = 1;
+        tx_stats.linearized++;
+    }
+    else
+    {
+        frame = p;
+        pbuf_ref(frame);
+        tx_stats.mapped++;
+    }
+
+    /* Pick up completions whose interrupt is still pending, then wait for room */
+    emac_tx_reclaim();
+    for (i = 0; i < seg_num; i++)
+    {
+        if (rt_sem_take(&tx_ring.tx_sem, RT_WAITING_NO) == RT_EOK)
+        {
+            continue;
+        }
+
+        tx_ring_stats.full++;
+        if (rt_sem_take(&tx_ring.tx_sem, EMAC_TX_TIMEOUT) != RT_EOK)
         {
-            rt_kprintf("tx desc %d is busy\n", tx_ring.current_proc_index);
-            return -RT_ERROR;
+            while (i-- > 0)
+            {
+                rt_sem_release(&tx_ring.tx_sem);
+            }
+            pbuf_free(frame);
+            tx_stats.stalled++;
+            return -RT_ETIMEOUT;
         }
     }
+    emac_tx_clean();
 
-    tx_buf = &tx_buffer[tx_ring.current_proc_index][0];
+    /* Every descriptor but the first is handed over as it is filled, the first one starts the frame */
+    index = tx_ring.current_proc_index;
+    i = 0;
+    for (q = frame; q != RT_NULL; q = q->next)
+    {
+        if (q->len == 0)
+        {
+            continue;
+        }
+
+        rt_hw_cpu_dcache_ops(RT_HW_CACHE_FLUSH, q->payload, q->len);
 
-    for (q = p; q != NULL; q = q->next)
+        tx_p = &tx_ring.tx_desc_pool[index];
+        tx_p->desc1 = (q->len & 0x7FF);
+        tx_p->desc2 = (rt_uint32_t)q->payload;
+        if (i == 0)
+        {
+            tx_p->desc1 |= TX_DESC_FIRST;
+        }
+        if (csum_offload == RT_TRUE)
+        {
+            tx_p->desc1 |= TX_DESC_CSUM_FULL;
+        }
+        if (++i == seg_num)
+        {
+            /* Every frame completes with an interrupt, its reference must not outlive the send */
+            tx_p->desc1 |= TX_DESC_LAST | TX_DESC_INT;
+            tx_ring.tx_pbuf[index] = frame;
+        }
+        else
+        {
+            index = (index + 1) % EMAC_DMA_TX_DESC_NUM;
+        }
+
+        if (tx_p != &tx_ring.tx_desc_pool[tx_ring.current_proc_index])
+        {
+            tx_p->desc0 = 0x80000000; /* Set Own */
+        }
+    }
+
+    if (csum_offload == RT_TRUE)
     {
-        rt_memcpy((rt_uint8_t *)(tx_buf + offset), (rt_uint8_t *)((rt_uint8_t *)q->payload), q->len);
-        offset += q->len;
+        csum_stats.tx_offload++;
     }
 
-    rt_hw_cpu_dcache_ops(RT_HW_CACHE_FLUSH, (void *)&tx_buffer[tx_ring.current_proc_index][0], offset);
+    rt_hw_dsb();
+    tx_ring.tx_desc_pool[tx_ring.current_proc_index].desc0 = 0x80000000;
+    rt_hw_dsb();
 
-    tx_p->desc0 = 0x80000000; /* Set Own */
-    tx_p->desc1 = 0x60000000; /* Set first pkg and last pkg */
-    tx_p->desc1 |= (offset & 0x7FF);
-    tx_ring.current_proc_index = (tx_ring.current_proc_index + 1) % EMAC_DMA_TX_DESC_NUM;
+    level = rt_hw_interrupt_disable();
+    tx_ring.busy += seg_num;
+    if (tx_ring.busy + tx_ring.done > tx_ring_stats.hwm)
+    {
+        tx_ring_stats.hwm = tx_ring.busy + tx_ring.done;
+    }
+    rt_hw_interrupt_enable(level);
+    tx_ring.current_proc_index = (index + 1) % EMAC_DMA_TX_DESC_NUM;
+
+    tx_ring_stats.frames++;
+    tx_ring_stats.bytes += frame->tot_len;
 
     /* Enable transmit and Poll transmit */
     reg_val = readl(dev->base_addr + REG_EMAC_TX_CTL1);
@@ -272,44 +716,275 @@ static rt_err_t t113_emac_tx(rt_device_t net_dev, struct pbuf *p)
     return RT_EOK;
 }
 
+static rt_err_t t113_emac_tx(rt_device_t net_dev, struct pbuf *p)
+{
+    struct emac_device *dev = rt_container_of(net_dev, struct emac_device, device);
+    rt_err_t ret = RT_EOK;
+
+    rt_mutex_take(&tx_ring.tx_lock, RT_WAITING_FOREVER);
+    if (dev->link_up == RT_TRUE)
+    {
+        ret = emac_tx_frame(dev, p);
+    }
+    else
+    {
+        tx_stats.nolink++;
+        ret = -RT_ERROR;
+    }
+    rt_mutex_release(&tx_ring.tx_lock);
+
+    return ret;
+}
+
+static void emac_rx_poll_timeout(void *param)
+{
+    struct emac_device *dev = (struct emac_device *)param;
+
+    rx_poll_stats.timer_polls++;
+    eth_device_ready(&dev->device);
+}
+
+/* End of one poll: pick the mode for the measured rate and rearm the interrupt, the timer or the thread */
+static void emac_rx_poll_done(emac_dev_t dev, rt_bool_t more)
+{
+    rt_tick_t now = rt_tick_get();
+    rt_tick_t elapsed = now - rx_poll.window_start;
+
+    rx_count = 0;
+    rx_poll_stats.polls++;
+
+    if (elapsed >= EMAC_RATE_WINDOW)
+    {
+        rx_poll.pps = rx_poll.window_frames * RT_TICK_PER_SECOND / elapsed;
+        rx_poll.window_frames = 0;
+        rx_poll.window_start = now;
+
+        if (rx_poll.poll_mode == RT_FALSE && rx_poll.pps >= rx_poll.enter_pps)
+        {
+            rx_poll.poll_mode = RT_TRUE;
+            rx_poll_stats.to_poll++;
+            rt_timer_start(&rx_poll.timer);
+        }
+        else if (rx_poll.poll_mode == RT_TRUE && rx_poll.pps < rx_poll.exit_pps)
+        {
+            rx_poll.poll_mode = RT_FALSE;
+            rx_poll_stats.to_irq++;
+            rt_timer_stop(&rx_poll.timer);
+        }
+    }
+
+    if (more == RT_TRUE)
+    {
+        eth_device_ready(&dev->device);
+    }
+    else if (rx_poll.poll_mode == RT_FALSE)
+    {
+        emac_int_enable(dev, EMAC_INT_RX, RT_TRUE);
+    }
+}
+
+/* Start of a poll: latency since the interrupt, ring occupancy and latched error events */
+static void emac_rx_poll_start(emac_dev_t dev)
+{
+    rt_uint32_t status = 0;
+    rt_uint32_t us = 0;
+    rt_uint32_t filled = 0;
+    rt_uint16_t index = 0;
+    int i = 0;
+
+    if (rx_lat.stamp != 0)
+    {
+        us = (emac_timer() - rx_lat.stamp) / EMAC_TIMER_MHZ;
+        rx_lat.stamp = 0;
+        if (us > rx_lat.max_us)
+        {
+            rx_lat.max_us = us;
+        }
+        for (i = 0; i < EMAC_LAT_BUCKETS - 1 && us >= (8U << i); i++);
+        rx_lat.hist[i]++;
+    }
+
+    index = rx_ring.current_proc_index;
+    while (filled < EMAC_DMA_RX_DESC_NUM && !(rx_ring.rx_desc_pool[index].desc0 & (1 << 31)))
+    {
+        filled++;
+        index = (index + 1) % EMAC_DMA_RX_DESC_NUM;
+    }
+    if (filled > rx_ring_stats.hwm)
+    {
+        rx_ring_stats.hwm = filled;
+    }
+
+    status = readl(dev->base_addr + REG_EMAC_INT_STA) & (EMAC_INT_TX_ERR | EMAC_INT_RX_ERR);
+    if (status != 0)
+    {
+        writel(status, dev->base_addr + REG_EMAC_INT_STA);
+        emac_int_err(status);
+    }
+}
+
+/* Eth thread, the only one walking the ring: drop what arrived around the link change and restart at the top */
+static void emac_rx_rearm(emac_dev_t dev)
+{
+    rt_uint32_t reg_val = 0;
+    int i = 0;
+
+    rx_ring.rearm = RT_FALSE;
+
+    dma_rx_enable(dev, RT_FALSE);
+    for (i = 0; i < EMAC_DMA_RX_DESC_NUM; i++)
+    {
+        emac_rx_arm(&rx_ring.rx_desc_pool[i], rx_ring.rx_buf[i]);
+    }
+    rx_ring.current_proc_index = 0;
+    emac_fill_rx_desc(dev);
+
+    /* Receive may have stopped on a full ring while the link was away */
+    reg_val = readl(dev->base_addr + REG_EMAC_RX_CTL1);
+    reg_val |= 0xC0000000;
+    writel(reg_val, dev->base_addr + REG_EMAC_RX_CTL1);
+}
+
+/* Drop the frame in the current descriptor and give the buffer straight back to the DMA */
+static void emac_rx_skip(dma_desc_t *rx_p, struct pktbuf *buf)
+{
+    emac_rx_arm(rx_p, buf);
+    rx_ring.current_proc_index = (rx_ring.current_proc_index + 1) % EMAC_DMA_RX_DESC_NUM;
+}
+
 static struct pbuf *t113_emac_rx(rt_device_t net_dev)
 {
     struct emac_device *dev = rt_container_of(net_dev, struct emac_device, device);
     struct pbuf *rx_puf = RT_NULL;
+    struct pktbuf *buf = RT_NULL;
+    struct pktbuf *spare = RT_NULL;
     rt_uint32_t len = 0;
     rt_uint32_t over_flag = 0;
     dma_desc_t *rx_p = RT_NULL;
 
-    rx_p = &rx_ring.rx_desc_pool[rx_ring.current_proc_index];
-    if (rx_p->desc0 & (1 << 31))
+    if (rx_ring.rearm == RT_TRUE)
     {
-        over_flag = 1;
-        goto exit;
+        emac_rx_rearm(dev);
     }
 
-    len = ((rx_p->desc0 >> 16) & 0x3fff);
-    rx_puf = pbuf_alloc(PBUF_RAW, len, PBUF_POOL);
-    if (rx_puf != RT_NULL)
+    if (rx_count == 0)
     {
-        rx_p->desc0 = 0x80000000;
-        rt_hw_cpu_dcache_ops(RT_HW_CACHE_INVALIDATE, (void *)&rx_buffer[rx_ring.current_proc_index][0], len);
-        rt_memcpy(rx_puf->payload, &rx_buffer[rx_ring.current_proc_index][0], len);
-        rx_ring.current_proc_index = (rx_ring.current_proc_index + 1) % EMAC_DMA_RX_DESC_NUM;
+        emac_rx_poll_start(dev);
+        rx_count += emac_tx_reclaim();
+        /* A transmit holding the lock cleans once it has room, never wait on it here */
+        if (rt_mutex_take(&tx_ring.tx_lock, RT_WAITING_NO) == RT_EOK)
+        {
+            emac_tx_clean();
+            rt_mutex_release(&tx_ring.tx_lock);
+        }
     }
 
-    rx_count++;
+    if (rx_count >= rx_poll.budget)
+    {
+        /* Budget spent: hand the thread back to lwIP, the rest comes on the next wakeup */
+        rx_poll_stats.exhausted++;
+        emac_rx_poll_done(dev, RT_TRUE);
+        return RT_NULL;
+    }
+
+    while (rx_puf == RT_NULL)
+    {
+        rx_p = &rx_ring.rx_desc_pool[rx_ring.current_proc_index];
+        if (rx_p->desc0 & (1 << 31))
+        {
+            over_flag = 1;
+            goto exit;
+        }
+
+        len = ((rx_p->desc0 >> 16) & 0x3fff);
+        buf = rx_ring.rx_buf[rx_ring.current_proc_index];
+
+        if ((rx_p->desc0 & (RX_DESC_FIRST | RX_DESC_LAST)) != (RX_DESC_FIRST | RX_DESC_LAST))
+        {
+            rx_ring_stats.oversize++;
+            emac_rx_skip(rx_p, buf);
+            continue;
+        }
+
+        if (csum_offload == RT_TRUE)
+        {
+            if (rx_p->desc0 & (RX_DESC_HDR_ERR | RX_DESC_PAYLOAD_ERR))
+            {
+                if (rx_p->desc0 & RX_DESC_HDR_ERR)
+                {
+                    csum_stats.rx_hdr_err++;
+                }
+                else
+                {
+                    csum_stats.rx_payload_err++;
+                }
+                emac_rx_skip(rx_p, buf);
+                continue;
+            }
+            csum_stats.rx_checked++;
+        }
+
+        rt_hw_cpu_dcache_ops(RT_HW_CACHE_INVALIDATE, (void *)buf->data, len);
+
+        spare = RT_NULL;
+        if (pktbuf_free_num() > EMAC_RX_LOW_WATER)
+        {
+            spare = pktbuf_get();
+        }
+
+        if (spare == RT_NULL)
+        {
+            rx_ring_stats.nomem++;
+            emac_rx_skip(rx_p, buf);
+            continue;
+        }
+
+        rx_puf = pktbuf_loan(buf, len);
+        rx_ring.rx_buf[rx_ring.current_proc_index] = spare;
+        emac_rx_arm(rx_p, spare);
+        rx_ring.current_proc_index = (rx_ring.current_proc_index + 1) % EMAC_DMA_RX_DESC_NUM;
+
+        rx_ring_stats.frames++;
+        rx_ring_stats.bytes += len;
+
+        rx_count++;
+        rx_poll.window_frames++;
+    }
 
 exit:
-    if ((rx_count > EMAC_RX_FRAME_MAX) || (over_flag == 1))
+    if (over_flag == 1)
     {
-        rx_count = 0;
-        writel((0x1 << 13), dev->base_addr + REG_EMAC_INT_EN);
-        rt_hw_interrupt_umask(dev->irq_num);
+        emac_rx_poll_done(dev, RT_FALSE);
     }
 
     return rx_puf;
 }
 
+static void emac_get_stats(struct eth_device_stats *st)
+{
+    int i = 0;
+
+    st->rx_frames  = rx_ring_stats.frames;
+    st->rx_bytes   = rx_ring_stats.bytes;
+    st->rx_dropped = rx_ring_stats.nomem + rx_ring_stats.oversize + csum_stats.rx_hdr_err + csum_stats.rx_payload_err;
+    st->tx_frames  = tx_ring_stats.frames;
+    st->tx_bytes   = tx_ring_stats.bytes;
+    st->tx_dropped = tx_ring_stats.nomem + tx_ring_stats.oversize + tx_stats.stalled;
+    st->rx_errors  = 0;
+    st->tx_errors  = 0;
+    for (i = 0; i < sizeof(int_err) / sizeof(int_err[0]); i++)
+    {
+        if (int_err[i].bit & EMAC_INT_RX_ERR)
+        {
+            st->rx_errors += int_err[i].count;
+        }
+        else
+        {
+            st->tx_errors += int_err[i].count;
+        }
+    }
+}
+
 static rt_err_t t113_emac_control(rt_device_t net_dev, int cmd, void *args)
 {
     struct emac_device *dev = rt_container_of(net_dev, struct emac_device, device);
@@ -327,6 +1002,17 @@ static rt_err_t t113_emac_control(rt_device_t net_dev, int cmd, void *args)
         }
         break;
 
+    case NIOCTL_GSTATS:
+        if (args)
+        {
+            emac_get_stats((struct eth_device_stats *)args);
+        }
+        else
+        {
+            return (-RT_ERROR);
+        }
+        break;
+
     default:
         break;
     }
@@ -334,37 +1020,88 @@ static rt_err_t t113_emac_control(rt_device_t net_dev, int cmd, void *args)
     return RT_EOK;
 }
 
-static void emac_phy_init(emac_dev_t dev)
+/* Reset the PHY, set its RGMII delays and start autonegotiation, sleeping instead of spinning */
+static rt_err_t emac_phy_setup(emac_dev_t dev)
 {
     int i = 0;
-    rt_uint32_t reg_val = 0;
     rt_uint16_t phy_val = 0;
-    rt_uint8_t phy_addr = 0;
-
-    /* reset phy */
-    phy_val = emac_phy_read(dev, phy_addr, 0x00);
-    emac_phy_write(dev, phy_addr, 0x00, phy_val | 0x8000);
-    while (emac_phy_read(dev, phy_addr, 0x00) & 0x8000);
-
-    phy_val = emac_phy_read(dev, phy_addr, 0x00);
-    emac_phy_write(dev, phy_addr, 0x00, (phy_val & ~(0x0800)));
-    while (emac_phy_read(dev, phy_addr, 0x00) & (0x0800));
 
-    /* Wait Auto negotiation success */
-    while (!(emac_phy_read(dev, phy_addr, 0x01) & 0x0020))
+    phy_val = emac_phy_read(dev, PHY_ADDR, MII_BMCR);
+    emac_phy_write(dev, PHY_ADDR, MII_BMCR, phy_val | BMCR_RESET);
+    while (emac_phy_read(dev, PHY_ADDR, MII_BMCR) & BMCR_RESET)
     {
-        if (i > 4)
+        if (++i > PHY_RESET_TIMEOUT)
         {
-            rt_kprintf("Warning: Auto negotiation timeout!\n");
+            rt_kprintf("emac: phy reset timeout\n");
+            return -RT_ETIMEOUT;
         }
-        rt_hw_us_delay(500*1000);
-        i++;
+        rt_thread_mdelay(1);
     }
 
-    phy_val = emac_phy_read(dev, phy_addr, 0x00);
+    /* Read rgmii cfg1 */
+    emac_phy_write(dev, PHY_ADDR, 0x1E, 0xA003);
+    phy_val = emac_phy_read(dev, PHY_ADDR, 0x1F);
+
+    phy_val &= ~(0xf << 0);
+    phy_val |= (0x03 << 0);
+
+    phy_val &= ~(0xf << 10);
+    phy_val |= (0 << 10);
+
+    /* Config phy tx/rx delay */
+    emac_phy_write(dev, PHY_ADDR, 0x1E, 0xA003);
+    emac_phy_write(dev, PHY_ADDR, 0x1F, phy_val);
+
+    phy_val = emac_phy_read(dev, PHY_ADDR, MII_BMCR);
+    phy_val &= ~BMCR_PDOWN;
+    phy_val |= BMCR_ANENABLE | BMCR_ANRESTART;
+    emac_phy_write(dev, PHY_ADDR, MII_BMCR, phy_val);
+
+    return RT_EOK;
+}
+
+/* Speed and duplex both ends agreed on, or what BMCR forces without autonegotiation */
+static void emac_phy_resolve(emac_dev_t dev, rt_uint32_t *speed, rt_bool_t *full_duplex)
+{
+    rt_uint16_t bmcr = 0;
+    rt_uint16_t common = 0;
+
+    bmcr = emac_phy_read(dev, PHY_ADDR, MII_BMCR);
+    if (!(bmcr & BMCR_ANENABLE))
+    {
+        *speed = (bmcr & BMCR_SPEED1000) ? 1000 : ((bmcr & BMCR_SPEED100) ? 100 : 10);
+        *full_duplex = (bmcr & BMCR_FULLDPLX) ? RT_TRUE : RT_FALSE;
+        return;
+    }
+
+    /* 1000BASE-T: our CTRL1000 bits 9/8 line up with the partner's STAT1000 bits 11/10 */
+    common = emac_phy_read(dev, PHY_ADDR, MII_CTRL1000) & (emac_phy_read(dev, PHY_ADDR, MII_STAT1000) >> 2);
+    if (common & 0x0300)
+    {
+        *speed = 1000;
+        *full_duplex = (common & 0x0200) ? RT_TRUE : RT_FALSE;
+        return;
+    }
+
+    common = emac_phy_read(dev, PHY_ADDR, MII_ADVERTISE) & emac_phy_read(dev, PHY_ADDR, MII_LPA);
+    if (common & 0x0180)
+    {
+        *speed = 100;
+        *full_duplex = (common & 0x0100) ? RT_TRUE : RT_FALSE;
+    }
+    else
+    {
+        *speed = 10;
+        *full_duplex = (common & 0x0040) ? RT_TRUE : RT_FALSE;
+    }
+}
+
+static void emac_set_speed(emac_dev_t dev, rt_uint32_t speed, rt_bool_t full_duplex)
+{
+    rt_uint32_t reg_val = 0;
 
     reg_val = readl(dev->base_addr + REG_EMAC_BASIC_CTL0);
-    if (phy_val & 0x0100)
+    if (full_duplex == RT_TRUE)
     {
         reg_val |= 0x01;
     }
@@ -373,55 +1110,160 @@ static void emac_phy_init(emac_dev_t dev)
         reg_val &= ~0x01;
     }
 
-    /* Default is 1000Mbps */
+    /* 00: 1000Mbps, 10: 10Mbps, 11: 100Mbps */
     reg_val &= ~0x0c;
-    if (phy_val & 0x2000)
+    if (speed == 100)
     {
         reg_val |= 0x0c;
     }
-    else if (!(phy_val & 0x0040))
+    else if (speed == 10)
     {
         reg_val |= 0x08;
     }
     writel(reg_val, dev->base_addr + REG_EMAC_BASIC_CTL0);
+}
 
-#if 0
-    /* just for debug loopback */
-    phy_val = emac_phy_read(dev, phy_addr, 0x00);
-    phy_val |= 0x4000;
-    emac_phy_write(dev, phy_addr, 0x00, phy_val);
-    phy_val = emac_phy_read(dev, phy_addr, 0x00);
-    rt_kprintf("REG0: %08x\n", phy_val);
+/* Link lost: stop the TX DMA and take every descriptor back, the frames still queued are dropped */
+static void emac_tx_drain(emac_dev_t dev)
+{
+    int i = 0;
+    rt_base_t level = 0;
+    rt_uint16_t busy = 0;
 
-    /* MAC layer Loopback */
-    reg_val = readl(dev->base_addr + REG_EMAC_BASIC_CTL0);
-    reg_val |= 0x02;
-    writel(reg_val, dev->base_addr + REG_EMAC_BASIC_CTL0);
-#endif
+    rt_mutex_take(&tx_ring.tx_lock, RT_WAITING_FOREVER);
 
-    /* Read rgmii cfg1 */
-    emac_phy_write(dev, phy_addr, 0x1E, 0xA003);
-    rt_hw_us_delay(100 * 1000);
-    phy_val = emac_phy_read(dev, phy_addr, 0x1F);
-    rt_hw_us_delay(100 * 1000);
+    dma_tx_enable(dev, RT_FALSE);
+    /* The DMA stops at a frame boundary, give the one on the wire time to finish */
+    for (i = 0; i < 10 && (readl(dev->base_addr + REG_EMAC_TX_DMA_STA) & 0x07) != 0; i++)
+    {
+        rt_thread_mdelay(1);
+    }
 
-    phy_val &= ~(0xf << 0);
-    phy_val |= (0x03 << 0);
+    level = rt_hw_interrupt_disable();
+    busy = tx_ring.busy;
+    while (tx_ring.busy > 0)
+    {
+        tx_ring.tx_desc_pool[tx_ring.dirty_index].desc0 = 0;
+        tx_ring.dirty_index = (tx_ring.dirty_index + 1) % EMAC_DMA_TX_DESC_NUM;
+        tx_ring.busy--;
+        tx_ring.done++;
+        rt_sem_release(&tx_ring.tx_sem);
+    }
+    rt_hw_interrupt_enable(level);
 
-    phy_val &= ~(0xf << 10);
-    phy_val |= (0 << 10);
+    emac_tx_clean();
+    tx_stats.drained += busy;
 
-    /* Config phy tx/rx delay */
-    emac_phy_write(dev, phy_addr, 0x1E, 0xA003);
-    rt_hw_us_delay(100 * 1000);
-    emac_phy_write(dev, phy_addr, 0x1F, phy_val);
+    /* Everything is free again, restart at the top of the ring */
+    tx_ring.current_proc_index = 0;
+    tx_ring.dirty_index = 0;
+    tx_ring.clean_index = 0;
+    writel((rt_uint32_t)&tx_ring.tx_desc_pool[0], dev->base_addr + REG_EMAC_TX_DMA_DESC_LIST);
+
+    rt_mutex_release(&tx_ring.tx_lock);
+}
+
+static void emac_link_up(emac_dev_t dev, rt_uint32_t speed, rt_bool_t full_duplex)
+{
+    emac_set_speed(dev, speed, full_duplex);
+
+    dma_tx_enable(dev, RT_TRUE);
+
+    /* The RX ring belongs to the eth thread, it resets and restarts it on this wakeup */
+    rx_ring.rearm = RT_TRUE;
+    eth_device_ready(&dev->device);
+
+    dev->link_up = RT_TRUE;
+    eth_device_linkchange(&dev->device, RT_TRUE);
+
+    rt_kprintf("[%s]: Link is UP, %dMbps %s duplex\n", dev->device.parent.parent.name,
+                speed, (full_duplex == RT_TRUE) ? "full" : "half");
+}
+
+static void emac_link_down(emac_dev_t dev)
+{
+    dev->link_up = RT_FALSE;
+    eth_device_linkchange(&dev->device, RT_FALSE);
+    emac_tx_drain(dev);
+    dma_rx_enable(dev, RT_FALSE);
 
-    phy_val = emac_phy_read(dev, phy_addr, 0x00);
-    rt_kprintf("emac   Speed: %dMbps, Mode: %s, Loopback: %s\n",
-                ((phy_val & 0x0040) ? 1000 :
-                ((phy_val & 0x2000) ? 100 : 10)),
-                (phy_val & 0x0100)  ? "Full duplex" : "Half duplex",
-                (phy_val & 0x4000)  ? "YES" : "NO");
+    rt_kprintf("[%s]: Link is Down\n", dev->device.parent.parent.name);
+}
+
+/* One poll of the PHY state machine, RT_TRUE when the state changed */
+static rt_bool_t emac_phy_poll(emac_dev_t dev)
+{
+    rt_uint16_t bmsr = 0;
+    enum phy_state old = phy.state;
+
+    /* Link status latches low, a flap between two polls still reads as down once */
+    bmsr = emac_phy_read(dev, PHY_ADDR, MII_BMSR);
+
+    switch (phy.state)
+    {
+    case PHY_DOWN:
+        if (bmsr & BMSR_LSTATUS)
+        {
+            phy.state = PHY_AN;
+            phy.since = rt_tick_get();
+        }
+        break;
+
+    case PHY_AN:
+        if (!(bmsr & BMSR_LSTATUS))
+        {
+            phy.state = PHY_DOWN;
+        }
+        else if ((bmsr & BMSR_ANEGCOMPLETE) || !(emac_phy_read(dev, PHY_ADDR, MII_BMCR) & BMCR_ANENABLE))
+        {
+            emac_phy_resolve(dev, &phy.speed, &phy.full_duplex);
+            emac_link_up(dev, phy.speed, phy.full_duplex);
+            phy.state = PHY_UP;
+            phy.ups++;
+        }
+        else if (rt_tick_get() - phy.since > PHY_AN_TIMEOUT)
+        {
+            rt_kprintf("Warning: Auto negotiation timeout!\n");
+            emac_phy_write(dev, PHY_ADDR, MII_BMCR, emac_phy_read(dev, PHY_ADDR, MII_BMCR) | BMCR_ANRESTART);
+            phy.since = rt_tick_get();
+            phy.an_restarts++;
+        }
+        break;
+
+    case PHY_UP:
+        if (!(bmsr & BMSR_LSTATUS))
+        {
+            emac_link_down(dev);
+            phy.state = PHY_DOWN;
+            phy.downs++;
+        }
+        break;
+    }
+
+    return (phy.state != old) ? RT_TRUE : RT_FALSE;
+}
+
+static void emac_csum_enable(emac_dev_t dev, rt_bool_t en)
+{
+    rt_uint32_t reg_val = 0;
+
+    reg_val = readl(dev->base_addr + REG_EMAC_RX_CTL0);
+    if (en == RT_TRUE)
+    {
+        reg_val |= RX_CTL0_CHECK_CSUM;
+    }
+    else
+    {
+        reg_val &= ~RX_CTL0_CHECK_CSUM;
+    }
+    writel(reg_val, dev->base_addr + REG_EMAC_RX_CTL0);
+
+    csum_offload = en;
+
+    if (dev->device.netif != RT_NULL)
+    {
+        NETIF_SET_CHECKSUM_CTRL(dev->device.netif, (en == RT_TRUE) ? EMAC_CSUM_NETIF_FLAGS : NETIF_CHECKSUM_ENABLE_ALL);
+    }
 }
 
 static struct iomux_cfg mdc  = {.port=IO_PORTG,.pin=PIN_14,.mux=IO_PERIPH_MUX4,.pull=IO_PULL_RESERVE};
@@ -445,6 +1287,7 @@ struct emac_device emac0 =
     .irq_num   = EMAC_IRQ_NUM,
     .tx_completed = RT_FALSE,
     .rx_completed = RT_FALSE,
+    .link_up      = RT_FALSE,
 };
 
 static const struct rt_device_ops emac_ops =
@@ -458,29 +1301,31 @@ static const struct rt_device_ops emac_ops =
 
 static void phy_monitor_thread_entry(void *parameter)
 {
-    int current_status = 0;
-    int old_status = 1;
     emac_dev_t dev = (emac_dev_t)parameter;
 
+    eth_device_linkchange(&dev->device, RT_FALSE);
+    /* Without a configured PHY there is no link to report, keep trying now and then */
+    while (emac_phy_setup(dev) != RT_EOK)
+    {
+        rt_kprintf("[%s]: phy setup failed, link stays down\n", dev->device.parent.parent.name);
+        rt_thread_delay(PHY_AN_TIMEOUT);
+    }
+
+    phy.state = PHY_DOWN;
+    phy.interval = PHY_POLL_FAST;
+
     while (1)
     {
-        current_status = emac_phy_read(dev, 0x00, 0x01) & (1 << 2);
-        if (current_status != old_status)
+        /* Fast while something is going on, backing off to PHY_POLL_SLOW when quiet */
+        if (emac_phy_poll(dev) == RT_TRUE || phy.state == PHY_AN)
         {
-            old_status = current_status;
-            if (current_status == 0x04)
-            {
-                rt_kprintf("[%s]: Link is UP\n", dev->device.parent.parent.name);
-                emac_phy_init(dev);
-                eth_device_linkchange(&dev->device, RT_TRUE);
-            }
-            else
-            {
-                rt_kprintf("[%s]: Link is Down\n", dev->device.parent.parent.name);
-                eth_device_linkchange(&dev->device, RT_FALSE);
-            }
+            phy.interval = PHY_POLL_FAST;
         }
-        rt_thread_delay(500);
+        else if (phy.interval < PHY_POLL_SLOW)
+        {
+            phy.interval = (phy.interval * 2 < PHY_POLL_SLOW) ? phy.interval * 2 : PHY_POLL_SLOW;
+        }
+        rt_thread_delay(phy.interval);
     }
 }
 
@@ -573,8 +1418,12 @@ static int t113_emac_init(void)
     emac_dma_rx_desc_init();
     emac_fill_rx_desc(&emac0);
 
-    /* Enable recv interrupt of dma */
-    writel((0x1 << 13), emac0.base_addr + REG_EMAC_INT_EN);
+    rx_poll.window_start = rt_tick_get();
+    rt_timer_init(&rx_poll.timer, "epoll", emac_rx_poll_timeout, &emac0,
+                  EMAC_POLL_PERIOD, RT_TIMER_FLAG_PERIODIC | RT_TIMER_FLAG_HARD_TIMER);
+
+    /* Enable recv and transmit complete interrupts of dma */
+    writel(EMAC_INT_RX | EMAC_INT_TX, emac0.base_addr + REG_EMAC_INT_EN);
 
     netif                   = &emac0.device;
     netif->parent.type      = RT_Device_Class_NetIf;
@@ -591,6 +1440,9 @@ static int t113_emac_init(void)
         return (-RT_ERROR);
     }
 
+    /* netif exists now, lwIP's software checksums can go */
+    emac_csum_enable(&emac0, csum_offload);
+
     tid = rt_thread_create("phy", phy_monitor_thread_entry, &emac0, 2048, 16, 10);
     if (tid != RT_NULL)
     {
@@ -620,6 +1472,8 @@ void dump_tx_desc(void)
     rt_kprintf("tx_status        : %p\n", readl(emac0.base_addr + REG_EMAC_TX_DMA_STA));
     rt_kprintf("tx_current desc  : %p\n", readl(emac0.base_addr + REG_EMAC_TX_CUR_DESC));
     rt_kprintf("tx_current buf   : %p\n", readl(emac0.base_addr + REG_EMAC_TX_CUR_BUF));
+    rt_kprintf("tx_desc free     : %d of %d, busy %d, done %d\n", tx_ring.tx_sem.value, EMAC_DMA_TX_DESC_NUM, tx_ring.busy, tx_ring.done);
+    rt_kprintf("tx mapped        : %d, linearized %d, stalled %d\n", tx_stats.mapped, tx_stats.linearized, tx_stats.stalled);
     // writel(readl(emac0.base_addr + REG_EMAC_INT_STA), emac0.base_addr + REG_EMAC_INT_STA);
 }
 MSH_CMD_EXPORT(dump_tx_desc, dump_tx_desc);
@@ -643,6 +1497,125 @@ void dump_rx_desc(void)
     rt_kprintf("rx_status        : %p\n", readl(emac0.base_addr + REG_EMAC_RX_DMA_STA));
     rt_kprintf("rx_current desc  : %p\n", readl(emac0.base_addr + REG_EMAC_RX_CUR_DESC));
     rt_kprintf("rx_current buf   : %p\n", readl(emac0.base_addr + REG_EMAC_RX_CUR_BUF));
+    rt_kprintf("pktbuf free      : %d of %d, rx no buffer %d\n", pktbuf_free_num(), PKTBUF_NUM, rx_ring_stats.nomem);
     // writel(readl(emac0.base_addr + REG_EMAC_INT_STA), emac0.base_addr + REG_EMAC_INT_STA);
 }
 MSH_CMD_EXPORT(dump_rx_desc, dump_rx_desc);
+
+static void emac_csum(int argc, char **argv)
+{
+    if (argc == 2 && rt_strcmp(argv[1], "on") == 0)
+    {
+        emac_csum_enable(&emac0, RT_TRUE);
+    }
+    else if (argc == 2 && rt_strcmp(argv[1], "off") == 0)
+    {
+        emac_csum_enable(&emac0, RT_FALSE);
+    }
+    else if (argc != 1)
+    {
+        rt_kprintf("Usage: emac_csum [on|off]\n");
+        return;
+    }
+
+    rt_kprintf("checksum offload : %s\n", (csum_offload == RT_TRUE) ? "on" : "off");
+    rt_kprintf("tx offloaded     : %d\n", csum_stats.tx_offload);
+    rt_kprintf("rx checked       : %d, header err %d, payload err %d\n",
+                csum_stats.rx_checked, csum_stats.rx_hdr_err, csum_stats.rx_payload_err);
+}
+MSH_CMD_EXPORT(emac_csum, show or switch emac checksum offload: emac_csum [on|off]);
+
+static void emac_poll(int argc, char **argv)
+{
+    rt_uint32_t value = 0;
+
+    if (argc == 3)
+    {
+        value = atoi(argv[2]);
+        if (rt_strcmp(argv[1], "budget") == 0 && value > 0)
+        {
+            rx_poll.budget = value;
+        }
+        else if (rt_strcmp(argv[1], "enter") == 0)
+        {
+            rx_poll.enter_pps = value;
+        }
+        else if (rt_strcmp(argv[1], "exit") == 0)
+        {
+            rx_poll.exit_pps = value;
+        }
+        else
+        {
+            argc = 0;
+        }
+    }
+
+    if (argc != 1 && argc != 3)
+    {
+        rt_kprintf("Usage: emac_poll [budget|enter|exit <n>]\n");
+        return;
+    }
+
+    rt_kprintf("rx mode          : %s, %d frames/s\n", (rx_poll.poll_mode == RT_TRUE) ? "poll" : "irq", rx_poll.pps);
+    rt_kprintf("budget           : %d, poll above %d, irq below %d frames/s\n",
+                rx_poll.budget, rx_poll.enter_pps, rx_poll.exit_pps);
+    rt_kprintf("irqs             : %d, polls %d, timer polls %d, budget spent %d\n",
+                rx_poll_stats.irqs, rx_poll_stats.polls, rx_poll_stats.timer_polls, rx_poll_stats.exhausted);
+    rt_kprintf("mode switches    : to poll %d, to irq %d\n", rx_poll_stats.to_poll, rx_poll_stats.to_irq);
+}
+MSH_CMD_EXPORT(emac_poll, show or tune emac receive polling: emac_poll [budget|enter|exit <n>]);
+
+static void emac_ring_stats_show(const char *name, struct ring_stats *st, rt_uint32_t ring)
+{
+    rt_kprintf("%s frames       : %u, %u bytes\n", name, st->frames, st->bytes);
+    rt_kprintf("%s ring         : full %u, high water %u of %u\n", name, st->full, st->hwm, ring);
+    rt_kprintf("%s dropped      : no pbuf %u, oversize %u\n", name, st->nomem, st->oversize);
+}
+
+static void emac_stats(int argc, char **argv)
+{
+    int i = 0;
+
+    if (argc == 2 && rt_strcmp(argv[1], "clear") == 0)
+    {
+        rt_memset(&rx_ring_stats, 0, sizeof(rx_ring_stats));
+        rt_memset(&tx_ring_stats, 0, sizeof(tx_ring_stats));
+        rt_memset(&rx_lat, 0, sizeof(rx_lat));
+        for (i = 0; i < sizeof(int_err) / sizeof(int_err[0]); i++)
+        {
+            int_err[i].count = 0;
+        }
+        return;
+    }
+    else if (argc != 1)
+    {
+        rt_kprintf("Usage: emac_stats [clear]\n");
+        return;
+    }
+
+    emac_ring_stats_show("rx", &rx_ring_stats, EMAC_DMA_RX_DESC_NUM);
+    emac_ring_stats_show("tx", &tx_ring_stats, EMAC_DMA_TX_DESC_NUM);
+    rt_kprintf("tx stalled       : %u, no link %u, drained %u\n", tx_stats.stalled, tx_stats.nolink, tx_stats.drained);
+    rt_kprintf("link             : %s %uMbps %s, up %u, down %u, an restarts %u\n",
+                (phy.state == PHY_UP) ? "up" : ((phy.state == PHY_AN) ? "negotiating" : "down"),
+                phy.speed, (phy.full_duplex == RT_TRUE) ? "full" : "half", phy.ups, phy.downs, phy.an_restarts);
+
+    for (i = 0; i < sizeof(int_err) / sizeof(int_err[0]); i++)
+    {
+        rt_kprintf("%-16s : %u\n", int_err[i].name, int_err[i].count);
+    }
+
+    rt_kprintf("irq -> rx latency, max %uus\n", rx_lat.max_us);
+    for (i = 0; i < EMAC_LAT_BUCKETS; i++)
+    {
+        if (i < EMAC_LAT_BUCKETS - 1)
+        {
+            rt_kprintf("  < %4uus       : %u\n", 8U << i, rx_lat.hist[i]);
+        }
+        else
+        {
+            rt_kprintf("  >= %4uus      : %u\n", 8U << (i - 1), rx_lat.hist[i]);
+        }
+    }
+}
+MSH_CMD_EXPORT(emac_stats, show or clear emac datapath statistics: emac_stats [clear]);
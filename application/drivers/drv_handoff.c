@@ -0,0 +1,94 @@
+#include <drv_handoff.h>
+#include <board.h>
+
+static rt_uint32_t handoff_crc32(const void *buf, rt_uint32_t len)
+{
+    const rt_uint8_t *p = (const rt_uint8_t *)buf;
+    rt_uint32_t crc = 0xffffffff;
+    int i;
+
+    while (len--)
+    {
+        crc ^= *p++;
+        for (i = 0; i < 8; i++)
+        {
+            crc = (crc >> 1) ^ (0xedb88320 & -(crc & 1));
+        }
+    }
+
+    return ~crc;
+}
+
+const struct boot_handoff *boot_handoff_get(void)
+{
+    static const struct boot_handoff *handoff = RT_NULL;
+    static rt_bool_t checked = RT_FALSE;
+    struct boot_handoff tmp;
+
+    /* the block sits in the uncached first MiB, check it once and keep the answer */
+    if (checked)
+    {
+        return handoff;
+    }
+    checked = RT_TRUE;
+
+    rt_memcpy(&tmp, (void *)HANDOFF_ADDR, sizeof(tmp));
+    if ((tmp.magic != HANDOFF_MAGIC) || (tmp.version != HANDOFF_VERSION) ||
+        (tmp.size != sizeof(struct boot_handoff)))
+    {
+        return RT_NULL;
+    }
+
+    tmp.crc = 0;
+    if (handoff_crc32(&tmp, sizeof(tmp)) != ((struct boot_handoff *)HANDOFF_ADDR)->crc)
+    {
+        return RT_NULL;
+    }
+
+    handoff = (const struct boot_handoff *)HANDOFF_ADDR;
+
+    return handoff;
+}
+
+static rt_uint32_t handoff_now_us(void)
+{
+    rt_uint32_t lo, hi;
+
+    asm volatile("mrrc p15, 0, %0, %1, c14" : "=r"(lo), "=r"(hi) : : "memory");
+
+    return (rt_uint32_t)((((rt_uint64_t)hi << 32) | lo) / 24);
+}
+
+static void bootinfo(void)
+{
+    const struct boot_handoff *ho = boot_handoff_get();
+
+    if (ho == RT_NULL)
+    {
+        rt_kprintf("no valid boot hand-off block at 0x%08x\n", HANDOFF_ADDR);
+        return;
+    }
+
+    rt_kprintf("hand-off v%d flags 0x%x\n", ho->version, ho->flags);
+    rt_kprintf("clk  : cpu %dHz ahb %dHz apb0 %dHz apb1 %dHz\n", ho->pll_cpu, ho->ahb, ho->apb0, ho->apb1);
+    rt_kprintf("dram : %dMB %dMHz timing %d%%\n", ho->dram_size >> 20, ho->dram_clk, ho->dram_timing_pct);
+    rt_kprintf("nand : %02x %04x, %d+%d x %d x %d, spi %dHz mode %d\n", ho->nand_mfr, ho->nand_dev,
+               ho->nand_page_size, ho->nand_spare_size, ho->nand_pages_per_block, ho->nand_blocks,
+               ho->spi_clk, ho->spi_mode);
+    rt_kprintf("boot0 -> dram  : %8dus\n", ho->ts_us[HANDOFF_TS_DRAM] - ho->ts_us[HANDOFF_TS_BOOT0]);
+    rt_kprintf("dram  -> nand  : %8dus\n", ho->ts_us[HANDOFF_TS_NAND] - ho->ts_us[HANDOFF_TS_DRAM]);
+    if (ho->flags & HANDOFF_F_DIRECT)
+    {
+        rt_kprintf("nand  -> app   : %8dus (boot1 skipped)\n", ho->ts_us[HANDOFF_TS_LOAD] - ho->ts_us[HANDOFF_TS_NAND]);
+    }
+    else
+    {
+        rt_kprintf("nand  -> boot1 : %8dus\n", ho->ts_us[HANDOFF_TS_LOAD] - ho->ts_us[HANDOFF_TS_NAND]);
+    }
+    if (ho->ts_us[HANDOFF_TS_BOOT1] != 0)
+    {
+        rt_kprintf("boot1 -> app   : %8dus\n", ho->ts_us[HANDOFF_TS_BOOT1] - ho->ts_us[HANDOFF_TS_LOAD]);
+    }
+    rt_kprintf("now            : %8dus\n", handoff_now_us());
+}
+MSH_CMD_EXPORT(bootinfo, show boot hand-off info and timeline);
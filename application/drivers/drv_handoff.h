@@ -0,0 +1,68 @@
+#ifndef __DRV_HANDOFF_H__
+#define __DRV_HANDOFF_H__
+
+#include <rtthread.h>
+
+/*
+ * Boot hand-off block left by boot0 and refreshed by boot1, layout shared
+ * with boot0/application/handoff.h. Only trusted when magic, version, size
+ * and CRC check out.
+ */
+#define HANDOFF_ADDR                (0x400ff000)
+#define HANDOFF_MAGIC               (0x46464f48) /* "HOFF" */
+#define HANDOFF_VERSION             2
+
+#define HANDOFF_F_CLK               (1 << 0)
+#define HANDOFF_F_DRAM              (1 << 1)
+#define HANDOFF_F_NAND              (1 << 2)
+#define HANDOFF_F_DIRECT            (1 << 3)    /* boot0 started the app itself, boot1 never ran */
+#define HANDOFF_F_TUNED             (1 << 4)    /* DRAM characterised on this boot */
+
+enum
+{
+    HANDOFF_TS_BOOT0 = 0,
+    HANDOFF_TS_DRAM,
+    HANDOFF_TS_NAND,
+    HANDOFF_TS_LOAD,
+    HANDOFF_TS_BOOT1,
+    HANDOFF_TS_NUM,
+};
+
+struct boot_handoff
+{
+    rt_uint32_t magic;
+    rt_uint32_t version;
+    rt_uint32_t size;
+    rt_uint32_t crc;
+    rt_uint32_t flags;
+
+    rt_uint32_t pll_cpu;
+    rt_uint32_t pll_peri_1x;
+    rt_uint32_t ahb;
+    rt_uint32_t apb0;
+    rt_uint32_t apb1;
+
+    rt_uint32_t dram_size;
+    rt_uint32_t dram_clk;
+    rt_uint32_t dram_timing_pct;
+    rt_uint32_t dram_clk_min;
+    rt_uint32_t dram_clk_max;
+    rt_uint32_t dram_pct_min;
+
+    rt_uint32_t nand_mfr;
+    rt_uint32_t nand_dev;
+    rt_uint32_t nand_page_size;
+    rt_uint32_t nand_spare_size;
+    rt_uint32_t nand_pages_per_block;
+    rt_uint32_t nand_blocks;
+    rt_uint32_t spi_clk;
+    rt_uint32_t spi_mode;
+    rt_uint32_t spi_tcr;
+    rt_uint32_t spi_dly;
+
+    rt_uint32_t ts_us[HANDOFF_TS_NUM];
+};
+
+const struct boot_handoff *boot_handoff_get(void);
+
+#endif
@@ -0,0 +1,128 @@
+#include <drv_pktbuf.h>
+
+struct pktbuf_stats
+{
+    rt_uint32_t free_min;       /* Fewest free buffers seen */
+    rt_uint32_t empty;          /* Requests the pool could not serve */
+    rt_uint32_t loans;          /* Buffers handed to lwIP */
+    rt_uint32_t owned[PKTBUF_OWNER_NUM];
+};
+
+static struct pktbuf pktbufs[PKTBUF_NUM] __attribute__((aligned(PKTBUF_ALIGN)));
+static struct pktbuf *pktbuf_list = RT_NULL;
+static struct pktbuf_stats pktbuf_stats = {0};
+
+/* Callers hold interrupts off */
+static void pktbuf_set_owner(struct pktbuf *buf, rt_uint8_t owner)
+{
+    pktbuf_stats.owned[buf->owner]--;
+    pktbuf_stats.owned[owner]++;
+    buf->owner = owner;
+}
+
+struct pktbuf *pktbuf_get(void)
+{
+    rt_base_t level = 0;
+    struct pktbuf *buf = RT_NULL;
+
+    level = rt_hw_interrupt_disable();
+    buf = pktbuf_list;
+    if (buf != RT_NULL)
+    {
+        pktbuf_list = buf->next;
+        pktbuf_set_owner(buf, PKTBUF_DRIVER);
+        if (pktbuf_stats.owned[PKTBUF_FREE] < pktbuf_stats.free_min)
+        {
+            pktbuf_stats.free_min = pktbuf_stats.owned[PKTBUF_FREE];
+        }
+    }
+    else
+    {
+        pktbuf_stats.empty++;
+    }
+    rt_hw_interrupt_enable(level);
+
+    return buf;
+}
+
+void pktbuf_put(struct pktbuf *buf)
+{
+    rt_base_t level = 0;
+
+    level = rt_hw_interrupt_disable();
+    buf->next = pktbuf_list;
+    pktbuf_list = buf;
+    pktbuf_set_owner(buf, PKTBUF_FREE);
+    rt_hw_interrupt_enable(level);
+}
+
+/* pbuf_free() of a loaned buffer, from whichever thread lwIP drops it in */
+static void pktbuf_pbuf_free(struct pbuf *p)
+{
+    pktbuf_put((struct pktbuf *)p);
+}
+
+struct pbuf *pktbuf_loan(struct pktbuf *buf, rt_uint16_t len)
+{
+    rt_base_t level = 0;
+
+    level = rt_hw_interrupt_disable();
+    pktbuf_set_owner(buf, PKTBUF_STACK);
+    pktbuf_stats.loans++;
+    rt_hw_interrupt_enable(level);
+
+    buf->pc.custom_free_function = pktbuf_pbuf_free;
+
+    return pbuf_alloced_custom(PBUF_RAW, len, PBUF_REF, &buf->pc, buf->data, PKTBUF_SIZE);
+}
+
+struct pbuf *pktbuf_alloc(rt_uint16_t len)
+{
+    struct pktbuf *buf = RT_NULL;
+
+    if (len > PKTBUF_SIZE)
+    {
+        return RT_NULL;
+    }
+
+    buf = pktbuf_get();
+    if (buf == RT_NULL)
+    {
+        return RT_NULL;
+    }
+
+    return pktbuf_loan(buf, len);
+}
+
+rt_uint32_t pktbuf_free_num(void)
+{
+    return pktbuf_stats.owned[PKTBUF_FREE];
+}
+
+static int pktbuf_init(void)
+{
+    int i = 0;
+
+    pktbuf_list = RT_NULL;
+    rt_memset(&pktbuf_stats, 0, sizeof(pktbuf_stats));
+    for (i = PKTBUF_NUM - 1; i >= 0; i--)
+    {
+        pktbufs[i].owner = PKTBUF_FREE;
+        pktbufs[i].next = pktbuf_list;
+        pktbuf_list = &pktbufs[i];
+    }
+    pktbuf_stats.owned[PKTBUF_FREE] = PKTBUF_NUM;
+    pktbuf_stats.free_min = PKTBUF_NUM;
+
+    return RT_EOK;
+}
+INIT_BOARD_EXPORT(pktbuf_init);
+
+static void pktbuf(void)
+{
+    rt_kprintf("pktbuf   : %d x %d bytes, %d KB\n", PKTBUF_NUM, PKTBUF_SIZE, (PKTBUF_NUM * sizeof(struct pktbuf)) >> 10);
+    rt_kprintf("free     : %d, min %d, empty %d\n", pktbuf_stats.owned[PKTBUF_FREE], pktbuf_stats.free_min, pktbuf_stats.empty);
+    rt_kprintf("driver   : %d\n", pktbuf_stats.owned[PKTBUF_DRIVER]);
+    rt_kprintf("stack    : %d, loans %d\n", pktbuf_stats.owned[PKTBUF_STACK], pktbuf_stats.loans);
+}
+MSH_CMD_EXPORT(pktbuf, show emac and lwIP packet buffer usage);
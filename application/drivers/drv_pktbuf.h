@@ -0,0 +1,49 @@
+#ifndef __DRV_PKTBUF_H__
+#define __DRV_PKTBUF_H__
+
+#include <rtthread.h>
+#include "lwip/pbuf.h"
+
+/*
+ * Packet buffers for the EMAC and lwIP. One pool backs the receive ring,
+ * the frames loaned to lwIP and the driver's own copies: a buffer moves
+ * between the driver and the stack without being copied and returns here
+ * when lwIP frees its pbuf. Sized by BSP_EMAC_PKTBUF_NUM.
+ */
+#ifdef BSP_EMAC_PKTBUF_NUM
+#define PKTBUF_NUM                  BSP_EMAC_PKTBUF_NUM
+#else
+#define PKTBUF_NUM                  160
+#endif
+#define PKTBUF_SIZE                 1536
+#define PKTBUF_ALIGN                64      /* Cortex-A7 D-cache line */
+
+enum
+{
+    PKTBUF_FREE = 0,
+    PKTBUF_DRIVER,                          /* Held by the EMAC, e.g. armed in the RX ring */
+    PKTBUF_STACK,                           /* A pbuf owned by lwIP */
+    PKTBUF_OWNER_NUM,
+};
+
+struct pktbuf
+{
+    struct pbuf_custom pc;                  /* First, the free callback gets the pbuf back */
+    struct pktbuf *next;                    /* Free list */
+    rt_uint8_t owner;
+    rt_uint8_t data[PKTBUF_SIZE] __attribute__((aligned(PKTBUF_ALIGN)));
+};
+
+/* Take a buffer for the driver, RT_NULL when the pool is empty */
+struct pktbuf *pktbuf_get(void);
+void pktbuf_put(struct pktbuf *buf);
+
+/* Hand len bytes of a driver buffer to lwIP, back in the pool on pbuf_free() */
+struct pbuf *pktbuf_loan(struct pktbuf *buf, rt_uint16_t len);
+
+/* PBUF_RAW pbuf of up to PKTBUF_SIZE bytes from the pool, in place of PBUF_POOL */
+struct pbuf *pktbuf_alloc(rt_uint16_t len);
+
+rt_uint32_t pktbuf_free_num(void);
+
+#endif
@@ -0,0 +1,676 @@
+#include <drv_spinand.h>
+#include <board.h>
+#include <drv_iomux.h>
+#include <drv_clk.h>
+#include <drv_handoff.h>
+
+#define DBG_TAG "[drv.spinand]"
+#define BSP_ENBALE_SPINAND_DEBUG 0
+
+#define DBG_ENABLE
+#if (BSP_ENBALE_SPINAND_DEBUG == 1)
+#define DBG_LVL DBG_LOG
+#else
+#define DBG_LVL DBG_WARNING
+#endif
+#define DBG_COLOR
+#include <rtdbg.h>
+
+struct spinand_stats
+{
+    rt_uint32_t reads;          /* Pages loaded into the cache */
+    rt_uint32_t programs;       /* Pages programmed */
+    rt_uint32_t erases;         /* Blocks erased */
+    rt_uint32_t ecc_fixed;      /* Reads the on-die ECC corrected */
+    rt_uint32_t ecc_fail;       /* Reads it could not */
+    rt_uint32_t fails;          /* Program / erase failures and timeouts */
+};
+
+typedef struct spinand_device
+{
+    rt_uint32_t                 base_addr;
+    rt_uint32_t                 id;
+    rt_uint32_t                 clk;
+    rt_uint8_t                  mfr_id;
+    rt_uint16_t                 dev_id;
+    rt_uint32_t                 page_size;
+    rt_uint32_t                 pages_per_block;
+    rt_uint32_t                 blocks;
+    struct iomux_cfg            spi_cs;
+    struct iomux_cfg            spi_clk;
+    struct iomux_cfg            spi_mosi;
+    struct iomux_cfg            spi_miso;
+    struct iomux_cfg            spi_wp;
+    struct iomux_cfg            spi_hold;
+    struct rt_mutex             lock;
+    struct spinand_stats        stats;
+}*spinand_dev_t;
+
+struct spinand_ptbl_header
+{
+    rt_uint32_t magic;
+    rt_uint32_t version;
+    rt_uint32_t count;
+    rt_uint32_t crc32;          /* Header with crc32 = 0, then the entries */
+};
+
+struct spinand_ptbl_entry
+{
+    char name[SPINAND_PTBL_NAME_MAX];
+    rt_uint32_t start;
+    rt_uint32_t size;
+    rt_uint32_t type;
+    rt_uint32_t copies;
+};
+
+static rt_bool_t spinand_layout = RT_FALSE;
+
+static struct spinand_device spinand0 =
+{
+    .base_addr  = SPI0_BASE_ADDR,
+    .id         = 0,
+    .spi_cs     = {.port=IO_PORTC,.pin=PIN_3,.mux=IO_PERIPH_MUX2,.pull=IO_PULL_RESERVE},
+    .spi_clk    = {.port=IO_PORTC,.pin=PIN_2,.mux=IO_PERIPH_MUX2,.pull=IO_PULL_RESERVE},
+    .spi_mosi   = {.port=IO_PORTC,.pin=PIN_4,.mux=IO_PERIPH_MUX2,.pull=IO_PULL_RESERVE},
+    .spi_miso   = {.port=IO_PORTC,.pin=PIN_5,.mux=IO_PERIPH_MUX2,.pull=IO_PULL_RESERVE},
+    .spi_wp     = {.port=IO_PORTC,.pin=PIN_6,.mux=IO_PERIPH_MUX2,.pull=IO_PULL_UP},
+    .spi_hold   = {.port=IO_PORTC,.pin=PIN_7,.mux=IO_PERIPH_MUX2,.pull=IO_PULL_UP},
+};
+
+/* SCLK straight from the module clock, CCR divider bypassed; returns the rate actually set */
+static rt_uint32_t spi_clk_init(spinand_dev_t dev, rt_uint32_t sclk)
+{
+    rt_uint32_t reg = 0;
+    rt_uint32_t src = 0;
+    rt_uint32_t div = 0;
+    rt_uint32_t m = 0;
+    rt_uint32_t n = 0;
+
+    reg = readl(CCU_BASE_ADDR + REG_CCU_SPI_BGR);
+    reg |= (1 << (dev->id + 16));
+    writel(reg, CCU_BASE_ADDR + REG_CCU_SPI_BGR);
+
+    reg = readl(CCU_BASE_ADDR + REG_CCU_SPI_BGR);
+    reg |= (1 << dev->id);
+    writel(reg, CCU_BASE_ADDR + REG_CCU_SPI_BGR);
+
+    /* SCLK = PLL_PERI(1X) / M / 2^N, M up to 16 */
+    src = drv_clk_get_pll_peri_1x();
+    div = (src + sclk - 1) / sclk;
+    while (div > 16 && n < 3)
+    {
+        n++;
+        div = (div + 1) >> 1;
+    }
+    m = div > 16 ? 16 : (div == 0 ? 1 : div);
+
+    writel((1U << 31) | (0x1 << 24) | (n << 8) | (m - 1), CCU_BASE_ADDR + REG_CCU_SPI0_CLK);
+    writel(0, dev->base_addr + REG_SPI_CLK);
+
+    return src / (m << n);
+}
+
+static void spi_hw_init(spinand_dev_t dev)
+{
+    const struct boot_handoff *ho = boot_handoff_get();
+    rt_uint32_t clk = SPINAND_CLK_DEFAULT;
+    rt_uint32_t reg = 0;
+
+    iomux_set_sel(&dev->spi_cs);
+    iomux_set_sel(&dev->spi_clk);
+    iomux_set_sel(&dev->spi_mosi);
+    iomux_set_sel(&dev->spi_miso);
+    iomux_set_sel(&dev->spi_wp);
+    iomux_set_sel(&dev->spi_hold);
+
+    if (ho != RT_NULL && (ho->flags & HANDOFF_F_NAND) && ho->spi_clk != 0)
+    {
+        clk = ho->spi_clk;
+    }
+    dev->clk = spi_clk_init(dev, clk);
+
+    writel(SPI_GCR_SRST | SPI_GCR_TPEN | SPI_GCR_MASTER | SPI_GCR_EN, dev->base_addr + REG_SPI_GCR);
+    while (readl(dev->base_addr + REG_SPI_GCR) & SPI_GCR_SRST);
+
+    /* mode 0, CS0 driven by the controller, active low, hash bursts discarded */
+    reg = SPI_TCR_SPOL | SPI_TCR_SS_LEVEL | SPI_TCR_DHB;
+    if (ho != RT_NULL && (ho->flags & HANDOFF_F_NAND) && ho->spi_clk != 0)
+    {
+        /* boot0's calibrated sample point belongs to its clock, keep both */
+        reg |= ho->spi_tcr & (SPI_TCR_SDC | SPI_TCR_SDM);
+        writel(ho->spi_dly, dev->base_addr + REG_SPI_SAMP_DL);
+    }
+    else
+    {
+        if (dev->clk >= 80000000)
+        {
+            reg |= SPI_TCR_SDC;
+        }
+        else if (dev->clk <= 24000000)
+        {
+            reg |= SPI_TCR_SDM;
+        }
+        writel(0, dev->base_addr + REG_SPI_SAMP_DL);
+    }
+    writel(reg, dev->base_addr + REG_SPI_TCR);
+
+    writel(0, dev->base_addr + REG_SPI_IER);
+}
+
+/*
+ * One polled single-wire exchange with CS held low throughout: tx, then
+ * tx2 (a page payload after its command), then rxlen bytes back. RX is
+ * drained while TX is fed, so neither FIFO limits the length.
+ */
+static rt_err_t spi_xfer(spinand_dev_t dev, const rt_uint8_t *tx, rt_uint32_t txlen,
+    const rt_uint8_t *tx2, rt_uint32_t tx2len, rt_uint8_t *rx, rt_uint32_t rxlen)
+{
+    rt_uint32_t base = dev->base_addr;
+    rt_uint32_t total_tx = txlen + tx2len;
+    rt_uint32_t sent = 0;
+    rt_uint32_t fsr = 0;
+    rt_uint32_t word = 0;
+    rt_uint32_t poll = 0;
+
+    writel(txlen + tx2len + rxlen, base + REG_SPI_MBC);
+    writel(total_tx, base + REG_SPI_MTC);
+    writel(total_tx + rxlen, base + REG_SPI_BCC);
+
+    writel(readl(base + REG_SPI_FCR) | SPI_FCR_RX_RST | SPI_FCR_TX_RST, base + REG_SPI_FCR);
+    writel(0xffffffff, base + REG_SPI_ISR);
+    writel(readl(base + REG_SPI_TCR) | SPI_TCR_XCH, base + REG_SPI_TCR);
+
+    while (sent < total_tx || rxlen > 0)
+    {
+        fsr = readl(base + REG_SPI_FSR);
+
+        while (sent < total_tx && ((fsr >> 16) & 0xff) < SPI_FIFO_DEPTH)
+        {
+            writeb(sent < txlen ? tx[sent] : tx2[sent - txlen], base + REG_SPI_TXD);
+            sent++;
+            fsr += (1 << 16);
+        }
+
+        while (rxlen >= 4 && (fsr & 0xff) >= 4)
+        {
+            word = readl(base + REG_SPI_RXD);
+            rx[0] = word;
+            rx[1] = word >> 8;
+            rx[2] = word >> 16;
+            rx[3] = word >> 24;
+            rx += 4;
+            rxlen -= 4;
+            fsr -= 4;
+        }
+        while (rxlen > 0 && rxlen < 4 && (fsr & 0xff) > 0)
+        {
+            *rx++ = readb(base + REG_SPI_RXD);
+            rxlen--;
+            fsr--;
+        }
+
+        if (++poll > 0x1000000)
+        {
+            return -RT_ETIMEOUT;
+        }
+    }
+
+    while (readl(base + REG_SPI_TCR) & SPI_TCR_XCH)
+    {
+        if (++poll > 0x1000000)
+        {
+            return -RT_ETIMEOUT;
+        }
+    }
+
+    return RT_EOK;
+}
+
+static rt_err_t spinand_cmd(spinand_dev_t dev, rt_uint8_t op)
+{
+    return spi_xfer(dev, &op, 1, RT_NULL, 0, RT_NULL, 0);
+}
+
+static rt_err_t spinand_get_feature(spinand_dev_t dev, rt_uint8_t addr, rt_uint8_t *val)
+{
+    rt_uint8_t tx[2] = {SPINAND_OP_GET_FEATURE, addr};
+
+    return spi_xfer(dev, tx, 2, RT_NULL, 0, val, 1);
+}
+
+static rt_err_t spinand_set_feature(spinand_dev_t dev, rt_uint8_t addr, rt_uint8_t val)
+{
+    rt_uint8_t tx[3] = {SPINAND_OP_SET_FEATURE, addr, val};
+
+    return spi_xfer(dev, tx, 3, RT_NULL, 0, RT_NULL, 0);
+}
+
+/* Status once the chip is ready, the caller checks the fail bits */
+static rt_err_t spinand_wait(spinand_dev_t dev, rt_uint8_t *status)
+{
+    rt_err_t ret = RT_EOK;
+    rt_uint32_t us = 0;
+
+    for (us = 0; us < SPINAND_BUSY_TIMEOUT_US; us += 10)
+    {
+        ret = spinand_get_feature(dev, SPINAND_FEATURE_STATUS, status);
+        if (ret != RT_EOK)
+        {
+            return ret;
+        }
+        if ((*status & SPINAND_STATUS_BUSY) == 0)
+        {
+            return RT_EOK;
+        }
+        rt_hw_us_delay(10);
+    }
+
+    dev->stats.fails++;
+
+    return -RT_ETIMEOUT;
+}
+
+static rt_err_t spinand_row_cmd(spinand_dev_t dev, rt_uint8_t op, rt_uint32_t page)
+{
+    rt_uint8_t tx[4] = {op, (rt_uint8_t)(page >> 16), (rt_uint8_t)(page >> 8), (rt_uint8_t)page};
+
+    return spi_xfer(dev, tx, 4, RT_NULL, 0, RT_NULL, 0);
+}
+
+static rt_err_t spinand_page_read(spinand_dev_t dev, rt_uint32_t page, rt_uint32_t col, rt_uint8_t *buf, rt_uint32_t len)
+{
+    rt_err_t ret = RT_EOK;
+    rt_uint8_t status = 0;
+    rt_uint8_t tx[4] = {SPINAND_OP_READ_CACHE, (rt_uint8_t)(col >> 8), (rt_uint8_t)col, 0x00};
+
+    ret = spinand_row_cmd(dev, SPINAND_OP_PAGE_READ, page);
+    if (ret == RT_EOK)
+    {
+        ret = spinand_wait(dev, &status);
+    }
+    if (ret != RT_EOK)
+    {
+        return ret;
+    }
+
+    dev->stats.reads++;
+    if ((status & SPINAND_STATUS_ECC_MASK) == SPINAND_STATUS_ECC_FAIL)
+    {
+        dev->stats.ecc_fail++;
+        LOG_E("page %d: uncorrectable ECC error", page);
+        return -RT_EIO;
+    }
+    if ((status & SPINAND_STATUS_ECC_MASK) == SPINAND_STATUS_ECC_FIXED)
+    {
+        dev->stats.ecc_fixed++;
+    }
+
+    return spi_xfer(dev, tx, 4, RT_NULL, 0, buf, len);
+}
+
+/* One program per page: the on-die ECC covers the page as a whole */
+static rt_err_t spinand_page_program(spinand_dev_t dev, rt_uint32_t page, rt_uint32_t col, const rt_uint8_t *buf, rt_uint32_t len)
+{
+    rt_err_t ret = RT_EOK;
+    rt_uint8_t status = 0;
+    rt_uint8_t tx[3] = {SPINAND_OP_PROGRAM_LOAD, (rt_uint8_t)(col >> 8), (rt_uint8_t)col};
+
+    ret = spinand_cmd(dev, SPINAND_OP_WRITE_ENABLE);
+    if (ret == RT_EOK)
+    {
+        ret = spi_xfer(dev, tx, 3, buf, len, RT_NULL, 0);
+    }
+    if (ret == RT_EOK)
+    {
+        ret = spinand_row_cmd(dev, SPINAND_OP_PROGRAM_EXEC, page);
+    }
+    if (ret == RT_EOK)
+    {
+        ret = spinand_wait(dev, &status);
+    }
+    if (ret != RT_EOK)
+    {
+        return ret;
+    }
+
+    dev->stats.programs++;
+    if (status & SPINAND_STATUS_P_FAIL)
+    {
+        dev->stats.fails++;
+        LOG_E("page %d: program failed", page);
+        return -RT_EIO;
+    }
+
+    return RT_EOK;
+}
+
+static rt_err_t spinand_block_erase(spinand_dev_t dev, rt_uint32_t block)
+{
+    rt_err_t ret = RT_EOK;
+    rt_uint8_t status = 0;
+
+    ret = spinand_cmd(dev, SPINAND_OP_WRITE_ENABLE);
+    if (ret == RT_EOK)
+    {
+        ret = spinand_row_cmd(dev, SPINAND_OP_BLOCK_ERASE, block * dev->pages_per_block);
+    }
+    if (ret == RT_EOK)
+    {
+        ret = spinand_wait(dev, &status);
+    }
+    if (ret != RT_EOK)
+    {
+        return ret;
+    }
+
+    dev->stats.erases++;
+    if (status & SPINAND_STATUS_E_FAIL)
+    {
+        dev->stats.fails++;
+        LOG_E("block %d: erase failed", block);
+        return -RT_EIO;
+    }
+
+    return RT_EOK;
+}
+
+/* Lower 2MB (boot0, ptable, boot1) stays locked as boot1 sets it, the rest is opened for OTA */
+static rt_err_t spinand_unlock(spinand_dev_t dev)
+{
+    rt_err_t ret = RT_EOK;
+    rt_uint8_t val = 0;
+
+    ret = spinand_get_feature(dev, SPINAND_FEATURE_PROTECT, &val);
+    if (ret != RT_EOK)
+    {
+        return ret;
+    }
+
+    val &= ~(0x1f << 2);
+    if (dev->mfr_id == 0xcd && dev->dev_id == 0x7272)
+    {
+        val |= (1 << 2) | (1 << 5) | (1 << 3);
+    }
+
+    return spinand_set_feature(dev, SPINAND_FEATURE_PROTECT, val);
+}
+
+static rt_err_t spinand_probe(spinand_dev_t dev)
+{
+    const struct boot_handoff *ho = boot_handoff_get();
+    rt_uint8_t tx[1] = {SPINAND_OP_READ_ID};
+    rt_uint8_t id[4] = {0};
+    rt_uint8_t *p = id;
+    rt_uint8_t status = 0;
+    rt_err_t ret = RT_EOK;
+
+    if (ho != RT_NULL && (ho->flags & HANDOFF_F_NAND))
+    {
+        /* boot0 reset and identified the chip already */
+        dev->mfr_id          = ho->nand_mfr;
+        dev->dev_id          = ho->nand_dev;
+        dev->page_size       = ho->nand_page_size;
+        dev->pages_per_block = ho->nand_pages_per_block;
+        dev->blocks          = ho->nand_blocks;
+
+        return spinand_wait(dev, &status);
+    }
+
+    ret = spinand_cmd(dev, SPINAND_OP_RESET);
+    if (ret == RT_EOK)
+    {
+        ret = spinand_wait(dev, &status);
+    }
+    if (ret == RT_EOK)
+    {
+        ret = spi_xfer(dev, tx, 1, RT_NULL, 0, id, 4);
+    }
+    if (ret != RT_EOK)
+    {
+        return ret;
+    }
+
+    /* Some chips put a dummy byte before the ID */
+    if (p[0] == 0xff)
+    {
+        p++;
+    }
+    dev->mfr_id = p[0];
+    dev->dev_id = (p[1] << 8) | p[2];
+
+    /* boot1's geometry for the board's part, the only one it supports */
+    dev->page_size       = 2048;
+    dev->pages_per_block = 64;
+    dev->blocks          = 2048;
+
+    return RT_EOK;
+}
+
+static rt_uint32_t spinand_crc32(rt_uint32_t crc, const rt_uint8_t *p, rt_uint32_t len)
+{
+    int i = 0;
+
+    while (len-- > 0)
+    {
+        crc ^= *p++;
+        for (i = 0; i < 8; i++)
+        {
+            crc = (crc >> 1) ^ (0xEDB88320U & (0U - (crc & 1U)));
+        }
+    }
+
+    return crc;
+}
+
+/* fal_partition.c keeps the entry magic to itself, fal_cfg.h needs it to expand here */
+#ifndef FAL_PART_MAGIC_WORD
+#define FAL_PART_MAGIC_WORD         0x45503130
+#endif
+
+/*
+ * fal_cfg.h repeats boot1's layout by hand. Compare it with the first valid
+ * copy of the table in the ptable partition, the one boot1 applies; with no
+ * valid copy boot1 runs its built-in table, which fal_cfg.h mirrors.
+ */
+static rt_bool_t spinand_layout_check(spinand_dev_t dev)
+{
+#ifdef FAL_PART_HAS_TABLE_CFG
+    static const struct fal_partition layout[] = FAL_PART_TABLE;
+    static rt_uint8_t buf[sizeof(struct spinand_ptbl_header) + SPINAND_PTBL_MAX * sizeof(struct spinand_ptbl_entry)];
+    struct spinand_ptbl_header *header = (struct spinand_ptbl_header *)buf;
+    struct spinand_ptbl_entry *entry = (struct spinand_ptbl_entry *)(buf + sizeof(*header));
+    rt_uint32_t blk_size = dev->page_size * dev->pages_per_block;
+    rt_uint32_t addr = 0;
+    rt_uint32_t crc = 0;
+    rt_uint32_t i = 0;
+    rt_uint32_t j = 0;
+
+    for (addr = SPINAND_PTBL_ADDR; addr < SPINAND_PTBL_ADDR + SPINAND_PTBL_SIZE; addr += blk_size)
+    {
+        if (spinand_page_read(dev, addr / dev->page_size, 0, buf, sizeof(buf)) != RT_EOK ||
+            header->magic != SPINAND_PTBL_MAGIC || header->version != SPINAND_PTBL_VERSION ||
+            header->count == 0 || header->count > SPINAND_PTBL_MAX)
+        {
+            continue;
+        }
+
+        crc = header->crc32;
+        header->crc32 = 0;
+        if ((spinand_crc32(0xFFFFFFFFU, buf, sizeof(*header) + header->count * sizeof(*entry)) ^ 0xFFFFFFFFU) == crc)
+        {
+            break;
+        }
+    }
+    if (addr >= SPINAND_PTBL_ADDR + SPINAND_PTBL_SIZE)
+    {
+        LOG_W("no partition table on flash, fal_cfg.h taken as boot1's built-in layout");
+        return RT_TRUE;
+    }
+
+    if (header->count != sizeof(layout) / sizeof(layout[0]))
+    {
+        LOG_E("partition table at 0x%x has %d entries, fal_cfg.h %d", addr, header->count, (int)(sizeof(layout) / sizeof(layout[0])));
+        return RT_FALSE;
+    }
+    for (i = 0; i < header->count; i++)
+    {
+        for (j = 0; j < header->count; j++)
+        {
+            if (rt_strncmp(entry[j].name, layout[i].name, SPINAND_PTBL_NAME_MAX) == 0)
+            {
+                break;
+            }
+        }
+        if (j == header->count || entry[j].start != layout[i].offset || entry[j].size != layout[i].len)
+        {
+            LOG_E("%s differs between the partition table at 0x%x and fal_cfg.h", layout[i].name, addr);
+            return RT_FALSE;
+        }
+    }
+
+    return RT_TRUE;
+#else
+    LOG_W("FAL_PART_HAS_TABLE_CFG off, layout not checked against boot1's");
+    return RT_FALSE;
+#endif
+}
+
+rt_bool_t spinand_layout_valid(void)
+{
+    return spinand_layout;
+}
+
+static int spinand_fal_init(void)
+{
+    spinand_dev_t dev = &spinand0;
+    rt_err_t ret = RT_EOK;
+
+    rt_mutex_init(&dev->lock, "spinand", RT_IPC_FLAG_PRIO);
+
+    spi_hw_init(dev);
+
+    ret = spinand_probe(dev);
+    if (ret == RT_EOK)
+    {
+        ret = spinand_unlock(dev);
+    }
+    if (ret != RT_EOK || dev->page_size == 0 || dev->pages_per_block == 0)
+    {
+        LOG_E("probe failed %d", ret);
+        spinand_flash.len = 0;
+        return -RT_ERROR;
+    }
+
+    spinand_flash.len = dev->page_size * dev->pages_per_block * dev->blocks;
+    spinand_flash.blk_size = dev->page_size * dev->pages_per_block;
+    spinand_flash.write_gran = dev->page_size * 8;
+
+    spinand_layout = spinand_layout_check(dev);
+
+    return RT_EOK;
+}
+
+static int spinand_fal_read(long offset, rt_uint8_t *buf, size_t size)
+{
+    spinand_dev_t dev = &spinand0;
+    rt_uint32_t page = offset / dev->page_size;
+    rt_uint32_t col = offset % dev->page_size;
+    rt_uint32_t left = size;
+    rt_uint32_t n = 0;
+    rt_err_t ret = RT_EOK;
+
+    rt_mutex_take(&dev->lock, RT_WAITING_FOREVER);
+    while (left > 0 && ret == RT_EOK)
+    {
+        n = dev->page_size - col;
+        n = n > left ? left : n;
+        ret = spinand_page_read(dev, page, col, buf, n);
+        buf += n;
+        left -= n;
+        page++;
+        col = 0;
+    }
+    rt_mutex_release(&dev->lock);
+
+    return ret == RT_EOK ? (int)size : -1;
+}
+
+/* Whole pages expected: a page holding data is not programmed again */
+static int spinand_fal_write(long offset, const rt_uint8_t *buf, size_t size)
+{
+    spinand_dev_t dev = &spinand0;
+    rt_uint32_t page = offset / dev->page_size;
+    rt_uint32_t col = offset % dev->page_size;
+    rt_uint32_t left = size;
+    rt_uint32_t n = 0;
+    rt_err_t ret = RT_EOK;
+
+    rt_mutex_take(&dev->lock, RT_WAITING_FOREVER);
+    while (left > 0 && ret == RT_EOK)
+    {
+        n = dev->page_size - col;
+        n = n > left ? left : n;
+        ret = spinand_page_program(dev, page, col, buf, n);
+        buf += n;
+        left -= n;
+        page++;
+        col = 0;
+    }
+    rt_mutex_release(&dev->lock);
+
+    return ret == RT_EOK ? (int)size : -1;
+}
+
+/* Every block the range touches */
+static int spinand_fal_erase(long offset, size_t size)
+{
+    spinand_dev_t dev = &spinand0;
+    rt_uint32_t blk_size = dev->page_size * dev->pages_per_block;
+    rt_uint32_t block = offset / blk_size;
+    rt_uint32_t end = (offset + size + blk_size - 1) / blk_size;
+    rt_err_t ret = RT_EOK;
+
+    rt_mutex_take(&dev->lock, RT_WAITING_FOREVER);
+    for (; block < end && ret == RT_EOK; block++)
+    {
+        ret = spinand_block_erase(dev, block);
+    }
+    rt_mutex_release(&dev->lock);
+
+    return ret == RT_EOK ? (int)size : -1;
+}
+
+struct fal_flash_dev spinand_flash =
+{
+    .name       = SPINAND_DEV_NAME,
+    .addr       = 0,
+    .len        = 0,
+    .blk_size   = 0,
+    .ops        = {spinand_fal_init, spinand_fal_read, spinand_fal_write, spinand_fal_erase},
+    .write_gran = 0,
+};
+
+int rt_hw_spinand_init(void)
+{
+    if (fal_init() <= 0)
+    {
+        rt_kprintf("spinand0 register fail\n");
+        return -RT_ERROR;
+    }
+
+    return RT_EOK;
+}
+INIT_DEVICE_EXPORT(rt_hw_spinand_init);
+
+static void spinand(void)
+{
+    spinand_dev_t dev = &spinand0;
+
+    rt_kprintf("id       : %02x %04x\n", dev->mfr_id, dev->dev_id);
+    rt_kprintf("geometry : %d x %d x %d bytes, %d MB\n", dev->blocks, dev->pages_per_block, dev->page_size,
+               spinand_flash.len >> 20);
+    rt_kprintf("sclk     : %d Hz\n", dev->clk);
+    rt_kprintf("reads    : %d, ecc fixed %d, ecc fail %d\n", dev->stats.reads, dev->stats.ecc_fixed, dev->stats.ecc_fail);
+    rt_kprintf("programs : %d, erases %d, fails %d\n", dev->stats.programs, dev->stats.erases, dev->stats.fails);
+}
+MSH_CMD_EXPORT(spinand, show SPI NAND geometry and operation counts);
@@ -0,0 +1,87 @@
+#ifndef __DRV_SPINAND_H__
+#define __DRV_SPINAND_H__
+
+#include <rtthread.h>
+#include <fal.h>
+
+/*
+ * SPI NAND on SPI0, the chip boot0 and boot1 load from. Exposed to FAL as
+ * one flash device with the partitions of fal_cfg.h, the same linear
+ * layout boot1 uses (no bad block skipping). Clock and sample delay are
+ * the ones boot0 calibrated, taken from the hand-off block.
+ */
+#define SPINAND_DEV_NAME            "spinand0"
+
+#define SPI0_BASE_ADDR              (0x04025000)
+
+#define REG_SPI_GCR                 0x0004
+#define REG_SPI_TCR                 0x0008
+#define REG_SPI_IER                 0x0010
+#define REG_SPI_ISR                 0x0014
+#define REG_SPI_FCR                 0x0018
+#define REG_SPI_FSR                 0x001c
+#define REG_SPI_CLK                 0x0024
+#define REG_SPI_SAMP_DL             0x0028
+#define REG_SPI_MBC                 0x0030
+#define REG_SPI_MTC                 0x0034
+#define REG_SPI_BCC                 0x0038
+#define REG_SPI_TXD                 0x0200
+#define REG_SPI_RXD                 0x0300
+
+#define SPI_GCR_EN                  (1 << 0)
+#define SPI_GCR_MASTER              (1 << 1)
+#define SPI_GCR_TPEN                (1 << 7)
+#define SPI_GCR_SRST                (1U << 31)
+
+#define SPI_TCR_SPOL                (1 << 2)
+#define SPI_TCR_SS_LEVEL            (1 << 7)
+#define SPI_TCR_DHB                 (1 << 8)
+#define SPI_TCR_SDC                 (1 << 11)
+#define SPI_TCR_SDM                 (1 << 13)
+#define SPI_TCR_XCH                 (1U << 31)
+
+#define SPI_FCR_RX_RST              (1 << 15)
+#define SPI_FCR_TX_RST              (1U << 31)
+
+#define SPI_FIFO_DEPTH              64
+
+#define SPINAND_CLK_DEFAULT         50000000    /* Without a hand-off, nothing calibrated */
+
+#define SPINAND_OP_RESET            0xff
+#define SPINAND_OP_READ_ID          0x9f
+#define SPINAND_OP_GET_FEATURE      0x0f
+#define SPINAND_OP_SET_FEATURE      0x1f
+#define SPINAND_OP_PAGE_READ        0x13
+#define SPINAND_OP_READ_CACHE       0x03
+#define SPINAND_OP_WRITE_ENABLE     0x06
+#define SPINAND_OP_PROGRAM_LOAD     0x02
+#define SPINAND_OP_PROGRAM_EXEC     0x10
+#define SPINAND_OP_BLOCK_ERASE      0xd8
+
+#define SPINAND_FEATURE_PROTECT     0xa0
+#define SPINAND_FEATURE_CONFIG      0xb0
+#define SPINAND_FEATURE_STATUS      0xc0
+
+#define SPINAND_STATUS_BUSY         (1 << 0)
+#define SPINAND_STATUS_E_FAIL       (1 << 2)
+#define SPINAND_STATUS_P_FAIL       (1 << 3)
+#define SPINAND_STATUS_ECC_MASK     (3 << 4)
+#define SPINAND_STATUS_ECC_FIXED    (1 << 4)
+#define SPINAND_STATUS_ECC_FAIL     (2 << 4)
+
+#define SPINAND_BUSY_TIMEOUT_US     50000       /* Block erase is 10ms at most */
+
+/* hgboot's on-flash partition table, boot1/hgboot/partition/partition.h */
+#define SPINAND_PTBL_ADDR           0x080000    /* ptable partition, one copy per good block */
+#define SPINAND_PTBL_SIZE           0x080000
+#define SPINAND_PTBL_MAGIC          0x4C425450  /* 'PTBL' */
+#define SPINAND_PTBL_VERSION        1
+#define SPINAND_PTBL_MAX            20
+#define SPINAND_PTBL_NAME_MAX       16
+
+extern struct fal_flash_dev spinand_flash;
+
+/* RT_TRUE once spinand_fal_init() found fal_cfg.h to agree with the layout boot1 uses */
+rt_bool_t spinand_layout_valid(void);
+
+#endif
@@ -0,0 +1,34 @@
+#ifndef _FAL_CFG_H_
+#define _FAL_CFG_H_
+
+#include <rtconfig.h>
+
+/*
+ * hgboot's SPI NAND layout: tool/nand_layout.txt and the built-in table of
+ * boot1/boards/port/partition_port.c. Names are the ones boot1 looks up,
+ * keep the three in step: spinand_fal_init() compares this table with the
+ * one on flash and OTA refuses to write when they differ.
+ */
+extern struct fal_flash_dev spinand_flash;
+
+#define FAL_FLASH_DEV_TABLE                                          \
+{                                                                    \
+    &spinand_flash,                                                  \
+}
+
+#ifdef FAL_PART_HAS_TABLE_CFG
+#define FAL_PART_TABLE                                                               \
+{                                                                                    \
+    {FAL_PART_MAGIC_WORD,    "boot0", "spinand0", 0x000000, 0x080000, 0},            \
+    {FAL_PART_MAGIC_WORD,   "ptable", "spinand0", 0x080000, 0x080000, 0},            \
+    {FAL_PART_MAGIC_WORD,    "boot1", "spinand0", 0x100000, 0x100000, 0},            \
+    {FAL_PART_MAGIC_WORD,     "APP1", "spinand0", 0x200000, 0x100000, 0},            \
+    {FAL_PART_MAGIC_WORD,     "APP2", "spinand0", 0x300000, 0x100000, 0},            \
+    {FAL_PART_MAGIC_WORD, "Download", "spinand0", 0x400000, 0x100000, 0},            \
+    {FAL_PART_MAGIC_WORD,    "Param", "spinand0", 0x500000, 0x01e000, 0},            \
+    {FAL_PART_MAGIC_WORD, "LittleFs", "spinand0", 0x520000, 0x400000, 0},            \
+    {FAL_PART_MAGIC_WORD,   "Param2", "spinand0", 0x920000, 0x01e000, 0},            \
+}
+#endif /* FAL_PART_HAS_TABLE_CFG */
+
+#endif /* _FAL_CFG_H_ */
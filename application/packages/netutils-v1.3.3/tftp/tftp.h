@@ -40,6 +40,7 @@ struct tftp_server
 {
     int is_stop;
     int is_write;
+    int windowsize;
     char *root_name;
     void *_private;
 };
@@ -49,8 +50,10 @@ void tftp_client_destroy(struct tftp_client *client);
 int tftp_client_push(struct tftp_client *client, const char *local_name, const char *remote_name);
 int tftp_client_pull(struct tftp_client *client, const char *remote_name, const char *local_name);
 int tftp_client_err(struct tftp_client *client);
+int tftp_client_windowsize_set(struct tftp_client *client, int windowsize);
 struct tftp_server *tftp_server_create(const char *root_name, int port);
 void tftp_server_run(struct tftp_server *server);
 void tftp_server_destroy(struct tftp_server *server);
 void tftp_server_write_set(struct tftp_server *server, int is_write);
+void tftp_server_windowsize_set(struct tftp_server *server, int windowsize);
 #endif
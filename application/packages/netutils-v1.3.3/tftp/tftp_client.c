@@ -36,8 +36,9 @@ static int tftp_client_select(struct tftp_client_private *_private)
     int ret;
     FD_ZERO(&_private->fdr);
     FD_SET(_private->xfer->sock, &_private->fdr);
-    _private->timeout.tv_sec = 5;
-    _private->timeout.tv_usec = 0;
+    /* Retransmission timeout of the transfer */
+    _private->timeout.tv_sec = _private->xfer->rto / 1000;
+    _private->timeout.tv_usec = (_private->xfer->rto % 1000) * 1000;
     ret = select(_private->xfer->sock + 1, &_private->fdr, NULL, NULL, (void *)&_private->timeout);
     if (ret == 0)
     {
@@ -72,6 +73,8 @@ struct tftp_client *tftp_client_create(const char *ip_addr, int port)
         free(client);
         return NULL;
     }
+    /* Ask for a window, the server may lower it or ignore the option */
+    tftp_xfer_windowsize_set(_private->xfer, XFER_WINDOW_SIZE_DEFAULT);
     /* Number of Initial Retries */
     client->max_retry = TFTP_MAX_RETRY;
     /* Initialization error number */
@@ -92,29 +95,23 @@ void tftp_client_destroy(struct tftp_client *client)
     free(client);
 }
 
-int tftp_client_push(struct tftp_client *client, const char *local_name, const char *remote_name)
+/* Send the request and settle the options, returns the opcode of the reply */
+static int tftp_client_request(struct tftp_client *client, uint16_t cmd, const char *remote_name, struct tftp_packet *pack)
 {
     struct tftp_client_private *_private;
-    void *fp;
-    struct tftp_packet *pack;
-    int send_size, r_size;
-    int file_size = 0;
     int res;
     int max_retry;
 
     _private = client->_private;
     max_retry = client->max_retry;
-    client->err = TFTP_OK;
     while (max_retry)
     {
-        /* Send Write Request */
-        res = tftp_send_request(_private->xfer, TFTP_CMD_WRQ, remote_name);
+        /* Send Request */
+        res = tftp_send_request(_private->xfer, cmd, remote_name);
         if (res != TFTP_OK)
         {
             tftp_printf("tftp send request failed !! retry:%d. exit\n", client->max_retry - max_retry);
-            max_retry = 0;
-            client->err = res;
-            break;
+            return res;
         }
         /* Waiting for server response */
         res = tftp_client_select(_private);
@@ -126,6 +123,7 @@ int tftp_client_push(struct tftp_client *client, const char *local_name, const c
         else if (res == -TFTP_ETIMEOUT)
         {
             tftp_printf("tftp wait response timeout. retry\n");
+            tftp_xfer_rto_backoff(_private->xfer);
             max_retry --;
             continue;
         }
@@ -133,156 +131,162 @@ int tftp_client_push(struct tftp_client *client, const char *local_name, const c
         {
             /* Waiting for Response Error */
             tftp_printf("tftp wait response err:%d. exit\n", res);
-            max_retry = 0;
-            client->err = res;
-            break;
+            return res;
         }
     }
-
     if (max_retry == 0)
     {
-        return res;
+        return -TFTP_ETIMEOUT;
+    }
+
+    res = tftp_peek_cmd(_private->xfer);
+    if (res == TFTP_CMD_OACK)
+    {
+        if (tftp_recv_oack(_private->xfer, pack, sizeof(struct tftp_packet)) != TFTP_OK)
+        {
+            return -TFTP_ECMD;
+        }
+    }
+    else if (res >= 0)
+    {
+        /* No OACK: the server ignored the options, RFC 1350 transfer */
+        tftp_xfer_blksize_set(_private->xfer, XFER_DATA_SIZE_MAX);
+        tftp_xfer_windowsize_set(_private->xfer, 1);
+    }
+    return res;
+}
+
+int tftp_client_push(struct tftp_client *client, const char *local_name, const char *remote_name)
+{
+    struct tftp_client_private *_private;
+    struct tftp_window win;
+    void *fp;
+    struct tftp_packet *pack;
+    uint16_t block;
+    int res;
+    int max_retry;
+
+    _private = client->_private;
+    client->err = TFTP_OK;
+    pack = malloc(sizeof(struct tftp_packet));
+    if (pack == NULL)
+    {
+        client->err = -TFTP_EMEM;
+        return -TFTP_EMEM;
+    }
+    /* Send Write Request */
+    res = tftp_client_request(client, TFTP_CMD_WRQ, remote_name, pack);
+    if (res == TFTP_CMD_ACK)
+    {
+        /* Receiving ACK of block 0 */
+        res = tftp_recv_ack(_private->xfer, &block);
+        if (res == TFTP_OK && block != 0)
+        {
+            res = -TFTP_EBLK;
+        }
+    }
+    else if (res == TFTP_CMD_OACK)
+    {
+        res = TFTP_OK;
+    }
+    else if (res >= 0)
+    {
+        res = -TFTP_EACK;
     }
-    /* Receiving ACK */
-    res = tftp_wait_ack(_private->xfer);
     if (res != TFTP_OK)
     {
         tftp_printf("wait ack failed!! exit\n");
+        free(pack);
         client->err = res;
         return res;
     }
     /* Open file */
-    fp = tftp_file_open(local_name, _private->xfer->mode, 1);
+    fp = tftp_file_open(local_name, _private->xfer->mode, 0);
     if (fp == NULL)
     {
         tftp_printf("open file \"%s\" error.\n", local_name);
+        tftp_transfer_err(_private->xfer, 0, "open file err!");
+        free(pack);
         client->err = -TFTP_EFILE;
         return -TFTP_EFILE;
     }
-    pack = malloc(sizeof(struct tftp_packet));
-    if (pack == NULL)
-    {
-        tftp_transfer_err(_private->xfer, 0, "malloc pack failed!");
-        tftp_file_close(fp);
-        client->err = -TFTP_EMEM;
-        return -TFTP_EMEM;
-    }
-    while (1)
+    tftp_window_init(&win, fp);
+    max_retry = client->max_retry;
+    /* Send a window of data, then slide it on each server ACK */
+    res = tftp_window_send(_private->xfer, &win, pack);
+    while (res == TFTP_OK)
     {
-        /* read file */
-        r_size = tftp_file_read(fp, file_size, &pack->data, _private->xfer->blksize);
-        if (r_size < 0)
-        {
-            max_retry = 0;
-            client->err = -TFTP_EFILE;
-            break;
-        }
-        max_retry = client->max_retry;
-        while (max_retry)
+        res = tftp_client_select(_private);
+        if (res > 0 && FD_ISSET(_private->xfer->sock, &_private->fdr))
         {
-            /* Send data to server */
-            send_size = tftp_write_data(_private->xfer, pack, r_size + 4);
-            if (send_size != (r_size + 4))
+            res = tftp_recv_ack(_private->xfer, &block);
+            if (res != TFTP_OK)
             {
-                tftp_transfer_err(_private->xfer, 0, "send file err!");
-                max_retry = 0;
-                client->err = -TFTP_EDATA;
+                tftp_printf("wait ack failed!! exit\n");
                 break;
             }
-            /* Wait server ACK */
-            res = tftp_client_select(_private);
-            if (res > 0 && FD_ISSET(_private->xfer->sock, &_private->fdr))
+            if (tftp_window_ack(_private->xfer, &win, block) == 1)
             {
-                /* Receive a server ACK */
+                tftp_window_report(_private->xfer, &win);
                 break;
             }
-            else if (res == -TFTP_ETIMEOUT)
-            {
-                tftp_printf("tftp wait response timeout. retry\n");
-                max_retry --;
-                continue;
-            }
-            else
+            max_retry = client->max_retry;
+        }
+        else if (res == -TFTP_ETIMEOUT)
+        {
+            /* Resend from the oldest block not acknowledged */
+            if (tftp_xfer_rto_backoff(_private->xfer) != TFTP_OK && --max_retry == 0)
             {
-                tftp_printf("tftp wait response err:%d. exit\n", res);
-                max_retry = 0;
-                client->err = res;
+                tftp_printf("tftp wait response timeout. exit\n");
                 break;
             }
+            tftp_window_rewind(&win);
         }
-
-        if (max_retry == 0)
-        {
-            break;
-        }
-        /* Receiving ACK */
-        if (tftp_wait_ack(_private->xfer) != TFTP_OK)
-        {
-            tftp_printf("wait ack failed!! exit\n");
-            client->err = -TFTP_EACK;
-            break;
-        }
-        file_size += r_size;
-        if (r_size < _private->xfer->blksize)
+        else
         {
+            tftp_printf("tftp wait response err:%d. exit\n", res);
             break;
         }
+        res = tftp_window_send(_private->xfer, &win, pack);
+    }
+    if (res != TFTP_OK)
+    {
+        client->err = res;
     }
     /* close file */
     tftp_file_close(fp);
     free(pack);
-    return file_size;
+    /* Bytes the server acknowledged */
+    if (res == TFTP_OK)
+    {
+        return win.bytes;
+    }
+    return (win.base - 1) * _private->xfer->blksize;
 }
 
 int tftp_client_pull(struct tftp_client *client, const char *remote_name, const char *local_name)
 {
     struct tftp_client_private *_private;
+    struct tftp_window win;
     void *fp;
     struct tftp_packet *pack;
-    int recv_size, w_size;
-    int file_size = 0;
     int res;
     int max_retry;
 
     _private = client->_private;
-    max_retry = client->max_retry;
     client->err = TFTP_OK;
-    while (max_retry)
+    pack = malloc(sizeof(struct tftp_packet));
+    if (pack == NULL)
     {
-        /* Send Read File Request */
-        res = tftp_send_request(_private->xfer, TFTP_CMD_RRQ, remote_name);
-        if (res != TFTP_OK)
-        {
-            tftp_printf("tftp send request failed !! retry:%d. exit\n", max_retry);
-            max_retry = 0;
-            client->err = res;
-            break;
-        }
-        /* Waiting for the server to respond to the request */
-        res = tftp_client_select(_private);
-        if (res > 0 && FD_ISSET(_private->xfer->sock, &_private->fdr))
-        {
-            /* Receive the server response */
-            break;
-        }
-        else if (res == -TFTP_ETIMEOUT)
-        {
-            tftp_printf("tftp wait response timeout. retry\n");
-            max_retry --;
-            continue;
-        }
-        else
-        {
-            tftp_printf("tftp wait response err:%d. exit\n", res);
-            max_retry = 0;
-            client->err = res;
-            break;
-        }
+        client->err = -TFTP_EMEM;
+        return -TFTP_EMEM;
     }
-
-    /* More than the maximum number of retries. exit */
-    if (max_retry == 0)
+    /* Send Read File Request */
+    res = tftp_client_request(client, TFTP_CMD_RRQ, remote_name, pack);
+    if (res < 0)
     {
+        free(pack);
+        client->err = res;
         return res;
     }
 
@@ -291,78 +295,69 @@ int tftp_client_pull(struct tftp_client *client, const char *remote_name, const
     if (fp == NULL)
     {
         tftp_printf("open file \"%s\" error.\n", local_name);
+        tftp_transfer_err(_private->xfer, 0, "open file err!");
+        free(pack);
         client->err = -TFTP_EFILE;
         return -TFTP_EFILE;
     }
-    pack = malloc(sizeof(struct tftp_packet));
-    if (pack == NULL)
+    tftp_window_init(&win, fp);
+    /* Options taken, ACK block 0 starts the data */
+    if (res == TFTP_CMD_OACK)
     {
-        /* malloc failed. send err msg and exit */
-        tftp_transfer_err(_private->xfer, 0, "malloc pack failed!");
-        tftp_file_close(fp);
-        client->err = -TFTP_EMEM;
-        return -TFTP_EMEM;
+        tftp_window_resp_ack(_private->xfer, &win);
     }
+    max_retry = client->max_retry;
     while (1)
     {
-        /* Receiving data from server */
-        recv_size = tftp_read_data(_private->xfer, pack, \
-            (int)((uint8_t *)&pack->data - (uint8_t *)pack) + _private->xfer->blksize);
-        if (recv_size < 0)
-        {
-            tftp_printf("read data err[%d]! exit\n", recv_size);
-            client->err = -TFTP_EDATA;
-            break;
-        }
-        /* Write data to file */
-        w_size = tftp_file_write(fp, file_size, &pack->data, recv_size);
-        if (w_size != recv_size)
-        {
-            tftp_printf("write file err! exit\n");
-            tftp_transfer_err(_private->xfer, 0, "write file err!");
-            client->err = -TFTP_EFILE;
-            break;
-        }
-        file_size += recv_size;
-        /* Data less than one package. Completion of reception */
-        if (recv_size < _private->xfer->blksize)
-        {
-            tftp_resp_ack(_private->xfer);
-            break;
-        }
-        max_retry = client->max_retry;
-        while (max_retry)
+        /* Waiting for the server to send data */
+        res = tftp_client_select(_private);
+        if (res > 0 && FD_ISSET(_private->xfer->sock, &_private->fdr))
         {
-            /* Send a response signal */
-            tftp_resp_ack(_private->xfer);
-            /* Waiting for the server to send data */
-            res = tftp_client_select(_private);
-            if (res > 0 && FD_ISSET(_private->xfer->sock, &_private->fdr))
+            /* Receiving data from server, ACKed per window */
+            res = tftp_window_recv(_private->xfer, &win, pack);
+            if (res < 0)
             {
+                tftp_printf("read data err[%d]! exit\n", res);
+                client->err = -TFTP_EDATA;
                 break;
             }
-            else if (res == -TFTP_ETIMEOUT)
+            if (res == 1)
             {
-                tftp_printf("tftp wait response timeout. retry\n");
-                max_retry --;
+                tftp_window_report(_private->xfer, &win);
+                break;
             }
-            else
+            max_retry = client->max_retry;
+        }
+        else if (res == -TFTP_ETIMEOUT)
+        {
+            /* ACK the last block held in order again */
+            if (tftp_xfer_rto_backoff(_private->xfer) != TFTP_OK && --max_retry == 0)
             {
-                tftp_printf("tftp wait response err:%d. exit\n", res);
-                max_retry = 0;
+                tftp_printf("tftp wait response timeout. exit\n");
                 client->err = res;
                 break;
             }
+            tftp_window_resp_ack(_private->xfer, &win);
         }
-        if (max_retry == 0)
+        else
         {
+            tftp_printf("tftp wait response err:%d. exit\n", res);
+            client->err = res;
             break;
         }
     }
     /* close file */
     tftp_file_close(fp);
     free(pack);
-    return file_size;
+    return win.bytes;
+}
+
+int tftp_client_windowsize_set(struct tftp_client *client, int windowsize)
+{
+    struct tftp_client_private *_private;
+
+    _private = client->_private;
+    return tftp_xfer_windowsize_set(_private->xfer, windowsize);
 }
 
 int tftp_client_err(struct tftp_client *client)
@@ -19,6 +19,7 @@
 #include <stdlib.h>
 #include <string.h>
 #include "tftp.h"
+#include "tftp_xfer.h"
 
 RT_WEAK void *tftp_file_open(const char *fname, const char *mode, int is_write)
 {
@@ -54,6 +55,11 @@ RT_WEAK int tftp_file_read(void *handle, int pos, void *buff, int len)
 {
     int fd = (int)handle;
 
+    /* A window is read again from its oldest block when it is resent */
+    if (lseek(fd, pos, SEEK_SET) != pos)
+    {
+        return -1;
+    }
     return read(fd, buff, len);
 }
 
@@ -75,6 +81,7 @@ static void tftp_server_thread(void *param)
 #define _CR_MODE_CMD       (102)
 #define _IP_MODE_CMD       (103)
 #define _P_MODE_CMD        (104)
+#define _W_MODE_CMD        (105)
 #define _STOP_MODE_CMD     (107)
 #define _UNKNOWN_MODE_CMD  (0)
 
@@ -91,13 +98,14 @@ static const struct _tftp_cmd _cmd_tab[] =
     {"-w", "client write file to server", _CW_MODE_CMD},
     {"-r", "client read file from server", _CR_MODE_CMD},
     {"-p", "server port to listen on/connect to", _P_MODE_CMD},
+    {"-W", "window size, blocks per ACK (RFC 7440)", _W_MODE_CMD},
     {"--stop", "stop tftp server", _STOP_MODE_CMD},
 };
 
 static void _tftp_help(void)
 {
     int i;
-    printf("Usage: tftp [-s|-w|-r host] [path]\n");
+    printf("Usage: tftp [-s|-w|-r host] [-W n] [path]\n");
     printf("       tftp [-h|--stop]\n\n");
     for (i = 0; i < sizeof(_cmd_tab) / sizeof(_cmd_tab[0]); i++)
     {
@@ -107,6 +115,7 @@ static void _tftp_help(void)
     printf("    open server: tftp -s /\n");
     printf("    read  file : tftp -r 192.168.1.1 test.data\n");
     printf("    wriet file : tftp -w 192.168.1.1 test.data\n");
+    printf("    lock-step  : tftp -W 1 -r 192.168.1.1 test.data\n");
 }
 
 static int _tftp_msh(int argc, char *argv[])
@@ -116,6 +125,7 @@ static int _tftp_msh(int argc, char *argv[])
     char *ip = RT_NULL;
     char *path[2] = {0};
     int port = 0, stop = 0;
+    int windowsize = 0;
 
     if (argc == 1)
     {
@@ -165,6 +175,22 @@ static int _tftp_msh(int argc, char *argv[])
                 i ++;
             }
             break;
+        case _W_MODE_CMD:
+            if (windowsize != 0)
+            {
+                goto _help;
+            }
+            if ((i + 1) < argc)
+            {
+                windowsize = atoi(argv[i + 1]);
+                i ++;
+            }
+            if (windowsize < 1 || windowsize > XFER_WINDOW_SIZE_MAX)
+            {
+                printf("window size 1 ~ %d\n", XFER_WINDOW_SIZE_MAX);
+                return -1;
+            }
+            break;
         case _STOP_MODE_CMD:
             if (argc != 2)
             {
@@ -214,6 +240,10 @@ static int _tftp_msh(int argc, char *argv[])
         }
         server = tftp_server_create(path[0], port);
         tftp_server_write_set(server, 1);
+        if (windowsize != 0)
+        {
+            tftp_server_windowsize_set(server, windowsize);
+        }
         tid = rt_thread_create("tftps", tftp_server_thread, server, 2048, 18, 20);
         if (tid == NULL)
         {
@@ -235,6 +265,14 @@ static int _tftp_msh(int argc, char *argv[])
             path[1] = path[0];
         }
         client = tftp_client_create(ip, port);
+        if (client == RT_NULL)
+        {
+            return -1;
+        }
+        if (windowsize != 0)
+        {
+            tftp_client_windowsize_set(client, windowsize);
+        }
         if (tftp_mode == _CR_MODE_CMD)
         {
             printf("file size:%d\n", tftp_client_pull(client, path[0], path[1]));
@@ -9,6 +9,7 @@
  * 2019-11-18     tjrong       fix a bug in tftp_server_request_handle.
  */
 
+#include <rtthread.h>
 #include <stdio.h>
 #include <stdint.h>
 #include <stdlib.h>
@@ -24,6 +25,7 @@
 #define TFTP_SERVER_EVENT_TIMEOUT   (0x1 << 2)
 
 #define TFTP_SERVER_FILE_NAME_MAX   (512)
+#define TFTP_SERVER_IDLE_WAIT       (5000)
 
 #define TFTP_SERVER_REQ_READ    (0x0)
 #define TFTP_SERVER_REQ_WRITE   (0x1)
@@ -38,8 +40,9 @@ struct tftp_client_xfer
     struct tftp_xfer *xfer;
     int16_t w_r;
     int16_t retry;
-    int pos;
-    int last_read;
+    int16_t oack;           /* Options taken, OACK resent until the client answers */
+    uint32_t deadline;      /* Retransmission due, ms */
+    struct tftp_window win;
     void *fd;
 };
 
@@ -57,8 +60,12 @@ static int tftp_server_select(struct tftp_server *server)
     struct tftp_server_private *_private;
     int max_sock, i;
     int ret;
+    int32_t wait, left;
+    uint32_t now;
 
     _private = server->_private;
+    wait = TFTP_SERVER_IDLE_WAIT;
+    now = rt_tick_get_millisecond();
     FD_ZERO(&_private->fdr);
     /* Select server */
     FD_SET(_private->server_xfer->sock, &_private->fdr);
@@ -73,11 +80,21 @@ static int tftp_server_select(struct tftp_server *server)
             {
                 max_sock = _private->client_table[i].xfer->sock;
             }
+            /* Wake for the earliest retransmission */
+            left = (int32_t)(_private->client_table[i].deadline - now);
+            if (left < 0)
+            {
+                left = 0;
+            }
+            if (left < wait)
+            {
+                wait = left;
+            }
         }
     }
     /* Setting timeout time */
-    _private->timeout.tv_sec = 5;
-    _private->timeout.tv_usec = 0;
+    _private->timeout.tv_sec = wait / 1000;
+    _private->timeout.tv_usec = (wait % 1000) * 1000;
     ret = select(max_sock + 1, &_private->fdr, NULL, NULL, (void *)&_private->timeout);
     if (ret == 0)
     {
@@ -149,87 +166,38 @@ static void tftp_client_xfer_destroy(struct tftp_server *server, struct tftp_cli
     tftp_client_xfer_delete(server, client->xfer);
 }
 
-static void tftp_server_send_file(struct tftp_server *server, struct tftp_client_xfer *client, struct tftp_packet *packet, bool resend)
-{
-    int r_size, s_size;
-    int retry = TFTP_MAX_RETRY;
-
-    if (resend == false)
-    {
-        client->pos += client->last_read;
-    }
-    /* read file */
-    r_size = tftp_file_read(client->fd, client->pos, &packet->data, client->xfer->blksize);
-    if (r_size < 0)
-    {
-        r_size = 0;
-    }
-    while (1)
-    {
-        /* Send data to client */
-        s_size = tftp_write_data(client->xfer, packet, r_size + 4);
-        if (r_size == (s_size - 4))
-        {
-            break;
-        }
-        /* Failed to send data. retry */
-        if (retry-- == 0)
-        {
-            break;
-        }
-    }
-    /* Maximum number of retries */
-    if (retry == 0)
-    {
-        /* Destroy client connection */
-        tftp_client_xfer_destroy(server, client);
-    }
-    else
-    {
-        client->last_read = r_size;
-    }
-}
-
-static void tftp_server_send_ack(struct tftp_server *server, struct tftp_client_xfer *client)
+static void tftp_server_transf_done(struct tftp_server *server, struct tftp_client_xfer *client)
 {
-    int retry = TFTP_MAX_RETRY;
-    bool res;
-
-    while (1)
-    {
-        /* send ack */
-        res = tftp_resp_ack(client->xfer);
-        if (res == TFTP_OK)
-        {
-            break;
-        }
-        /* send failed. retry */
-        if (retry-- == 0)
-        {
-            break;
-        }
-    }
-    if (retry == 0)
-    {
-        /* Maximum number of retries */
-        tftp_client_xfer_destroy(server, client);
-    }
+    tftp_window_report(client->xfer, &client->win);
+    tftp_client_xfer_destroy(server, client);
 }
 
 static void tftp_server_transf_handle(struct tftp_server *server, struct tftp_client_xfer *client, int event, struct tftp_packet *packet)
 {
+    uint16_t block;
+    int res;
+
     switch (event)
     {
     case TFTP_SERVER_EVENT_CONNECT:
-        if (client->w_r == TFTP_SERVER_REQ_READ)
+        if (client->oack)
+        {
+            /* Options taken, data or ACKs follow the client's answer */
+            res = tftp_send_oack(client->xfer, client->oack);
+        }
+        else if (client->w_r == TFTP_SERVER_REQ_READ)
         {
             /* Read the file request and return the file data */
-            tftp_server_send_file(server, client, packet, false);
+            res = tftp_window_send(client->xfer, &client->win, packet);
         }
         else
         {
             /* Write file request, return ACK */
-            tftp_server_send_ack(server, client);
+            res = tftp_window_resp_ack(client->xfer, &client->win);
+        }
+        if (res != TFTP_OK)
+        {
+            tftp_client_xfer_destroy(server, client);
         }
         break;
     case TFTP_SERVER_EVENT_DATA:
@@ -237,95 +205,85 @@ static void tftp_server_transf_handle(struct tftp_server *server, struct tftp_cl
         if (client->w_r == TFTP_SERVER_REQ_READ)
         {
             /* If reques is read. Receive ACK */
-            if (tftp_wait_ack(client->xfer) == TFTP_OK)
-            {
-                /* Receive ACK success. If it's the last package of data, close client */
-                if (client->last_read < client->xfer->blksize)
-                {
-                    tftp_client_xfer_destroy(server, client);
-                    break;
-                }
-                /* Receive ACK success. Continue sending data */
-                tftp_server_send_file(server, client, packet, false);
-                client->retry = TFTP_MAX_RETRY;
-            }
-            else
+            if (tftp_recv_ack(client->xfer, &block) != TFTP_OK)
             {
                 /* Receive ACK failed. close client */
                 tftp_transfer_err(client->xfer, 0, "err ack!");
                 tftp_client_xfer_destroy(server, client);
+                break;
+            }
+            client->oack = 0;
+            /* The last package of data acknowledged, close client */
+            if (tftp_window_ack(client->xfer, &client->win, block) == 1)
+            {
+                tftp_server_transf_done(server, client);
+                break;
             }
+            /* Slide the window. Continue sending data */
+            if (tftp_window_send(client->xfer, &client->win, packet) != TFTP_OK)
+            {
+                tftp_client_xfer_destroy(server, client);
+                break;
+            }
+            client->retry = TFTP_MAX_RETRY;
         }
         else
         {
-            /* Write File Request handle */
-            int recv_size, w_size;
-            /* Receiving File Data from Client */
-            recv_size = tftp_read_data(client->xfer, packet,
-                                       (int)((uint8_t *)&packet->data - (uint8_t *)packet) + client->xfer->blksize);
-            if (recv_size < 0)
+            /* Write File Request handle, ACKed per window */
+            res = tftp_window_recv(client->xfer, &client->win, packet);
+            if (res < 0)
             {
                 /* Receiving failed. */
                 tftp_printf("server read data err! disconnect client\n");
                 tftp_client_xfer_destroy(server, client);
+                break;
             }
-            else
+            client->oack = 0;
+            /* Receive the last packet of data. close client */
+            if (res == 1)
             {
-                /* write file */
-                w_size = tftp_file_write(client->fd, client->pos, &packet->data, recv_size);
-                if (w_size != recv_size)
-                {
-                    /* Write file error, close connection */
-                    tftp_printf("server write file err! disconnect client\n");
-                    tftp_transfer_err(client->xfer, 0, "write file err!");
-                    tftp_client_xfer_destroy(server, client);
-                    break;
-                }
-                /* Reply ack */
-                tftp_server_send_ack(server, client);
-                client->pos += recv_size;
-                /* Receive the last packet of data. close client */
-                if (recv_size < client->xfer->blksize)
-                {
-                    tftp_client_xfer_destroy(server, client);
-                }
+                tftp_server_transf_done(server, client);
+                break;
             }
+            client->retry = TFTP_MAX_RETRY;
         }
         break;
     case TFTP_SERVER_EVENT_TIMEOUT:
-        /* Timeout handle */
-        if (client->w_r == TFTP_SERVER_REQ_READ)
+        /* Timeout handle, retries count once the RTO is at its ceiling */
+        if (tftp_xfer_rto_backoff(client->xfer) != TFTP_OK && client->retry-- <= 0)
         {
-            /* resend file */
-            if (client->retry > 0)
-            {
-                tftp_server_send_file(server, client, packet, true);
-                client->retry--;
-            }
-            else
-            {
-                /* Maximum number of retransmissions */
-                tftp_client_xfer_destroy(server, client);
-            }
+            /* Maximum number of retransmissions */
+            tftp_client_xfer_destroy(server, client);
+            break;
+        }
+        if (client->oack)
+        {
+            res = tftp_send_oack(client->xfer, client->oack);
+        }
+        else if (client->w_r == TFTP_SERVER_REQ_READ)
+        {
+            /* resend from the oldest block not acknowledged */
+            tftp_window_rewind(&client->win);
+            res = tftp_window_send(client->xfer, &client->win, packet);
         }
         else
         {
-            if (client->retry > 0)
-            {
-                /* resend ack */
-                tftp_server_send_ack(server, client);
-                client->retry--;
-            }
-            else
-            {
-                tftp_client_xfer_destroy(server, client);
-            }
+            /* resend ack */
+            res = tftp_window_resp_ack(client->xfer, &client->win);
+        }
+        if (res != TFTP_OK)
+        {
+            tftp_client_xfer_destroy(server, client);
         }
         break;
     default:
         tftp_printf("warr!! unknown event:%d\n", event);
         break;
     }
+    if (client->xfer != NULL)
+    {
+        client->deadline = rt_tick_get_millisecond() + client->xfer->rto;
+    }
 }
 
 static struct tftp_client_xfer *tftp_server_request_handle(struct tftp_server *server, struct tftp_packet *packet)
@@ -337,8 +295,7 @@ static struct tftp_client_xfer *tftp_server_request_handle(struct tftp_server *s
     struct tftp_client_xfer *client_xfer;
     void *fd = NULL;
     char *mode;
-    char *blksize_str;
-    int blocksize;
+    int opts;
 
     _private = server->_private;
     /* Receiving client requests */
@@ -362,18 +319,11 @@ static struct tftp_client_xfer *tftp_server_request_handle(struct tftp_server *s
     /* Get transfer mode */
     mode = path + strlen(path) + 1;
     tftp_xfer_mode_set(xfer, mode);
-    /* Get block size */
-    blksize_str = mode + strlen(mode) + 1;
-    if (strcmp(blksize_str, "blksize") == 0)
+    /* Get block size and window size, RFC 2347 options */
+    opts = tftp_xfer_options_parse(xfer, mode + strlen(mode) + 1, (char *)packet + sizeof(struct tftp_packet));
+    if (xfer->windowsize > server->windowsize)
     {
-        blocksize = atoi(blksize_str + strlen(blksize_str) + 1);
-        if (tftp_xfer_blksize_set(xfer, blocksize) != TFTP_OK)
-        {
-            tftp_printf("set block size err:%d\n", blocksize);
-            tftp_transfer_err(xfer, 0, "block size err!");
-            tftp_xfer_destroy(xfer);
-            return NULL;
-        }
+        tftp_xfer_windowsize_set(xfer, server->windowsize);
     }
     /* Get full file path */
     name_len = strlen(path) + strlen(server->root_name) + 2;
@@ -431,9 +381,9 @@ static struct tftp_client_xfer *tftp_server_request_handle(struct tftp_server *s
         client_xfer->w_r = ntohs(packet->cmd) == TFTP_CMD_RRQ ? \
             TFTP_SERVER_REQ_READ : TFTP_SERVER_REQ_WRITE;
         client_xfer->retry = TFTP_MAX_RETRY;
+        client_xfer->oack = opts;
         client_xfer->fd = fd;
-        client_xfer->pos = 0;
-        client_xfer->last_read = 0;
+        tftp_window_init(&client_xfer->win, fd);
     }
     return client_xfer;
 }
@@ -444,6 +394,7 @@ void tftp_server_run(struct tftp_server *server)
     struct tftp_packet *packet;
     struct tftp_server_private *_private;
     int res, i;
+    uint32_t now;
     struct tftp_client_xfer *client_xfer;
 
     if (server == NULL)
@@ -478,24 +429,11 @@ void tftp_server_run(struct tftp_server *server)
     {
         /* Waiting client data */
         res = tftp_server_select(server);
-        if (res == -TFTP_ETIMEOUT)
-        {
-            /* Waiting for data timeout */
-            for (i = 0; i < _private->table_num; i++)
-            {
-                if (_private->client_table[i].xfer != NULL)
-                {
-                    client_xfer = tftp_client_xfer_get(server, i);
-                    tftp_server_transf_handle(server, client_xfer, TFTP_SERVER_EVENT_TIMEOUT, packet);
-                }
-            }
-            continue;
-        }
-        else if (res < 0)
+        if (res < 0 && res != -TFTP_ETIMEOUT)
         {
             break;
         }
-        else
+        else if (res > 0)
         {
             /* Connection request handle */
             if (FD_ISSET(_private->server_xfer->sock, &_private->fdr))
@@ -517,6 +455,17 @@ void tftp_server_run(struct tftp_server *server)
                 }
             }
         }
+        /* Waiting for data timeout, each client on its own RTO */
+        now = rt_tick_get_millisecond();
+        for (i = 0; i < _private->table_num; i++)
+        {
+            if (_private->client_table[i].xfer != NULL &&
+                (int32_t)(now - _private->client_table[i].deadline) >= 0)
+            {
+                client_xfer = tftp_client_xfer_get(server, i);
+                tftp_server_transf_handle(server, client_xfer, TFTP_SERVER_EVENT_TIMEOUT, packet);
+            }
+        }
     }
     /* exit. destroy all client */
     for (i = 0; i < _private->table_num; i++)
@@ -569,6 +518,7 @@ struct tftp_server *tftp_server_create(const char *root_name, int port)
     }
     rt_memset(_private->client_table, 0, mem_len);
     _private->table_num = TFTP_SERVER_CONNECT_MAX;
+    server->windowsize = XFER_WINDOW_SIZE_MAX;
     return server;
 }
 
@@ -580,6 +530,14 @@ void tftp_server_write_set(struct tftp_server *server, int is_write)
     }
 }
 
+void tftp_server_windowsize_set(struct tftp_server *server, int windowsize)
+{
+    if (server != NULL && windowsize >= 1 && windowsize <= XFER_WINDOW_SIZE_MAX)
+    {
+        server->windowsize = windowsize;
+    }
+}
+
 void tftp_server_destroy(struct tftp_server *server)
 {
     if (server != NULL)
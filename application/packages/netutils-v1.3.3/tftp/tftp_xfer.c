@@ -8,6 +8,7 @@
  * 2019-02-26     tyx          first implementation
  */
 
+#include <rtthread.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -24,8 +25,13 @@ struct tftp_xfer_private
     char *ip_addr;
     uint16_t port;
     uint16_t block;
+    int srtt;       /* Smoothed RTT, ms << 3 */
+    int rttvar;     /* RTT variation, ms << 2 */
 };
 
+extern int tftp_file_write(void *handle, int pos, void *buff, int len);
+extern int tftp_file_read(void *handle, int pos, void *buff, int len);
+
 static int tftp_recv_raw_data(struct tftp_xfer *xfer, void *buff, int len)
 {
     struct tftp_xfer_private *_private;
@@ -121,6 +127,34 @@ int tftp_wait_ack(struct tftp_xfer *xfer)
     return -TFTP_EOTHER;
 }
 
+int tftp_recv_ack(struct tftp_xfer *xfer, uint16_t *block)
+{
+    int r_size;
+    uint16_t recv_buff[4];
+
+    /* Receiving raw data, an ACK of any block */
+    r_size = tftp_recv_raw_data(xfer, recv_buff, sizeof(recv_buff));
+    if (r_size < 0)
+    {
+        return r_size;
+    }
+    else if (r_size < 4)
+    {
+        return -TFTP_EDATA;
+    }
+    else if (ntohs(recv_buff[0]) == TFTP_CMD_ERROR)
+    {
+        tftp_printf("err[%d] code:%d\n", ntohs(recv_buff[1]), ntohs(recv_buff[1]));
+        return -TFTP_ECMD;
+    }
+    else if (ntohs(recv_buff[0]) != TFTP_CMD_ACK)
+    {
+        return -TFTP_EACK;
+    }
+    *block = ntohs(recv_buff[1]);
+    return TFTP_OK;
+}
+
 int tftp_read_data(struct tftp_xfer *xfer, struct tftp_packet *pack, int len)
 {
     int r_size;
@@ -150,9 +184,9 @@ int tftp_read_data(struct tftp_xfer *xfer, struct tftp_packet *pack, int len)
         tftp_printf("err[%d] msg:%s code:%d\n", ntohs(pack->info.code), pack->data, ntohs(pack->info.code));
         return -TFTP_ECMD;
     }
-    else if ((_private->block + 1) != pack->info.block)
+    else if (ntohs(pack->cmd) == TFTP_CMD_DATA)
     {
-        tftp_printf("Bad block recv:%d != check:%d\n", _private->block + 1, pack->info.block);
+        /* Out of order or again, the window decides */
         return -TFTP_EBLK;
     }
 
@@ -160,6 +194,14 @@ int tftp_read_data(struct tftp_xfer *xfer, struct tftp_packet *pack, int len)
 }
 
 int tftp_write_data(struct tftp_xfer *xfer, struct tftp_packet *pack, int len)
+{
+    struct tftp_xfer_private *_private;
+
+    _private = xfer->_private;
+    return tftp_write_block(xfer, pack, _private->block, len);
+}
+
+int tftp_write_block(struct tftp_xfer *xfer, struct tftp_packet *pack, uint16_t block, int len)
 {
     struct tftp_xfer_private *_private;
     int size;
@@ -167,7 +209,7 @@ int tftp_write_data(struct tftp_xfer *xfer, struct tftp_packet *pack, int len)
     _private = xfer->_private;
     /* Packing header */
     pack->cmd = htons(TFTP_CMD_DATA);
-    pack->info.block = htons(_private->block);
+    pack->info.block = htons(block);
     /* Send data */
     size = sendto(xfer->sock, pack, len, 0, (struct sockaddr *)&_private->sender, sizeof(struct sockaddr_in));
     if (size != len)
@@ -204,6 +246,11 @@ int tftp_send_request(struct tftp_xfer *xfer, uint16_t cmd, const char *remote_f
     send_packet->cmd = htons(cmd);
     size = rt_sprintf(send_packet->info.filename, "%s%c%s%c%s%c%d%c%s%c%d%c",
         remote_file, 0, xfer->mode, 0, "blksize", 0, xfer->blksize, 0,"tsize", 0, 0, 0) + 2;
+    /* RFC 7440, only asked for when more than lock-step is wanted */
+    if (xfer->windowsize > 1)
+    {
+        size += rt_sprintf((char *)send_packet + size, "%s%c%d%c", "windowsize", 0, xfer->windowsize, 0);
+    }
     /* send data */
     r_size = sendto(xfer->sock, send_packet, size, 0,
         (struct sockaddr *)&_private->server, sizeof(struct sockaddr_in));
@@ -234,8 +281,8 @@ struct tftp_xfer *tftp_recv_request(struct tftp_xfer *xfer, struct tftp_packet *
     /* get packet size */
     mem_size = sizeof(struct tftp_packet);
     rt_memset(packet, 0, mem_size);
-    /* Receiving raw data */
-    size = tftp_recv_raw_data(xfer, packet, mem_size);
+    /* Receiving raw data, the options are parsed as strings and stay terminated */
+    size = tftp_recv_raw_data(xfer, packet, mem_size - 1);
     if (size > 0)
     {
         /* Determine the type of request */
@@ -328,6 +375,368 @@ int tftp_xfer_blksize_set(struct tftp_xfer *xfer, int blksize)
     return TFTP_OK;
 }
 
+int tftp_xfer_windowsize_set(struct tftp_xfer *xfer, int windowsize)
+{
+    if ((windowsize < 1) || (windowsize > XFER_WINDOW_SIZE_MAX))
+    {
+        return -TFTP_EINVAL;
+    }
+    xfer->windowsize = windowsize;
+
+    return TFTP_OK;
+}
+
+int tftp_xfer_options_parse(struct tftp_xfer *xfer, const char *opt, const char *end)
+{
+    const char *val;
+    int opts = 0;
+    int num;
+
+    /* "name\0value\0" pairs, RFC 2347. Values above ours are lowered, the rest is ignored */
+    while (opt < end && *opt != '\0')
+    {
+        val = opt + strlen(opt) + 1;
+        if (val >= end)
+        {
+            break;
+        }
+        num = atoi(val);
+        if (rt_strcasecmp(opt, "blksize") == 0)
+        {
+            if (num > XFER_DATA_SIZE_MAX)
+            {
+                num = XFER_DATA_SIZE_MAX;
+            }
+            if (tftp_xfer_blksize_set(xfer, num) == TFTP_OK)
+            {
+                opts |= TFTP_OPT_BLKSIZE;
+            }
+        }
+        else if (rt_strcasecmp(opt, "windowsize") == 0)
+        {
+            if (num > XFER_WINDOW_SIZE_MAX)
+            {
+                num = XFER_WINDOW_SIZE_MAX;
+            }
+            if (tftp_xfer_windowsize_set(xfer, num) == TFTP_OK)
+            {
+                opts |= TFTP_OPT_WINDOWSIZE;
+            }
+        }
+        opt = val + strlen(val) + 1;
+    }
+
+    return opts;
+}
+
+void tftp_xfer_rtt_sample(struct tftp_xfer *xfer, int rtt)
+{
+    struct tftp_xfer_private *_private;
+    int delta;
+
+    _private = xfer->_private;
+    /* RFC 6298 estimator in the scaled integer form */
+    if (_private->srtt == 0)
+    {
+        _private->srtt = rtt << 3;
+        _private->rttvar = rtt << 1;
+    }
+    else
+    {
+        delta = rtt - (_private->srtt >> 3);
+        _private->srtt += delta;
+        if (delta < 0)
+        {
+            delta = -delta;
+        }
+        _private->rttvar += delta - (_private->rttvar >> 2);
+    }
+    xfer->rto = (_private->srtt >> 3) + _private->rttvar;
+    if (xfer->rto < TFTP_RTO_MIN)
+    {
+        xfer->rto = TFTP_RTO_MIN;
+    }
+    else if (xfer->rto > TFTP_RTO_MAX)
+    {
+        xfer->rto = TFTP_RTO_MAX;
+    }
+}
+
+int tftp_xfer_rto_backoff(struct tftp_xfer *xfer)
+{
+    /* Once at the ceiling every further timeout counts as a retry */
+    if (xfer->rto >= TFTP_RTO_MAX)
+    {
+        return -TFTP_ETIMEOUT;
+    }
+    xfer->rto <<= 1;
+    if (xfer->rto > TFTP_RTO_MAX)
+    {
+        xfer->rto = TFTP_RTO_MAX;
+    }
+
+    return TFTP_OK;
+}
+
+int tftp_peek_cmd(struct tftp_xfer *xfer)
+{
+    struct tftp_xfer_private *_private;
+    int sender_len = sizeof(struct sockaddr_in);
+    uint16_t cmd;
+    int r_size;
+
+    /* Opcode of the next packet, left queued */
+    _private = xfer->_private;
+    r_size = recvfrom(xfer->sock, &cmd, sizeof(cmd), MSG_PEEK, (struct sockaddr *)&_private->sender, (socklen_t *)&sender_len);
+    if (r_size < 0)
+    {
+        return -TFTP_EXFER;
+    }
+    else if (r_size < (int)sizeof(cmd))
+    {
+        return -TFTP_EDATA;
+    }
+    return ntohs(cmd);
+}
+
+int tftp_send_oack(struct tftp_xfer *xfer, int opts)
+{
+    uint16_t snd_packet[24];
+    struct tftp_xfer_private *_private;
+    char *opt;
+    int size;
+
+    _private = xfer->_private;
+    /* Echo the options taken, with the values in use */
+    snd_packet[0] = htons(TFTP_CMD_OACK);
+    opt = (char *)&snd_packet[1];
+    size = 0;
+    if (opts & TFTP_OPT_BLKSIZE)
+    {
+        size += rt_sprintf(opt + size, "%s%c%d%c", "blksize", 0, xfer->blksize, 0);
+    }
+    if (opts & TFTP_OPT_WINDOWSIZE)
+    {
+        size += rt_sprintf(opt + size, "%s%c%d%c", "windowsize", 0, xfer->windowsize, 0);
+    }
+    size += 2;
+    if (sendto(xfer->sock, snd_packet, size, 0, (struct sockaddr *)&_private->sender, sizeof(struct sockaddr_in)) != size)
+    {
+        return -TFTP_EXFER;
+    }
+    return TFTP_OK;
+}
+
+int tftp_recv_oack(struct tftp_xfer *xfer, struct tftp_packet *pack, int len)
+{
+    int r_size;
+
+    r_size = tftp_recv_raw_data(xfer, pack, len - 1);
+    if (r_size < 0)
+    {
+        return r_size;
+    }
+    else if (r_size < 2 || ntohs(pack->cmd) != TFTP_CMD_OACK)
+    {
+        return -TFTP_ECMD;
+    }
+    ((char *)pack)[r_size] = '\0';
+    /* An option missing from the OACK was refused, its default applies */
+    xfer->blksize = XFER_DATA_SIZE_MAX;
+    xfer->windowsize = 1;
+    tftp_xfer_options_parse(xfer, pack->info.filename, (char *)pack + r_size);
+
+    return TFTP_OK;
+}
+
+void tftp_window_init(struct tftp_window *win, void *fd)
+{
+    rt_memset(win, 0, sizeof(struct tftp_window));
+    win->fd = fd;
+    win->base = 1;
+    win->next = 1;
+    win->high = 1;
+    win->start = rt_tick_get_millisecond();
+}
+
+int tftp_window_send(struct tftp_xfer *xfer, struct tftp_window *win, struct tftp_packet *pack)
+{
+    int r_size, s_size;
+
+    /* Fill the window from next, never past the final block */
+    while ((win->next - win->base) < (uint32_t)xfer->windowsize &&
+           (win->last == 0 || win->next <= win->last))
+    {
+        r_size = tftp_file_read(win->fd, (win->next - 1) * xfer->blksize, &pack->data, xfer->blksize);
+        if (r_size < 0)
+        {
+            tftp_transfer_err(xfer, 0, "read file err!");
+            return -TFTP_EFILE;
+        }
+        s_size = tftp_write_block(xfer, pack, (uint16_t)win->next, r_size + 4);
+        if (s_size != (r_size + 4))
+        {
+            return -TFTP_EXFER;
+        }
+        if (r_size < xfer->blksize)
+        {
+            win->last = win->next;
+        }
+        if (win->next < win->high)
+        {
+            win->resent++;
+        }
+        else
+        {
+            /* Only first transmissions are timed (Karn) */
+            if (win->timed == 0)
+            {
+                win->timed = win->next;
+                win->sent_at = rt_tick_get_millisecond();
+            }
+            win->high = win->next + 1;
+            win->bytes += r_size;
+        }
+        win->next++;
+    }
+
+    return TFTP_OK;
+}
+
+int tftp_window_ack(struct tftp_xfer *xfer, struct tftp_window *win, uint16_t block)
+{
+    uint32_t acked;
+
+    /* Wire number to block count, anything not yet sent is stale */
+    acked = win->base - 1 + (uint16_t)(block - (uint16_t)(win->base - 1));
+    if (acked >= win->next)
+    {
+        return TFTP_OK;
+    }
+    if (win->timed != 0 && acked >= win->timed)
+    {
+        tftp_xfer_rtt_sample(xfer, rt_tick_get_millisecond() - win->sent_at);
+        win->timed = 0;
+    }
+    if (acked == win->base - 1)
+    {
+        /*
+         * No progress: a gap reported from inside the window. Go back once
+         * per base, a lock-step transfer never answers a duplicate ACK
+         * (Sorcerer's Apprentice, RFC 1123).
+         */
+        if (win->next == win->base || xfer->windowsize == 1 || win->rewind == win->base)
+        {
+            return TFTP_OK;
+        }
+        win->rewind = win->base;
+        tftp_window_rewind(win);
+        return TFTP_OK;
+    }
+    win->base = acked + 1;
+    if (win->last != 0 && acked == win->last)
+    {
+        return 1;
+    }
+    if (win->next != win->base)
+    {
+        /* ACK from inside the window, the blocks after it were lost */
+        tftp_window_rewind(win);
+    }
+    return TFTP_OK;
+}
+
+void tftp_window_rewind(struct tftp_window *win)
+{
+    win->next = win->base;
+    win->timed = 0;
+}
+
+int tftp_window_resp_ack(struct tftp_xfer *xfer, struct tftp_window *win)
+{
+    win->count = 0;
+    win->timed = 0;
+    return tftp_resp_ack(xfer);
+}
+
+int tftp_window_recv(struct tftp_xfer *xfer, struct tftp_window *win, struct tftp_packet *pack)
+{
+    int recv_size, w_size;
+    int16_t ahead;
+
+    recv_size = tftp_read_data(xfer, pack, (int)((uint8_t *)&pack->data - (uint8_t *)pack) + xfer->blksize);
+    if (recv_size == -TFTP_EBLK)
+    {
+        win->unordered++;
+        ahead = (int16_t)(ntohs(pack->info.block) - (uint16_t)win->base);
+        /*
+         * A block past the expected one is a gap, reported once. A resent
+         * window is answered at its end, the last block already held.
+         */
+        if ((ahead > 0 && !win->gap) || ahead == -1)
+        {
+            if (ahead > 0)
+            {
+                win->gap = true;
+            }
+            return tftp_window_resp_ack(xfer, win);
+        }
+        return TFTP_OK;
+    }
+    else if (recv_size == -TFTP_EOTHER && ntohs(pack->cmd) == TFTP_CMD_OACK && win->base == 1)
+    {
+        /* The OACK again, our ACK of block 0 was lost */
+        return tftp_window_resp_ack(xfer, win);
+    }
+    else if (recv_size < 0)
+    {
+        return recv_size;
+    }
+    w_size = tftp_file_write(win->fd, (win->base - 1) * xfer->blksize, &pack->data, recv_size);
+    if (w_size != recv_size)
+    {
+        tftp_transfer_err(xfer, 0, "write file err!");
+        return -TFTP_EFILE;
+    }
+    if (win->timed == win->base)
+    {
+        tftp_xfer_rtt_sample(xfer, rt_tick_get_millisecond() - win->sent_at);
+        win->timed = 0;
+    }
+    win->bytes += recv_size;
+    win->base++;
+    win->gap = false;
+    /* Data less than one package. Completion of reception */
+    if (recv_size < xfer->blksize)
+    {
+        tftp_resp_ack(xfer);
+        return 1;
+    }
+    if (++win->count >= (uint32_t)xfer->windowsize)
+    {
+        win->count = 0;
+        /* Time the round trip to the first block of the next window */
+        win->timed = win->base;
+        win->sent_at = rt_tick_get_millisecond();
+        return tftp_resp_ack(xfer);
+    }
+    return TFTP_OK;
+}
+
+void tftp_window_report(struct tftp_xfer *xfer, struct tftp_window *win)
+{
+    uint32_t ms;
+
+    ms = rt_tick_get_millisecond() - win->start;
+    if (ms == 0)
+    {
+        ms = 1;
+    }
+    tftp_printf("tftp: %d bytes in %d ms, %d KB/s, window %d, rto %d ms, resent %d, unordered %d\n",
+                (int)win->bytes, (int)ms, (int)((uint64_t)win->bytes * 1000 / 1024 / ms),
+                xfer->windowsize, xfer->rto, (int)win->resent, (int)win->unordered);
+}
+
 struct tftp_xfer *tftp_xfer_create(const char *ip_addr, int port)
 {
     int sock;
@@ -362,6 +771,8 @@ struct tftp_xfer *tftp_xfer_create(const char *ip_addr, int port)
     xfer->sock = sock;
     xfer->mode = rt_strdup(TFTP_XFER_OCTET);
     xfer->blksize = XFER_DATA_SIZE_MAX;
+    xfer->windowsize = 1;
+    xfer->rto = TFTP_RTO_INIT;
     xfer->_private = _private;
     return xfer;
 }
@@ -19,6 +19,10 @@
 #define TFTP_CMD_DATA       (3) /*Data (DATA)*/
 #define TFTP_CMD_ACK        (4) /*Acknowledgment (ACK)*/
 #define TFTP_CMD_ERROR      (5) /*Error (ERROR)*/
+#define TFTP_CMD_OACK       (6) /*Option Acknowledgment (OACK), RFC 2347*/
+
+#define TFTP_OPT_BLKSIZE    (0x01)
+#define TFTP_OPT_WINDOWSIZE (0x02)
 
 #define TFTP_XFER_OCTET ("octet")
 #define TFTP_XFER_ASCII ("ascii")
@@ -28,6 +32,15 @@
 
 #define XFER_DATA_SIZE_MAX (512)
 
+/* RFC 7440 blocks in flight per ACK, bounded by DEFAULT_UDP_RECVMBOX_SIZE */
+#define XFER_WINDOW_SIZE_MAX (16)
+#define XFER_WINDOW_SIZE_DEFAULT (8)
+
+/* Retransmission timeout in ms, from measured round trips (RFC 6298) */
+#define TFTP_RTO_INIT (1000)
+#define TFTP_RTO_MIN  (100)
+#define TFTP_RTO_MAX  (5000)
+
 union file_info
 {
     uint16_t code;
@@ -47,21 +60,64 @@ struct tftp_xfer
     int sock;
     int type;
     int blksize;
+    int windowsize;
+    int rto;
     char *mode;
     void *_private;
 };
 
+/*
+ * Sliding window state of one transfer. The sender keeps up to windowsize
+ * blocks unacknowledged and goes back to the first of them on a timeout or
+ * an ACK from inside the window; the receiver ACKs every windowsize blocks
+ * and reports a gap with an ACK of the last block it holds in order.
+ * Block numbers count from 1 and do not wrap, the wire numbers do.
+ */
+struct tftp_window
+{
+    void *fd;
+    uint32_t base;          /* Sender: oldest unacknowledged block. Receiver: next block expected */
+    uint32_t next;          /* Sender: next block to send */
+    uint32_t high;          /* Sender: first block never sent */
+    uint32_t last;          /* Sender: the final, short block once read */
+    uint32_t rewind;        /* Sender: base of the last go-back, one per loss */
+    uint32_t count;         /* Receiver: blocks since the last ACK */
+    uint32_t timed;         /* Block that ends the running RTT sample, 0 when none */
+    uint32_t sent_at;       /* Start of that sample, ms */
+    uint32_t start;         /* Start of the transfer, ms */
+    uint32_t bytes;
+    uint32_t resent;        /* Blocks sent again */
+    uint32_t unordered;     /* Blocks received out of order or twice */
+    bool gap;               /* Receiver: the current gap is reported */
+};
+
 struct tftp_xfer *tftp_xfer_create(const char *ip_addr, int port);
 void tftp_xfer_destroy(struct tftp_xfer *xfer);
 int tftp_send_request(struct tftp_xfer *xfer, uint16_t cmd, const char *remote_file);
 struct tftp_xfer *tftp_recv_request(struct tftp_xfer *xfer, struct tftp_packet *packet);
 void tftp_xfer_mode_set(struct tftp_xfer *xfer, const char *mode);
 int tftp_xfer_blksize_set(struct tftp_xfer *xfer, int blksize);
+int tftp_xfer_windowsize_set(struct tftp_xfer *xfer, int windowsize);
+int tftp_xfer_options_parse(struct tftp_xfer *xfer, const char *opt, const char *end);
+void tftp_xfer_rtt_sample(struct tftp_xfer *xfer, int rtt);
+int tftp_xfer_rto_backoff(struct tftp_xfer *xfer);
 int tftp_xfer_type_set(struct tftp_xfer *xfer, int type);
 int tftp_read_data(struct tftp_xfer *xfer, struct tftp_packet *pack, int size);
 void tftp_transfer_err(struct tftp_xfer *xfer, uint16_t err_no, const char *err_msg);
 int tftp_wait_ack(struct tftp_xfer *xfer);
 int tftp_write_data(struct tftp_xfer *xfer, struct tftp_packet *pack, int len);
 int tftp_resp_ack(struct tftp_xfer *xfer);
+int tftp_recv_ack(struct tftp_xfer *xfer, uint16_t *block);
+int tftp_write_block(struct tftp_xfer *xfer, struct tftp_packet *pack, uint16_t block, int len);
+int tftp_peek_cmd(struct tftp_xfer *xfer);
+int tftp_send_oack(struct tftp_xfer *xfer, int opts);
+int tftp_recv_oack(struct tftp_xfer *xfer, struct tftp_packet *pack, int len);
+void tftp_window_init(struct tftp_window *win, void *fd);
+int tftp_window_send(struct tftp_xfer *xfer, struct tftp_window *win, struct tftp_packet *pack);
+int tftp_window_ack(struct tftp_xfer *xfer, struct tftp_window *win, uint16_t block);
+void tftp_window_rewind(struct tftp_window *win);
+int tftp_window_recv(struct tftp_xfer *xfer, struct tftp_window *win, struct tftp_packet *pack);
+int tftp_window_resp_ack(struct tftp_xfer *xfer, struct tftp_window *win);
+void tftp_window_report(struct tftp_xfer *xfer, struct tftp_window *win);
 
 #endif
@@ -285,6 +285,9 @@ void lwip_netdev_netstat(struct netdev *netif)
 {
     extern void list_tcps(void);
     extern void list_udps(void);
+    struct netif *lwip_netif = RT_NULL;
+    struct eth_device *ethif = RT_NULL;
+    struct eth_device_stats stats;
 
 #ifdef RT_LWIP_TCP
     list_tcps();
@@ -292,6 +295,26 @@ void lwip_netdev_netstat(struct netdev *netif)
 #ifdef RT_LWIP_UDP
     list_udps();
 #endif
+
+    for (lwip_netif = netif_list; lwip_netif != RT_NULL; lwip_netif = lwip_netif->next)
+    {
+        ethif = (struct eth_device *)lwip_netif->state;
+        if (ethif == RT_NULL)
+        {
+            continue;
+        }
+
+        rt_memset(&stats, 0, sizeof(stats));
+        if (rt_device_control(&ethif->parent, NIOCTL_GSTATS, &stats) != RT_EOK)
+        {
+            continue;
+        }
+
+        rt_kprintf("%c%c: rx %u frames %u bytes, dropped %u, errors %u\n", lwip_netif->name[0], lwip_netif->name[1],
+                   stats.rx_frames, stats.rx_bytes, stats.rx_dropped, stats.rx_errors);
+        rt_kprintf("    tx %u frames %u bytes, dropped %u, errors %u\n",
+                   stats.tx_frames, stats.tx_bytes, stats.tx_dropped, stats.tx_errors);
+    }
 }
 #endif /* RT_LWIP_TCP || RT_LWIP_UDP */
 #endif /* RT_USING_FINSH */
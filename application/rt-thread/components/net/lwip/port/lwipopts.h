@@ -344,6 +344,10 @@
 #define PBUF_POOL_BUFSIZE            RT_LWIP_PBUF_POOL_BUFSIZE
 #endif
 
+/* The EMAC driver loans its receive buffers to lwIP as custom pbufs,
+   IP_FRAG is off so lwIP would not enable them on its own. */
+#define LWIP_SUPPORT_CUSTOM_PBUF    1
+
 /* PBUF_LINK_HLEN: the number of bytes that should be allocated for a
    link level header. */
 #define PBUF_LINK_HLEN              16
@@ -432,6 +436,10 @@
 #define CHECKSUM_CHECK_UDP              0
 #define CHECKSUM_CHECK_TCP              0
 #define CHECKSUM_CHECK_ICMP             0
+#else
+/* Software checksums stay compiled in, a netif whose MAC does them
+   (drv_emac.c) switches them off for itself at run time. */
+#define LWIP_CHECKSUM_CTRL_PER_NETIF    1
 #endif
 
 /* ---------- IP options ---------- */
@@ -481,7 +489,8 @@
 
 #define LWIP_UDPLITE                0
 #define UDP_TTL                     255
-#define DEFAULT_UDP_RECVMBOX_SIZE   1
+/* Datagrams queued per socket, a full TFTP window (XFER_WINDOW_SIZE_MAX) arrives back to back */
+#define DEFAULT_UDP_RECVMBOX_SIZE   16
 
 /* ---------- RAW options ---------- */
 #ifdef RT_LWIP_RAW
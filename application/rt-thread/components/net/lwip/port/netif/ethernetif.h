@@ -19,6 +19,7 @@ extern "C" {
 #include <rtthread.h>
 
 #define NIOCTL_GADDR        0x01
+#define NIOCTL_GSTATS       0x02    /* args: struct eth_device_stats, filled by the driver */
 #ifndef RT_LWIP_ETH_MTU
 #define ETHERNET_MTU        1500
 #else
@@ -29,6 +30,19 @@ extern "C" {
 #define ETHIF_LINK_AUTOUP   0x0000
 #define ETHIF_LINK_PHYUP    0x0100
 
+/* Datapath counters of an eth device, 'netstat' shows them per interface */
+struct eth_device_stats
+{
+    rt_uint32_t rx_frames;
+    rt_uint32_t rx_bytes;
+    rt_uint32_t rx_dropped;     /* No buffer, oversize or failed checks */
+    rt_uint32_t rx_errors;      /* DMA and MAC error events */
+    rt_uint32_t tx_frames;
+    rt_uint32_t tx_bytes;
+    rt_uint32_t tx_dropped;
+    rt_uint32_t tx_errors;
+};
+
 struct eth_device
 {
     /* inherit from rt_device */
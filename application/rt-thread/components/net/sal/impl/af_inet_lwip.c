@@ -15,6 +15,13 @@
 #include <lwip/api.h>
 #include <lwip/init.h>
 #include <lwip/netif.h>
+#include <lwip/tcp.h>
+#include <lwip/tcpip.h>
+#if LWIP_VERSION < 0x2000000
+#include <lwip/tcp_impl.h>
+#else
+#include <lwip/priv/tcp_priv.h>
+#endif
 
 #ifdef SAL_USING_POSIX
 #include <poll.h>
@@ -281,6 +288,288 @@ static int inet_poll(struct dfs_fd *file, struct rt_pollreq *req)
 
     return mask;
 }
+
+/*
+ * sendfile: file blocks are queued to the pcb with tcp_write() but without
+ * TCP_WRITE_FLAG_COPY, so the segments are PBUF_ROM pbufs over the blocks
+ * and the EMAC sends them from there. A block is read again only once the
+ * peer acknowledged its last byte; tcp_sndbuf() bounds what is in flight
+ * and the blocks not queued yet are read ahead while waiting for ACKs.
+ *
+ * An ACK only means lwIP let go of a segment, the netif may still hold the
+ * frame (a retransmission in its TX ring). sendfile takes its own reference
+ * on every PBUF_ROM over the pool; once that is the last one nothing else
+ * points there. Blocks are reused, and the pool freed, only after that,
+ * also when the pcb was aborted underneath.
+ */
+#ifndef SAL_LWIP_SENDFILE_BLOCK
+#define SAL_LWIP_SENDFILE_BLOCK        4096
+#endif
+#ifndef SAL_LWIP_SENDFILE_BLOCKS
+#define SAL_LWIP_SENDFILE_BLOCKS       4
+#endif
+#define SAL_LWIP_SENDFILE_WAIT_MS      100
+#define SAL_LWIP_SENDFILE_POOL         (SAL_LWIP_SENDFILE_BLOCK * SAL_LWIP_SENDFILE_BLOCKS)
+/* Queued segments stay under TCP_SND_QUEUELEN pbufs, as many again may wait for the netif */
+#define SAL_LWIP_SENDFILE_HOLDS        (TCP_SND_QUEUELEN * 2)
+
+struct inet_sendfile_block
+{
+    rt_uint8_t *buf;
+    u16_t len;                      /* Bytes read from the file */
+    u16_t queued;                   /* Bytes given to tcp_write() */
+    u32_t end;                      /* Sequence number after the block, once all queued */
+};
+
+/* netconn's own sent callback, the same for every TCP netconn */
+static tcp_sent_fn inet_sent_tcp;
+
+/* ACKs wake the sender on top of what the netconn does, select() only hears of them past TCP_SNDLOWAT */
+static err_t inet_sendfile_sent(void *arg, struct tcp_pcb *pcb, u16_t len)
+{
+    struct netconn *conn = (struct netconn *)arg;
+    struct lwip_sock *sock;
+
+    if (conn && conn->socket >= 0)
+    {
+        sock = lwip_tryget_socket(conn->socket);
+        if (sock)
+        {
+            rt_wqueue_wakeup(&sock->wait_head, (void *) POLLOUT);
+        }
+    }
+
+    return inet_sent_tcp(arg, pcb, len);
+}
+
+/* Reference the pool pbufs tcp_write() queued since the last call, core locked */
+static int inet_sendfile_hold(struct tcp_pcb *pcb, rt_uint8_t *pool, struct pbuf **held, int holds)
+{
+    struct tcp_seg *seg;
+    struct pbuf *q;
+    int i;
+
+    for (seg = pcb->unsent; seg != NULL; seg = seg->next)
+    {
+        for (q = seg->p; q != NULL; q = q->next)
+        {
+            /* Only the PBUF_ROM of tcp_write() point into the pool */
+            if ((rt_uint8_t *)q->payload < pool || (rt_uint8_t *)q->payload >= pool + SAL_LWIP_SENDFILE_POOL)
+            {
+                continue;
+            }
+            for (i = 0; i < holds && held[i] != q; i++);
+            if (i == holds)
+            {
+                pbuf_ref(q);
+                held[holds++] = q;
+            }
+        }
+    }
+
+    return holds;
+}
+
+/* Drop the pbufs nobody but sendfile refers to any more, core locked */
+static int inet_sendfile_release(struct pbuf **held, int holds)
+{
+    int i = 0;
+
+    while (i < holds)
+    {
+        if (held[i]->ref == 1)
+        {
+            pbuf_free(held[i]);
+            held[i] = held[--holds];
+        }
+        else
+        {
+            i++;
+        }
+    }
+
+    return holds;
+}
+
+/* A held pbuf still covers part of the block */
+static rt_bool_t inet_sendfile_busy(struct pbuf **held, int holds, const rt_uint8_t *buf)
+{
+    int i;
+
+    for (i = 0; i < holds; i++)
+    {
+        if ((const rt_uint8_t *)held[i]->payload < buf + SAL_LWIP_SENDFILE_BLOCK &&
+            (const rt_uint8_t *)held[i]->payload + held[i]->len > buf)
+        {
+            return RT_TRUE;
+        }
+    }
+
+    return RT_FALSE;
+}
+
+static int inet_sendfile(int socket, struct dfs_fd *file, size_t count)
+{
+    struct inet_sendfile_block blocks[SAL_LWIP_SENDFILE_BLOCKS];
+    struct inet_sendfile_block *block;
+    struct lwip_sock *sock;
+    struct netconn *conn;
+    struct tcp_pcb *pcb;
+    struct pbuf **held;
+    rt_uint8_t *pool;
+    rt_uint32_t acked = 0, queued = 0, filled = 0;
+    size_t read = 0, sent = 0;
+    u32_t tail;
+    u16_t len;
+    rt_bool_t done = RT_FALSE, failed = RT_FALSE;
+    err_t err;
+    int i, ret, holds = 0;
+
+    sock = lwip_tryget_socket(socket);
+    if (sock == NULL || sock->conn == NULL || NETCONNTYPE_GROUP(netconn_type(sock->conn)) != NETCONN_TCP)
+    {
+        return -1;
+    }
+    conn = sock->conn;
+
+    pool = rt_malloc_align(SAL_LWIP_SENDFILE_POOL + SAL_LWIP_SENDFILE_HOLDS * sizeof(struct pbuf *), RT_ALIGN_SIZE);
+    if (pool == RT_NULL)
+    {
+        return -1;
+    }
+    held = (struct pbuf **)(pool + SAL_LWIP_SENDFILE_POOL);
+    for (i = 0; i < SAL_LWIP_SENDFILE_BLOCKS; i++)
+    {
+        blocks[i].buf = pool + i * SAL_LWIP_SENDFILE_BLOCK;
+    }
+
+    LOCK_TCPIP_CORE();
+    pcb = conn->pcb.tcp;
+    if (pcb == NULL || conn->state != NETCONN_NONE)
+    {
+        UNLOCK_TCPIP_CORE();
+        rt_free_align(pool);
+        return -1;
+    }
+    if (pcb->sent != inet_sendfile_sent)
+    {
+        inet_sent_tcp = pcb->sent;
+        tcp_sent(pcb, inet_sendfile_sent);
+    }
+    tail = pcb->snd_lbb;
+    UNLOCK_TCPIP_CORE();
+
+    for (;;)
+    {
+        /* Read ahead into the blocks the peer is done with */
+        while (done == RT_FALSE && filled - acked < SAL_LWIP_SENDFILE_BLOCKS)
+        {
+            block = &blocks[filled % SAL_LWIP_SENDFILE_BLOCKS];
+            ret = dfs_file_read(file, block->buf, LWIP_MIN(count - read, SAL_LWIP_SENDFILE_BLOCK));
+            if (ret <= 0)
+            {
+                failed = (ret < 0) ? RT_TRUE : failed;
+                done = RT_TRUE;
+                break;
+            }
+            block->len = (u16_t) ret;
+            block->queued = 0;
+            read += ret;
+            filled++;
+            if (read == count)
+            {
+                done = RT_TRUE;
+            }
+        }
+
+        LOCK_TCPIP_CORE();
+        pcb = conn->pcb.tcp;
+        if (pcb == NULL)
+        {
+            /* Aborted, the segments went with the pcb but the netif may still send some */
+            UNLOCK_TCPIP_CORE();
+            failed = RT_TRUE;
+            break;
+        }
+
+        holds = inet_sendfile_release(held, holds);
+        while (acked != queued && (s32_t)(pcb->lastack - blocks[acked % SAL_LWIP_SENDFILE_BLOCKS].end) >= 0 &&
+               inet_sendfile_busy(held, holds, blocks[acked % SAL_LWIP_SENDFILE_BLOCKS].buf) == RT_FALSE)
+        {
+            acked++;
+        }
+
+        /* Below TCP_SND_QUEUELEN held, one tcp_write() cannot overrun the list */
+        while (failed == RT_FALSE && queued != filled && holds < TCP_SND_QUEUELEN)
+        {
+            block = &blocks[queued % SAL_LWIP_SENDFILE_BLOCKS];
+            len = LWIP_MIN(block->len - block->queued, tcp_sndbuf(pcb));
+            if (len == 0)
+            {
+                break;
+            }
+
+            err = tcp_write(pcb, block->buf + block->queued, len,
+                            (queued + 1 != filled || done == RT_FALSE) ? TCP_WRITE_FLAG_MORE : 0);
+            if (err == ERR_MEM)
+            {
+                /* Out of queue entries, the next ACK frees some */
+                break;
+            }
+            if (err != ERR_OK)
+            {
+                failed = RT_TRUE;
+                done = RT_TRUE;
+                break;
+            }
+            holds = inet_sendfile_hold(pcb, pool, held, holds);
+
+            block->queued += len;
+            sent += len;
+            tail = pcb->snd_lbb;
+            if (block->queued == block->len)
+            {
+                block->end = tail;
+                queued++;
+            }
+        }
+        tcp_output(pcb);
+
+        /* lwIP is done with the pool, what the netif still holds is waited for below */
+        if ((failed == RT_TRUE || (done == RT_TRUE && queued == filled)) &&
+            (s32_t)(pcb->lastack - tail) >= 0)
+        {
+            if (pcb->sent == inet_sendfile_sent)
+            {
+                tcp_sent(pcb, inet_sent_tcp);
+            }
+            UNLOCK_TCPIP_CORE();
+            break;
+        }
+        UNLOCK_TCPIP_CORE();
+
+        if (done == RT_TRUE || filled - acked == SAL_LWIP_SENDFILE_BLOCKS)
+        {
+            rt_wqueue_wait(&sock->wait_head, 0, SAL_LWIP_SENDFILE_WAIT_MS);
+        }
+    }
+
+    /* Nothing may point into the pool once it is freed, a netif drops its frames as they complete */
+    for (;;)
+    {
+        LOCK_TCPIP_CORE();
+        holds = inet_sendfile_release(held, holds);
+        UNLOCK_TCPIP_CORE();
+        if (holds == 0)
+        {
+            break;
+        }
+        rt_thread_mdelay(SAL_LWIP_SENDFILE_WAIT_MS / 10);
+    }
+    rt_free_align(pool);
+
+    return (sent == 0 && failed == RT_TRUE) ? -1 : (int) sent;
+}
 #endif
 
 static const struct sal_socket_ops lwip_socket_ops =
@@ -302,6 +591,7 @@ static const struct sal_socket_ops lwip_socket_ops =
     inet_ioctlsocket,
 #ifdef SAL_USING_POSIX
     inet_poll,
+    inet_sendfile,
 #endif
 };
 
@@ -81,6 +81,8 @@ struct sal_socket_ops
     int (*ioctlsocket)(int s, long cmd, void *arg);
 #ifdef SAL_USING_POSIX
     int (*poll)       (struct dfs_fd *file, struct rt_pollreq *req);
+    /* optional, stream sockets only: send count bytes from the file position, return the bytes sent */
+    int (*sendfile)   (int s, struct dfs_fd *file, size_t count);
 #endif
 };
 
@@ -12,6 +12,7 @@
 #define SAL_SOCKET_H__
 
 #include <stddef.h>
+#include <sys/types.h>
 #include <arpa/inet.h>
 
 #ifdef __cplusplus
@@ -210,6 +211,9 @@ int sal_sendto(int socket, const void *dataptr, size_t size, int flags,
 int sal_socket(int domain, int type, int protocol);
 int sal_closesocket(int socket);
 int sal_ioctlsocket(int socket, long cmd, void *arg);
+#ifdef SAL_USING_POSIX
+int sal_sendfile(int socket, int fd, off_t *offset, size_t count);
+#endif
 
 #ifdef __cplusplus
 }
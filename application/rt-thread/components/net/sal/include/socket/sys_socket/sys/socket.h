@@ -41,6 +41,7 @@ int sendto(int s, const void *dataptr, size_t size, int flags,
 int socket(int domain, int type, int protocol);
 int closesocket(int s);
 int ioctlsocket(int s, long cmd, void *arg);
+int sendfile(int out_fd, int in_fd, off_t *offset, size_t count);
 #else
 #define accept(s, addr, addrlen)                           sal_accept(s, addr, addrlen)
 #define bind(s, name, namelen)                             sal_bind(s, name, namelen)
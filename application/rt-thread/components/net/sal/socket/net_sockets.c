@@ -291,3 +291,11 @@ int ioctlsocket(int s, long cmd, void *arg)
     return sal_ioctlsocket(socket, cmd, arg);
 }
 RTM_EXPORT(ioctlsocket);
+
+int sendfile(int out_fd, int in_fd, off_t *offset, size_t count)
+{
+    int socket = dfs_net_getsocket(out_fd);
+
+    return sal_sendfile(socket, in_fd, offset, count);
+}
+RTM_EXPORT(sendfile);
@@ -20,6 +20,9 @@
 #endif
 #include <sal_low_lvl.h>
 #include <netdev.h>
+#ifdef SAL_USING_POSIX
+#include <dfs.h>
+#endif
 
 #ifdef SAL_INTERNET_CHECK
 #include <ipc/workqueue.h>
@@ -36,6 +39,11 @@
 
 #define SOCKET_TABLE_STEP_LEN          4
 
+/* bounce buffer of sal_sendfile when the family has no sendfile of its own */
+#ifndef SAL_SENDFILE_BUF_SIZE
+#define SAL_SENDFILE_BUF_SIZE          1460
+#endif
+
 /* the socket table used to dynamic allocate sockets */
 struct sal_socket_table
 {
@@ -1058,6 +1066,102 @@ int sal_poll(struct dfs_fd *file, struct rt_pollreq *req)
 
     return pf->skt_ops->poll(file, req);
 }
+
+/* Families without a sendfile operation (and TLS) go through read and send */
+static int sal_sendfile_copy(int socket, struct dfs_fd *file, size_t count)
+{
+    char *buf;
+    size_t sent = 0;
+    int len, ret = 0;
+
+    buf = rt_malloc(SAL_SENDFILE_BUF_SIZE);
+    if (buf == RT_NULL)
+    {
+        return -1;
+    }
+
+    while (sent < count)
+    {
+        len = dfs_file_read(file, buf, (count - sent) < SAL_SENDFILE_BUF_SIZE ? (count - sent) : SAL_SENDFILE_BUF_SIZE);
+        if (len <= 0)
+        {
+            ret = len;
+            break;
+        }
+
+        ret = sal_sendto(socket, buf, len, 0, RT_NULL, 0);
+        if (ret > 0)
+        {
+            sent += ret;
+        }
+        if (ret < len)
+        {
+            break;
+        }
+    }
+
+    rt_free(buf);
+
+    return (sent == 0 && ret < 0) ? -1 : (int) sent;
+}
+
+int sal_sendfile(int socket, int fd, off_t *offset, size_t count)
+{
+    struct sal_socket *sock;
+    struct sal_proto_family *pf;
+    struct dfs_fd *file;
+    off_t pos, start;
+    int ret;
+
+    /* get the socket object by socket descriptor */
+    SAL_SOCKET_OBJ_GET(sock, socket);
+
+    /* check the network interface is up status  */
+    SAL_NETDEV_IS_UP(sock->netdev);
+    pf = (struct sal_proto_family *) sock->netdev->sal_user_data;
+
+    file = fd_get(fd);
+    if (file == RT_NULL)
+    {
+        return -1;
+    }
+
+    /* with an offset the file position is left alone, as on Linux */
+    pos = file->pos;
+    start = offset ? *offset : pos;
+    if (start != pos && dfs_file_lseek(file, start) < 0)
+    {
+        fd_put(file);
+        return -1;
+    }
+
+#ifdef SAL_USING_TLS
+    if (pf->skt_ops->sendfile && sock->type == SOCK_STREAM && !IS_SOCKET_PROTO_TLS(sock))
+#else
+    if (pf->skt_ops->sendfile && sock->type == SOCK_STREAM)
+#endif
+    {
+        ret = pf->skt_ops->sendfile((int) sock->user_data, file, count);
+    }
+    else
+    {
+        ret = sal_sendfile_copy(socket, file, count);
+    }
+
+    /* both paths may have read ahead of what went out */
+    if (ret >= 0 && offset)
+    {
+        *offset = start + ret;
+        dfs_file_lseek(file, pos);
+    }
+    else
+    {
+        dfs_file_lseek(file, ret >= 0 ? start + ret : pos);
+    }
+    fd_put(file);
+
+    return ret;
+}
 #endif
 
 struct hostent *sal_gethostbyname(const char *name)
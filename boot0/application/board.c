@@ -12,15 +12,16 @@ sunxi_usart_t usart0_dbg = {
 };
 
 sunxi_spi_t sunxi_spi0 = {
-	.base	   = 0x04025000,
-	.id		   = 0,
-	.clk_rate  = 100 * 1000 * 1000,
-	.gpio_cs   = {GPIO_PIN(PORTC, 3), GPIO_PERIPH_MUX2},
-	.gpio_sck  = {GPIO_PIN(PORTC, 2), GPIO_PERIPH_MUX2},
-	.gpio_mosi = {GPIO_PIN(PORTC, 4), GPIO_PERIPH_MUX2},
-	.gpio_miso = {GPIO_PIN(PORTC, 5), GPIO_PERIPH_MUX2},
-	.gpio_wp   = {GPIO_PIN(PORTC, 6), GPIO_PERIPH_MUX2},
-	.gpio_hold = {GPIO_PIN(PORTC, 7), GPIO_PERIPH_MUX2},
+	.base		  = 0x04025000,
+	.id			  = 0,
+	.clk_rate	  = 50 * 1000 * 1000,
+	.max_clk_rate = 150 * 1000 * 1000,
+	.gpio_cs	  = {GPIO_PIN(PORTC, 3), GPIO_PERIPH_MUX2},
+	.gpio_sck	  = {GPIO_PIN(PORTC, 2), GPIO_PERIPH_MUX2},
+	.gpio_mosi	  = {GPIO_PIN(PORTC, 4), GPIO_PERIPH_MUX2},
+	.gpio_miso	  = {GPIO_PIN(PORTC, 5), GPIO_PERIPH_MUX2},
+	.gpio_wp	  = {GPIO_PIN(PORTC, 6), GPIO_PERIPH_MUX2},
+	.gpio_hold	  = {GPIO_PIN(PORTC, 7), GPIO_PERIPH_MUX2},
 };
 
 
@@ -10,6 +10,30 @@
 
 #define CONFIG_CPU_FREQ 1200000000
 
+/*
+ * Start the application straight from boot0 when the Param record has
+ * nothing pending (application/fast_boot.c). A key pressed on the debug
+ * UART during power-on, or this pin held low, boots through boot1 instead.
+ * Off by default: a board without the key pin has only the UART to get
+ * back into boot1's shell, give it the pin before turning this on.
+ */
+// #define CONFIG_FAST_BOOT
+// #define CONFIG_FAST_BOOT_KEY GPIO_PIN(PORTE, 2)
+
+/*
+ * DRAM bandwidth, latency and pattern tests right after training while
+ * this strap is held low (application/dram_bench.c), boot1's dram_bench
+ * and dram_test commands run the same suite later.
+ */
+// #define CONFIG_DRAM_BENCH GPIO_PIN(PORTE, 3)
+
+/*
+ * DRAM characterisation while this strap is held low (application/dram_tune.c):
+ * sweep clock and timings, boot1 then stores the chosen point for every
+ * later boot. Without a stored point CONFIG_DRAM_CLK and spec timings apply.
+ */
+// #define CONFIG_DRAM_TUNE GPIO_PIN(PORTE, 4)
+
 extern int __memheap_start;
 extern int __memheap_end;
 #define HEAP_BEGIN          (&__memheap_start)
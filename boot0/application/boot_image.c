@@ -0,0 +1,192 @@
+#include "main.h"
+#include "dram.h"
+#include "handoff.h"
+#include "boot_image.h"
+#include "ptable.h"
+
+/* Table driven, a page has to be checked faster than the DMA fills the next one */
+static uint32_t crc_table[256];
+
+static void boot_image_crc_init(void)
+{
+	uint32_t c;
+	int		 i, j;
+
+	for (i = 0; i < 256; i++) {
+		c = i;
+		for (j = 0; j < 8; j++)
+			c = (c >> 1) ^ (0xedb88320 & -(c & 1));
+		crc_table[i] = c;
+	}
+}
+
+/* zlib crc32(): start with 0, feed the previous result back in for the next piece */
+uint32_t boot_image_crc32(uint32_t crc, const void *buf, uint32_t len)
+{
+	const uint8_t *p = buf;
+
+	if (crc_table[1] == 0)
+		boot_image_crc_init();
+
+	crc = ~crc;
+	while (len--)
+		crc = crc_table[(crc ^ *p++) & 0xff] ^ (crc >> 8);
+
+	return ~crc;
+}
+
+static int boot_image_check_head(const boot_head_t *head, uint32_t offset, uint32_t max_size)
+{
+	uint32_t crc;
+
+	if (head->img_magic != IMG_MAGIC) {
+		error("boot1 @0x%08" PRIx32 ": bad magic 0x%08" PRIx32 "\r\n", offset, head->img_magic);
+		return -1;
+	}
+
+	/* A flipped size or load address is caught here rather than after streaming the body */
+	if (head->head_crc != 0) {
+		crc = boot_image_crc32(0, head, offsetof(boot_head_t, head_crc));
+		crc = boot_image_crc32(crc, &head->head_crc + 1, sizeof(boot_head_t) - offsetof(boot_head_t, head_crc) - 4);
+		if (crc != head->head_crc) {
+			error("boot1 @0x%08" PRIx32 ": header CRC 0x%08" PRIx32 ", header says 0x%08" PRIx32 "\r\n", offset, crc,
+				  head->head_crc);
+			return -1;
+		}
+	}
+
+	/* The image must not reach the hand-off page, it is written after the load */
+	if (head->img_size <= sizeof(boot_head_t) || head->img_size > max_size || head->img_load < SDRAM_BASE ||
+		head->img_load + head->img_size > HANDOFF_ADDR || head->img_entry < head->img_load ||
+		head->img_entry >= head->img_load + head->img_size) {
+		error("boot1 @0x%08" PRIx32 ": bad header, size 0x%08" PRIx32 " load 0x%08" PRIx32 " entry 0x%08" PRIx32 "\r\n",
+			  offset, head->img_size, head->img_load, head->img_entry);
+		return -1;
+	}
+
+	return 0;
+}
+
+/* First good block from addr on, end once the copy's span has no good block left */
+static uint32_t boot_image_good(sunxi_spi_t *spi, uint32_t offset, uint32_t addr, uint32_t end)
+{
+	uint32_t block = spi->info.page_size * spi->info.pages_per_block;
+
+	while (addr < end && spi_nand_block_bad(spi, addr)) {
+		warning("boot1 @0x%08" PRIx32 ": bad block 0x%08" PRIx32 " skipped\r\n", offset, addr);
+		addr += block - addr % block;
+	}
+
+	return addr < end ? addr : end;
+}
+
+int boot_image_load(sunxi_spi_t *spi, uint32_t offset, uint32_t max_size, boot_head_t *head)
+{
+	uint32_t page  = spi->info.page_size;
+	uint32_t block = page * spi->info.pages_per_block;
+	uint32_t end   = offset + max_size;
+	uint8_t *dst;
+	uint32_t data, count, span, addr, i, n, crc;
+	int		 ret = BOOT_IMAGE_OK;
+
+	/* Header first, the rest once the size and layout are known */
+	addr = boot_image_good(spi, offset, offset, end);
+	if (addr == end)
+		return BOOT_IMAGE_ERR_BAD;
+
+	spi_nand_read(spi, (uint8_t *)head, addr, sizeof(boot_head_t));
+	if (boot_image_check_head(head, offset, max_size) != 0)
+		return BOOT_IMAGE_ERR_HEAD;
+
+	/* A copy expanded for another page size has its pieces in the wrong places */
+	if (head->img_page != 0 && head->img_page != page) {
+		error("boot1 @0x%08" PRIx32 ": expanded for %" PRIu32 " byte pages, flash has %" PRIu32 "\r\n", offset,
+			  head->img_page, page);
+		return BOOT_IMAGE_ERR_HEAD;
+	}
+
+	/* Image bytes per flash page */
+	data  = head->img_page ? IMG_BROM_PAGE : page;
+	count = (head->img_size + data - 1) / data;
+	span  = count * page;
+	if (data != page)
+		debug("boot1 @0x%08" PRIx32 ": %" PRIu32 " of every %" PRIu32 " bytes used\r\n", offset, data, page);
+	if (span > max_size) {
+		error("boot1 @0x%08" PRIx32 ": 0x%08" PRIx32 " bytes of flash, slot is 0x%08" PRIx32 "\r\n", offset, span, max_size);
+		return BOOT_IMAGE_ERR_HEAD;
+	}
+
+	/* Only the checked header's img_size bytes reach DRAM, nothing past img_load + img_size */
+	dst = (uint8_t *)(uintptr_t)head->img_load;
+	if (spi_nand_read_start(spi, dst, addr, min(data, head->img_size)) != 0)
+		return BOOT_IMAGE_ERR_READ;
+	spi_nand_read_wait(spi);
+
+	crc = 0;
+	for (i = 0; i < count; i++) {
+		if (i > 0)
+			spi_nand_read_wait(spi);
+
+		/* Written around bad blocks: the next page is in the next good block, inside the span */
+		if (i + 1 < count) {
+			addr += page;
+			if (addr % block == 0)
+				addr = boot_image_good(spi, offset, addr, end);
+			if (addr == end) {
+				error("boot1 @0x%08" PRIx32 ": bad blocks leave no room for page %" PRIu32 "\r\n", offset, i + 1);
+				return BOOT_IMAGE_ERR_BAD;
+			}
+			if (spi_nand_read_start(spi, dst + data * (i + 1), addr, min(data, head->img_size - data * (i + 1))) != 0)
+				ret = BOOT_IMAGE_ERR_READ;
+		}
+
+		/* Page i is in DRAM, check it while page i + 1 streams in */
+		n = min(data, head->img_size - data * i);
+		if (i == 0) {
+			crc = boot_image_crc32(crc, dst, offsetof(boot_head_t, img_crc));
+			crc = boot_image_crc32(crc, dst + sizeof(boot_head_t), n - sizeof(boot_head_t));
+		} else {
+			crc = boot_image_crc32(crc, dst + data * i, n);
+		}
+
+		if (ret != BOOT_IMAGE_OK)
+			return ret;
+	}
+
+	if (head->img_crc == 0) {
+		warning("boot1 @0x%08" PRIx32 ": unsealed image, CRC not checked\r\n", offset);
+	} else if (crc != head->img_crc) {
+		error("boot1 @0x%08" PRIx32 ": CRC 0x%08" PRIx32 ", header says 0x%08" PRIx32 "\r\n", offset, crc, head->img_crc);
+		return BOOT_IMAGE_ERR_CHECK;
+	}
+
+	return BOOT_IMAGE_OK;
+}
+
+int boot_image_load_any(sunxi_spi_t *spi, boot_head_t *head)
+{
+	const ptable_entry_t *part	 = ptable_find("boot1");
+	uint32_t			  block	 = spi->info.page_size * spi->info.pages_per_block;
+	uint32_t			  start	 = BOOT1_ADDR;
+	uint32_t			  stride = BOOT1_STRIDE;
+	uint32_t			  copies = BOOT1_COPIES;
+	uint32_t			  i;
+
+	if (part != NULL && part->copies >= 1 && part->copies <= BOOT1_COPIES_MAX && part->size / part->copies >= block) {
+		start  = part->start;
+		copies = part->copies;
+		stride = part->size / part->copies / block * block;
+	}
+
+	/* Lowest offset first: the copies are identical, the first good one is as fast as any */
+	for (i = 0; i < copies; i++) {
+		if (boot_image_load(spi, start + stride * i, stride, head) == BOOT_IMAGE_OK) {
+			debug("boot1 copy %" PRIu32 " of %" PRIu32 " @0x%08" PRIx32 "\r\n", i, copies, start + stride * i);
+			return i;
+		}
+		warning("boot1 copy %" PRIu32 " unusable\r\n", i);
+	}
+
+	error("no valid boot1\r\n");
+	return BOOT_IMAGE_ERR_NONE;
+}
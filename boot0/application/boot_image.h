@@ -0,0 +1,66 @@
+#ifndef __BOOT_IMAGE_H__
+#define __BOOT_IMAGE_H__
+
+#include <stdint.h>
+#include "sunxi_spi.h"
+
+/*
+ * boot1 image header, the first words of boot1/libcpu/vector_gcc.S.
+ * img_crc is the CRC32 (zlib) of img_size bytes of the image with the
+ * words from img_crc to the end of the header left out; 0 means unsealed
+ * and is only warned about. head_crc is the CRC32 of the header with the
+ * head_crc word left out, checked before the body is read; 0 skips it.
+ * tool/mk_boot1.c and tool/mk_nand.c fill both in, img_crc first.
+ */
+#define IMG_MAGIC 0x12345678
+
+/*
+ * boot1 streams in one flash page per read, whatever spi->info.page_size
+ * is. Written through tool/mk_image.c's expand_pagesize() only the first
+ * IMG_BROM_PAGE bytes of every page carry the image and the rest is zero;
+ * expand_pagesize() records the page size in img_page, 0 means dense.
+ */
+#define IMG_BROM_PAGE 2048
+
+/*
+ * Where the copies are when the partition table has no boot1 entry,
+ * tool/nand_layout.txt. With one, its size is split into `copies`
+ * block aligned slots the way tool/mk_nand.c writes them.
+ */
+#define BOOT1_ADDR		 0x100000
+#define BOOT1_STRIDE	 0x80000
+#define BOOT1_COPIES	 2
+#define BOOT1_COPIES_MAX 8
+
+typedef struct boot_head {
+	uint32_t img_magic;
+	uint32_t img_size;
+	uint32_t img_load;
+	uint32_t img_entry;
+	uint32_t img_crc;
+	uint32_t head_crc;
+	uint32_t img_page;
+} boot_head_t;
+
+enum {
+	BOOT_IMAGE_OK		 = 0,
+	BOOT_IMAGE_ERR_HEAD	 = -1, /* No magic, header CRC mismatch or an implausible header */
+	BOOT_IMAGE_ERR_READ	 = -2, /* SPI read could not be started */
+	BOOT_IMAGE_ERR_CHECK = -3, /* Body CRC mismatch */
+	BOOT_IMAGE_ERR_BAD	 = -4, /* Bad blocks leave the copy's span too few good ones */
+	BOOT_IMAGE_ERR_NONE	 = -5, /* No copy loaded */
+};
+
+uint32_t boot_image_crc32(uint32_t crc, const void *buf, uint32_t len);
+
+/*
+ * Load the copy at offset to its load address, CRC checked while it streams
+ * in. The copy continues past a bad block in the next good one, as
+ * tool/mk_nand.c writes it, as long as it stays inside its max_size span.
+ */
+int boot_image_load(sunxi_spi_t *spi, uint32_t offset, uint32_t max_size, boot_head_t *head);
+
+/* Try the copies in flash order, returns the index of the first one that loads or BOOT_IMAGE_ERR_NONE */
+int boot_image_load_any(sunxi_spi_t *spi, boot_head_t *head);
+
+#endif
@@ -0,0 +1,59 @@
+#include "main.h"
+#include "board.h"
+#include "dram_bench.h"
+
+#if defined(CONFIG_DRAM_BENCH) || defined(CONFIG_DRAM_TUNE)
+
+#define STRESS_WINS 4		   /* dram_bench_stress() windows, spread over the banks and rows */
+#define STRESS_LEN	(1 << 20) /* Per window */
+
+#ifdef CONFIG_DRAM_BENCH
+static void bench_fail(volatile uint32_t *p, uint32_t want, uint32_t got)
+{
+	error("DRAM: 0x%08" PRIx32 " reads 0x%08" PRIx32 ", wrote 0x%08" PRIx32 "\r\n", (uint32_t)p, got, want);
+}
+
+uint32_t dram_bench_run(uint32_t base, uint32_t size)
+{
+	struct dram_bench_speed s;
+	uint32_t				fails;
+	uint64_t				t;
+
+	base = ALIGN(base, 64);
+	size &= ~63;
+
+	dram_bench_speed(base, size, get_arch_counter, &s);
+	info("DRAM: %" PRIu32 "KiB NEON read %" PRIu32 " MB/s, write %" PRIu32 " MB/s, copy %" PRIu32 " MB/s\r\n", s.len >> 10,
+		 s.read_mbs, s.write_mbs, s.copy_mbs);
+	info("DRAM: %" PRIu32 "KiB random load latency %" PRIu32 ".%" PRIu32 " ns\r\n", s.lat_len >> 10, s.lat_ps / 1000,
+		 s.lat_ps % 1000 / 100);
+
+	t	  = time_us();
+	fails = dram_bench_patterns(base, size, bench_fail);
+
+	if (fails)
+		error("DRAM: 0x%08" PRIx32 "+0x%08" PRIx32 " %" PRIu32 " words failed\r\n", base, size, fails);
+	else
+		info("DRAM: 0x%08" PRIx32 "+0x%08" PRIx32 " walk / address / march OK in %" PRIu32 " ms\r\n", base, size,
+			 (uint32_t)((time_us() - t) / 1000));
+
+	return fails;
+}
+
+#endif
+
+uint32_t dram_bench_stress(uint32_t base, uint32_t size)
+{
+	uint32_t win   = min(STRESS_LEN, size / STRESS_WINS) & ~63;
+	uint32_t fails = 0;
+	uint32_t i, at;
+
+	for (i = 0; i < STRESS_WINS; i++) {
+		at = ALIGN(base + size / STRESS_WINS * i, 64);
+		fails += dram_bench_patterns(at, win, NULL);
+	}
+
+	return fails;
+}
+
+#endif
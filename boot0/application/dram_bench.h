@@ -0,0 +1,22 @@
+#ifndef __DRAM_BENCH_H__
+#define __DRAM_BENCH_H__
+
+#include <stdint.h>
+
+#include "dram_bench_core.h"
+
+/*
+ * DRAM qualification after training: NEON read / write / copy bandwidth
+ * in MB/s, dependent-load latency in ns, then walking bit, own address and
+ * March C- passes over a range. The passes live in
+ * boards/aw_boot_lib/dram_bench_core.c, which boot1's dram_bench /
+ * dram_test shell commands build too.
+ */
+
+/* Bandwidth and latency figures, then the integrity passes; returns the number of failing words */
+uint32_t dram_bench_run(uint32_t base, uint32_t size);
+
+/* Walk, address and March C- over a few windows of the range, nothing printed; returns the failing words */
+uint32_t dram_bench_stress(uint32_t base, uint32_t size);
+
+#endif
@@ -0,0 +1,133 @@
+#include "main.h"
+#include "board.h"
+#include "mmu.h"
+#include "handoff.h"
+#include "boot_image.h"
+#include "dram_bench.h"
+#include "dram_tune.h"
+
+static int dram_op_valid(const dram_op_rec_t *rec)
+{
+	if (rec->magic != DRAM_OP_MAGIC || rec->version != DRAM_OP_VER)
+		return 0;
+	if (boot_image_crc32(0, rec, offsetof(dram_op_rec_t, crc32)) != rec->crc32)
+		return 0;
+
+	return rec->clk >= DRAM_OP_CLK_MIN && rec->clk <= DRAM_OP_CLK_MAX && rec->timing_pct >= DRAM_OP_PCT_MIN &&
+		   rec->timing_pct <= 100;
+}
+
+int dram_op_load(sunxi_spi_t *spi, dram_op_t *op)
+{
+	uint32_t	  block = spi->info.page_size * spi->info.pages_per_block;
+	uint32_t	  addr	= DRAM_OP_END - block;
+	dram_op_rec_t rec;
+
+	op->clk		   = 0;
+	op->timing_pct = 0;
+
+	/* Under 64 bytes, PIO into SRAM: DRAM is not up yet */
+	if (spi_nand_block_bad(spi, addr))
+		return -1;
+	spi_nand_read(spi, (uint8_t *)&rec, addr, sizeof(rec));
+	if (!dram_op_valid(&rec)) {
+		debug("DRAM: no operating point @0x%08" PRIx32 "\r\n", addr);
+		return -1;
+	}
+
+	op->clk		   = rec.clk;
+	op->timing_pct = rec.timing_pct;
+	info("DRAM: stored point %" PRIu32 "MHz, timing %" PRIu32 "%%\r\n", rec.clk, rec.timing_pct);
+
+	return 0;
+}
+
+#ifdef CONFIG_DRAM_TUNE
+
+#define TUNE_STEP	24
+#define TUNE_CLKS	((DRAM_OP_CLK_MAX - DRAM_OP_CLK_MIN) / TUNE_STEP + 1)
+#define TUNE_MARGIN 2 /* Clock steps that must still pass above the chosen one */
+
+/* Timing percents, tightest last; a point passes only if every looser one did */
+static const uint8_t tune_pct[] = {100, 90, 80, 70};
+
+#define TUNE_PCTS (sizeof(tune_pct) / sizeof(tune_pct[0]))
+
+static int tune_point(uint32_t clk, uint32_t pct)
+{
+	dram_op_t op = {.clk = clk, .timing_pct = pct};
+	uint32_t  size, fails;
+
+	size = sunxi_dram_init_op(&op);
+	if (size == 0)
+		return 0;
+
+	/* Caches on so the stress runs at burst rate, the windows are well past the L2 */
+	mmu_setup(SDRAM_BASE, size);
+	fails = dram_bench_stress(SDRAM_BASE, size - MMU_TTB_SIZE);
+	mmu_disable();
+
+	return fails == 0;
+}
+
+uint32_t dram_tune(dram_op_t *op)
+{
+	uint8_t	 pass[TUNE_CLKS];
+	uint32_t i, j, best, pct, clk_min = 0, clk_max = 0;
+	uint64_t t = time_us();
+
+	info("DRAM: characterising %d-%dMHz\r\n", DRAM_OP_CLK_MIN, DRAM_OP_CLK_MAX);
+
+	for (i = 0; i < TUNE_CLKS; i++) {
+		pass[i] = 0;
+		for (j = 0; j < TUNE_PCTS; j++) {
+			if (!tune_point(DRAM_OP_CLK_MIN + i * TUNE_STEP, tune_pct[j]))
+				break;
+			pass[i] |= 1 << j;
+		}
+		info("DRAM: %4" PRIu32 "MHz %s %s %s %s\r\n", DRAM_OP_CLK_MIN + i * TUNE_STEP, pass[i] & 1 ? "100" : " --",
+			 pass[i] & 2 ? "90" : "--", pass[i] & 4 ? "80" : "--", pass[i] & 8 ? "70" : "--");
+
+		if (pass[i] & 1) {
+			if (clk_min == 0)
+				clk_min = DRAM_OP_CLK_MIN + i * TUNE_STEP;
+			clk_max = DRAM_OP_CLK_MIN + i * TUNE_STEP;
+		}
+	}
+
+	/* Highest clock with all of the TUNE_MARGIN steps above it passing at spec timings */
+	for (best = TUNE_CLKS - TUNE_MARGIN; best-- > 0;) {
+		for (j = 0; j <= TUNE_MARGIN; j++) {
+			if (!(pass[best + j] & 1))
+				break;
+		}
+		if (j > TUNE_MARGIN)
+			break;
+	}
+	if (best >= TUNE_CLKS) {
+		error("DRAM: no point with margin, %" PRIu32 " ms\r\n", (uint32_t)((time_us() - t) / 1000));
+		op->clk		   = 0;
+		op->timing_pct = 0;
+		return sunxi_dram_init_op(op);
+	}
+
+	/* Then the tightest timing that still has one passing step below it */
+	pct = 0;
+	for (j = 1; j + 1 < TUNE_PCTS; j++) {
+		if (pass[best] & (1 << (j + 1)))
+			pct = j;
+	}
+
+	op->clk		   = DRAM_OP_CLK_MIN + best * TUNE_STEP;
+	op->timing_pct = tune_pct[pct];
+	for (j = 0; j < TUNE_PCTS && (pass[best] & (1 << j)); j++)
+		;
+	handoff_set_tuned(clk_min, clk_max, tune_pct[j - 1]);
+
+	info("DRAM: window %" PRIu32 "-%" PRIu32 "MHz, using %" PRIu32 "MHz timing %" PRIu32 "%%, %" PRIu32 " ms\r\n",
+		 clk_min, clk_max, op->clk, op->timing_pct, (uint32_t)((time_us() - t) / 1000));
+
+	return sunxi_dram_init_op(op);
+}
+
+#endif
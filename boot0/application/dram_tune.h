@@ -0,0 +1,41 @@
+#ifndef __DRAM_TUNE_H__
+#define __DRAM_TUNE_H__
+
+#include <stdint.h>
+#include "dram.h"
+#include "sunxi_spi.h"
+
+/*
+ * Per-board DRAM operating point. The characterisation run (CONFIG_DRAM_TUNE
+ * strap) sweeps dram_clk against the mctl_set_timing_params() timings with a
+ * stress test at every point, picks a point with margin on both axes and
+ * hands it to boot1 (HANDOFF_F_TUNED), which writes the record below into
+ * the last block of the boot0 partition. boot0 only ever reads it, before
+ * DRAM init on every boot; boot1/application/dram_op.c is the write side.
+ */
+
+#define DRAM_OP_END		0x80000	   /* Record in the block below, after boot0's own copies */
+#define DRAM_OP_MAGIC	0x504f5244 /* 'DROP' */
+#define DRAM_OP_VER		1
+#define DRAM_OP_CLK_MIN 528
+#define DRAM_OP_CLK_MAX 936
+#define DRAM_OP_PCT_MIN 50
+
+typedef struct {
+	uint32_t magic;
+	uint32_t version;
+	uint32_t clk;		 /* MHz */
+	uint32_t timing_pct; /* See dram_op_t */
+	uint32_t clk_min;	 /* Passing window found by the sweep, for the record */
+	uint32_t clk_max;
+	uint32_t pct_min;
+	uint32_t crc32; /* Of the words above */
+} dram_op_rec_t;
+
+/* Stored operating point into *op, 0 when there is a valid one; *op is cleared (defaults) otherwise */
+int dram_op_load(sunxi_spi_t *spi, dram_op_t *op);
+
+/* Characterisation sweep, DRAM is left initialised at the chosen point in *op; returns its size or 0 */
+uint32_t dram_tune(dram_op_t *op);
+
+#endif
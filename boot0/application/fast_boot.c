@@ -0,0 +1,224 @@
+#include "main.h"
+#include "board.h"
+#include "dram.h"
+#include "mmu.h"
+#include "handoff.h"
+#include "boot_image.h"
+#include "fast_boot.h"
+
+/* Two page bounce buffers in boot1's DRAM area, unused when boot1 is skipped */
+#define FB_BUF SDRAM_BASE
+
+/* Applications link above the hand-off page (application/link_m.lds) and must stay below the MMU table */
+#define FB_LOAD_MIN (HANDOFF_ADDR + 0x1000)
+
+static uint32_t fb_load_max;
+
+static int fast_boot_break(void)
+{
+	/* Anything typed since board_init() is still in the RX FIFO, boot1 sees it too and opens its shell */
+	if (sunxi_usart_rx_pending(&USART_DBG))
+		return 1;
+
+#ifdef CONFIG_FAST_BOOT_KEY
+	sunxi_gpio_init(CONFIG_FAST_BOOT_KEY, GPIO_INPUT);
+	sunxi_gpio_set_pull(CONFIG_FAST_BOOT_KEY, GPIO_PULL_UP);
+	udelay(10);
+	if (sunxi_gpio_read(CONFIG_FAST_BOOT_KEY) == 0)
+		return 1;
+#endif
+
+	return 0;
+}
+
+/*
+ * Copy len bytes at flash addr to dst, any alignment. Pages stream into the
+ * bounce buffers, the next one is in flight while the last is copied and,
+ * when crc is given, fed to the CRC.
+ */
+static int fast_boot_read(sunxi_spi_t *spi, uint32_t addr, uint8_t *dst, uint32_t len, uint32_t *crc)
+{
+	uint32_t page = spi->info.page_size;
+	uint32_t pos  = addr - addr % page;
+	uint32_t end  = addr + len;
+	uint32_t from, n;
+	uint8_t *buf[2] = {(uint8_t *)FB_BUF, (uint8_t *)FB_BUF + page};
+	int		 i = 0, ret = 0;
+
+	if (len == 0)
+		return 0;
+
+	if (spi_nand_read_start(spi, buf[0], pos, page) != 0)
+		return -1;
+
+	while (pos < end) {
+		spi_nand_read_wait(spi);
+
+		if (pos + page < end && spi_nand_read_start(spi, buf[(i + 1) & 1], pos + page, page) != 0)
+			ret = -1;
+
+		from = max(addr, pos);
+		n	 = min(pos + page, end) - from;
+		memcpy(dst, buf[i & 1] + (from - pos), n);
+		if (crc)
+			*crc = boot_image_crc32(*crc, dst, n);
+
+		if (ret != 0)
+			return ret;
+
+		dst += n;
+		pos += page;
+		i++;
+	}
+
+	return 0;
+}
+
+/* One Param record, 0 if valid; seq 0 with the CRC still erased is a record from before seq */
+static int fast_boot_para(sunxi_spi_t *spi, const ptable_entry_t *part, fb_para_t *para)
+{
+	if (part == NULL || fast_boot_read(spi, part->start, (uint8_t *)para, sizeof(*para), NULL) != 0)
+		return -1;
+
+	if (para->magic != FB_PARA_MAGIC)
+		return -1;
+	if (para->crc32 != boot_image_crc32(0, para, offsetof(fb_para_t, crc32)) &&
+		(para->seq != 0 || para->crc32 != 0xffffffff))
+		return -1;
+
+	return 0;
+}
+
+static int fast_boot_range_ok(uint32_t addr, uint32_t len)
+{
+	return addr >= FB_LOAD_MIN && addr < fb_load_max && len <= fb_load_max - addr;
+}
+
+static int fast_boot_segments(sunxi_spi_t *spi, const ptable_entry_t *part, const fb_fw_head_t *fw, uint32_t *entry_ok)
+{
+	fb_fw_seg_t seg[FB_SEG_MAX];
+	uint32_t	offset, table, crc, i;
+
+	if (fw->seg_count > FB_SEG_MAX)
+		return FAST_BOOT_ERR_HEAD;
+
+	table  = fw->seg_count * sizeof(fb_fw_seg_t);
+	offset = sizeof(fb_fw_head_t);
+	crc	   = 0;
+	if (fast_boot_read(spi, part->start + offset, (uint8_t *)seg, table, &crc) != 0)
+		return FAST_BOOT_ERR_READ;
+	if (crc != fw->seg_crc32)
+		return FAST_BOOT_ERR_HEAD;
+
+	/* All segments are checked before the first byte is written to DRAM */
+	offset += table;
+	for (i = 0; i < fw->seg_count; i++) {
+		if (seg[i].mem_size < seg[i].file_size || !fast_boot_range_ok(seg[i].load_addr, seg[i].mem_size) ||
+			offset - sizeof(fb_fw_head_t) + seg[i].file_size > fw->size) {
+			error("fast boot: segment %" PRIu32 " out of range\r\n", i);
+			return FAST_BOOT_ERR_HEAD;
+		}
+		if (fw->exec_addr - seg[i].load_addr < seg[i].mem_size)
+			*entry_ok = 1;
+		offset += seg[i].file_size;
+	}
+
+	offset = sizeof(fb_fw_head_t) + table;
+	for (i = 0; i < fw->seg_count; i++) {
+		crc = 0;
+		if (fast_boot_read(spi, part->start + offset, (uint8_t *)(uintptr_t)seg[i].load_addr, seg[i].file_size, &crc) != 0)
+			return FAST_BOOT_ERR_READ;
+		if (crc != seg[i].crc32) {
+			error("fast boot: segment %" PRIu32 " CRC 0x%08" PRIx32 " != 0x%08" PRIx32 "\r\n", i, crc, seg[i].crc32);
+			return FAST_BOOT_ERR_CHECK;
+		}
+
+		if (seg[i].flags & FB_SEG_ZERO)
+			memset((void *)(uintptr_t)(seg[i].load_addr + seg[i].file_size), 0, seg[i].mem_size - seg[i].file_size);
+
+		offset += seg[i].file_size;
+	}
+
+	return FAST_BOOT_OK;
+}
+
+int fast_boot_load(sunxi_spi_t *spi, uint32_t dram_size, uint32_t *entry)
+{
+	const ptable_entry_t *app1, *app2, *part_para, *part;
+	fb_para_t			  para, para2;
+	fb_fw_head_t		  fw;
+	uint32_t			  expect, crc, entry_ok = 0;
+	int					  ret;
+
+	if (fast_boot_break()) {
+		info("fast boot: break, booting boot1\r\n");
+		return FAST_BOOT_ERR_BREAK;
+	}
+
+	fb_load_max = SDRAM_BASE + dram_size - MMU_TTB_SIZE;
+
+	app1	  = ptable_find("APP1");
+	app2	  = ptable_find("APP2");
+	part_para = ptable_find("Param");
+	if (app1 == NULL || app2 == NULL || part_para == NULL) {
+		debug("fast boot: no partition table\r\n");
+		return FAST_BOOT_ERR_TABLE;
+	}
+
+	/* boot1's ota_param_load(): the newer of the two records, a torn one is skipped */
+	ret = fast_boot_para(spi, part_para, &para);
+	if (fast_boot_para(spi, ptable_find("Param2"), &para2) == 0 && (ret != 0 || (int32_t)(para2.seq - para.seq) > 0)) {
+		para = para2;
+		ret	 = 0;
+	}
+
+	/* boot1 applies pending updates and rollbacks, leave those to it */
+	if (ret != 0 || para.upgrade_ready != 0 ||
+		(para.active_slot != FB_SLOT_1 && para.active_slot != FB_SLOT_2)) {
+		info("fast boot: Param magic 0x%08" PRIx32 " slot 0x%" PRIx32 " upgrade %" PRIu32 ", booting boot1\r\n",
+			 para.magic, para.active_slot, para.upgrade_ready);
+		return FAST_BOOT_ERR_PARA;
+	}
+
+	part   = para.active_slot == FB_SLOT_1 ? app1 : app2;
+	expect = para.active_slot == FB_SLOT_1 ? para.app1_crc : para.app2_crc;
+
+	if (fast_boot_read(spi, part->start, (uint8_t *)&fw, sizeof(fw), NULL) != 0)
+		return FAST_BOOT_ERR_READ;
+
+	if (fw.magic != FB_FW_MAGIC || fw.crc32 != expect || fw.size > part->size - sizeof(fw)) {
+		error("fast boot: %s magic 0x%08" PRIx32 " size 0x%08" PRIx32 " crc 0x%08" PRIx32 ", Param says 0x%08" PRIx32 "\r\n",
+			  part->name, fw.magic, fw.size, fw.crc32, expect);
+		return FAST_BOOT_ERR_HEAD;
+	}
+
+	if (fw.seg_count == 0) {
+		if (!fast_boot_range_ok(fw.load_addr, fw.size)) {
+			error("fast boot: %s load 0x%08" PRIx32 " size 0x%08" PRIx32 " out of range\r\n", part->name, fw.load_addr, fw.size);
+			return FAST_BOOT_ERR_HEAD;
+		}
+		entry_ok = fw.exec_addr - fw.load_addr < fw.size;
+
+		crc = 0;
+		if (fast_boot_read(spi, part->start + sizeof(fw), (uint8_t *)(uintptr_t)fw.load_addr, fw.size, &crc) != 0)
+			return FAST_BOOT_ERR_READ;
+		ret = crc == expect ? FAST_BOOT_OK : FAST_BOOT_ERR_CHECK;
+		if (ret != FAST_BOOT_OK)
+			error("fast boot: %s CRC 0x%08" PRIx32 " != 0x%08" PRIx32 "\r\n", part->name, crc, expect);
+	} else {
+		ret = fast_boot_segments(spi, part, &fw, &entry_ok);
+	}
+
+	if (ret != FAST_BOOT_OK)
+		return ret;
+
+	if (!entry_ok) {
+		error("fast boot: entry 0x%08" PRIx32 " outside the image\r\n", fw.exec_addr);
+		return FAST_BOOT_ERR_HEAD;
+	}
+
+	info("fast boot: %s v%" PRIu32 " entry 0x%08" PRIx32 "\r\n", part->name, fw.version, fw.exec_addr);
+	*entry = fw.exec_addr;
+
+	return FAST_BOOT_OK;
+}
@@ -0,0 +1,70 @@
+#ifndef __FAST_BOOT_H__
+#define __FAST_BOOT_H__
+
+#include <stdint.h>
+#include "sunxi_spi.h"
+#include "ptable.h"
+
+/*
+ * Direct application boot: boot0 takes the partition table, the OTA
+ * parameter record and the active slot's pack.py image the way boot1's
+ * boot_firmware() does, and starts the application without boot1 when
+ * all of it checks out. Anything unexpected boots through boot1, which
+ * can roll back, take an update or open its shell.
+ *
+ * The partition table comes from ptable_load(), the on-flash layouts below
+ * are shared with boot1/hgboot/ota/ota.h.
+ */
+
+#define FB_FW_MAGIC		0x46574D47 /* 'FWMG' */
+#define FB_PARA_MAGIC	0x50415241 /* 'PARA' */
+#define FB_SLOT_1		0xa1
+#define FB_SLOT_2		0xa2
+#define FB_SEG_MAX		16
+#define FB_SEG_ZERO		0x01 /* Clear the bytes between file_size and mem_size */
+
+typedef struct {
+	uint32_t magic;
+	uint32_t active_slot;
+	uint32_t can_be_back;
+	uint32_t upgrade_ready;
+	uint32_t app1_crc;
+	uint32_t app2_crc;
+	uint32_t download_crc;
+	uint32_t seq;	/* The valid record of Param / Param2 with the higher one is current */
+	uint32_t crc32; /* Of the fields above, erased on records from before seq (seq 0) */
+} fb_para_t;
+
+typedef struct {
+	uint32_t magic;
+	uint32_t size; /* Bytes after this header */
+	uint32_t crc32;
+	uint32_t version;
+	uint32_t load_addr;
+	uint32_t exec_addr;
+	uint32_t seg_count; /* 0 for a flat image */
+	uint32_t seg_crc32;
+} fb_fw_head_t;
+
+typedef struct {
+	uint32_t load_addr;
+	uint32_t file_size;
+	uint32_t mem_size;
+	uint32_t flags;
+	uint32_t crc32;
+} fb_fw_seg_t;
+
+enum {
+	FAST_BOOT_OK		= 0,
+	FAST_BOOT_ERR_BREAK = -1, /* Key on the UART or the boot key held */
+	FAST_BOOT_ERR_TABLE = -2, /* No partition table, or no APP1 / APP2 / Param in it, Param2 is optional */
+	FAST_BOOT_ERR_PARA	= -3, /* Bad Param record or an update pending */
+	FAST_BOOT_ERR_HEAD	= -4, /* Bad firmware header or segment table */
+	FAST_BOOT_ERR_READ	= -5, /* SPI read could not be started */
+	FAST_BOOT_ERR_CHECK = -6, /* Image CRC mismatch */
+};
+
+/* Load the active application, *entry is its exec_addr on FAST_BOOT_OK */
+int fast_boot_load(sunxi_spi_t *spi, uint32_t dram_size, uint32_t *entry);
+
+#endif
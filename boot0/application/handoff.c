@@ -0,0 +1,118 @@
+#include "main.h"
+#include "board.h"
+#include "handoff.h"
+#include "sunxi_clk.h"
+#include "sunxi_spi.h"
+#include "reg-ccu.h"
+
+/* Built in SRAM while boot0 runs, DRAM is only up half way through */
+static boot_handoff_t handoff;
+
+uint32_t handoff_crc32(const void *buf, uint32_t len)
+{
+	const uint8_t *p   = buf;
+	uint32_t	   crc = 0xffffffff;
+	int			   i;
+
+	while (len--) {
+		crc ^= *p++;
+		for (i = 0; i < 8; i++)
+			crc = (crc >> 1) ^ (0xedb88320 & -(crc & 1));
+	}
+
+	return ~crc;
+}
+
+void handoff_timestamp(int which)
+{
+	if (which < 0 || which >= HANDOFF_TS_NUM)
+		return;
+
+	handoff.ts_us[which] = (uint32_t)time_us();
+}
+
+void handoff_set_clk(void)
+{
+	handoff.pll_cpu		= sunxi_clk_get_cpu_rate();
+	handoff.pll_peri_1x = sunxi_clk_get_peri1x_rate();
+	handoff.ahb			= sunxi_clk_get_ahb_rate();
+	handoff.apb0		= sunxi_clk_get_apb_rate(CCU_APB0_CLK_REG);
+	handoff.apb1		= sunxi_clk_get_apb_rate(CCU_APB1_CLK_REG);
+	handoff.flags |= HANDOFF_F_CLK;
+}
+
+void handoff_set_dram(uint32_t size, uint32_t clk, uint32_t timing_pct)
+{
+	if (size == 0)
+		return;
+
+	handoff.dram_size		= size;
+	handoff.dram_clk		= clk;
+	handoff.dram_timing_pct = timing_pct;
+	handoff.flags |= HANDOFF_F_DRAM;
+}
+
+void handoff_set_tuned(uint32_t clk_min, uint32_t clk_max, uint32_t pct_min)
+{
+	handoff.dram_clk_min = clk_min;
+	handoff.dram_clk_max = clk_max;
+	handoff.dram_pct_min = pct_min;
+	handoff.flags |= HANDOFF_F_TUNED;
+}
+
+void handoff_set_nand(void *p)
+{
+	sunxi_spi_t *spi = p;
+
+	handoff.nand_mfr			 = spi->info.id.mfr;
+	handoff.nand_dev			 = spi->info.id.dev;
+	handoff.nand_page_size		 = spi->info.page_size;
+	handoff.nand_spare_size		 = spi->info.spare_size;
+	handoff.nand_pages_per_block = spi->info.pages_per_block;
+	handoff.nand_blocks			 = spi->info.blocks_per_die * spi->info.ndies;
+	handoff.spi_clk				 = sunxi_spi_get_clk(spi);
+	handoff.spi_mode			 = spi->info.mode;
+	sunxi_spi_get_sample(spi, &handoff.spi_tcr, &handoff.spi_dly);
+	handoff.flags |= HANDOFF_F_NAND;
+}
+
+void handoff_set_direct(int direct)
+{
+	if (direct)
+		handoff.flags |= HANDOFF_F_DIRECT;
+	else
+		handoff.flags &= ~HANDOFF_F_DIRECT;
+}
+
+/* Seal the block and copy it to its DRAM page, last thing before the jump */
+void handoff_commit(void)
+{
+	boot_handoff_t *dst = (boot_handoff_t *)HANDOFF_ADDR;
+
+	if (!(handoff.flags & HANDOFF_F_DRAM))
+		return;
+
+	handoff.magic	= HANDOFF_MAGIC;
+	handoff.version = HANDOFF_VERSION;
+	handoff.size	= sizeof(boot_handoff_t);
+	handoff.crc		= 0;
+	handoff.crc		= handoff_crc32(&handoff, sizeof(boot_handoff_t));
+
+	memcpy(dst, &handoff, sizeof(boot_handoff_t));
+}
+
+const boot_handoff_t *handoff_get(void)
+{
+	boot_handoff_t *ho = (boot_handoff_t *)HANDOFF_ADDR;
+	boot_handoff_t	tmp;
+
+	if (ho->magic != HANDOFF_MAGIC || ho->version != HANDOFF_VERSION || ho->size != sizeof(boot_handoff_t))
+		return NULL;
+
+	memcpy(&tmp, ho, sizeof(boot_handoff_t));
+	tmp.crc = 0;
+	if (handoff_crc32(&tmp, sizeof(boot_handoff_t)) != ho->crc)
+		return NULL;
+
+	return ho;
+}
@@ -0,0 +1,90 @@
+#ifndef __HANDOFF_H__
+#define __HANDOFF_H__
+
+#include <stdint.h>
+
+/*
+ * boot0 -> boot1 -> application hand-off block.
+ *
+ * boot0 records what it already brought up (clock tree, DRAM, SPI NAND and
+ * the SPI timing it read it with) and writes the block to a fixed DRAM page
+ * right before jumping to boot1. Later stages check magic, version, size and
+ * CRC and skip re-detection when it is valid; boot1 refreshes the clock tree
+ * and its own timestamp and re-seals the block before starting the app.
+ *
+ * The layout is shared with boot1/application/handoff.h and
+ * application/drivers/drv_handoff.h, bump HANDOFF_VERSION on any change.
+ */
+
+/* Last page of the first DRAM MiB: above boot1's heap, outside the app's uncached heap */
+#define HANDOFF_ADDR	0x400ff000
+#define HANDOFF_MAGIC	0x46464f48 /* "HOFF" */
+#define HANDOFF_VERSION 2
+
+/* Valid sections */
+#define HANDOFF_F_CLK	 (1 << 0)
+#define HANDOFF_F_DRAM	 (1 << 1)
+#define HANDOFF_F_NAND	 (1 << 2)
+#define HANDOFF_F_DIRECT (1 << 3) /* boot0 started the app itself, boot1 never ran */
+#define HANDOFF_F_TUNED	 (1 << 4) /* DRAM characterised this boot, boot1 stores dram_clk / dram_timing_pct */
+
+/* Boot timeline, arch counter in microseconds */
+enum {
+	HANDOFF_TS_BOOT0 = 0, /* boot0 main() */
+	HANDOFF_TS_DRAM,	  /* DRAM trained */
+	HANDOFF_TS_NAND,	  /* SPI NAND detected */
+	HANDOFF_TS_LOAD,	  /* boot1 (or the app, F_DIRECT) loaded, jumping */
+	HANDOFF_TS_BOOT1,	  /* boot1 jumping to the app */
+	HANDOFF_TS_NUM,
+};
+
+typedef struct {
+	uint32_t magic;
+	uint32_t version;
+	uint32_t size; /* sizeof(boot_handoff_t) */
+	uint32_t crc;  /* CRC32 of the block with crc = 0 */
+	uint32_t flags;
+
+	/* Clock tree, Hz */
+	uint32_t pll_cpu;
+	uint32_t pll_peri_1x;
+	uint32_t ahb;
+	uint32_t apb0;
+	uint32_t apb1;
+
+	/* DRAM */
+	uint32_t dram_size;		  /* Bytes */
+	uint32_t dram_clk;		  /* MHz */
+	uint32_t dram_timing_pct; /* ns timings scaled to this percent */
+	uint32_t dram_clk_min;	  /* F_TUNED: passing clocks at spec timings */
+	uint32_t dram_clk_max;
+	uint32_t dram_pct_min;	  /* F_TUNED: tightest timing passing at dram_clk */
+
+	/* SPI NAND */
+	uint32_t nand_mfr;
+	uint32_t nand_dev;
+	uint32_t nand_page_size;
+	uint32_t nand_spare_size;
+	uint32_t nand_pages_per_block;
+	uint32_t nand_blocks; /* blocks_per_die * ndies */
+	uint32_t spi_clk;	  /* SCLK actually set */
+	uint32_t spi_mode;	  /* spi_io_mode_t used for cache reads */
+	uint32_t spi_tcr;	  /* SPI_TCR SDC (bit 11) / SDM (bit 13) */
+	uint32_t spi_dly;	  /* SPI_DLY sample delay chain, raw */
+
+	uint32_t ts_us[HANDOFF_TS_NUM];
+} boot_handoff_t;
+
+uint32_t handoff_crc32(const void *buf, uint32_t len);
+
+void handoff_timestamp(int which);
+void handoff_set_clk(void);
+void handoff_set_dram(uint32_t size, uint32_t clk, uint32_t timing_pct);
+void handoff_set_tuned(uint32_t clk_min, uint32_t clk_max, uint32_t pct_min);
+void handoff_set_nand(void *spi); /* sunxi_spi_t *, after spi_nand_detect() */
+void handoff_set_direct(int direct); /* The app was loaded by boot0, boot1 skipped */
+void handoff_commit(void);
+
+const boot_handoff_t *handoff_get(void);
+
+#endif
@@ -8,6 +8,14 @@
 #include "board.h"
 #include "barrier.h"
 #include "string.h"
+#include "handoff.h"
+#include "boot_image.h"
+#include "fast_boot.h"
+#include "ptable.h"
+#include "dram_bench.h"
+#include "dram_tune.h"
+#include "mmu.h"
+#include "dram.h"
 
 # if 0
 static void hexdump(const void *p, uint32_t len)
@@ -47,28 +55,44 @@ static void hexdump(const void *p, uint32_t len)
 }
 #endif
 
-#define IMG_OFFSET_IN_FLASH 0x100000
-#define IMG_MAGIC 0x12345678
+/* DRAM scratch for the SPI calibration, boot1 is loaded over it afterwards */
+#define SPI_CAL_BUF 0x40000000
 
-typedef struct boot_head
+static int load_boot1(uint32_t *entry)
 {
-    uint32_t img_magic;
-    uint32_t img_size;
-    uint32_t img_load;
-    uint32_t img_entry;
-}boot_head_t;
+    int copy;
+    boot_head_t img_head;
+
+    copy = boot_image_load_any(&sunxi_spi0, &img_head);
+    if (copy < 0)
+    {
+        return -1;
+    }
+
+    debug("boot1 copy %d\r\n", copy);
+    debug("img_size:  0x%08x\r\n", img_head.img_size);
+    debug("img_load:  0x%08x\r\n", img_head.img_load);
+    debug("img_entry: 0x%08x\r\n", img_head.img_entry);
+
+    *entry = img_head.img_entry;
+
+    return 0;
+}
 
 int main(void)
 {
-    uint32_t i = 0;
-    uint32_t count = 0;
     void (*app_entry)(void);
-    uint8_t *dst_addr;
-    boot_head_t img_head;
+    uint32_t dram_size;
+    dram_op_t dram_op;
+    uint32_t entry = 0;
+    uint32_t cal_page = BOOT1_ADDR;
+
+    handoff_timestamp(HANDOFF_TS_BOOT0);
 
     board_init();
     sunxi_clk_init();
-    sunxi_dram_init();
+    handoff_set_clk();
+
     dma_init();
 
     debug("SPI: init\r\n");
@@ -84,39 +108,87 @@ int main(void)
         while(1);
     }
 
-    spi_nand_read(&sunxi_spi0, (uint8_t *)&img_head, IMG_OFFSET_IN_FLASH, sizeof(boot_head_t));
-
-    if (img_head.img_magic != IMG_MAGIC)
+    /* The board's stored operating point comes off the flash first, DRAM is trained at it */
+    dram_op_load(&sunxi_spi0, &dram_op);
+    dram_size = 0;
+#ifdef CONFIG_DRAM_TUNE
+    sunxi_gpio_init(CONFIG_DRAM_TUNE, GPIO_INPUT);
+    sunxi_gpio_set_pull(CONFIG_DRAM_TUNE, GPIO_PULL_UP);
+    udelay(10);
+    if (sunxi_gpio_read(CONFIG_DRAM_TUNE) == 0)
     {
-        error("img_magic err\r\n");
-        while(1);
+        dram_size = dram_tune(&dram_op);
+    }
+    else
+#endif
+    if (dram_op.clk != 0)
+    {
+        dram_size = sunxi_dram_init_op(&dram_op);
+    }
+    if (dram_size == 0)
+    {
+        if (dram_op.clk != 0)
+        {
+            warning("DRAM: stored point failed, defaults\r\n");
+        }
+        dram_op.clk = 0;
+        dram_op.timing_pct = 0;
+        dram_size = sunxi_dram_init_op(&dram_op);
     }
+    handoff_set_dram(dram_size, dram_op.clk, dram_op.timing_pct);
+    handoff_timestamp(HANDOFF_TS_DRAM);
+
+    /* Caches on for the load phase, DMA targets are cleaned/invalidated in spi_transfer() */
+    mmu_setup(SDRAM_BASE, dram_size);
+
+#ifdef CONFIG_DRAM_BENCH
+    /* Strap held low: qualify the DRAM before anything is loaded into it, the hand-off block is still in SRAM */
+    sunxi_gpio_init(CONFIG_DRAM_BENCH, GPIO_INPUT);
+    sunxi_gpio_set_pull(CONFIG_DRAM_BENCH, GPIO_PULL_UP);
+    udelay(10);
+    if (sunxi_gpio_read(CONFIG_DRAM_BENCH) == 0)
+    {
+        dram_bench_run(SDRAM_BASE, dram_size - MMU_TTB_SIZE);
+    }
+#endif
 
-    debug("img_magic: 0x%08x\r\n", img_head.img_magic);
-    debug("img_size:  0x%08x\r\n", img_head.img_size);
-    debug("img_load:  0x%08x\r\n", img_head.img_load);
-    debug("img_entry: 0x%08x\r\n", img_head.img_entry);
+    /* boot1's header page is the reference, never blank on a flashed board; a bad block reads back as junk */
+    if (spi_nand_block_bad(&sunxi_spi0, cal_page))
+    {
+        cal_page += BOOT1_STRIDE;
+    }
+    sunxi_spi_calibrate(&sunxi_spi0, cal_page, (uint8_t *)SPI_CAL_BUF);
+    handoff_timestamp(HANDOFF_TS_NAND);
 
-    app_entry = (void (*)(void))img_head.img_entry;
-    dst_addr = (uint8_t *)img_head.img_load;
+    /* boot1 copies and the fast boot partitions, the built-in layout without it */
+    ptable_load(&sunxi_spi0);
 
-    count = img_head.img_size/2048;
-    if (img_head.img_size%2048)
+#ifdef CONFIG_FAST_BOOT
+    /* Nothing pending in Param: start the app and skip boot1 */
+    if (fast_boot_load(&sunxi_spi0, dram_size, &entry) != FAST_BOOT_OK)
     {
-        count++;
+        entry = 0;
     }
+#endif
+    handoff_set_direct(entry != 0);
 
-    for (i = 0; i < count; i++)
+    if (entry == 0 && load_boot1(&entry) != 0)
     {
-        spi_nand_read(&sunxi_spi0, (dst_addr+(2048*i)), (IMG_OFFSET_IN_FLASH+(2048*i)), 2048);
+        while(1);
     }
 
+    app_entry = (void (*)(void))entry;
+
+    handoff_set_nand(&sunxi_spi0);
+
     sunxi_spi_disable(&sunxi_spi0);
     dma_exit();
 
-    arm32_mmu_disable();
-    arm32_dcache_disable();
-    arm32_icache_disable();
+    handoff_timestamp(HANDOFF_TS_LOAD);
+    handoff_commit();
+
+    /* Clean the hand-off block and everything else to DRAM, the next stage starts uncached */
+    mmu_disable();
     arm32_interrupt_disable();
 
     app_entry();
@@ -0,0 +1,50 @@
+#include "main.h"
+#include "boot_image.h"
+#include "ptable.h"
+
+/* Header and entries as they sit at the start of a block, read in one go */
+static struct {
+	ptable_head_t  head;
+	ptable_entry_t entry[PTABLE_MAX];
+} ptable;
+
+static uint32_t ptable_count;
+
+int ptable_load(sunxi_spi_t *spi)
+{
+	uint32_t block = spi->info.page_size * spi->info.pages_per_block;
+	uint32_t addr, crc, want;
+
+	ptable_count = 0;
+
+	for (addr = PTABLE_ADDR; addr < PTABLE_ADDR + PTABLE_SIZE; addr += block) {
+		spi_nand_read(spi, (uint8_t *)&ptable, addr, sizeof(ptable));
+		if (ptable.head.magic != PTABLE_MAGIC || ptable.head.version != PTABLE_VER || ptable.head.count > PTABLE_MAX)
+			continue;
+
+		want			  = ptable.head.crc32;
+		ptable.head.crc32 = 0;
+		crc				  = boot_image_crc32(0, &ptable, sizeof(ptable_head_t) + ptable.head.count * sizeof(ptable_entry_t));
+		if (crc != want)
+			continue;
+
+		debug("ptable @0x%08" PRIx32 ": %" PRIu32 " partitions\r\n", addr, ptable.head.count);
+		ptable_count = ptable.head.count;
+		return 0;
+	}
+
+	debug("ptable: none found\r\n");
+	return -1;
+}
+
+const ptable_entry_t *ptable_find(const char *name)
+{
+	uint32_t i;
+
+	for (i = 0; i < ptable_count; i++) {
+		if (strncmp(ptable.entry[i].name, name, PTABLE_NAME) == 0)
+			return &ptable.entry[i];
+	}
+
+	return NULL;
+}
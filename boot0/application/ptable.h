@@ -0,0 +1,41 @@
+#ifndef __PTABLE_H__
+#define __PTABLE_H__
+
+#include <stdint.h>
+#include "sunxi_spi.h"
+
+/*
+ * Read side of boot1/hgboot/partition/partition.h. tool/mk_nand.c writes
+ * one table per good block of the ptable partition; the first one with a
+ * good CRC is used.
+ */
+
+#define PTABLE_ADDR	 0x80000 /* boot1/boards/port/partition_port.h PARTITION_TABLE_ADDR */
+#define PTABLE_SIZE	 0x80000
+#define PTABLE_MAGIC 0x4C425450 /* 'PTBL' */
+#define PTABLE_VER	 1
+#define PTABLE_MAX	 20
+#define PTABLE_NAME	 16
+
+typedef struct {
+	uint32_t magic;
+	uint32_t version;
+	uint32_t count;
+	uint32_t crc32; /* Header with crc32 = 0, then the entries */
+} ptable_head_t;
+
+typedef struct {
+	char	 name[PTABLE_NAME];
+	uint32_t start;
+	uint32_t size;
+	uint32_t type;
+	uint32_t copies;
+} ptable_entry_t;
+
+/* Find and cache the table, 0 when one was found */
+int ptable_load(sunxi_spi_t *spi);
+
+/* Entry from the cached table, NULL without a table or without that name */
+const ptable_entry_t *ptable_find(const char *name);
+
+#endif
@@ -44,6 +44,9 @@
 #define SUNXI_SID_BASE 0x3006200
 #endif
 
+/* Percent of the table ns timings that carry margin, sunxi_dram_init_op() */
+static unsigned int timing_pct = 100;
+
 static int ns_to_t(dram_para_t *para, int nanoseconds)
 {
 	const unsigned int ctrl_freq = para->dram_clk / 2;
@@ -51,6 +54,22 @@ static int ns_to_t(dram_para_t *para, int nanoseconds)
 	return DIV_ROUND_UP(ctrl_freq * nanoseconds, 1000);
 }
 
+/*
+ * A row timing the table pads over JEDEC: scaled by timing_pct, but never
+ * below min_ps, the minimum of the slowest speed bin running at this clock.
+ * Everything else (tRFC, tREFI, tWTR, tRRD, ...) stays at ns_to_t().
+ */
+static int ns_to_t_op(dram_para_t *para, int nanoseconds, unsigned int min_ps)
+{
+	const unsigned int ctrl_freq = para->dram_clk / 2;
+	unsigned int ps = nanoseconds * 10 * timing_pct;
+
+	if (ps < min_ps)
+		ps = min_ps;
+
+	return DIV_ROUND_UP(ctrl_freq * ps, 1000 * 1000);
+}
+
 void abort(void)
 {
 	while (1)
@@ -230,17 +249,17 @@ static void mctl_set_timing_params(dram_para_t *para)
 	switch (para->dram_type) {
 		case SUNXI_DRAM_TYPE_DDR2:
 			/* DRAM_TPR0 */
-			tfaw = ns_to_t(para, 50);
+			tfaw = ns_to_t_op(para, 50, 45000);
 			trrd = ns_to_t(para, 10);
-			trcd = ns_to_t(para, 20);
-			trc = ns_to_t(para, 65);
+			trcd = ns_to_t_op(para, 20, 12500);
+			trc = ns_to_t_op(para, 65, 57500);
 
 			/* DRAM_TPR1 */
 			txp = 2;
 			twtr = ns_to_t(para, 8);
 			twr = ns_to_t(para, 15);
-			trp = ns_to_t(para, 15);
-			tras = ns_to_t(para, 45);
+			trp = ns_to_t_op(para, 15, 12500);
+			tras = ns_to_t_op(para, 45, 40000);
 
 			/* DRAM_TRP2 */
 			trfc = ns_to_t(para, 328);
@@ -289,11 +308,12 @@ static void mctl_set_timing_params(dram_para_t *para)
 			txp = max(ns_to_t(para, 10), 2);
 
 			if (para->dram_clk <= 800) {
-				tfaw = ns_to_t(para, 50);
-				trcd = ns_to_t(para, 15);
-				trp = ns_to_t(para, 15);
-				trc = ns_to_t(para, 53);
-				tras = ns_to_t(para, 38);
+				/* DDR3-1600 */
+				tfaw = ns_to_t_op(para, 50, 40000);
+				trcd = ns_to_t_op(para, 15, 13750);
+				trp = ns_to_t_op(para, 15, 13750);
+				trc = ns_to_t_op(para, 53, 48750);
+				tras = ns_to_t_op(para, 38, 35000);
 
 				mr0 = 0x1c70;
 				mr2 = 0x18;
@@ -302,11 +322,12 @@ static void mctl_set_timing_params(dram_para_t *para)
 				tcwl = 4;
 				t_rdata_en = 4;
 			} else {
-				tfaw = ns_to_t(para, 35);
-				trcd = ns_to_t(para, 14);
-				trp = ns_to_t(para, 14);
-				trc = ns_to_t(para, 48);
-				tras = ns_to_t(para, 34);
+				/* DDR3-1866 */
+				tfaw = ns_to_t_op(para, 35, 35000);
+				trcd = ns_to_t_op(para, 14, 13910);
+				trp = ns_to_t_op(para, 14, 13910);
+				trc = ns_to_t_op(para, 48, 47910);
+				tras = ns_to_t_op(para, 34, 34000);
 
 				mr0 = 0x1e14;
 				mr2 = 0x20;
@@ -1412,9 +1433,14 @@ int init_DRAM(int type, dram_para_t *para)
 }
 
 unsigned long sunxi_dram_init(void)
+{
+	return sunxi_dram_init_op(NULL);
+}
+
+unsigned long sunxi_dram_init_op(dram_op_t *op)
 {
 	dram_para_t para = {
-		.dram_clk = CONFIG_DRAM_CLK,
+		.dram_clk = (op && op->clk) ? op->clk : CONFIG_DRAM_CLK,
 		.dram_type = CONFIG_SUNXI_DRAM_TYPE,
 		.dram_zq = CONFIG_DRAM_ZQ,
 		.dram_odt_en = CONFIG_DRAM_SUNXI_ODT_EN,
@@ -1440,5 +1466,11 @@ unsigned long sunxi_dram_init(void)
 		.dram_tpr13 = CONFIG_DRAM_SUNXI_TPR13,
 	};
 
+	timing_pct = (op && op->timing_pct) ? op->timing_pct : 100;
+	if (op) {
+		op->clk		   = para.dram_clk;
+		op->timing_pct = timing_pct;
+	}
+
 	return init_DRAM(0, &para) * 1024UL * 1024;
 };
@@ -70,7 +70,15 @@ typedef struct __DRAM_PARA {
 
 } dram_para_t;
 
+/* Operating point over the built-in parameters, application/dram_tune.c finds and stores it */
+typedef struct {
+	unsigned int clk;		 /* MHz, 0 keeps CONFIG_DRAM_CLK */
+	unsigned int timing_pct; /* padded row timings scaled to this percent down to JEDEC, 0 = 100 */
+} dram_op_t;
+
 int init_DRAM(int type, dram_para_t *para);
 unsigned long sunxi_dram_init(void);
+/* NULL or zero fields for the defaults, *op is set to the point actually used */
+unsigned long sunxi_dram_init_op(dram_op_t *op);
 
 #endif
@@ -0,0 +1,187 @@
+#include <stddef.h>
+#include <stdint.h>
+
+#include "dram_bench_core.h"
+
+#define BENCH_LEN	 (16 << 20) /* Per buffer, far past the 256KiB L2 */
+#define BENCH_ROUNDS 4			/* Best of */
+#define LAT_LEN		 (16 << 20)
+#define LAT_STRIDE	 64 /* One cache line per load */
+#define LAT_LOADS	 (1 << 20)
+#define WALK_LEN	 (1 << 20) /* Data line faults do not depend on the address */
+#define FAIL_SHOW	 8
+
+#define TICKS_PER_US 24 /* CNTPCT */
+
+#define bench_min(a, b) (((a) < (b)) ? (a) : (b))
+
+static uint32_t			 bench_fails;
+static dram_bench_fail_t bench_hook;
+static uint32_t			 bench_seed = 0x2545f491;
+
+static uint32_t bench_rand(void)
+{
+	bench_seed ^= bench_seed << 13;
+	bench_seed ^= bench_seed >> 17;
+	bench_seed ^= bench_seed << 5;
+
+	return bench_seed;
+}
+
+static uint32_t bench_mbs(uint32_t bytes, uint64_t ticks)
+{
+	return ticks ? (uint32_t)((uint64_t)bytes * TICKS_PER_US / ticks) : 0;
+}
+
+static void bench_fail(volatile uint32_t *p, uint32_t want, uint32_t got)
+{
+	if (bench_fails++ < FAIL_SHOW && bench_hook)
+		bench_hook(p, want, got);
+}
+
+static void bench_bandwidth(uint32_t base, uint32_t size, dram_bench_clock_t clock, struct dram_bench_speed *s)
+{
+	uint32_t len = bench_min(BENCH_LEN, size / 2) & ~63;
+	void	*src = (void *)base;
+	void	*dst = (void *)(base + len);
+	uint64_t t, rd = ~0ULL, wr = ~0ULL, cp = ~0ULL;
+	int		 i;
+
+	for (i = 0; i < BENCH_ROUNDS; i++) {
+		t  = clock();
+		neon_bench_write(src, len, 0x5aa5a55a);
+		wr = bench_min(wr, clock() - t);
+
+		t  = clock();
+		neon_bench_read(src, len);
+		rd = bench_min(rd, clock() - t);
+
+		t  = clock();
+		neon_bench_copy(dst, src, len);
+		cp = bench_min(cp, clock() - t);
+	}
+
+	s->len		 = len;
+	s->read_mbs	 = bench_mbs(len, rd);
+	s->write_mbs = bench_mbs(len, wr);
+	s->copy_mbs	 = bench_mbs(len, cp);
+}
+
+/* Pointer chase through a random single cycle of cache lines (Sattolo), every load misses */
+static void bench_latency(uint32_t base, uint32_t size, dram_bench_clock_t clock, struct dram_bench_speed *s)
+{
+	uint32_t  n = bench_min(LAT_LEN, size) / LAT_STRIDE;
+	uint32_t *slot, i, j, tmp;
+	uint32_t *p = (uint32_t *)base;
+	uint64_t  t;
+
+	for (i = 0; i < n; i++)
+		*(uint32_t *)(base + i * LAT_STRIDE) = i;
+
+	for (i = n - 1; i > 0; i--) {
+		j	  = bench_rand() % i;
+		slot  = (uint32_t *)(base + i * LAT_STRIDE);
+		tmp	  = *slot;
+		*slot = *(uint32_t *)(base + j * LAT_STRIDE);
+		*(uint32_t *)(base + j * LAT_STRIDE) = tmp;
+	}
+
+	for (i = 0; i < n; i++) {
+		slot  = (uint32_t *)(base + i * LAT_STRIDE);
+		*slot = base + *slot * LAT_STRIDE;
+	}
+
+	t = clock();
+	for (i = 0; i < LAT_LOADS; i++)
+		p = (uint32_t *)*(volatile uint32_t *)p;
+	t = clock() - t;
+
+	s->lat_len = n * LAT_STRIDE;
+	s->lat_ps  = (uint32_t)(t * 1000000 / TICKS_PER_US / LAT_LOADS);
+}
+
+/* Every bit alone, set and cleared, in every word lane */
+static void bench_walk(uint32_t base, uint32_t size)
+{
+	volatile uint32_t *p = (volatile uint32_t *)base;
+	uint32_t		   n = bench_min(WALK_LEN, size) / 4;
+	uint32_t		   bit, inv, i, v;
+
+	for (bit = 0; bit < 32; bit++) {
+		for (inv = 0; inv < 2; inv++) {
+			for (i = 0; i < n; i++)
+				p[i] = (1U << ((i + bit) & 31)) ^ -inv;
+			for (i = 0; i < n; i++) {
+				v = (1U << ((i + bit) & 31)) ^ -inv;
+				if (p[i] != v)
+					bench_fail(&p[i], v, p[i]);
+			}
+		}
+	}
+}
+
+/* Address in every word, then its complement: shorted or open address lines alias */
+static void bench_address(uint32_t base, uint32_t size)
+{
+	volatile uint32_t *p = (volatile uint32_t *)base;
+	uint32_t		   n = size / 4;
+	uint32_t		   inv, i;
+
+	for (inv = 0; inv < 2; inv++) {
+		for (i = 0; i < n; i++)
+			p[i] = (uint32_t)&p[i] ^ -inv;
+		for (i = 0; i < n; i++) {
+			if (p[i] != ((uint32_t)&p[i] ^ -inv))
+				bench_fail(&p[i], (uint32_t)&p[i] ^ -inv, p[i]);
+		}
+	}
+}
+
+/* Read want, write next, one March C- element */
+static void bench_march_step(volatile uint32_t *p, uint32_t want, uint32_t next)
+{
+	if (*p != want)
+		bench_fail(p, want, *p);
+	*p = next;
+}
+
+/* March C-: up(w0) up(r0,w1) up(r1,w0) down(r0,w1) down(r1,w0) up(r0), all-ones as the 1 pattern */
+static void bench_march(uint32_t base, uint32_t size)
+{
+	volatile uint32_t *p = (volatile uint32_t *)base;
+	uint32_t		   n = size / 4;
+	uint32_t		   i;
+
+	for (i = 0; i < n; i++)
+		p[i] = 0;
+	for (i = 0; i < n; i++)
+		bench_march_step(&p[i], 0, ~0U);
+	for (i = 0; i < n; i++)
+		bench_march_step(&p[i], ~0U, 0);
+	for (i = n; i-- > 0;)
+		bench_march_step(&p[i], 0, ~0U);
+	for (i = n; i-- > 0;)
+		bench_march_step(&p[i], ~0U, 0);
+	for (i = 0; i < n; i++)
+		bench_march_step(&p[i], 0, 0);
+}
+
+void dram_bench_speed(uint32_t base, uint32_t size, dram_bench_clock_t clock, struct dram_bench_speed *s)
+{
+	bench_bandwidth(base, size, clock, s);
+	bench_latency(base, size, clock, s);
+}
+
+uint32_t dram_bench_patterns(uint32_t base, uint32_t size, dram_bench_fail_t fail)
+{
+	bench_fails = 0;
+	bench_hook	= fail;
+
+	bench_walk(base, size);
+	bench_address(base, size);
+	bench_march(base, size);
+
+	bench_hook = NULL;
+
+	return bench_fails;
+}
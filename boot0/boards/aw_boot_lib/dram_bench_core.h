@@ -0,0 +1,39 @@
+#ifndef __DRAM_BENCH_CORE_H__
+#define __DRAM_BENCH_CORE_H__
+
+#include <stdint.h>
+
+/*
+ * Measurement and pattern passes behind boot0's dram_bench.c and boot1's
+ * dram_bench / dram_test shell commands. Nothing here prints: figures come
+ * back in struct dram_bench_speed, failing words through the caller's hook.
+ * boot1/application/dram_bench_core.c builds this same source for boot1.
+ */
+
+/* NEON kernels, neon_bench.S: len a multiple of 64, 16 byte aligned buffers */
+void neon_bench_read(const void *src, uint32_t len);
+void neon_bench_write(void *dst, uint32_t len, uint32_t pattern);
+void neon_bench_copy(void *dst, const void *src, uint32_t len);
+
+/* 24MHz CNTPCT ticks */
+typedef uint64_t (*dram_bench_clock_t)(void);
+
+/* Called for the first few failing words of a pass */
+typedef void (*dram_bench_fail_t)(volatile uint32_t *p, uint32_t want, uint32_t got);
+
+struct dram_bench_speed {
+	uint32_t len; /* Per buffer, best of a few rounds */
+	uint32_t read_mbs;
+	uint32_t write_mbs;
+	uint32_t copy_mbs; /* Copy moves every byte twice over the bus, quoted as bytes copied */
+	uint32_t lat_len;
+	uint32_t lat_ps; /* Random dependent load */
+};
+
+/* base 64 byte aligned, size a multiple of 64 and at least 128 bytes */
+void dram_bench_speed(uint32_t base, uint32_t size, dram_bench_clock_t clock, struct dram_bench_speed *s);
+
+/* Walking bit, own address and March C-; fail may be NULL. Returns the number of failing words */
+uint32_t dram_bench_patterns(uint32_t base, uint32_t size, dram_bench_fail_t fail);
+
+#endif
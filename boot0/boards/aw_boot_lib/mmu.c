@@ -0,0 +1,133 @@
+#include "main.h"
+#include "arm32.h"
+#include "barrier.h"
+#include "mmu.h"
+#include "debug.h"
+
+/*
+ * Flat 1MiB section map for the load phase: BROM/SRAM and DRAM are normal
+ * write-back write-allocate memory, everything else is device memory and
+ * never executable. The table lives in the last 16KiB of DRAM, away from
+ * the boot1 load area and the hand-off page; mmu_disable() cleans the
+ * caches to DRAM before boot1 starts with the MMU off.
+ */
+
+#define SECT_TYPE	(2 << 0)
+#define SECT_B		(1 << 2)
+#define SECT_C		(1 << 3)
+#define SECT_XN		(1 << 4)
+#define SECT_AP_RW	(3 << 10)
+#define SECT_TEX(x) ((x) << 12)
+
+#define SECT_DEVICE (SECT_TYPE | SECT_B | SECT_XN | SECT_AP_RW)
+#define SECT_NORMAL (SECT_TYPE | SECT_TEX(1) | SECT_C | SECT_B | SECT_AP_RW)
+
+#define DCACHE_LINE 64 /* Cortex-A7 L1 and L2 */
+
+extern void v7_dcache_all(int clean);
+extern void v7_mmu_cache_off(void);
+
+static int mmu_on;
+
+static inline void mmu_set_ttb(uint32_t ttb)
+{
+	__asm__ __volatile__("mcr p15, 0, %0, c2, c0, 2" : : "r"(0) : "memory");   /* TTBCR: TTBR0 only */
+	__asm__ __volatile__("mcr p15, 0, %0, c2, c0, 0" : : "r"(ttb) : "memory"); /* TTBR0, non-cacheable walks */
+	__asm__ __volatile__("mcr p15, 0, %0, c3, c0, 0" : : "r"(0x55555555) : "memory"); /* DACR: all client */
+}
+
+static inline void mmu_inv_tlb_icache(void)
+{
+	__asm__ __volatile__("mcr p15, 0, %0, c8, c7, 0" : : "r"(0) : "memory"); /* TLBIALL */
+	__asm__ __volatile__("mcr p15, 0, %0, c7, c5, 0" : : "r"(0) : "memory"); /* ICIALLU */
+	__asm__ __volatile__("mcr p15, 0, %0, c7, c5, 6" : : "r"(0) : "memory"); /* BPIALL */
+	dsb();
+	isb();
+}
+
+/* Cortex-A7 needs ACTLR.SMP before its caches and TLB are used */
+static inline void mmu_smp_enable(void)
+{
+	uint32_t val;
+
+	__asm__ __volatile__("mrc p15, 0, %0, c1, c0, 1" : "=r"(val));
+	val |= (1 << 6);
+	__asm__ __volatile__("mcr p15, 0, %0, c1, c0, 1" : : "r"(val) : "memory");
+	isb();
+}
+
+void mmu_setup(uint32_t dram_base, uint32_t dram_size)
+{
+	uint32_t *ttb;
+	uint32_t  i;
+
+	if (dram_size < (1 << 20))
+		return;
+
+	ttb = (uint32_t *)(dram_base + dram_size - MMU_TTB_SIZE);
+
+	for (i = 0; i < 4096; i++)
+		ttb[i] = (i << 20) | SECT_DEVICE;
+
+	/* BROM and SRAM A1: boot0 code, stack and DMA descriptors */
+	ttb[0] = SECT_NORMAL;
+
+	for (i = dram_base >> 20; i < (dram_base + dram_size) >> 20; i++)
+		ttb[i] = (i << 20) | SECT_NORMAL;
+	dsb();
+
+	mmu_smp_enable();
+	v7_dcache_all(0);
+	mmu_inv_tlb_icache();
+	mmu_set_ttb((uint32_t)ttb);
+	isb();
+
+	arm32_write_p15_c1(arm32_read_p15_c1() | (1 << 0) | (1 << 2) | (1 << 12));
+	isb();
+	mmu_on = 1;
+
+	debug("MMU: on, table at 0x%08" PRIx32 ", DRAM %" PRIu32 "MB cached\r\n", (uint32_t)ttb, dram_size >> 20);
+}
+
+/* Everything back to the reset state boot1 expects, dirty lines written to DRAM first */
+void mmu_disable(void)
+{
+	v7_mmu_cache_off();
+	mmu_on = 0;
+}
+
+void dcache_clean_range(uint32_t start, uint32_t size)
+{
+	uint32_t addr = start & ~(DCACHE_LINE - 1);
+
+	if (!mmu_on)
+		return;
+
+	for (; addr < start + size; addr += DCACHE_LINE)
+		__asm__ __volatile__("mcr p15, 0, %0, c7, c10, 1" : : "r"(addr) : "memory"); /* DCCMVAC */
+	dsb();
+}
+
+void dcache_inv_range(uint32_t start, uint32_t size)
+{
+	uint32_t addr = start & ~(DCACHE_LINE - 1);
+
+	if (!mmu_on)
+		return;
+
+	for (; addr < start + size; addr += DCACHE_LINE)
+		__asm__ __volatile__("mcr p15, 0, %0, c7, c6, 1" : : "r"(addr) : "memory"); /* DCIMVAC */
+	dsb();
+}
+
+void dcache_flush_range(uint32_t start, uint32_t size)
+{
+	uint32_t addr = start & ~(DCACHE_LINE - 1);
+
+	if (!mmu_on)
+		return;
+
+	for (; addr < start + size; addr += DCACHE_LINE)
+		__asm__ __volatile__("mcr p15, 0, %0, c7, c14, 1" : : "r"(addr) : "memory"); /* DCCIMVAC */
+	dsb();
+}
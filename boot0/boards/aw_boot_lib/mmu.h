@@ -0,0 +1,17 @@
+#ifndef __MMU_H__
+#define __MMU_H__
+
+#include "main.h"
+
+/* 4096 short-descriptor entries, 16KiB aligned */
+#define MMU_TTB_SIZE 0x4000
+
+void mmu_setup(uint32_t dram_base, uint32_t dram_size);
+void mmu_disable(void);
+
+/* Cache maintenance by address around DMA buffers, no-ops while the caches are off */
+void dcache_clean_range(uint32_t start, uint32_t size);
+void dcache_inv_range(uint32_t start, uint32_t size);
+void dcache_flush_range(uint32_t start, uint32_t size);
+
+#endif
@@ -196,6 +196,69 @@ uint32_t sunxi_clk_get_peri1x_rate()
 	return 0;
 }
 
+uint32_t sunxi_clk_get_cpu_rate(void)
+{
+	uint32_t reg32;
+	uint32_t plln, p;
+
+	/* PLL_CPUX = 24 MHz*N/P */
+	reg32 = read32(T113_CCU_BASE + CCU_PLL_CPU_CTRL_REG);
+	plln  = ((reg32 >> 8) & 0xff) + 1;
+	p	  = 1 << ((read32(T113_CCU_BASE + CCU_CPU_AXI_CFG_REG) >> 16) & 0x03);
+
+	return (24 * plln / p) * 1000 * 1000;
+}
+
+/* PSI_CLK = Clock Source / M / N */
+uint32_t sunxi_clk_get_ahb_rate(void)
+{
+	uint32_t reg32;
+	uint32_t src;
+
+	reg32 = read32(T113_CCU_BASE + CCU_PSI_CLK_REG);
+	switch ((reg32 >> 24) & 0x03) {
+		case 0x0:
+			src = 24000000;
+			break;
+		case 0x1:
+			src = 32000;
+			break;
+		case 0x2:
+			src = 16000000;
+			break;
+		default:
+			src = sunxi_clk_get_peri1x_rate();
+			break;
+	}
+
+	return src / ((reg32 & 0x03) + 1) / (1 << ((reg32 >> 8) & 0x03));
+}
+
+/* APB0_CLK / APB1_CLK = Clock Source / M / N */
+uint32_t sunxi_clk_get_apb_rate(uint32_t reg)
+{
+	uint32_t reg32;
+	uint32_t src;
+
+	reg32 = read32(T113_CCU_BASE + reg);
+	switch ((reg32 >> 24) & 0x03) {
+		case 0x0:
+			src = 24000000;
+			break;
+		case 0x1:
+			src = 32000;
+			break;
+		case 0x2:
+			src = sunxi_clk_get_ahb_rate();
+			break;
+		default:
+			src = sunxi_clk_get_peri1x_rate();
+			break;
+	}
+
+	return src / ((reg32 & 0x1f) + 1) / (1 << ((reg32 >> 8) & 0x03));
+}
+
 #ifdef CONFIG_ENABLE_CPU_FREQ_DUMP
 void sunxi_clk_dump()
 {
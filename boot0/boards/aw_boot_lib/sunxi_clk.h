@@ -6,6 +6,9 @@
 
 void	 sunxi_clk_init(void);
 uint32_t sunxi_clk_get_peri1x_rate(void);
+uint32_t sunxi_clk_get_cpu_rate(void);
+uint32_t sunxi_clk_get_ahb_rate(void);
+uint32_t sunxi_clk_get_apb_rate(uint32_t reg);
 
 void sunxi_clk_dump(void);
 
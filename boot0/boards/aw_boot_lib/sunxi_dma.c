@@ -24,6 +24,7 @@
 
 #include <main.h>
 #include "sunxi_dma.h"
+#include "mmu.h"
 #include "debug.h"
 #include "reg-ccu.h"
 #include "board.h"
@@ -88,8 +89,8 @@ void dma_exit(void)
 	/* free dma channel if other module not free it */
 	for (i = 0; i < SUNXI_DMA_MAX; i++) {
 		if (dma_channel_source[i].used == 1) {
-			dma_channel_source[i].channel->enable = 0;
-			dma_channel_source[i].used			  = 0;
+			write32((virtual_addr_t)(uintptr_t)&dma_channel_source[i].channel->enable, 0);
+			dma_channel_source[i].used = 0;
 		}
 	}
 
@@ -116,7 +117,7 @@ u32 dma_request_from_last(u32 dmatype)
 		if (dma_channel_source[i].used == 0) {
 			dma_channel_source[i].used			= 1;
 			dma_channel_source[i].channel_count = i;
-			return (u32)&dma_channel_source[i];
+			return (u32)(uintptr_t)&dma_channel_source[i];
 		}
 	}
 
@@ -132,7 +133,7 @@ u32 dma_request(u32 dmatype)
 			dma_channel_source[i].used			= 1;
 			dma_channel_source[i].channel_count = i;
 			trace("DMA: provide channel %u\r\n", i);
-			return (u32)&dma_channel_source[i];
+			return (u32)(uintptr_t)&dma_channel_source[i];
 		}
 	}
 
@@ -141,7 +142,7 @@ u32 dma_request(u32 dmatype)
 
 int dma_release(u32 hdma)
 {
-	dma_source_t *dma_source = (dma_source_t *)hdma;
+	dma_source_t *dma_source = (dma_source_t *)(uintptr_t)hdma;
 
 	if (!dma_source->used)
 		return -1;
@@ -155,15 +156,15 @@ int dma_setting(u32 hdma, dma_set_t *cfg)
 {
 	u32			  commit_para;
 	dma_set_t	  *dma_set	   = cfg;
-	dma_source_t *dma_source   = (dma_source_t *)hdma;
+	dma_source_t *dma_source   = (dma_source_t *)(uintptr_t)hdma;
 	dma_desc_t   *desc		   = dma_source->desc;
-	u32			  channel_addr = (u32)(&(dma_set->channel_cfg));
+	u32			  channel_addr = (u32)(uintptr_t)(&(dma_set->channel_cfg));
 
 	if (!dma_source->used)
 		return -1;
 
 	if (dma_set->loop_mode)
-		desc->link = (u32)(&dma_source->desc);
+		desc->link = (u32)(uintptr_t)(&dma_source->desc);
 	else
 		desc->link = SUNXI_DMA_LINK_NULL;
 
@@ -171,14 +172,14 @@ int dma_setting(u32 hdma, dma_set_t *cfg)
 	commit_para |= (dma_set->data_block_size & 0xff) << 8;
 
 	desc->commit_para = commit_para;
-	desc->config	  = *(volatile u32 *)channel_addr;
+	desc->config	  = *(volatile u32 *)(uintptr_t)channel_addr;
 
 	return 0;
 }
 
 int dma_start(u32 hdma, u32 saddr, u32 daddr, u32 bytes)
 {
-	dma_source_t		 *dma_source = (dma_source_t *)hdma;
+	dma_source_t		 *dma_source = (dma_source_t *)(uintptr_t)hdma;
 	dma_channel_reg_t *channel	  = dma_source->channel;
 	dma_desc_t		   *desc		  = dma_source->desc;
 
@@ -189,22 +190,23 @@ int dma_start(u32 hdma, u32 saddr, u32 daddr, u32 bytes)
 	desc->source_addr = saddr;
 	desc->dest_addr	  = daddr;
 	desc->byte_count  = bytes;
+	dcache_clean_range((u32)(uintptr_t)desc, sizeof(dma_desc_t));
 
 	/* start dma */
-	channel->desc_addr = (u32)desc;
-	channel->enable	   = 1;
+	write32((virtual_addr_t)(uintptr_t)&channel->desc_addr, (u32)(uintptr_t)desc);
+	write32((virtual_addr_t)(uintptr_t)&channel->enable, 1);
 
 	return 0;
 }
 
 int dma_stop(u32 hdma)
 {
-	dma_source_t		 *dma_source = (dma_source_t *)hdma;
+	dma_source_t		 *dma_source = (dma_source_t *)(uintptr_t)hdma;
 	dma_channel_reg_t *channel	  = dma_source->channel;
 
 	if (!dma_source->used)
 		return -1;
-	channel->enable = 0;
+	write32((virtual_addr_t)(uintptr_t)&channel->enable, 0);
 
 	return 0;
 }
@@ -212,7 +214,7 @@ int dma_stop(u32 hdma)
 int dma_querystatus(u32 hdma)
 {
 	u32			  channel_count;
-	dma_source_t *dma_source = (dma_source_t *)hdma;
+	dma_source_t *dma_source = (dma_source_t *)(uintptr_t)hdma;
 	dma_reg_t	  *dma_reg	 = (dma_reg_t *)SUNXI_DMA_BASE;
 
 	if (!dma_source->used)
@@ -220,7 +222,7 @@ int dma_querystatus(u32 hdma)
 
 	channel_count = dma_source->channel_count;
 
-	return (dma_reg->status >> channel_count) & 0x01;
+	return (read32((virtual_addr_t)(uintptr_t)&dma_reg->status) >> channel_count) & 0x01;
 }
 
 // int dma_test()
@@ -29,6 +29,7 @@
 #include "sunxi_spi.h"
 #include "sunxi_clk.h"
 #include "sunxi_dma.h"
+#include "mmu.h"
 #include "debug.h"
 
 enum {
@@ -94,6 +95,12 @@ enum {
 	SPI_BCC_DUM_MSK = (0xf << SPI_BCC_DUM_POS),
 };
 
+enum {
+	SPI_DLY_SW_MSK	  = (0x3f),
+	SPI_DLY_SW_EN_POS = 7,
+	SPI_DLY_SW_EN_MSK = (1 << SPI_DLY_SW_EN_POS),
+};
+
 enum {
 	SPI_MBC_CNT_MSK = (0x00ffffff),
 };
@@ -150,51 +157,52 @@ typedef enum {
 
 static const spi_nand_info_t spi_nand_infos[] = {
 	/* Winbond */
-	{	 "W25N512GV",  {.mfr = SPI_NAND_MFR_WINBOND, .dev = 0xaa20, 2}, 2048,	 64, 64,	 512, 1, 1, SPI_IO_QUAD_RX},
-	{		 "W25N01GV",	 {.mfr = SPI_NAND_MFR_WINBOND, .dev = 0xaa21, 2}, 2048,	64, 64, 1024, 1, 1, SPI_IO_QUAD_RX},
-	{		 "W25M02GV",	 {.mfr = SPI_NAND_MFR_WINBOND, .dev = 0xab21, 2}, 2048,	64, 64, 1024, 1, 2, SPI_IO_QUAD_RX},
-	{		 "W25N02KV",	 {.mfr = SPI_NAND_MFR_WINBOND, .dev = 0xaa22, 2}, 2048, 128, 64, 2048, 1, 1, SPI_IO_QUAD_RX},
-	{	 "F35SQA002G", 		 {.mfr = 0xcd, 				   .dev = 0x7272, 2}, 2048, 128, 64, 2048, 1, 1, SPI_IO_SINGLE},
+	{	 "W25N512GV",  {.mfr = SPI_NAND_MFR_WINBOND, .dev = 0xaa20, 2}, 2048,	 64, 64,	 512, 1, 1, SPI_IO_QUAD_RX, 104},
+	{		 "W25N01GV",	 {.mfr = SPI_NAND_MFR_WINBOND, .dev = 0xaa21, 2}, 2048,	64, 64, 1024, 1, 1, SPI_IO_QUAD_RX, 104},
+	{		 "W25M02GV",	 {.mfr = SPI_NAND_MFR_WINBOND, .dev = 0xab21, 2}, 2048,	64, 64, 1024, 1, 2, SPI_IO_QUAD_RX, 104},
+	{		 "W25N02KV",	 {.mfr = SPI_NAND_MFR_WINBOND, .dev = 0xaa22, 2}, 2048, 128, 64, 2048, 1, 1, SPI_IO_QUAD_RX, 104},
+	{	 "F35SQA002G", 		 {.mfr = 0xcd, 				   .dev = 0x7272, 2}, 2048, 128, 64, 2048, 1, 1, SPI_IO_SINGLE, 104},
  /* Gigadevice */
-	{ "GD5F1GQ4UAWxx", {.mfr = SPI_NAND_MFR_GIGADEVICE, .dev = 0x10, 1}, 2048,  64, 64, 1024, 1, 1, SPI_IO_QUAD_RX},
-	{ "GD5F1GQ5UExxG", {.mfr = SPI_NAND_MFR_GIGADEVICE, .dev = 0x51, 1}, 2048, 128, 64, 1024, 1, 1, SPI_IO_QUAD_RX},
-	{ "GD5F1GQ4UExIG", {.mfr = SPI_NAND_MFR_GIGADEVICE, .dev = 0xd1, 1}, 2048, 128, 64, 1024, 1, 1, SPI_IO_QUAD_RX},
-	{ "GD5F1GQ4UExxH", {.mfr = SPI_NAND_MFR_GIGADEVICE, .dev = 0xd9, 1}, 2048,  64, 64, 1024, 1, 1, SPI_IO_QUAD_RX},
-	{ "GD5F1GQ4xAYIG", {.mfr = SPI_NAND_MFR_GIGADEVICE, .dev = 0xf1, 1}, 2048,  64, 64, 1024, 1, 1, SPI_IO_QUAD_RX},
-	{ "GD5F2GQ4UExIG", {.mfr = SPI_NAND_MFR_GIGADEVICE, .dev = 0xd2, 1}, 2048, 128, 64, 2048, 1, 1, SPI_IO_QUAD_RX},
-	{ "GD5F2GQ5UExxH", {.mfr = SPI_NAND_MFR_GIGADEVICE, .dev = 0x32, 1}, 2048,  64, 64, 2048, 1, 1, SPI_IO_QUAD_RX},
-	{ "GD5F2GQ4xAYIG", {.mfr = SPI_NAND_MFR_GIGADEVICE, .dev = 0xf2, 1}, 2048,  64, 64, 2048, 1, 1, SPI_IO_QUAD_RX},
-	{ "GD5F4GQ4UBxIG", {.mfr = SPI_NAND_MFR_GIGADEVICE, .dev = 0xd4, 1}, 4096, 256, 64, 2048, 1, 1, SPI_IO_QUAD_RX},
-	{ "GD5F4GQ4xAYIG", {.mfr = SPI_NAND_MFR_GIGADEVICE, .dev = 0xf4, 1}, 2048,  64, 64, 4096, 1, 1, SPI_IO_QUAD_RX},
-	{ "GD5F2GQ5UExxG", {.mfr = SPI_NAND_MFR_GIGADEVICE, .dev = 0x52, 1}, 2048, 128, 64, 2048, 1, 1, SPI_IO_QUAD_RX},
-	{ "GD5F4GQ4UCxIG", {.mfr = SPI_NAND_MFR_GIGADEVICE, .dev = 0xb4, 1}, 4096, 256, 64, 2048, 1, 1, SPI_IO_QUAD_RX},
-	{ "GD5F4GQ4RCxIG", {.mfr = SPI_NAND_MFR_GIGADEVICE, .dev = 0xa4, 1}, 4096, 256, 64, 2048, 1, 1, SPI_IO_QUAD_RX},
+	{ "GD5F1GQ4UAWxx", {.mfr = SPI_NAND_MFR_GIGADEVICE, .dev = 0x10, 1}, 2048,  64, 64, 1024, 1, 1, SPI_IO_QUAD_RX, 120},
+	{ "GD5F1GQ5UExxG", {.mfr = SPI_NAND_MFR_GIGADEVICE, .dev = 0x51, 1}, 2048, 128, 64, 1024, 1, 1, SPI_IO_QUAD_RX, 133},
+	{ "GD5F1GQ4UExIG", {.mfr = SPI_NAND_MFR_GIGADEVICE, .dev = 0xd1, 1}, 2048, 128, 64, 1024, 1, 1, SPI_IO_QUAD_RX, 120},
+	{ "GD5F1GQ4UExxH", {.mfr = SPI_NAND_MFR_GIGADEVICE, .dev = 0xd9, 1}, 2048,  64, 64, 1024, 1, 1, SPI_IO_QUAD_RX, 104},
+	{ "GD5F1GQ4xAYIG", {.mfr = SPI_NAND_MFR_GIGADEVICE, .dev = 0xf1, 1}, 2048,  64, 64, 1024, 1, 1, SPI_IO_QUAD_RX, 120},
+	{ "GD5F2GQ4UExIG", {.mfr = SPI_NAND_MFR_GIGADEVICE, .dev = 0xd2, 1}, 2048, 128, 64, 2048, 1, 1, SPI_IO_QUAD_RX, 120},
+	{ "GD5F2GQ5UExxH", {.mfr = SPI_NAND_MFR_GIGADEVICE, .dev = 0x32, 1}, 2048,  64, 64, 2048, 1, 1, SPI_IO_QUAD_RX, 104},
+	{ "GD5F2GQ4xAYIG", {.mfr = SPI_NAND_MFR_GIGADEVICE, .dev = 0xf2, 1}, 2048,  64, 64, 2048, 1, 1, SPI_IO_QUAD_RX, 120},
+	{ "GD5F4GQ4UBxIG", {.mfr = SPI_NAND_MFR_GIGADEVICE, .dev = 0xd4, 1}, 4096, 256, 64, 2048, 1, 1, SPI_IO_QUAD_RX, 120},
+	{ "GD5F4GQ4xAYIG", {.mfr = SPI_NAND_MFR_GIGADEVICE, .dev = 0xf4, 1}, 2048,  64, 64, 4096, 1, 1, SPI_IO_QUAD_RX, 120},
+	{ "GD5F2GQ5UExxG", {.mfr = SPI_NAND_MFR_GIGADEVICE, .dev = 0x52, 1}, 2048, 128, 64, 2048, 1, 1, SPI_IO_QUAD_RX, 133},
+	{ "GD5F4GQ4UCxIG", {.mfr = SPI_NAND_MFR_GIGADEVICE, .dev = 0xb4, 1}, 4096, 256, 64, 2048, 1, 1, SPI_IO_QUAD_RX, 120},
+	{ "GD5F4GQ4RCxIG", {.mfr = SPI_NAND_MFR_GIGADEVICE, .dev = 0xa4, 1}, 4096, 256, 64, 2048, 1, 1, SPI_IO_QUAD_RX, 104},
 
  /* Macronix */
-	{	 "MX35LF1GE4AB",	 {.mfr = SPI_NAND_MFR_MACRONIX, .dev = 0x12, 1}, 2048,  64, 64, 1024, 1, 1, SPI_IO_DUAL_RX},
-	{	 "MX35LF1G24AD",	 {.mfr = SPI_NAND_MFR_MACRONIX, .dev = 0x14, 1}, 2048, 128, 64, 1024, 1, 1, SPI_IO_DUAL_RX},
-	{	 "MX31LF1GE4BC",	 {.mfr = SPI_NAND_MFR_MACRONIX, .dev = 0x1e, 1}, 2048,  64, 64, 1024, 1, 1, SPI_IO_DUAL_RX},
-	{	 "MX35LF2GE4AB",	 {.mfr = SPI_NAND_MFR_MACRONIX, .dev = 0x22, 1}, 2048,  64, 64, 2048, 1, 1, SPI_IO_DUAL_RX},
-	{	 "MX35LF2G24AD",	 {.mfr = SPI_NAND_MFR_MACRONIX, .dev = 0x24, 1}, 2048, 128, 64, 2048, 1, 1, SPI_IO_DUAL_RX},
-	{	 "MX35LF2GE4AD",	 {.mfr = SPI_NAND_MFR_MACRONIX, .dev = 0x26, 1}, 2048, 128, 64, 2048, 1, 1, SPI_IO_DUAL_RX},
-	{	 "MX35LF2G14AC",	 {.mfr = SPI_NAND_MFR_MACRONIX, .dev = 0x20, 1}, 2048,  64, 64, 2048, 1, 1, SPI_IO_DUAL_RX},
-	{	 "MX35LF4G24AD",	 {.mfr = SPI_NAND_MFR_MACRONIX, .dev = 0x35, 1}, 4096, 256, 64, 2048, 1, 1, SPI_IO_DUAL_RX},
-	{	 "MX35LF4GE4AD",	 {.mfr = SPI_NAND_MFR_MACRONIX, .dev = 0x37, 1}, 4096, 256, 64, 2048, 1, 1, SPI_IO_DUAL_RX},
+	{	 "MX35LF1GE4AB",	 {.mfr = SPI_NAND_MFR_MACRONIX, .dev = 0x12, 1}, 2048,  64, 64, 1024, 1, 1, SPI_IO_DUAL_RX, 104},
+	{	 "MX35LF1G24AD",	 {.mfr = SPI_NAND_MFR_MACRONIX, .dev = 0x14, 1}, 2048, 128, 64, 1024, 1, 1, SPI_IO_DUAL_RX, 104},
+	{	 "MX31LF1GE4BC",	 {.mfr = SPI_NAND_MFR_MACRONIX, .dev = 0x1e, 1}, 2048,  64, 64, 1024, 1, 1, SPI_IO_DUAL_RX, 104},
+	{	 "MX35LF2GE4AB",	 {.mfr = SPI_NAND_MFR_MACRONIX, .dev = 0x22, 1}, 2048,  64, 64, 2048, 1, 1, SPI_IO_DUAL_RX, 104},
+	{	 "MX35LF2G24AD",	 {.mfr = SPI_NAND_MFR_MACRONIX, .dev = 0x24, 1}, 2048, 128, 64, 2048, 1, 1, SPI_IO_DUAL_RX, 104},
+	{	 "MX35LF2GE4AD",	 {.mfr = SPI_NAND_MFR_MACRONIX, .dev = 0x26, 1}, 2048, 128, 64, 2048, 1, 1, SPI_IO_DUAL_RX, 104},
+	{	 "MX35LF2G14AC",	 {.mfr = SPI_NAND_MFR_MACRONIX, .dev = 0x20, 1}, 2048,  64, 64, 2048, 1, 1, SPI_IO_DUAL_RX, 104},
+	{	 "MX35LF4G24AD",	 {.mfr = SPI_NAND_MFR_MACRONIX, .dev = 0x35, 1}, 4096, 256, 64, 2048, 1, 1, SPI_IO_DUAL_RX, 104},
+	{	 "MX35LF4GE4AD",	 {.mfr = SPI_NAND_MFR_MACRONIX, .dev = 0x37, 1}, 4096, 256, 64, 2048, 1, 1, SPI_IO_DUAL_RX, 104},
 
  /* Micron */
-	{"MT29F1G01AAADD",	   {.mfr = SPI_NAND_MFR_MICRON, .dev = 0x12, 1}, 2048,  64, 64, 1024, 1, 1, SPI_IO_DUAL_RX},
-	{"MT29F1G01ABAFD",	   {.mfr = SPI_NAND_MFR_MICRON, .dev = 0x14, 1}, 2048, 128, 64, 1024, 1, 1, SPI_IO_DUAL_RX},
-	{"MT29F2G01AAAED",	   {.mfr = SPI_NAND_MFR_MICRON, .dev = 0x9f, 1}, 2048,  64, 64, 2048, 2, 1, SPI_IO_DUAL_RX},
-	{"MT29F2G01ABAGD",	   {.mfr = SPI_NAND_MFR_MICRON, .dev = 0x24, 1}, 2048, 128, 64, 2048, 2, 1, SPI_IO_DUAL_RX},
-	{"MT29F4G01AAADD",	   {.mfr = SPI_NAND_MFR_MICRON, .dev = 0x32, 1}, 2048,  64, 64, 4096, 2, 1, SPI_IO_DUAL_RX},
-	{"MT29F4G01ABAFD",	   {.mfr = SPI_NAND_MFR_MICRON, .dev = 0x34, 1}, 4096, 256, 64, 2048, 1, 1, SPI_IO_DUAL_RX},
-	{"MT29F4G01ADAGD",	   {.mfr = SPI_NAND_MFR_MICRON, .dev = 0x36, 1}, 2048, 128, 64, 2048, 2, 2, SPI_IO_DUAL_RX},
-	{"MT29F8G01ADAFD",	   {.mfr = SPI_NAND_MFR_MICRON, .dev = 0x46, 1}, 4096, 256, 64, 2048, 1, 2, SPI_IO_DUAL_RX},
+	{"MT29F1G01AAADD",	   {.mfr = SPI_NAND_MFR_MICRON, .dev = 0x12, 1}, 2048,  64, 64, 1024, 1, 1, SPI_IO_DUAL_RX,  50},
+	{"MT29F1G01ABAFD",	   {.mfr = SPI_NAND_MFR_MICRON, .dev = 0x14, 1}, 2048, 128, 64, 1024, 1, 1, SPI_IO_DUAL_RX, 133},
+	{"MT29F2G01AAAED",	   {.mfr = SPI_NAND_MFR_MICRON, .dev = 0x9f, 1}, 2048,  64, 64, 2048, 2, 1, SPI_IO_DUAL_RX,  50},
+	{"MT29F2G01ABAGD",	   {.mfr = SPI_NAND_MFR_MICRON, .dev = 0x24, 1}, 2048, 128, 64, 2048, 2, 1, SPI_IO_DUAL_RX, 133},
+	{"MT29F4G01AAADD",	   {.mfr = SPI_NAND_MFR_MICRON, .dev = 0x32, 1}, 2048,  64, 64, 4096, 2, 1, SPI_IO_DUAL_RX,  50},
+	{"MT29F4G01ABAFD",	   {.mfr = SPI_NAND_MFR_MICRON, .dev = 0x34, 1}, 4096, 256, 64, 2048, 1, 1, SPI_IO_DUAL_RX, 133},
+	{"MT29F4G01ADAGD",	   {.mfr = SPI_NAND_MFR_MICRON, .dev = 0x36, 1}, 2048, 128, 64, 2048, 2, 2, SPI_IO_DUAL_RX, 133},
+	{"MT29F8G01ADAFD",	   {.mfr = SPI_NAND_MFR_MICRON, .dev = 0x46, 1}, 4096, 256, 64, 2048, 1, 2, SPI_IO_DUAL_RX, 133},
 };
 
 sunxi_spi_t		*spip;
 static dma_set_t spi_rx_dma;
 static u32		 spi_rx_dma_hd;
+static uint32_t	 spi_mod_clk;
 
 /* SPI Clock Control Register Bit Fields & Masks,default:0x0000_0002 */
 #define SPI_CLK_CTL_CDR2_MASK 0xff /* Clock Divide Rate 2,master mode only : SPI_CLK = AHB_CLK/(2*(n+1)) */
@@ -210,9 +218,9 @@ static uint32_t spi_set_clk(sunxi_spi_t *spi, u32 spi_clk, u32 mclk, u32 cdr2)
 	uint32_t reg	 = 0;
 	uint32_t div	 = 1;
 	uint32_t src_clk = mclk;
-	uint32_t freq	 = SPI_MOD_CLK;
+	uint32_t freq	 = mclk;
 
-	if (spi_clk != SPI_MOD_CLK) {
+	if (spi_clk < mclk) {
 		/* CDR2 */
 		if (cdr2) {
 			div = mclk / (spi_clk * 2) - 1;
@@ -238,25 +246,6 @@ static uint32_t spi_set_clk(sunxi_spi_t *spi, u32 spi_clk, u32 mclk, u32 cdr2)
 	return freq;
 }
 
-#if 0
-static void spi_set_sample_deplay(sunxi_spi_t *spi)
-{
-	uint32_t reg = 0;
-
-	write32(spi->base + SPI_DLY, 0xA0); // initial delay value from manual
-	write32(spi->base + SPI_DLY, 0x0);
-	write32(spi->base + SPI_DLY, (1 << 15)); // SAMP_DL_CAL_START
-
-	// Check SAMP_DL_CAL_DONE
-	while ((read32(spi->base + SPI_DLY) & (1 << 14)) == 0);
-
-	reg = read32(spi->base + SPI_DLY);
-	debug("SPI: sample delay=%u \r\n", (reg & 0x3f00) >> 8);
-
-	write32(spi->base + SPI_DLY, reg | (1 << 7)); // SAMP_DL_SW_EN
-}
-#endif
-
 static int spi_clk_init(uint32_t mod_clk)
 {
 	uint32_t rval;
@@ -288,8 +277,9 @@ static int spi_clk_init(uint32_t mod_clk)
 		m = divi;
 	}
 
-	factor_m = m - 1;
-	rval	 = (1U << 31) | (0x1 << 24) | (n << 8) | factor_m;
+	factor_m	= m - 1;
+	rval		= (1U << 31) | (0x1 << 24) | (n << 8) | factor_m;
+	spi_mod_clk = source_clk / (m << n);
 	trace("SPI: parent_clk=%" PRIu32 "MHz, div=%" PRIu32 ", n=%" PRIu32 ", m=%" PRIu32 "\r\n", source_clk / 1000 / 1000, divi, n + 1, m);
 	write32(T113_CCU_BASE + CCU_SPI0_CLK_REG, rval);
 
@@ -395,7 +385,7 @@ int sunxi_spi_init(sunxi_spi_t *spi)
 	write32(T113_CCU_BASE + CCU_SPI_BGR_REG, val);
 
 	spi_clk_init(SPI_MOD_CLK);
-	freq = spi_set_clk(spi, spi->clk_rate, SPI_MOD_CLK, 1);
+	freq = spi_set_clk(spi, spi->clk_rate, spi_mod_clk, 1);
 
 	/* Enable spi0 and do a soft reset */
 	val = SPI_GCR_SRST_MSK | SPI_GCR_TPEN_MSK | SPI_GCR_MODE_MSK | SPI_GCR_EN_MSK;
@@ -413,6 +403,7 @@ int sunxi_spi_init(sunxi_spi_t *spi)
 	else if ((freq <= 24000000))
 		val |= SPI_TCR_SDM_MSK; // Set SDM bit when below 24MHz
 	write32(spi->base + SPI_TCR, val);
+	write32(spi->base + SPI_DLY, 0);
 
 	spi_reset_fifo(spi);
 	spi_dma_init();
@@ -440,6 +431,25 @@ void sunxi_spi_disable(sunxi_spi_t *spi)
 	write32(T113_CCU_BASE + CCU_SPI_BGR_REG, val);
 }
 
+/* SCLK the controller was set up for, derived back from CCR */
+uint32_t sunxi_spi_get_clk(sunxi_spi_t *spi)
+{
+	uint32_t reg;
+
+	reg = read32(spi->base + SPI_CCR);
+	if (reg & SPI_CLK_CTL_DRS)
+		return spi_mod_clk / (2 * ((reg & SPI_CLK_CTL_CDR2_MASK) + 1));
+
+	return spi_mod_clk >> ((reg >> 8) & SPI_CLK_CTL_CDR1_MASK);
+}
+
+/* Sampling setup: TCR SDC/SDM bits and the raw delay chain register */
+void sunxi_spi_get_sample(sunxi_spi_t *spi, uint32_t *tcr, uint32_t *dly)
+{
+	*tcr = read32(spi->base + SPI_TCR) & (SPI_TCR_SDM_MSK | SPI_TCR_SDC_MSK);
+	*dly = read32(spi->base + SPI_DLY);
+}
+
 /*
  *	txlen: transmit length
  * rxlen: receive length
@@ -539,7 +549,13 @@ static void spi_set_io_mode(sunxi_spi_t *spi, spi_io_mode_t mode)
 	write32(spi->base + SPI_BCC, bcc);
 }
 
-int spi_transfer(sunxi_spi_t *spi, spi_io_mode_t mode, void *txbuf, uint32_t txlen, void *rxbuf, uint32_t rxlen)
+/*
+ * First half of an exchange: counters, TX FIFO and, for more than 64 RX
+ * bytes, the DMA channel are set up and running when this returns, short
+ * reads are drained by PIO. spi_transfer_end() waits for the rest, the CPU
+ * is free in between.
+ */
+static int spi_transfer_begin(sunxi_spi_t *spi, spi_io_mode_t mode, void *txbuf, uint32_t txlen, void *rxbuf, uint32_t rxlen)
 {
 	uint32_t stxlen, fcr;
     // trace("SPI: tsfr mode=%u tx=%" PRIu32 " rx=%" PRIu32 "\r\n", mode, txlen, rxlen);
@@ -580,18 +596,41 @@ int spi_transfer(sunxi_spi_t *spi, spi_io_mode_t mode, void *txbuf, uint32_t txl
 	if (rxbuf && rxlen) {
 		if (rxlen > 64) {
 			write32(spi->base + SPI_FCR, (fcr | SPI_FCR_RX_DRQEN_MSK)); // Enable RX FIFO DMA request
-			if (dma_start(spi_rx_dma_hd, spi->base + SPI_RXD, (u32)rxbuf, rxlen) != 0) {
+			// No dirty line may be evicted over the DMA data, none may be left stale after it
+			dcache_flush_range((u32)(uintptr_t)rxbuf, rxlen);
+			if (dma_start(spi_rx_dma_hd, spi->base + SPI_RXD, (u32)(uintptr_t)rxbuf, rxlen) != 0) {
 				error("SPI: DMA transfer failed\r\n");
 				return -1;
 			}
-			while (dma_querystatus(spi_rx_dma_hd)) {
-			};
 		} else {
 			spi_read_rx_fifo(spi, rxbuf, rxlen);
 		}
 	}
 
+	return 0;
+}
+
+static void spi_transfer_end(sunxi_spi_t *spi, void *rxbuf, uint32_t rxlen)
+{
+	if (rxbuf && rxlen > 64) {
+		while (dma_querystatus(spi_rx_dma_hd)) {
+		};
+		dcache_inv_range((u32)(uintptr_t)rxbuf, rxlen);
+	}
+
+	// Wait for the exchange to end, TX-only bursts may still be shifting out of the FIFO
+	while (read32(spi->base + SPI_TCR) & (1 << 31)) {
+	};
+
     // trace("SPI: ISR=0x%" PRIx32 "\r\n", read32(spi->base + SPI_ISR));
+}
+
+int spi_transfer(sunxi_spi_t *spi, spi_io_mode_t mode, void *txbuf, uint32_t txlen, void *rxbuf, uint32_t rxlen)
+{
+	if (spi_transfer_begin(spi, mode, txbuf, txlen, rxbuf, rxlen) != 0)
+		return -1;
+
+	spi_transfer_end(spi, rxbuf, rxlen);
 
 	return txlen + rxlen;
 }
@@ -631,6 +670,10 @@ int spi_transfer_then_transfer(sunxi_spi_t *spi, spi_io_mode_t mode, void *txbuf
     // Disable DMA request by default
     write32(spi->base + SPI_FCR, (fcr & ~SPI_FCR_RX_DRQEN_MSK));
 
+    // Wait for the exchange to end before the FIFOs are reset again
+    while (read32(spi->base + SPI_TCR) & (1 << 31)) {
+    };
+
     return txlen + txlen2;
 }
 
@@ -871,3 +914,294 @@ uint32_t spi_nand_read(sunxi_spi_t *spi, uint8_t *buf, uint32_t addr, uint32_t r
 	}
 	return len;
 }
+
+/*
+ * Sample point calibration
+ *
+ * Detection runs at the board's clk_rate. The ramp then steps the module
+ * clock up with the CCR divider bypassed and, at each step, sweeps the
+ * delay chain (SPI_DLY software taps) with and without SDC. A tap passes
+ * when READ ID and the start of a page already in the NAND cache read back
+ * exactly as they did at the detect clock. The widest passing window is
+ * kept and its centre tap used; the ramp stops at the first step whose
+ * window is too narrow to trust.
+ */
+#define SPI_CAL_LEN		   512 /* Page bytes compared per tap */
+#define SPI_CAL_TAPS	   64
+#define SPI_CAL_MIN_WINDOW 8 /* Taps of margin needed to keep a step */
+
+/* SCLK = PERI(1x) / M, 600MHz / 6, 5, 4 */
+static const uint32_t spi_cal_rates[] = {100000000, 120000000, 150000000};
+
+static int spi_nand_read_id(sunxi_spi_t *spi, uint8_t *rx)
+{
+	uint8_t tx[1];
+
+	tx[0] = OPCODE_READ_ID;
+	return spi_transfer(spi, SPI_IO_SINGLE, tx, 1, rx, 4);
+}
+
+/* Read-from-cache command at column 0 for the chip's I/O mode, returns its length */
+static int spi_nand_cache_cmd(sunxi_spi_t *spi, uint8_t *tx)
+{
+	uint32_t txlen = 4;
+
+	switch (spi->info.mode) {
+		case SPI_IO_SINGLE:
+			tx[0] = OPCODE_READ;
+			break;
+		case SPI_IO_DUAL_RX:
+			tx[0] = OPCODE_FAST_READ_DUAL_O;
+			break;
+		case SPI_IO_QUAD_RX:
+			tx[0] = OPCODE_FAST_READ_QUAD_O;
+			break;
+		case SPI_IO_QUAD_IO:
+			tx[0] = OPCODE_FAST_READ_QUAD_IO;
+			txlen = 5;
+			break;
+		default:
+			return -1;
+	}
+
+	/* Winbond continuous mode takes one more dummy, the column is ignored */
+	if (spi->info.id.mfr == SPI_NAND_MFR_WINBOND)
+		txlen++;
+
+	memset(tx + 1, 0, txlen - 1);
+
+	return txlen;
+}
+
+/* Read the start of the page held in the cache, no page load */
+static int spi_nand_read_cache(sunxi_spi_t *spi, uint8_t *buf, uint32_t len)
+{
+	uint8_t tx[6];
+	int		txlen;
+
+	txlen = spi_nand_cache_cmd(spi, tx);
+	if (txlen < 0)
+		return -1;
+
+	return spi_transfer(spi, spi->info.mode, tx, txlen, buf, len);
+}
+
+static int spi_cal_check(sunxi_spi_t *spi, const uint8_t *id, const uint8_t *ref, uint8_t *buf)
+{
+	uint8_t rx[4];
+
+	if (spi_nand_read_id(spi, rx) < 0 || memcmp(rx, id, sizeof(rx)) != 0)
+		return -1;
+
+	memset(buf, 0, SPI_CAL_LEN);
+	if (spi_nand_read_cache(spi, buf, SPI_CAL_LEN) < 0 || memcmp(buf, ref, SPI_CAL_LEN) != 0)
+		return -1;
+
+	return 0;
+}
+
+/* Widest run of passing taps in one TCR sample mode, centre tap returned in *center */
+static int spi_cal_sweep(sunxi_spi_t *spi, uint32_t tcr, const uint8_t *id, const uint8_t *ref, uint8_t *buf, uint32_t *center)
+{
+	uint32_t val;
+	int		 tap, run = 0, width = 0;
+
+	val = read32(spi->base + SPI_TCR);
+	val &= ~(SPI_TCR_SDM_MSK | SPI_TCR_SDC_MSK);
+	write32(spi->base + SPI_TCR, val | tcr);
+
+	for (tap = 0; tap < SPI_CAL_TAPS; tap++) {
+		write32(spi->base + SPI_DLY, SPI_DLY_SW_EN_MSK | tap);
+		if (spi_cal_check(spi, id, ref, buf) != 0) {
+			run = 0;
+			continue;
+		}
+		if (++run > width) {
+			width	= run;
+			*center = tap - (run - 1) / 2;
+		}
+	}
+
+	return width;
+}
+
+static void spi_cal_apply(sunxi_spi_t *spi, uint32_t mod_clk, uint32_t ccr, uint32_t tcr, uint32_t dly)
+{
+	uint32_t val;
+
+	spi_clk_init(mod_clk);
+	write32(spi->base + SPI_CCR, ccr);
+
+	val = read32(spi->base + SPI_TCR);
+	val &= ~(SPI_TCR_SDM_MSK | SPI_TCR_SDC_MSK);
+	write32(spi->base + SPI_TCR, val | tcr);
+	write32(spi->base + SPI_DLY, dly);
+}
+
+/*
+ * Ramp SCLK up to spi->max_clk_rate after spi_nand_detect(), never past the
+ * datasheet maximum of the detected part.
+ * addr: page used as reference, must not be blank
+ * buf: 2 * SPI_CAL_LEN bytes of scratch
+ * Returns the SCLK left set up; the detect setting is kept if no step passes.
+ */
+uint32_t sunxi_spi_calibrate(sunxi_spi_t *spi, uint32_t addr, uint8_t *buf)
+{
+	uint8_t	 id[4];
+	uint8_t *ref = buf, *cur = buf + SPI_CAL_LEN;
+	uint32_t safe_mod, safe_ccr, safe_tcr, safe_dly;
+	uint32_t best_mod = 0, best_ccr = 0, best_tcr = 0, best_dly = 0;
+	uint32_t freq, rate, best = sunxi_spi_get_clk(spi);
+	uint32_t tcr, dly, center = 0;
+	uint32_t max = spi->max_clk_rate;
+	int		 i, w, width;
+
+	if (max > spi->info.max_clk_mhz * 1000000)
+		max = spi->info.max_clk_mhz * 1000000;
+	if (max <= best)
+		return best;
+
+	safe_mod = spi_mod_clk;
+	safe_ccr = read32(spi->base + SPI_CCR);
+	safe_tcr = read32(spi->base + SPI_TCR) & (SPI_TCR_SDM_MSK | SPI_TCR_SDC_MSK);
+	safe_dly = read32(spi->base + SPI_DLY);
+
+	/* Reference at the detect clock, leaves the page in the NAND cache */
+	if (spi_nand_read_id(spi, id) < 0)
+		return best;
+	spi_nand_read(spi, ref, addr, SPI_CAL_LEN);
+	for (i = 0; i < SPI_CAL_LEN && ref[i] == 0xff; i++)
+		;
+	if (i == SPI_CAL_LEN) {
+		warning("SPI: calibration page 0x%08" PRIx32 " is blank, keeping %" PRIu32 "MHz\r\n", addr, best / 1000000);
+		return best;
+	}
+
+	/* A step above the cap is tried at the cap, spi_clk_init() rounds the divider up */
+	for (i = 0; i < ARRAY_SIZE(spi_cal_rates) && (i == 0 || spi_cal_rates[i - 1] < max); i++) {
+		rate = spi_cal_rates[i] < max ? spi_cal_rates[i] : max;
+		spi_clk_init(rate);
+		freq = spi_set_clk(spi, rate, spi_mod_clk, 1);
+		if (freq <= best || freq > max)
+			continue;
+
+		width = 0;
+		tcr	  = 0;
+		dly	  = 0;
+		w	  = spi_cal_sweep(spi, 0, id, ref, cur, &center);
+		if (w > width) {
+			width = w;
+			tcr	  = 0;
+			dly	  = SPI_DLY_SW_EN_MSK | center;
+		}
+		w = spi_cal_sweep(spi, SPI_TCR_SDC_MSK, id, ref, cur, &center);
+		if (w > width) {
+			width = w;
+			tcr	  = SPI_TCR_SDC_MSK;
+			dly	  = SPI_DLY_SW_EN_MSK | center;
+		}
+
+		debug("SPI: %" PRIu32 "MHz window %d taps, SDC=%d tap %" PRIu32 "\r\n", freq / 1000000, width, tcr ? 1 : 0,
+			  dly & SPI_DLY_SW_MSK);
+		if (width < SPI_CAL_MIN_WINDOW)
+			break;
+
+		best	 = freq;
+		best_mod = spi_mod_clk;
+		best_ccr = read32(spi->base + SPI_CCR);
+		best_tcr = tcr;
+		best_dly = dly;
+	}
+
+	if (best_mod == 0) {
+		spi_cal_apply(spi, safe_mod, safe_ccr, safe_tcr, safe_dly);
+		return sunxi_spi_get_clk(spi);
+	}
+
+	/* Page load and read through the normal path once more at the chosen setting */
+	spi_cal_apply(spi, best_mod, best_ccr, best_tcr, best_dly);
+	memset(cur, 0, SPI_CAL_LEN);
+	spi_nand_read(spi, cur, addr, SPI_CAL_LEN);
+	if (memcmp(cur, ref, SPI_CAL_LEN) != 0) {
+		warning("SPI: %" PRIu32 "MHz failed the final read, back to the detect clock\r\n", best / 1000000);
+		spi_cal_apply(spi, safe_mod, safe_ccr, safe_tcr, safe_dly);
+		return sunxi_spi_get_clk(spi);
+	}
+
+	info("SPI: calibrated to %" PRIu32 "MHz, sample delay 0x%02" PRIx32 "\r\n", best / 1000000, best_dly);
+
+	return best;
+}
+
+/*
+ * Split page read for streaming loaders: spi_nand_read_start() loads one
+ * page and starts its cache read into buf, spi_nand_read_wait() completes
+ * it. Work on the previous chunk can run while the DMA fills this one.
+ * addr must be page aligned and len at most one page.
+ */
+static uint8_t *spi_async_buf;
+static uint32_t spi_async_len;
+
+int spi_nand_read_start(sunxi_spi_t *spi, uint8_t *buf, uint32_t addr, uint32_t len)
+{
+	uint8_t tx[6];
+	int		txlen;
+
+	if ((addr % spi->info.page_size) || len > spi->info.page_size) {
+		error("spi_nand: bad async read 0x%08" PRIx32 " +%" PRIu32 "\r\n", addr, len);
+		return -1;
+	}
+
+	txlen = spi_nand_cache_cmd(spi, tx);
+	if (txlen < 0)
+		return -1;
+
+	spi_nand_load_page(spi, addr);
+
+	spi_async_buf = buf;
+	spi_async_len = len;
+
+	return spi_transfer_begin(spi, spi->info.mode, tx, txlen, buf, len);
+}
+
+void spi_nand_read_wait(sunxi_spi_t *spi)
+{
+	spi_transfer_end(spi, spi_async_buf, spi_async_len);
+	spi_async_buf = NULL;
+	spi_async_len = 0;
+}
+
+/*
+ * Factory bad block marker: first spare byte of the block's first page,
+ * anything but 0xff is bad. Winbond chips are switched to buffer mode for
+ * the read, continuous mode ignores the column.
+ */
+int spi_nand_block_bad(sunxi_spi_t *spi, uint32_t addr)
+{
+	uint32_t block = spi->info.page_size * spi->info.pages_per_block;
+	uint8_t	 tx[4], mark[4], cfg = 0;
+	int		 winbond = spi->info.id.mfr == (uint8_t)SPI_NAND_MFR_WINBOND;
+
+	if (winbond && spi_nand_get_config(spi, CONFIG_ADDR_OTP, &cfg) == 0 && !(cfg & CONFIG_POS_BUF)) {
+		spi_nand_set_config(spi, CONFIG_ADDR_OTP, cfg | CONFIG_POS_BUF);
+		spi_nand_wait_while_busy(spi);
+	} else {
+		winbond = 0;
+	}
+
+	spi_nand_load_page(spi, addr - addr % block);
+
+	tx[0] = OPCODE_READ;
+	tx[1] = (uint8_t)(spi->info.page_size >> 8);
+	tx[2] = (uint8_t)(spi->info.page_size >> 0);
+	tx[3] = 0x0;
+	mark[0] = 0xff;
+	spi_transfer(spi, SPI_IO_SINGLE, tx, 4, mark, 1);
+
+	if (winbond) {
+		spi_nand_set_config(spi, CONFIG_ADDR_OTP, cfg);
+		spi_nand_wait_while_busy(spi);
+	}
+
+	return mark[0] != 0xff;
+}
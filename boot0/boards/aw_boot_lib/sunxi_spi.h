@@ -27,12 +27,14 @@ typedef struct {
 	uint32_t	  planes_per_die;
 	uint32_t	  ndies;
 	spi_io_mode_t mode;
+	uint32_t	  max_clk_mhz; /* Datasheet SCLK maximum of the read path */
 } spi_nand_info_t;
 
 typedef struct {
 	uint32_t   base;
 	uint8_t	   id;
-	uint32_t   clk_rate;
+	uint32_t   clk_rate;	 /* Detect clock, known good on any board */
+	uint32_t   max_clk_rate; /* Controller ceiling for sunxi_spi_calibrate(), info.max_clk_mhz caps it further */
 	gpio_mux_t gpio_cs;
 	gpio_mux_t gpio_sck;
 	gpio_mux_t gpio_miso;
@@ -45,11 +47,17 @@ typedef struct {
 
 int		 sunxi_spi_init(sunxi_spi_t *spi);
 void	 sunxi_spi_disable(sunxi_spi_t *spi);
+uint32_t sunxi_spi_get_clk(sunxi_spi_t *spi);
+void	 sunxi_spi_get_sample(sunxi_spi_t *spi, uint32_t *tcr, uint32_t *dly);
+uint32_t sunxi_spi_calibrate(sunxi_spi_t *spi, uint32_t addr, uint8_t *buf);
 
 int spi_transfer(sunxi_spi_t *spi, spi_io_mode_t mode, void *txbuf, uint32_t txlen, void *rxbuf, uint32_t rxlen);
 int spi_transfer_then_transfer(sunxi_spi_t *spi, spi_io_mode_t mode, void *txbuf, uint32_t txlen, void *txbuf2, uint32_t txlen2);
 
 int		 spi_nand_detect(sunxi_spi_t *spi);
 uint32_t spi_nand_read(sunxi_spi_t *spi, uint8_t *buf, uint32_t addr, uint32_t rxlen);
+int		 spi_nand_read_start(sunxi_spi_t *spi, uint8_t *buf, uint32_t addr, uint32_t len);
+void	 spi_nand_read_wait(sunxi_spi_t *spi);
+int		 spi_nand_block_bad(sunxi_spi_t *spi, uint32_t addr);
 
 #endif
@@ -54,3 +54,9 @@ void sunxi_usart_putc(void *arg, char c)
 	while ((read32(usart->base + 0x7c) & (0x1 << 0)) == 1)
 		;
 }
+
+/* Data in the RX FIFO or a break on the line (LSR DR / BI), nothing is consumed */
+int sunxi_usart_rx_pending(sunxi_usart_t *usart)
+{
+	return (read32(usart->base + 0x14) & ((0x1 << 0) | (0x1 << 4))) != 0;
+}
@@ -13,5 +13,6 @@ typedef struct {
 
 extern void sunxi_usart_init(sunxi_usart_t *usart);
 extern void sunxi_usart_putc(void *arg, char c);
+extern int	sunxi_usart_rx_pending(sunxi_usart_t *usart);
 
 #endif
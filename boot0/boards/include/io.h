@@ -7,6 +7,52 @@
 
 typedef unsigned int virtual_addr_t;
 
+#ifdef CONFIG_HOST_SIM
+/* Host build (boot0/host): registers are served by the peripheral models */
+extern uint32_t host_mmio_read(virtual_addr_t addr, int width);
+extern void host_mmio_write(virtual_addr_t addr, uint32_t value, int width);
+
+static inline uint8_t read8(virtual_addr_t addr)
+{
+	return host_mmio_read(addr, 8);
+}
+
+static inline uint16_t read16(virtual_addr_t addr)
+{
+	return host_mmio_read(addr, 16);
+}
+
+static inline uint32_t read32(virtual_addr_t addr)
+{
+	return host_mmio_read(addr, 32);
+}
+
+static inline uint64_t read64(virtual_addr_t addr)
+{
+	return host_mmio_read(addr, 32) | ((uint64_t)host_mmio_read(addr + 4, 32) << 32);
+}
+
+static inline void write8(virtual_addr_t addr, uint8_t value)
+{
+	host_mmio_write(addr, value, 8);
+}
+
+static inline void write16(virtual_addr_t addr, uint16_t value)
+{
+	host_mmio_write(addr, value, 16);
+}
+
+static inline void write32(virtual_addr_t addr, uint32_t value)
+{
+	host_mmio_write(addr, value, 32);
+}
+
+static inline void write64(virtual_addr_t addr, uint64_t value)
+{
+	host_mmio_write(addr, (uint32_t)value, 32);
+	host_mmio_write(addr + 4, (uint32_t)(value >> 32), 32);
+}
+#else
 static inline __attribute__((__always_inline__)) uint8_t read8(virtual_addr_t addr)
 {
 	return (*((volatile uint8_t *)(addr)));
@@ -47,4 +93,6 @@ static inline __attribute__((__always_inline__)) void write64(virtual_addr_t add
 	*((volatile uint64_t *)(addr)) = value;
 }
 
+#endif /* CONFIG_HOST_SIM */
+
 #endif
\ No newline at end of file
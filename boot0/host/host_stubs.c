@@ -0,0 +1,73 @@
+#include <stdarg.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "spi_model.h"
+
+/*
+ * arch_timer.c, mmu.c and lib/debug.c for the host build. Time is the simulated
+ * clock of the peripheral models, so udelay() lets the SPI controller and
+ * the NAND make progress exactly as a busy wait on the board would.
+ */
+
+#define PS_PER_US 1000000ULL
+
+void message(const char *fmt, ...)
+{
+	va_list ap;
+
+	va_start(ap, fmt);
+	vprintf(fmt, ap);
+	va_end(ap);
+}
+
+uint64_t get_arch_counter(void)
+{
+	return sim_now_ps() * 24 / PS_PER_US;
+}
+
+uint32_t time_ms(void)
+{
+	return sim_now_ps() / (PS_PER_US * 1000);
+}
+
+uint64_t time_us(void)
+{
+	return sim_now_ps() / PS_PER_US;
+}
+
+void udelay(uint64_t us)
+{
+	sim_advance_ps(us * PS_PER_US);
+}
+
+void mdelay(uint32_t ms)
+{
+	udelay((uint64_t)ms * 1000);
+}
+
+/* Two instructions per loop at 1.2GHz */
+void sdelay(uint32_t loops)
+{
+	sim_advance_ps((uint64_t)loops * 1667);
+}
+
+/* The host has coherent memory, there is nothing to clean or invalidate */
+void dcache_clean_range(uint32_t start, uint32_t size)
+{
+}
+
+void dcache_inv_range(uint32_t start, uint32_t size)
+{
+}
+
+void dcache_flush_range(uint32_t start, uint32_t size)
+{
+}
+
+void reset(void)
+{
+	fprintf(stderr, "boot0 requested a reset\n");
+	exit(2);
+}
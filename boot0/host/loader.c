@@ -0,0 +1,114 @@
+#include "main.h"
+#include "board.h"
+#include "sunxi_dma.h"
+#include "debug.h"
+#include "loader.h"
+#include "handoff.h"
+#include "boot_image.h"
+#include "fast_boot.h"
+#include "ptable.h"
+#include "dram_tune.h"
+#include "spi_model.h"
+
+/* main() up to the NAND detect and SPI calibration, minus the clock and DRAM setup */
+int loader_detect(uint32_t clk_rate, uint32_t max_clk_rate)
+{
+    static uint32_t board_clk_rate;
+    static uint32_t board_max_clk_rate;
+    dram_op_t dram_op;
+    uint32_t cal_page = BOOT1_ADDR;
+
+    handoff_timestamp(HANDOFF_TS_BOOT0);
+    handoff_set_clk();
+
+    if (board_clk_rate == 0)
+    {
+        board_clk_rate = sunxi_spi0.clk_rate;
+        board_max_clk_rate = sunxi_spi0.max_clk_rate;
+    }
+    sunxi_spi0.clk_rate = clk_rate ? clk_rate : board_clk_rate;
+    sunxi_spi0.max_clk_rate = max_clk_rate ? max_clk_rate : board_max_clk_rate;
+
+    dma_init();
+
+    if (sunxi_spi_init(&sunxi_spi0) != 0)
+    {
+        error("SPI: init failed\r\n");
+        return -1;
+    }
+
+    if (spi_nand_detect(&sunxi_spi0) != 0)
+    {
+        error("SPI: nand detect failed\r\n");
+        return -1;
+    }
+
+    /* The model's DRAM needs no training, the point is only reported */
+    dram_op_load(&sunxi_spi0, &dram_op);
+    handoff_set_dram(HOST_DRAM_SIZE, dram_op.clk, dram_op.timing_pct);
+    handoff_timestamp(HANDOFF_TS_DRAM);
+
+    if (spi_nand_block_bad(&sunxi_spi0, cal_page))
+    {
+        cal_page += BOOT1_STRIDE;
+    }
+    sunxi_spi_calibrate(&sunxi_spi0, cal_page, (uint8_t *)HOST_DRAM_BASE);
+    handoff_timestamp(HANDOFF_TS_NAND);
+
+    ptable_load(&sunxi_spi0);
+
+    return 0;
+}
+
+/* The rest of main() until the jump, the image is left in DRAM */
+int loader_load(uint32_t *load, uint32_t *size, int *copy, uint32_t *entry)
+{
+    int i = 0;
+    boot_head_t img_head;
+
+    *entry = 0;
+#ifdef CONFIG_FAST_BOOT
+    if (fast_boot_load(&sunxi_spi0, HOST_DRAM_SIZE, entry) != FAST_BOOT_OK)
+    {
+        *entry = 0;
+    }
+#endif
+    handoff_set_direct(*entry != 0);
+
+    if (*entry == 0)
+    {
+        i = boot_image_load_any(&sunxi_spi0, &img_head);
+        if (i < 0)
+        {
+            return -1;
+        }
+    }
+
+    handoff_set_nand(&sunxi_spi0);
+
+    sunxi_spi_disable(&sunxi_spi0);
+    dma_exit();
+
+    handoff_timestamp(HANDOFF_TS_LOAD);
+    handoff_commit();
+
+    if (*entry != 0)
+    {
+        *copy = LOADER_DIRECT;
+        return 0;
+    }
+
+    *load = img_head.img_load;
+    *size = img_head.img_size;
+    *copy = i;
+    *entry = img_head.img_entry;
+
+    return 0;
+}
+
+/* Release the controller and DMA channel after a run was cut short */
+void loader_abort(void)
+{
+    sunxi_spi_disable(&sunxi_spi0);
+    dma_exit();
+}
@@ -0,0 +1,19 @@
+#ifndef __LOADER_H__
+#define __LOADER_H__
+
+#include <stdint.h>
+
+#define LOADER_IMG_OFFSET  0x100000
+#define LOADER_IMG_MAGIC   0x12345678
+#define LOADER_IMG_HCRC	   20 /* head_crc in application/boot_image.h */
+#define LOADER_IMG_PAGE	   24 /* img_page */
+#define LOADER_IMG_HEAD	   28 /* sizeof(boot_head_t) */
+#define LOADER_COPY_STRIDE 0x80000 /* Second boot1 copy, see application/main.c */
+#define LOADER_COPIES	   2
+#define LOADER_DIRECT	   (-1) /* *copy when boot0 started the app itself, application/fast_boot.c */
+
+int loader_detect(uint32_t clk_rate, uint32_t max_clk_rate);
+int loader_load(uint32_t *load, uint32_t *size, int *copy, uint32_t *entry);
+void loader_abort(void);
+
+#endif
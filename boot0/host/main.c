@@ -0,0 +1,931 @@
+#include <getopt.h>
+#include <setjmp.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "handoff.h"
+#include "loader.h"
+#include "nand_model.h"
+#include "spi_model.h"
+
+/*
+ * Runs boot0's SPI NAND loader (sunxi_spi.c, sunxi_dma.c, the load loop of
+ * application/main.c) against the controller and NAND models and reports
+ * what it cost on the bus, normalised per MiB loaded.
+ */
+
+#define PS_PER_US 1000000.0
+#define MIB		  (1024.0 * 1024.0)
+
+#define DEFAULT_SIZE	(512 * 1024)
+#define DEFAULT_LOAD	0x40000000
+#define SELFTEST_SIZE	300001
+#define BROM_PAGE		2048 /* tool/mk_image.c, bytes used per page of an expanded image */
+#define EXPAND_SIZE		200001 /* Expanded onto 4KiB pages it still fits one copy stride */
+
+#define HOST_UART0_BASE 0x02500000
+#define HOST_DRAM_CLEAR (4 << 20) /* boot1 and the app's first MiBs */
+
+/* tool/nand_layout.txt, what boot0's direct app boot reads */
+#define PTABLE_ADDR		0x080000
+#define APP1_ADDR		0x200000
+#define APP2_ADDR		0x300000
+#define APP_PART_SIZE	0x100000
+#define PARAM_ADDR		0x500000
+#define PARAM2_ADDR		0x520000 /* After LittleFs on the board, nothing here uses that */
+#define FLASH_END		0x540000
+#define APP_LOAD		0x40100000
+#define DRAM_OP_END		0x080000 /* application/dram_tune.h, record in the block below */
+
+/* Faults that have to send a direct boot back to boot1 */
+#define FB_FAULT_PENDING (1 << 0) /* Param has upgrade_ready set */
+#define FB_FAULT_CRC	 (1 << 1) /* A byte of the app flipped */
+#define FB_FAULT_KEY	 (1 << 2) /* Key in the UART RX FIFO */
+#define FB_FAULT_TORN	 (1 << 3) /* Param pending, the newer Param2 record with a bad CRC */
+
+struct run_opts {
+	uint32_t				spi_hz;	 /* 0 keeps board.c's clk_rate */
+	uint32_t				max_hz;	 /* Calibration ceiling, 0 keeps board.c's max_clk_rate */
+	uint32_t				t_r_us;	 /* 0 keeps the chip's tR */
+	struct spi_model_config model;
+	int						quiet;
+	uint32_t				corrupt;  /* Bit mask of boot1 copies to flip a byte in */
+	uint32_t				corrupt_head; /* Bit mask of boot1 copies to flip an img_size bit in */
+	uint32_t				bad;	  /* Bit mask of boot1 copies whose first block is factory bad */
+	uint32_t				bad_span; /* Bit mask of boot1 copies with too few good blocks left in their stride */
+	uint32_t				copies;	  /* boot1 copies listed in a partition table, 0 for the built-in two */
+	const uint8_t		   *app;	  /* pack.py image for the active slot, NULL leaves no partition table */
+	uint32_t				app_size;
+	uint32_t				app_slot; /* 1 or 2 */
+	uint32_t				fb_fault; /* FB_FAULT_* */
+	int						para2;	  /* Current record in Param2, an older pending one left in Param */
+	uint32_t				dram_clk; /* Stored DRAM operating point, 0 leaves none */
+	int						dram_spoil; /* Store it with a bad CRC */
+	int						expand;		/* boot1 written as tool/mk_image.c expand_pagesize() does */
+};
+
+static jmp_buf hang_jmp;
+
+static void on_hang(void)
+{
+	longjmp(hang_jmp, 1);
+}
+
+static uint32_t crc32(uint32_t crc, const uint8_t *p, uint32_t len)
+{
+	int i;
+
+	crc = ~crc;
+	while (len--) {
+		crc ^= *p++;
+		for (i = 0; i < 8; i++)
+			crc = (crc >> 1) ^ (0xedb88320 & -(crc & 1));
+	}
+
+	return ~crc;
+}
+
+/*
+ * As tool/mk_boot1.c seals it: CRC of the whole image minus the crc words
+ * (offset 16 to the end of the header), then of the header minus head_crc.
+ */
+static void seal_image(uint8_t *img, uint32_t size)
+{
+	uint32_t crc;
+
+	crc = crc32(0, img, 16);
+	crc = crc32(crc, img + LOADER_IMG_HEAD, size - LOADER_IMG_HEAD);
+	memcpy(img + 16, &crc, sizeof(crc));
+	crc = crc32(0, img, LOADER_IMG_HCRC);
+	crc = crc32(crc, img + LOADER_IMG_HCRC + 4, LOADER_IMG_HEAD - LOADER_IMG_HCRC - 4);
+	memcpy(img + LOADER_IMG_HCRC, &crc, sizeof(crc));
+}
+
+/* As tool/mk_image.c expand_pagesize() leaves a boot1 header: img_page set, head_crc sealed again */
+static void seal_expanded(uint8_t *img, uint32_t page)
+{
+	uint32_t crc;
+
+	memcpy(img + LOADER_IMG_PAGE, &page, sizeof(page));
+	crc = crc32(0, img, LOADER_IMG_HCRC);
+	crc = crc32(crc, img + LOADER_IMG_HCRC + 4, LOADER_IMG_HEAD - LOADER_IMG_HCRC - 4);
+	memcpy(img + LOADER_IMG_HCRC, &crc, sizeof(crc));
+}
+
+/* Packed boot1 layout: magic, size, load, entry, crc, header crc, page, then the image */
+static uint8_t *make_image(uint32_t size)
+{
+	uint8_t *img = malloc(size);
+	uint32_t seed = size;
+	uint32_t hdr[7] = {LOADER_IMG_MAGIC, size, DEFAULT_LOAD, DEFAULT_LOAD + 0x40, 0, 0, 0};
+	uint32_t i;
+
+	if (img == NULL || size < sizeof(hdr))
+		return NULL;
+
+	for (i = 0; i < size; i++) {
+		seed   = seed * 1103515245 + 12345;
+		img[i] = seed >> 16;
+	}
+	memcpy(img, hdr, sizeof(hdr));
+	seal_image(img, size);
+
+	return img;
+}
+
+/* pack.py layout: 32 byte header, then the flat payload or the segment table and the segments */
+static uint8_t *make_app(int segmented, uint32_t *size)
+{
+	static const uint32_t seg_load[2] = {APP_LOAD, APP_LOAD + 0x80000};
+	static const uint32_t seg_file[2] = {150001, 20000};
+	static const uint32_t seg_mem[2]  = {150001, 60000};
+	uint32_t			  hdr[8] = {0x46574D47, 0, 0, 7, APP_LOAD, APP_LOAD + 0x40, 0, 0};
+	uint32_t			  table[2][5];
+	uint32_t			  payload, seed = 7, off, i;
+	uint8_t				 *app;
+
+	payload = segmented ? sizeof(table) + seg_file[0] + seg_file[1] : 200001;
+	app		= malloc(sizeof(hdr) + payload);
+	if (app == NULL)
+		return NULL;
+
+	for (i = 0; i < payload; i++) {
+		seed				 = seed * 1103515245 + 12345;
+		app[sizeof(hdr) + i] = seed >> 16;
+	}
+
+	if (segmented) {
+		off = sizeof(hdr) + sizeof(table);
+		for (i = 0; i < 2; i++) {
+			table[i][0] = seg_load[i];
+			table[i][1] = seg_file[i];
+			table[i][2] = seg_mem[i];
+			table[i][3] = seg_mem[i] > seg_file[i] ? 1 : 0;
+			table[i][4] = crc32(0, app + off, seg_file[i]);
+			off += seg_file[i];
+		}
+		memcpy(app + sizeof(hdr), table, sizeof(table));
+		hdr[6] = 2;
+		hdr[7] = crc32(0, (uint8_t *)table, sizeof(table));
+	}
+
+	hdr[1] = payload;
+	hdr[2] = crc32(0, app + sizeof(hdr), payload);
+	memcpy(app, hdr, sizeof(hdr));
+	*size = sizeof(hdr) + payload;
+
+	return app;
+}
+
+/*
+ * Partition table and Param as tool/mk_nand.c writes them, the app in its slot.
+ * More than two boot1 copies run into APP1, only done without an app.
+ */
+static void make_app_parts(uint8_t *flash, const struct run_opts *o)
+{
+	static const struct {
+		const char *name;
+		uint32_t	start, size, type;
+	} parts[] = {
+		{"boot0", 0x000000, 0x080000, 1},
+		{"ptable", PTABLE_ADDR, 0x080000, 2},
+		{"boot1", LOADER_IMG_OFFSET, 0x100000, 3},
+		{"APP1", APP1_ADDR, APP_PART_SIZE, 4},
+		{"APP2", APP2_ADDR, APP_PART_SIZE, 4},
+		{"Download", 0x400000, 0x100000, 0},
+		{"Param", PARAM_ADDR, 0x01e000, 5},
+		{"Param2", PARAM2_ADDR, 0x01e000, 5},
+	};
+	uint32_t n		 = sizeof(parts) / sizeof(parts[0]);
+	uint32_t head[4] = {0x4C425450, 1, n, 0};
+	uint32_t copies	 = o->copies ? o->copies : LOADER_COPIES;
+	uint32_t para[9] = {0x50415241, o->app_slot == 2 ? 0xa2 : 0xa1, 0, 0, 0, 0, 0, 1, 0};
+	uint32_t slot	 = o->app_slot == 2 ? APP2_ADDR : APP1_ADDR;
+	uint8_t *entry	 = flash + PTABLE_ADDR + sizeof(head);
+	uint32_t i, v = 1;
+
+	for (i = 0; i < n; i++, entry += 32) {
+		memset(entry, 0, 16);
+		strncpy((char *)entry, parts[i].name, 16);
+		memcpy(entry + 16, &parts[i].start, 4);
+		memcpy(entry + 20, &parts[i].size, 4);
+		memcpy(entry + 24, &parts[i].type, 4);
+		memcpy(entry + 28, &v, 4);
+		if (parts[i].type == 3) {
+			v = copies * LOADER_COPY_STRIDE;
+			memcpy(entry + 20, &v, 4);
+			memcpy(entry + 28, &copies, 4);
+			v = 1;
+		}
+	}
+	memcpy(flash + PTABLE_ADDR, head, sizeof(head));
+	head[3] = crc32(0, flash + PTABLE_ADDR, sizeof(head) + n * 32);
+	memcpy(flash + PTABLE_ADDR, head, sizeof(head));
+
+	if (o->app == NULL)
+		return;
+
+	memcpy(flash + slot, o->app, o->app_size);
+	if (o->fb_fault & FB_FAULT_CRC)
+		flash[slot + o->app_size - 1] ^= 0x01;
+
+	memcpy(&para[o->app_slot == 2 ? 5 : 4], o->app + 8, 4);
+	para[3] = (o->fb_fault & FB_FAULT_PENDING) ? 1 : 0;
+	para[8] = crc32(0, (uint8_t *)para, 32);
+	if (!o->para2 && !(o->fb_fault & FB_FAULT_TORN)) {
+		memcpy(flash + PARAM_ADDR, para, sizeof(para));
+		return;
+	}
+
+	/* The record ota_param_save() superseded stays in Param with its update still pending */
+	para[7] = 2;
+	para[8] = crc32(0, (uint8_t *)para, 32);
+	if (o->fb_fault & FB_FAULT_TORN)
+		para[8] ^= 1;
+	memcpy(flash + PARAM2_ADDR, para, sizeof(para));
+	para[3] = 1;
+	para[7] = 1;
+	para[8] = crc32(0, (uint8_t *)para, 32);
+	memcpy(flash + PARAM_ADDR, para, sizeof(para));
+}
+
+/* Flash offset of image byte pos: dense, or only the first BROM page of every flash page used */
+static uint32_t image_pos(uint32_t pos, uint32_t page, int expand)
+{
+	return expand ? pos / BROM_PAGE * page + pos % BROM_PAGE : pos;
+}
+
+/* Block blk of boot1 copy i is factory bad: the first with o->bad, the second and fourth with o->bad_span */
+static int copy_block_bad(const struct run_opts *o, uint32_t i, uint32_t blk)
+{
+	if ((o->bad & (1U << i)) && blk == 0)
+		return 1;
+	if ((o->bad_span & (1U << i)) && (blk == 1 || blk == 3))
+		return 1;
+
+	return 0;
+}
+
+/* The flash as boot0 sees it: boot1 copies one stride apart, the corrupt ones with a flipped byte */
+static uint8_t *make_flash(const struct nand_chip *chip, const uint8_t *img, uint32_t size, const struct run_opts *o,
+						   uint32_t *len)
+{
+	uint32_t copies = o->copies ? o->copies : size <= LOADER_COPY_STRIDE ? LOADER_COPIES : 1;
+	uint32_t page	= chip->page_size;
+	uint32_t block	= page * chip->pages_per_block;
+	uint32_t span	= o->expand ? (size + BROM_PAGE - 1) / BROM_PAGE * page : size;
+	uint32_t room	= copies > 1 ? LOADER_COPY_STRIDE : span;
+	uint8_t *flash, *copy;
+	uint32_t i, pos, blk, n;
+
+	*len = LOADER_IMG_OFFSET + (copies - 1) * LOADER_COPY_STRIDE + span;
+	if ((o->bad | o->bad_span) && *len < LOADER_IMG_OFFSET + copies * LOADER_COPY_STRIDE)
+		*len = LOADER_IMG_OFFSET + copies * LOADER_COPY_STRIDE;
+	if (o->app && *len < FLASH_END)
+		*len = FLASH_END;
+	flash = malloc(*len);
+	copy  = malloc(span);
+	if (flash == NULL || copy == NULL) {
+		free(flash);
+		free(copy);
+		return NULL;
+	}
+
+	memset(flash, 0xff, *len);
+	for (i = 0; i < copies; i++) {
+		if (o->expand) {
+			memset(copy, 0, span);
+			for (pos = 0; pos < size; pos += BROM_PAGE)
+				memcpy(copy + image_pos(pos, page, 1), img + pos, size - pos < BROM_PAGE ? size - pos : BROM_PAGE);
+			seal_expanded(copy, page);
+		} else {
+			memcpy(copy, img, size);
+		}
+		if (o->corrupt & (1U << i))
+			copy[image_pos(size / 2, page, o->expand)] ^= 0x10;
+		if (o->corrupt_head & (1U << i))
+			copy[5] ^= 0x01;
+
+		/* As tool/mk_nand.c writes it: bad blocks skipped, whatever does not fit the stride is lost */
+		for (pos = 0, blk = 0; pos < span && blk * block < room; blk++) {
+			if (copy_block_bad(o, i, blk))
+				continue;
+			n = span - pos < block ? span - pos : block;
+			memcpy(flash + LOADER_IMG_OFFSET + i * LOADER_COPY_STRIDE + blk * block, copy + pos, n);
+			pos += n;
+		}
+	}
+	free(copy);
+
+	if (o->app || o->copies)
+		make_app_parts(flash, o);
+
+	return flash;
+}
+
+static uint8_t *read_image(const char *path, uint32_t *size)
+{
+	FILE	*f = fopen(path, "rb");
+	uint8_t *img;
+	long	 len;
+
+	if (f == NULL) {
+		perror(path);
+		return NULL;
+	}
+
+	fseek(f, 0, SEEK_END);
+	len = ftell(f);
+	fseek(f, 0, SEEK_SET);
+
+	img = malloc(len > 0 ? len : 1);
+	if (img == NULL || len < 16 || fread(img, 1, len, f) != (size_t)len) {
+		fprintf(stderr, "%s: can't read image\n", path);
+		fclose(f);
+		free(img);
+		return NULL;
+	}
+	fclose(f);
+
+	*size = len;
+	return img;
+}
+
+static void report(const struct nand_chip *chip, uint32_t size, uint64_t detect_ps, uint64_t load_ps)
+{
+	const struct spi_model_stats *s = spi_model_stats();
+	const struct nand_stats		 *n = nand_model_stats();
+	double						  per = MIB / size;
+	double						  load_us = load_ps / PS_PER_US;
+	double						  data_us = n->data_cycles * 1e6 / s->sclk_hz;
+
+	printf("%s: SCLK %.1f MHz, detect %.2f ms, %u bytes in %.3f ms (%.2f MiB/s)\n", chip->name,
+		   s->sclk_hz / 1e6, detect_ps / 1e9, size, load_us / 1000, size / MIB / (load_us / 1e6));
+	printf("  per MiB: %.0f xfers, %.0f page loads, %.0f status polls (%.0f busy)\n", s->xfers * per,
+		   n->page_loads * per, n->status_polls * per, n->busy_polls * per);
+	printf("           SCLK cycles: %.0f data, %.0f other RX, %.0f cmd/addr/dummy\n", n->data_cycles * per,
+		   (s->rx_cycles - n->data_cycles) * per, s->tx_cycles * per);
+	printf("           %.0f MMIO accesses, %.0f PIO bytes, %.0f DMA bursts\n", (s->mmio_reads + s->mmio_writes) * per,
+		   s->pio_bytes * per, s->dma_bursts * per);
+	printf("           time: %.3f ms total, %.3f ms clocking data, %.3f ms busy (tR), %.3f ms SCLK stalled\n",
+		   load_us * per / 1000, data_us * per / 1000, n->busy_ps / PS_PER_US * per / 1000,
+		   s->stall_ps / PS_PER_US * per / 1000);
+	printf("  command overhead: %.1f%% of load time\n", load_us ? 100.0 * (load_us - data_us) / load_us : 0);
+}
+
+/* boot1 trusts the hand-off block instead of probing, so it has to describe what was found */
+/* application/dram_tune.h dram_op_rec_t at the top of the boot0 partition */
+static void make_dram_op(uint8_t *flash, const struct nand_chip *chip, const struct run_opts *o)
+{
+	uint32_t rec[8] = {0x504f5244, 1, o->dram_clk, 90, o->dram_clk - 48, o->dram_clk + 48, 80, 0};
+
+	rec[7] = crc32(0, (uint8_t *)rec, 28) ^ (o->dram_spoil ? 1 : 0);
+	memcpy(flash + DRAM_OP_END - chip->page_size * chip->pages_per_block, rec, sizeof(rec));
+}
+
+static int check_handoff(const struct nand_chip *chip, uint32_t sclk_hz, int direct, uint32_t dram_clk)
+{
+	const boot_handoff_t *ho = handoff_get();
+
+	if (ho == NULL) {
+		printf("%s: no valid hand-off block at 0x%08x\n", chip->name, HANDOFF_ADDR);
+		return -1;
+	}
+
+	if ((ho->flags & (HANDOFF_F_CLK | HANDOFF_F_DRAM | HANDOFF_F_NAND)) !=
+			(HANDOFF_F_CLK | HANDOFF_F_DRAM | HANDOFF_F_NAND) ||
+		ho->nand_mfr != chip->id[0] || ho->nand_page_size != chip->page_size ||
+		ho->nand_pages_per_block != chip->pages_per_block || ho->nand_blocks != chip->blocks ||
+		ho->spi_clk != sclk_hz || ho->dram_size != HOST_DRAM_SIZE) {
+		printf("%s: hand-off block mismatch: flags 0x%x mfr 0x%02x page %u x %u x %u, SCLK %u\n", chip->name,
+			   ho->flags, ho->nand_mfr, ho->nand_page_size, ho->nand_pages_per_block, ho->nand_blocks, ho->spi_clk);
+		return -1;
+	}
+
+	if (ho->dram_clk != dram_clk || ho->dram_timing_pct != (dram_clk ? 90 : 0)) {
+		printf("%s: hand-off DRAM point %uMHz %u%%, expected %uMHz\n", chip->name, ho->dram_clk, ho->dram_timing_pct,
+			   dram_clk);
+		return -1;
+	}
+
+	if (!!(ho->flags & HANDOFF_F_DIRECT) != direct) {
+		printf("%s: hand-off block says boot1 was %s\n", chip->name, direct ? "run" : "skipped");
+		return -1;
+	}
+
+	if (ho->ts_us[HANDOFF_TS_LOAD] < ho->ts_us[HANDOFF_TS_NAND] ||
+		ho->ts_us[HANDOFF_TS_NAND] < ho->ts_us[HANDOFF_TS_BOOT0]) {
+		printf("%s: hand-off timestamps out of order\n", chip->name);
+		return -1;
+	}
+
+	return 0;
+}
+
+/* What a direct boot has to leave in DRAM: the payload or every segment, zero-fill included */
+static int check_app(const struct nand_chip *chip, const uint8_t *app, uint32_t entry)
+{
+	uint32_t hdr[8], seg[5], off, i;
+	uint8_t *mem;
+
+	memcpy(hdr, app, sizeof(hdr));
+	if (entry != hdr[5]) {
+		printf("%s: direct boot entry 0x%08x, header says 0x%08x\n", chip->name, entry, hdr[5]);
+		return -1;
+	}
+
+	if (hdr[6] == 0) {
+		if (memcmp((void *)(uintptr_t)hdr[4], app + sizeof(hdr), hdr[1]) != 0) {
+			printf("%s: DRAM contents differ from the app\n", chip->name);
+			return -1;
+		}
+		return 0;
+	}
+
+	off = sizeof(hdr) + hdr[6] * sizeof(seg);
+	for (i = 0; i < hdr[6]; i++) {
+		memcpy(seg, app + sizeof(hdr) + i * sizeof(seg), sizeof(seg));
+		mem = (uint8_t *)(uintptr_t)seg[0];
+		if (memcmp(mem, app + off, seg[1]) != 0) {
+			printf("%s: DRAM contents differ from app segment %u\n", chip->name, i);
+			return -1;
+		}
+		for (off += seg[1]; seg[1] < seg[2]; seg[1]++) {
+			if (mem[seg[1]] != 0) {
+				printf("%s: app segment %u not zero filled\n", chip->name, i);
+				return -1;
+			}
+		}
+	}
+
+	return 0;
+}
+
+/* One boot: detect, load, compare DRAM with the image. Returns 0 when clean. */
+static int run(const struct nand_chip *chip, const uint8_t *img, uint32_t size, const struct run_opts *o)
+{
+	const struct spi_model_stats *s;
+	const struct nand_stats		 *n;
+	static uint8_t				 *flash;
+	uint32_t					  load = 0, len = 0, flash_len, entry = 0;
+	uint64_t					  t0, t1;
+	uint32_t					  blk;
+	int							  ret = 0, copy = -1, i;
+	int							  direct = o->app != NULL && o->fb_fault == 0;
+
+	/* Left alive until the next run, the NAND model reads it until then */
+	free(flash);
+	flash = make_flash(chip, img, size, o, &flash_len);
+	if (flash == NULL)
+		return -1;
+	if (o->dram_clk)
+		make_dram_op(flash, chip, o);
+
+	if (spi_model_init(&o->model) != 0 || nand_model_init(chip, flash, 0, flash_len) != 0)
+		return -1;
+	for (i = 0; i < 32; i++) {
+		for (blk = 0; blk * chip->page_size * chip->pages_per_block < LOADER_COPY_STRIDE; blk++) {
+			if (copy_block_bad(o, i, blk))
+				nand_model_mark_bad((LOADER_IMG_OFFSET + i * LOADER_COPY_STRIDE) / (chip->page_size * chip->pages_per_block) + blk);
+		}
+	}
+	if (o->fb_fault & FB_FAULT_KEY)
+		*(volatile uint32_t *)(uintptr_t)(HOST_UART0_BASE + 0x14) = 0x1; /* LSR.DR */
+	if (o->t_r_us)
+		nand_model_set_tr(o->t_r_us);
+	sim_set_hang_handler(on_hang);
+
+	/* Not zero, a missing zero-fill has to show */
+	memset((void *)(uintptr_t)HOST_DRAM_BASE, 0xaa, size + 2048 < HOST_DRAM_CLEAR ? HOST_DRAM_CLEAR : size + 2048);
+	memset((void *)(uintptr_t)HANDOFF_ADDR, 0, sizeof(boot_handoff_t));
+
+	if (setjmp(hang_jmp)) {
+		printf("%s: boot0 hung after %.1f ms simulated time, %lu busy errors (%s)\n", chip->name,
+			   sim_now_ps() / 1e9, spi_model_stats()->busy_errors, nand_model_last_error());
+		sim_set_hang_handler(NULL);
+		loader_abort();
+		return -1;
+	}
+
+	if (loader_detect(o->spi_hz, o->max_hz) != 0) {
+		printf("%s: detect failed (%s)\n", chip->name, nand_model_last_error());
+		return -1;
+	}
+	t0 = sim_now_ps();
+
+	spi_model_reset_stats();
+	nand_model_reset_stats();
+
+	if (loader_load(&load, &len, &copy, &entry) != 0) {
+		printf("%s: load failed (%s)\n", chip->name, nand_model_last_error());
+		return -1;
+	}
+	t1 = sim_now_ps();
+
+	if (copy == LOADER_DIRECT) {
+		memcpy(&len, o->app + 4, sizeof(len));
+	} else if (len > size || load < HOST_DRAM_BASE || load - HOST_DRAM_BASE + len > HOST_DRAM_SIZE) {
+		printf("%s: bad header, load 0x%08x size %u\n", chip->name, load, len);
+		return -1;
+	}
+
+	if (!o->quiet)
+		report(chip, len, t0, t1 - t0);
+
+	s = spi_model_stats();
+	n = nand_model_stats();
+	if (n->errors) {
+		printf("%s: %lu NAND protocol errors, last: %s\n", chip->name, n->errors, nand_model_last_error());
+		ret = -1;
+	}
+	if (s->fifo_errors || s->busy_errors || s->sample_errors || s->dma_errors) {
+		printf("%s: controller errors: fifo %lu, busy %lu, sampling %lu, dma %lu\n", chip->name, s->fifo_errors,
+			   s->busy_errors, s->sample_errors, s->dma_errors);
+		ret = -1;
+	}
+	if (direct) {
+		if (copy != LOADER_DIRECT) {
+			printf("%s: booted boot1 copy %d, expected the app directly\n", chip->name, copy);
+			ret = -1;
+		} else if (check_app(chip, o->app, entry) != 0) {
+			ret = -1;
+		}
+	} else if (copy != __builtin_ctz(~(o->corrupt | o->corrupt_head | o->bad_span))) {
+		printf("%s: booted copy %d, expected the first intact one\n", chip->name, copy);
+		ret = -1;
+	} else if (memcmp((void *)(uintptr_t)load, img, LOADER_IMG_HCRC) != 0 ||
+			   memcmp((uint8_t *)(uintptr_t)load + LOADER_IMG_HEAD, img + LOADER_IMG_HEAD, len - LOADER_IMG_HEAD) != 0) {
+		/* head_crc and img_page differ on an expanded copy */
+		printf("%s: DRAM contents differ from the image\n", chip->name);
+		ret = -1;
+	} else {
+		/* Reads stop at img_size, the rest of the last page must not land behind the image */
+		for (blk = 0; blk < chip->page_size && ((uint8_t *)(uintptr_t)load)[len + blk] == 0xaa; blk++)
+			;
+		if (blk < chip->page_size) {
+			printf("%s: DRAM overwritten at byte %u after the image\n", chip->name, blk);
+			ret = -1;
+		}
+	}
+	if (check_handoff(chip, s->sclk_hz, direct, o->dram_spoil ? 0 : o->dram_clk) != 0)
+		ret = -1;
+
+	return ret;
+}
+
+static int selftest(const struct run_opts *base)
+{
+	static const uint32_t clocks[] = {0, 50000000, 25000000};
+	static const struct {
+		const char *name;
+		uint32_t	fault;
+	} faults[] = {
+		{"pending update", FB_FAULT_PENDING},
+		{"app CRC error", FB_FAULT_CRC},
+		{"UART key", FB_FAULT_KEY},
+		{"torn newer Param2 record", FB_FAULT_TORN},
+	};
+	uint8_t				   *app[2];
+	uint32_t				app_size[2];
+	const struct nand_chip *chip;
+	struct run_opts			o = *base;
+	uint8_t				   *img, *small;
+	unsigned int			i, c;
+	unsigned long			rx;
+	int						failed = 0;
+
+	img = make_image(SELFTEST_SIZE);
+	if (img == NULL)
+		return 1;
+
+	o.quiet = 1;
+	for (i = 0; (chip = nand_model_chip(i)) != NULL; i++) {
+		for (c = 0; c < sizeof(clocks) / sizeof(clocks[0]); c++) {
+			/* Board default detects slow and calibrates, the fixed clocks skip the ramp */
+			o.spi_hz = clocks[c];
+			o.max_hz = clocks[c];
+			if (run(chip, img, SELFTEST_SIZE, &o) != 0) {
+				printf("FAIL %s @ %s\n", chip->name, c ? "slow clock" : "default clock");
+				failed++;
+			} else {
+				printf("ok   %s @ %.1f MHz\n", chip->name, spi_model_stats()->sclk_hz / 1e6);
+			}
+		}
+	}
+
+	/* The ramp stops at the datasheet maximum of the part, not at board.c's ceiling, and short of it on a narrow eye */
+	o.spi_hz = o.max_hz = 0;
+	if (run(nand_model_chip(1), img, SELFTEST_SIZE, &o) != 0 || spi_model_stats()->sclk_hz != 120000000) {
+		printf("FAIL calibration did not reach 120 MHz on a 133 MHz part\n");
+		failed++;
+	} else {
+		printf("ok   calibration @ %.1f MHz on a 133 MHz part\n", spi_model_stats()->sclk_hz / 1e6);
+	}
+
+	if (run(nand_model_chip(0), img, SELFTEST_SIZE, &o) != 0 || spi_model_stats()->sclk_hz != 100000000) {
+		printf("FAIL calibration exceeded a 104 MHz part\n");
+		failed++;
+	} else {
+		printf("ok   calibration @ %.1f MHz on a 104 MHz part\n", spi_model_stats()->sclk_hz / 1e6);
+	}
+
+	o.model.eye_loss_ps = 8000;
+	if (run(nand_model_chip(1), img, SELFTEST_SIZE, &o) != 0 || spi_model_stats()->sclk_hz != 100000000) {
+		printf("FAIL calibration on a narrow eye\n");
+		failed++;
+	} else {
+		printf("ok   calibration on a narrow eye @ %.1f MHz\n", spi_model_stats()->sclk_hz / 1e6);
+	}
+	o.model.eye_loss_ps = base->model.eye_loss_ps;
+
+	/* A corrupted first copy has to be caught by the CRC and the second one booted, two bad ones stop the boot */
+	for (i = 0; i < 3; i += 2) {
+		o.corrupt = 1;
+		if (run(nand_model_chip(i), img, SELFTEST_SIZE, &o) != 0) {
+			printf("FAIL %s did not fall back to boot1 copy 1\n", nand_model_chip(i)->name);
+			failed++;
+		} else {
+			printf("ok   %s falls back to boot1 copy 1\n", nand_model_chip(i)->name);
+		}
+	}
+	o.corrupt = 3;
+	if (run(nand_model_chip(0), img, SELFTEST_SIZE, &o) == 0) {
+		printf("FAIL two corrupted copies booted\n");
+		failed++;
+	} else {
+		printf("ok   two corrupted copies refused\n");
+	}
+	o.corrupt = 0;
+
+	/* A plausible but wrong img_size fails the header CRC, the body of that copy is never read */
+	if (run(nand_model_chip(0), img, SELFTEST_SIZE, &o) != 0)
+		failed++;
+	rx = spi_model_stats()->rx_bytes;
+	o.corrupt_head = 1;
+	if (run(nand_model_chip(0), img, SELFTEST_SIZE, &o) != 0 || spi_model_stats()->rx_bytes > rx + 4096) {
+		printf("FAIL bad header of copy 0 not caught before its body\n");
+		failed++;
+	} else {
+		printf("ok   bad header of copy 0 caught before its body, %lu extra bytes read\n",
+			   spi_model_stats()->rx_bytes - rx);
+	}
+	o.corrupt_head = 0;
+
+	/*
+	 * A copy continues in the next good block after a bad one, the header's included; only one whose
+	 * stride runs out of good blocks is given up: the built-in two, then three from the partition table
+	 */
+	o.bad = 1;
+	if (run(nand_model_chip(2), img, SELFTEST_SIZE, &o) != 0) {
+		printf("FAIL %s did not load boot1 copy 0 past its bad first block\n", nand_model_chip(2)->name);
+		failed++;
+	} else {
+		printf("ok   %s loads boot1 copy 0 past its bad first block\n", nand_model_chip(2)->name);
+	}
+	o.bad	   = 0;
+	o.bad_span = 1;
+	o.copies   = 3;
+	o.corrupt  = 2;
+	for (i = 0; i < 2; i++) {
+		if (run(nand_model_chip(i), img, SELFTEST_SIZE, &o) != 0) {
+			printf("FAIL %s did not boot copy 2 of 3\n", nand_model_chip(i)->name);
+			failed++;
+		} else {
+			printf("ok   %s boots copy 2 of 3, copy 0 out of good blocks and copy 1 corrupt\n", nand_model_chip(i)->name);
+		}
+	}
+	o.bad_span = 0;
+	o.corrupt = 0;
+	o.copies  = 0;
+
+	/* Direct app boot: a flat APP1 and a scatter-loaded APP2, then every reason to go through boot1 instead */
+	app[0] = make_app(0, &app_size[0]);
+	app[1] = make_app(1, &app_size[1]);
+	if (app[0] == NULL || app[1] == NULL)
+		return 1;
+	for (i = 0; i < 2; i++) {
+		o.app	   = app[i];
+		o.app_size = app_size[i];
+		o.app_slot = i + 1;
+		if (run(nand_model_chip(i * 2), img, SELFTEST_SIZE, &o) != 0) {
+			printf("FAIL %s direct boot of APP%u\n", nand_model_chip(i * 2)->name, i + 1);
+			failed++;
+		} else {
+			printf("ok   %s boots APP%u without boot1\n", nand_model_chip(i * 2)->name, i + 1);
+		}
+	}
+	o.para2 = 1;
+	if (run(nand_model_chip(0), img, SELFTEST_SIZE, &o) != 0) {
+		printf("FAIL %s direct boot with the current Param record in Param2\n", nand_model_chip(0)->name);
+		failed++;
+	} else {
+		printf("ok   %s takes the newer Param2 record over a pending Param one\n", nand_model_chip(0)->name);
+	}
+	o.para2 = 0;
+	for (i = 0; i < sizeof(faults) / sizeof(faults[0]); i++) {
+		o.fb_fault = faults[i].fault;
+		if (run(nand_model_chip(0), img, SELFTEST_SIZE, &o) != 0) {
+			printf("FAIL %s did not fall back to boot1\n", faults[i].name);
+			failed++;
+		} else {
+			printf("ok   %s falls back to boot1\n", faults[i].name);
+		}
+	}
+	o.app	   = NULL;
+	o.fb_fault = 0;
+	free(app[0]);
+	free(app[1]);
+
+	/* tool/mk_image.c layout on a 4KiB page part, both copies, then the second one after a bad first */
+	small = make_image(EXPAND_SIZE);
+	if (small == NULL)
+		return 1;
+	o.expand = 1;
+	for (i = 0; i < 2; i++) {
+		o.corrupt = i;
+		if (run(nand_model_find("GD5F4GQ4UBxIG"), small, EXPAND_SIZE, &o) != 0) {
+			printf("FAIL expanded boot1 copy %u on 4KiB pages\n", i);
+			failed++;
+		} else {
+			printf("ok   expanded boot1 copy %u on 4KiB pages\n", i);
+		}
+	}
+	o.expand  = 0;
+	o.corrupt = 0;
+
+	/* Dense, with zeros where an expanded copy has its padding: still read as dense */
+	memset(small + BROM_PAGE, 0, BROM_PAGE);
+	seal_image(small, EXPAND_SIZE);
+	if (run(nand_model_find("GD5F4GQ4UBxIG"), small, EXPAND_SIZE, &o) != 0) {
+		printf("FAIL dense boot1 with a zero second 2KiB on 4KiB pages\n");
+		failed++;
+	} else {
+		printf("ok   dense boot1 with a zero second 2KiB on 4KiB pages\n");
+	}
+	free(small);
+
+	/* The stored DRAM point is read before DRAM init and handed on, a bad CRC leaves the defaults */
+	o.dram_clk = 864;
+	for (i = 0; i < 2; i++) {
+		o.dram_spoil = i;
+		if (run(nand_model_chip(i), img, SELFTEST_SIZE, &o) != 0) {
+			printf("FAIL %s %s DRAM point\n", nand_model_chip(i)->name, i ? "spoilt" : "stored");
+			failed++;
+		} else {
+			printf("ok   %s %s DRAM point\n", nand_model_chip(i)->name, i ? "ignores a spoilt" : "takes the stored");
+		}
+	}
+	o.dram_clk	 = 0;
+	o.dram_spoil = 0;
+
+	/* Negative control: 50MHz without delayed sampling has to be caught */
+	o.spi_hz			   = 50000000;
+	o.max_hz			   = 50000000;
+	o.model.sample_limit_hz = 40000000;
+	if (run(nand_model_chip(0), img, SELFTEST_SIZE, &o) == 0) {
+		printf("FAIL sampling check did not trigger\n");
+		failed++;
+	} else {
+		printf("ok   sampling check triggers\n");
+	}
+
+	free(img);
+	printf("%s\n", failed ? "selftest FAILED" : "selftest passed");
+
+	return failed ? 1 : 0;
+}
+
+static void usage(const char *prog)
+{
+	const struct nand_chip *chip;
+	int						i;
+
+	printf("usage: %s [options] [run|selftest]\n", prog);
+	printf("  -c CHIP   NAND model, 'all' runs every chip (default F35SQA002G)\n");
+	printf("  -i FILE   packed boot1 image (header + code), copies at flash 0x%x + n * 0x%x\n", LOADER_IMG_OFFSET,
+		   LOADER_COPY_STRIDE);
+	printf("  -s BYTES  size of the generated image when -i is not given (default %u)\n", DEFAULT_SIZE);
+	printf("  -f HZ     SPI detect clock (default board.c clk_rate)\n");
+	printf("  -F HZ     SPI calibration ceiling (default board.c max_clk_rate, -f alone pins the clock)\n");
+	printf("  -e PS     data eye lost to setup, hold and jitter (default 2500)\n");
+	printf("  -x MASK   flip a byte in these boot1 copies (bit 0 = copy at 0x%x)\n", LOADER_IMG_OFFSET);
+	printf("  -b MASK   mark the first block of these boot1 copies bad, the copy written from the next one\n");
+	printf("  -p        write boot1 as tool/mk_image.c expand_pagesize() does, 2KiB per page\n");
+	printf("  -n COPIES boot1 copies, listed in a partition table (default 2, no table)\n");
+	printf("  -a FILE   pack.py app image, written to APP1 with a partition table and a Param booting it,\n");
+	printf("            so boot0 starts it without boot1\n");
+	printf("  -r US     tR of the NAND (default per chip)\n");
+	printf("  -m NS     CPU time of one register access (default 40)\n");
+	printf("  -d NS     DMAC time of one burst (default 100)\n");
+	printf("chips:");
+	for (i = 0; (chip = nand_model_chip(i)) != NULL; i++)
+		printf(" %s", chip->name);
+	printf("\n");
+}
+
+int main(int argc, char **argv)
+{
+	const struct nand_chip *chip;
+	struct run_opts			o;
+	const char			   *chip_name = "F35SQA002G";
+	const char			   *image	  = NULL;
+	uint8_t				   *app		  = NULL;
+	uint32_t				size	  = DEFAULT_SIZE;
+	uint8_t				   *img;
+	int						i, opt, ret = 0;
+
+	memset(&o, 0, sizeof(o));
+	spi_model_default_config(&o.model);
+
+	while ((opt = getopt(argc, argv, "c:i:s:f:F:e:x:b:pn:a:r:m:d:h")) != -1) {
+		switch (opt) {
+			case 'c':
+				chip_name = optarg;
+				break;
+			case 'i':
+				image = optarg;
+				break;
+			case 's':
+				size = strtoul(optarg, NULL, 0);
+				break;
+			case 'f':
+				o.spi_hz = strtoul(optarg, NULL, 0);
+				if (o.max_hz == 0)
+					o.max_hz = o.spi_hz;
+				break;
+			case 'F':
+				o.max_hz = strtoul(optarg, NULL, 0);
+				break;
+			case 'e':
+				o.model.eye_loss_ps = strtoul(optarg, NULL, 0);
+				break;
+			case 'x':
+				o.corrupt = strtoul(optarg, NULL, 0);
+				break;
+			case 'b':
+				o.bad = strtoul(optarg, NULL, 0);
+				break;
+			case 'p':
+				o.expand = 1;
+				break;
+			case 'n':
+				o.copies = strtoul(optarg, NULL, 0);
+				if (o.copies < 1 || o.copies > 8)
+					return 1;
+				break;
+			case 'a':
+				free(app);
+				app = read_image(optarg, &o.app_size);
+				if (app == NULL || o.app_size > APP_PART_SIZE)
+					return 1;
+				o.app	   = app;
+				o.app_slot = 1;
+				break;
+			case 'r':
+				o.t_r_us = strtoul(optarg, NULL, 0);
+				break;
+			case 'm':
+				o.model.mmio_ns = strtoul(optarg, NULL, 0);
+				break;
+			case 'd':
+				o.model.dma_burst_ns = strtoul(optarg, NULL, 0);
+				break;
+			default:
+				usage(argv[0]);
+				return opt == 'h' ? 0 : 1;
+		}
+	}
+
+	/* Peripherals and DRAM live at fixed low addresses, map them before anything else */
+	if (spi_model_init(&o.model) != 0)
+		return 1;
+
+	if (optind < argc && strcmp(argv[optind], "selftest") == 0)
+		return selftest(&o);
+
+	if (optind < argc && strcmp(argv[optind], "run") != 0) {
+		usage(argv[0]);
+		return 1;
+	}
+
+	img = image ? read_image(image, &size) : make_image(size);
+	if (img == NULL)
+		return 1;
+
+	if (strcmp(chip_name, "all") == 0) {
+		for (i = 0; (chip = nand_model_chip(i)) != NULL; i++)
+			ret |= run(chip, img, size, &o) ? 1 : 0;
+	} else if ((chip = nand_model_find(chip_name)) != NULL) {
+		ret = run(chip, img, size, &o) ? 1 : 0;
+	} else {
+		fprintf(stderr, "unknown chip %s\n", chip_name);
+		ret = 1;
+	}
+
+	free(img);
+	free(app);
+
+	return ret;
+}
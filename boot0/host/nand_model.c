@@ -0,0 +1,431 @@
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "nand_model.h"
+
+#define PS_PER_US 1000000ULL
+
+#define MAX_PAGE	 (4096 + 256)
+#define MAX_BLOCKS 4096
+#define MAX_CMD	 8
+
+#define FEATURE_PROTECT 0xa0
+#define FEATURE_CONFIG	0xb0
+#define FEATURE_STATUS	0xc0
+
+#define CONFIG_BUF 0x08
+#define CONFIG_QE  0x01
+#define STATUS_OIP 0x01
+
+/* Chips boot0 knows about that cover its four read paths, and a 4KiB page part */
+static const struct nand_chip chips[] = {
+	/* name             id                      len  page  spare ppb  blocks cfg  cont qe  tR  tRST */
+	{"F35SQA002G",		{0xcd, 0x72, 0x72},		3, 2048, 128, 64, 2048, 0x10, 0, 0, 60, 500},
+	{"GD5F1GQ5UExxG",	{0xc8, 0x51},			2, 2048, 128, 64, 1024, 0x10, 0, 1, 80, 500},
+	{"W25N01GV",		{0xef, 0xaa, 0x21},		3, 2048, 64, 64, 1024, 0x18, 1, 0, 60, 500},
+	{"MX35LF1GE4AB",	{0xc2, 0x12},			2, 2048, 64, 64, 1024, 0x10, 0, 0, 100, 500},
+	{"GD5F4GQ4UBxIG",	{0xc8, 0xd4},			2, 4096, 256, 64, 2048, 0x10, 0, 1, 120, 500},
+};
+
+static struct {
+	const struct nand_chip *chip;
+	const uint8_t		   *image;
+	uint32_t				image_off;
+	uint32_t				image_len;
+	uint32_t				t_r_us;
+
+	uint8_t	 cache[MAX_PAGE];
+	uint32_t cache_page;
+	uint8_t	 bad[MAX_BLOCKS / 8];
+
+	uint8_t	 protect;
+	uint8_t	 config;
+	uint64_t busy_until;
+
+	int		 selected;
+	uint8_t	 cmd[MAX_CMD];
+	int		 ncmd;			/* Bytes clocked in since CS went low */
+	int		 nrx;			/* Bytes clocked out since CS went low */
+	int		 skip;			/* Output bytes lost to a short header */
+	uint32_t col;			/* Cache read pointer */
+	int		 lane_error;	/* Reported once per command */
+
+	struct nand_stats stats;
+	char			  last_error[160];
+} nm;
+
+static void nand_error(const char *fmt, ...)
+{
+	va_list ap;
+
+	va_start(ap, fmt);
+	vsnprintf(nm.last_error, sizeof(nm.last_error), fmt, ap);
+	va_end(ap);
+
+	nm.stats.errors++;
+}
+
+const struct nand_chip *nand_model_chip(int index)
+{
+	if (index < 0 || index >= (int)(sizeof(chips) / sizeof(chips[0])))
+		return NULL;
+
+	return &chips[index];
+}
+
+const struct nand_chip *nand_model_find(const char *name)
+{
+	const struct nand_chip *chip;
+	int						i;
+
+	for (i = 0; (chip = nand_model_chip(i)) != NULL; i++) {
+		if (strcmp(chip->name, name) == 0)
+			return chip;
+	}
+
+	return NULL;
+}
+
+int nand_model_init(const struct nand_chip *chip, const uint8_t *image, uint32_t image_off, uint32_t image_len)
+{
+	memset(&nm, 0, sizeof(nm));
+
+	if (chip->page_size + chip->spare_size > MAX_PAGE || chip->blocks > MAX_BLOCKS)
+		return -1;
+
+	nm.chip		 = chip;
+	nm.image	 = image;
+	nm.image_off = image_off;
+	nm.image_len = image_len;
+	nm.t_r_us	 = chip->t_r_us;
+	nm.protect	 = 0x38; /* All blocks locked after power up */
+	nm.config	 = chip->config_default;
+
+	return 0;
+}
+
+void nand_model_set_tr(uint32_t t_r_us)
+{
+	nm.t_r_us = t_r_us;
+}
+
+int nand_model_mark_bad(uint32_t block)
+{
+	if (nm.chip == NULL || block >= nm.chip->blocks)
+		return -1;
+
+	nm.bad[block / 8] |= 1 << (block % 8);
+
+	return 0;
+}
+
+static int busy(uint64_t now)
+{
+	return now < nm.busy_until;
+}
+
+static void set_busy(uint64_t now, uint32_t us)
+{
+	nm.busy_until = now + us * PS_PER_US;
+	nm.stats.busy_ps += us * PS_PER_US;
+}
+
+static void load_page(uint32_t page)
+{
+	uint32_t size = nm.chip->page_size;
+	uint64_t addr = (uint64_t)page * size;
+	uint32_t block = page / nm.chip->pages_per_block;
+	uint32_t i;
+
+	nm.cache_page = page;
+	nm.stats.page_loads++;
+
+	/* A factory bad block reads back as zeroes, marker byte included */
+	if (block < nm.chip->blocks && (nm.bad[block / 8] & (1 << (block % 8)))) {
+		memset(nm.cache, 0x00, size + nm.chip->spare_size);
+		return;
+	}
+
+	memset(nm.cache, 0xff, size + nm.chip->spare_size);
+	for (i = 0; i < size; i++) {
+		if (addr + i >= nm.image_off && addr + i < (uint64_t)nm.image_off + nm.image_len)
+			nm.cache[i] = nm.image[addr + i - nm.image_off];
+	}
+}
+
+static int read_lanes(uint8_t op)
+{
+	switch (op) {
+		case 0x3b:
+		case 0xbb:
+			return 2;
+		case 0x6b:
+		case 0xeb:
+			return 4;
+		default:
+			return 1;
+	}
+}
+
+static int is_cache_read(uint8_t op)
+{
+	return op == 0x03 || op == 0x0b || op == 0x3b || op == 0x6b || op == 0xbb || op == 0xeb;
+}
+
+/* Bytes the host has to clock in before the first data byte */
+static int read_header_len(uint8_t op)
+{
+	if (nm.chip->continuous && !(nm.config & CONFIG_BUF))
+		return (op == 0x03) ? 4 : 5; /* opcode + 3 or 4 dummy bytes */
+
+	return (op == 0xeb) ? 5 : 4; /* opcode + column + dummy */
+}
+
+void nand_model_select(uint64_t now)
+{
+	if (nm.selected)
+		nand_error("CS asserted twice");
+
+	nm.selected	  = 1;
+	nm.ncmd		  = 0;
+	nm.nrx		  = 0;
+	nm.skip		  = 0;
+	nm.lane_error = 0;
+}
+
+void nand_model_tx(uint8_t byte, int lanes, uint64_t now)
+{
+	if (!nm.selected) {
+		nand_error("data clocked with CS high");
+		return;
+	}
+
+	if (nm.nrx) {
+		nand_error("input after output in op 0x%02x", nm.cmd[0]);
+		return;
+	}
+
+	/* Only the address/dummy phase of the x2/x4 IO reads is not single line */
+	if (lanes != 1 && !(nm.ncmd > 0 && (nm.cmd[0] == 0xbb || nm.cmd[0] == 0xeb))) {
+		nand_error("command byte %d on %d lines", nm.ncmd, lanes);
+		byte = 0x00;
+	}
+
+	if (nm.ncmd < MAX_CMD)
+		nm.cmd[nm.ncmd] = byte;
+	nm.ncmd++;
+}
+
+static void start_output(uint64_t now)
+{
+	uint8_t op = nm.cmd[0];
+	int		want;
+
+	if (!is_cache_read(op))
+		return;
+
+	if (busy(now))
+		nand_error("cache read 0x%02x while busy", op);
+
+	want = read_header_len(op);
+	if (nm.ncmd != want)
+		nand_error("read 0x%02x with %d header bytes, chip expects %d", op, nm.ncmd, want);
+
+	/* A short header turns the first data bytes into dummy cycles, a long one eats data */
+	nm.skip = want - nm.ncmd;
+
+	if (nm.chip->continuous && !(nm.config & CONFIG_BUF))
+		nm.col = 0;
+	else
+		nm.col = ((nm.cmd[1] << 8) | nm.cmd[2]) & 0x1fff;
+
+	if (nm.skip < 0) {
+		nm.col += -nm.skip;
+		nm.skip = 0;
+	}
+}
+
+static uint8_t cache_byte(int lanes)
+{
+	uint32_t limit = nm.chip->page_size + nm.chip->spare_size;
+	uint8_t	 b;
+
+	if (nm.chip->continuous && !(nm.config & CONFIG_BUF)) {
+		/* Continuous mode: data area only, then the next page follows */
+		if (nm.col >= nm.chip->page_size) {
+			load_page(nm.cache_page + 1);
+			nm.col = 0;
+		}
+	} else if (nm.col >= limit) {
+		return 0xff;
+	}
+
+	b = nm.cache[nm.col++];
+	nm.stats.data_bytes++;
+	nm.stats.data_cycles += 8 / lanes;
+
+	return b;
+}
+
+uint8_t nand_model_rx(int lanes, uint64_t now)
+{
+	uint8_t op = nm.cmd[0];
+	uint8_t b  = 0xff;
+	int		n;
+
+	if (!nm.selected) {
+		nand_error("data clocked with CS high");
+		return 0xff;
+	}
+
+	if (nm.ncmd == 0) {
+		nand_error("output before opcode");
+		return 0xff;
+	}
+
+	if (nm.nrx == 0)
+		start_output(now);
+	n = nm.nrx++;
+
+	if (lanes != read_lanes(op)) {
+		if (!nm.lane_error)
+			nand_error("op 0x%02x read on %d lines, chip drives %d", op, lanes, read_lanes(op));
+		nm.lane_error = 1;
+		return 0x5a;
+	}
+
+	if (lanes == 4 && nm.chip->quad_needs_qe && !(nm.config & CONFIG_QE)) {
+		if (!nm.lane_error)
+			nand_error("x4 read 0x%02x with QE clear", op);
+		nm.lane_error = 1;
+		return 0x5a;
+	}
+
+	switch (op) {
+		case 0x9f:
+			/* One dummy byte while the chip decodes, then the ID */
+			if (n >= 1 && n - 1 < nm.chip->id_len)
+				b = nm.chip->id[n - 1];
+			break;
+
+		case 0x0f:
+			if (nm.ncmd != 2) {
+				nand_error("get feature with %d bytes", nm.ncmd);
+				break;
+			}
+			if (n == 0) {
+				if (nm.cmd[1] == FEATURE_STATUS) {
+					nm.stats.status_polls++;
+					if (busy(now))
+						nm.stats.busy_polls++;
+				} else if (nm.cmd[1] != FEATURE_PROTECT && nm.cmd[1] != FEATURE_CONFIG) {
+					nand_error("get feature 0x%02x", nm.cmd[1]);
+				}
+			}
+			if (nm.cmd[1] == FEATURE_STATUS)
+				b = busy(now) ? STATUS_OIP : 0x00;
+			else if (nm.cmd[1] == FEATURE_PROTECT)
+				b = nm.protect;
+			else if (nm.cmd[1] == FEATURE_CONFIG)
+				b = nm.config;
+			break;
+
+		default:
+			if (!is_cache_read(op)) {
+				if (n == 0)
+					nand_error("op 0x%02x has no output", op);
+				break;
+			}
+			if (nm.skip) {
+				nm.skip--;
+				break;
+			}
+			b = cache_byte(lanes);
+			break;
+	}
+
+	return b;
+}
+
+void nand_model_deselect(uint64_t now)
+{
+	uint8_t	 op = nm.cmd[0];
+	uint32_t page;
+
+	if (!nm.selected) {
+		nand_error("CS released twice");
+		return;
+	}
+	nm.selected = 0;
+
+	if (nm.ncmd == 0)
+		return;
+
+	nm.stats.cmds[op]++;
+
+	switch (op) {
+		case 0xff:
+			if (nm.ncmd != 1)
+				nand_error("reset with %d bytes", nm.ncmd);
+			nm.config = nm.chip->config_default;
+			set_busy(now, nm.chip->t_rst_us);
+			break;
+
+		case 0x13:
+			if (nm.ncmd != 4) {
+				nand_error("page read with %d bytes", nm.ncmd);
+				break;
+			}
+			if (busy(now))
+				nand_error("page read while busy");
+			page = (nm.cmd[1] << 16) | (nm.cmd[2] << 8) | nm.cmd[3];
+			if (page >= nm.chip->blocks * nm.chip->pages_per_block) {
+				nand_error("page read 0x%06x out of range", page);
+				break;
+			}
+			load_page(page);
+			set_busy(now, nm.t_r_us);
+			break;
+
+		case 0x1f:
+			if (nm.ncmd != 3) {
+				nand_error("set feature with %d bytes", nm.ncmd);
+				break;
+			}
+			if (nm.cmd[1] == FEATURE_PROTECT)
+				nm.protect = nm.cmd[2];
+			else if (nm.cmd[1] == FEATURE_CONFIG)
+				nm.config = nm.cmd[2];
+			else
+				nand_error("set feature 0x%02x", nm.cmd[1]);
+			break;
+
+		case 0x0f:
+		case 0x9f:
+			break;
+
+		default:
+			if (!is_cache_read(op))
+				nand_error("unsupported op 0x%02x", op);
+			else if (nm.nrx == 0)
+				nand_error("cache read 0x%02x without data", op);
+			break;
+	}
+}
+
+void nand_model_reset_stats(void)
+{
+	memset(&nm.stats, 0, sizeof(nm.stats));
+	nm.last_error[0] = '\0';
+}
+
+const struct nand_stats *nand_model_stats(void)
+{
+	return &nm.stats;
+}
+
+const char *nand_model_last_error(void)
+{
+	return nm.last_error;
+}
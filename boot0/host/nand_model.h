@@ -0,0 +1,61 @@
+#ifndef __NAND_MODEL_H__
+#define __NAND_MODEL_H__
+
+#include <stdint.h>
+
+/*
+ * Behavioural model of an SPI NAND as seen on the SPI0 pins.
+ *
+ * The controller model feeds it every byte clocked out on MOSI together with
+ * the number of data lines used, and asks it for every byte clocked in. The
+ * model decodes the command set used by boot0 (RESET, GET/SET FEATURE,
+ * READ ID, PAGE READ and the 03/0B/3B/6B/BB/EB cache reads), keeps OIP busy
+ * for tR/tRST and reports protocol mistakes instead of silently returning
+ * data, so a driver change that breaks the wire protocol fails on the host.
+ *
+ * Time is in picoseconds of simulated time.
+ */
+
+struct nand_chip {
+	const char *name;
+	uint8_t		id[4];			 /* READ ID bytes after the dummy byte */
+	int			id_len;
+	uint32_t	page_size;
+	uint32_t	spare_size;
+	uint32_t	pages_per_block;
+	uint32_t	blocks;
+	uint8_t		config_default;	 /* Feature B0 after power up and RESET */
+	int			continuous;		 /* BUF=0 streams pages (Winbond) */
+	int			quad_needs_qe;	 /* x4 reads need QE (feature B0 bit 0) */
+	uint32_t	t_r_us;			 /* Array to cache time */
+	uint32_t	t_rst_us;		 /* RESET busy time */
+};
+
+struct nand_stats {
+	unsigned long cmds[256];	 /* Commands by opcode */
+	unsigned long page_loads;	 /* Array to cache transfers, incl. continuous mode */
+	unsigned long status_polls;	 /* GET FEATURE C0 commands */
+	unsigned long busy_polls;	 /* ... of which returned OIP set */
+	unsigned long data_bytes;	 /* Cache bytes sent to the host */
+	uint64_t	  data_cycles;	 /* SCLK cycles those bytes took */
+	unsigned long errors;		 /* Protocol errors */
+	uint64_t	  busy_ps;		 /* Time spent busy (tR/tRST) */
+};
+
+const struct nand_chip *nand_model_chip(int index);
+const struct nand_chip *nand_model_find(const char *name);
+
+int	 nand_model_init(const struct nand_chip *chip, const uint8_t *image, uint32_t image_off, uint32_t image_len);
+void nand_model_set_tr(uint32_t t_r_us);
+int	 nand_model_mark_bad(uint32_t block); /* After init, until the next init */
+
+void	nand_model_select(uint64_t now);
+void	nand_model_tx(uint8_t byte, int lanes, uint64_t now);
+uint8_t nand_model_rx(int lanes, uint64_t now);
+void	nand_model_deselect(uint64_t now);
+
+void					 nand_model_reset_stats(void);
+const struct nand_stats *nand_model_stats(void);
+const char				*nand_model_last_error(void);
+
+#endif
@@ -0,0 +1,579 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+
+#include "io.h"
+#include "nand_model.h"
+#include "spi_model.h"
+
+#define PS_PER_NS 1000ULL
+#define PS_PER_S  1000000000000ULL
+
+#define FIFO_DEPTH 64
+
+/* SPI registers, see sunxi_spi.c */
+#define SPI_GCR 0x04
+#define SPI_TCR 0x08
+#define SPI_ISR 0x14
+#define SPI_FCR 0x18
+#define SPI_FSR 0x1c
+#define SPI_CCR 0x24
+#define SPI_DLY 0x28
+#define SPI_MBC 0x30
+#define SPI_MTC 0x34
+#define SPI_BCC 0x38
+#define SPI_TXD 0x200
+#define SPI_RXD 0x300
+
+#define GCR_SRST	(1U << 31)
+#define TCR_XCH		(1U << 31)
+#define TCR_SDC		(1U << 11)
+#define ISR_TC		(1U << 12)
+#define FCR_TX_RST	(1U << 31)
+#define FCR_RX_RST	(1U << 15)
+#define FCR_RX_DRQ	(1U << 8)
+#define CCR_DRS		(1U << 12)
+#define DLY_SW_EN	(1U << 7)
+#define DLY_SW		0x3f
+#define BCC_DUAL_RX (1U << 28)
+#define BCC_QUAD_IO (1U << 29)
+
+/* CCU */
+#define CCU_BASE			0x02001000
+#define CCU_PLL_PERI0_CTRL	0x020
+#define CCU_SPI0_CLK		0x940
+#define CCU_SPI_BGR			0x96c
+
+/* DMAC */
+#define DMA_STATUS		 0x30
+#define DMA_CH_BASE		 0x100
+#define DMA_CH_SIZE		 0x40
+#define DMA_CH_ENABLE	 0x00
+#define DMA_CH_DESC		 0x08
+#define DMA_DRQ_DRAM	 1
+#define DMA_DRQ_SPI0	 22
+
+struct region {
+	uint32_t base;
+	uint32_t size;
+};
+
+/* Everything boot0 touches, mapped at the physical address */
+static const struct region regions[] = {
+	{0x02000000, 0x2000},		 /* GPIO + CCU */
+	{0x02500000, 0x1000},		 /* UART0 */
+	{HOST_DMA_BASE, 0x1000},	 /* DMAC */
+	{HOST_SPI0_BASE, 0x1000},	 /* SPI0 */
+	{HOST_DRAM_BASE, HOST_DRAM_SIZE},
+};
+
+static struct spi_model_config cfg;
+static struct spi_model_stats	stats;
+static uint64_t					now;
+static uint64_t					deadline;
+static void (*hang_handler)(void);
+static int mapped;
+
+static struct {
+	uint8_t	 tx[FIFO_DEPTH];
+	uint32_t tx_head, tx_cnt;
+	uint8_t	 rx[FIFO_DEPTH];
+	uint64_t rx_ts[FIFO_DEPTH];	 /* Time each RX byte landed, for DMA bursts */
+	uint32_t rx_head, rx_cnt;
+
+	int		 active;
+	int		 pending;		/* XCH written while busy, starts after this one */
+	uint64_t t;				/* When the shifter can start the next byte */
+	uint32_t done;			/* Bytes of this exchange shifted so far */
+	uint32_t mbc, mtc, stc, dum;
+	int		 lanes;			/* Lines used past the single transmit count */
+	int		 sample_bad;	/* Sample point outside the data eye */
+	uint64_t cycle_ps;
+} spi;
+
+static struct {
+	int		 active;
+	int		 channel;
+	uint32_t dst;
+	uint32_t left;
+	uint32_t burst;
+	uint64_t start;			/* Start of the last burst, frees FIFO space */
+	uint64_t free_at;		/* DMAC busy with the last burst until then */
+} dma;
+
+static inline volatile uint32_t *reg(uint32_t addr)
+{
+	return (volatile uint32_t *)(uintptr_t)addr;
+}
+
+static inline uint32_t spi_reg(uint32_t off)
+{
+	return *reg(HOST_SPI0_BASE + off);
+}
+
+static inline void spi_reg_set(uint32_t off, uint32_t val)
+{
+	*reg(HOST_SPI0_BASE + off) = val;
+}
+
+void spi_model_default_config(struct spi_model_config *c)
+{
+	c->mmio_ns		   = 40;	 /* APB register access seen from the Cortex-A7 */
+	c->dma_burst_ns	   = 100;	 /* 16 bytes to DRAM through the MBUS */
+	c->sample_limit_hz = 60000000;
+	c->eye_loss_ps	   = 2500;
+	c->tap_ps		   = 100;
+	c->timeout_ms	   = 5000;
+}
+
+uint64_t sim_now_ps(void)
+{
+	return now;
+}
+
+void sim_set_hang_handler(void (*handler)(void))
+{
+	hang_handler = handler;
+}
+
+const struct spi_model_stats *spi_model_stats(void)
+{
+	return &stats;
+}
+
+void spi_model_reset_stats(void)
+{
+	memset(&stats, 0, sizeof(stats));
+}
+
+/* SCLK from PLL_PERI0 -> SPI0 module clock -> CCR divider */
+uint32_t spi_model_sclk_hz(void)
+{
+	uint32_t pll = *reg(CCU_BASE + CCU_PLL_PERI0_CTRL);
+	uint32_t clk = *reg(CCU_BASE + CCU_SPI0_CLK);
+	uint32_t bgr = *reg(CCU_BASE + CCU_SPI_BGR);
+	uint32_t ccr = spi_reg(SPI_CCR);
+	uint64_t src;
+
+	if (!(clk & (1U << 31)) || (bgr & 0x10001) != 0x10001)
+		return 0;
+
+	switch ((clk >> 24) & 0x7) {
+		case 0:
+			src = 24000000;
+			break;
+		case 1:
+			if (!(pll & (1U << 31)))
+				return 0;
+			src = 24000000ULL * (((pll >> 8) & 0xff) + 1) / (((pll & 1) + 1) * (((pll >> 16) & 3) + 1)) / 2;
+			break;
+		default:
+			return 0;
+	}
+
+	src = src / ((clk & 0xf) + 1) >> ((clk >> 8) & 0x3);
+
+	if (ccr & CCR_DRS)
+		return src / (2 * ((ccr & 0xff) + 1));
+
+	return src >> ((ccr >> 8) & 0xf);
+}
+
+static void fifo_reset(int tx, int rx)
+{
+	if (spi.active && ((tx && spi.tx_cnt) || (rx && spi.rx_cnt)))
+		stats.busy_errors++;
+
+	if (tx)
+		spi.tx_head = spi.tx_cnt = 0;
+	if (rx)
+		spi.rx_head = spi.rx_cnt = 0;
+}
+
+/* Is the sample point of the current TCR / SPI_DLY setting inside the data eye? */
+static int sample_ok(uint32_t sclk)
+{
+	uint64_t period = PS_PER_S / sclk;
+	uint64_t open	= PS_PER_S / cfg.sample_limit_hz / 2;
+	uint32_t dly	= spi_reg(SPI_DLY);
+	uint64_t at;
+
+	at = (spi_reg(SPI_TCR) & TCR_SDC) ? period : period / 2;
+	if (dly & DLY_SW_EN)
+		at += (uint64_t)(dly & DLY_SW) * cfg.tap_ps;
+
+	return at >= open && at + cfg.eye_loss_ps <= period + open;
+}
+
+static void xfer_start(uint64_t t)
+{
+	uint32_t bcc = spi_reg(SPI_BCC);
+	uint32_t sclk;
+
+	spi.mbc = spi_reg(SPI_MBC) & 0xffffff;
+	spi.mtc = spi_reg(SPI_MTC) & 0xffffff;
+	spi.stc = bcc & 0xffffff;
+	spi.dum = (bcc >> 24) & 0xf;
+	spi.lanes = (bcc & BCC_QUAD_IO) ? 4 : (bcc & BCC_DUAL_RX) ? 2 : 1;
+
+	sclk = spi_model_sclk_hz();
+	if (sclk == 0 || spi.mtc + spi.dum > spi.mbc) {
+		/* No clock or inconsistent counters: nothing gets shifted */
+		stats.busy_errors++;
+		spi_reg_set(SPI_TCR, spi_reg(SPI_TCR) & ~TCR_XCH);
+		return;
+	}
+
+	spi.cycle_ps   = PS_PER_S / sclk;
+	spi.sample_bad = !sample_ok(sclk);
+	spi.done	   = 0;
+	spi.active	   = 1;
+	spi.t		   = t + spi.cycle_ps; /* CS setup */
+
+	stats.sclk_hz = sclk;
+	stats.xfers++;
+	nand_model_select(t);
+}
+
+static void xfer_finish(void)
+{
+	spi.active = 0;
+	spi.t += spi.cycle_ps; /* CS hold */
+
+	spi_reg_set(SPI_TCR, spi_reg(SPI_TCR) & ~TCR_XCH);
+	spi_reg_set(SPI_ISR, spi_reg(SPI_ISR) | ISR_TC);
+	nand_model_deselect(spi.t);
+
+	if (spi.pending) {
+		spi.pending = 0;
+		spi_reg_set(SPI_TCR, spi_reg(SPI_TCR) | TCR_XCH);
+		xfer_start(spi.t);
+	}
+}
+
+static void dma_run(uint64_t until)
+{
+	uint64_t start;
+	uint32_t n, i;
+
+	while (dma.active && dma.left && (spi_reg(SPI_FCR) & FCR_RX_DRQ)) {
+		n = dma.left < dma.burst ? dma.left : dma.burst;
+		if (spi.rx_cnt < n)
+			break;
+
+		/* The burst starts once its last byte is in the FIFO and the DMAC is free */
+		start = spi.rx_ts[(spi.rx_head + n - 1) % FIFO_DEPTH];
+		if (start < dma.free_at)
+			start = dma.free_at;
+		if (start > until)
+			break;
+
+		for (i = 0; i < n; i++) {
+			*(volatile uint8_t *)(uintptr_t)dma.dst++ = spi.rx[spi.rx_head];
+			spi.rx_head = (spi.rx_head + 1) % FIFO_DEPTH;
+		}
+		spi.rx_cnt -= n;
+		dma.left -= n;
+		dma.start	= start;
+		dma.free_at = start + cfg.dma_burst_ns * PS_PER_NS;
+
+		stats.dma_bursts++;
+		stats.dma_bytes += n;
+	}
+
+	if (dma.active && dma.left == 0 && until >= dma.free_at)
+		dma.active = 0;
+}
+
+/* Shift bytes until the given time or until a FIFO stalls the shifter */
+static void spi_run(uint64_t until)
+{
+	uint64_t dur;
+	uint32_t i;
+	int		 lanes;
+	uint8_t	 b;
+
+	while (spi.active && spi.t < until) {
+		i = spi.done;
+
+		if (i < spi.mtc + spi.dum) {
+			/* TX phase: command, address, dummy */
+			if (i < spi.mtc && spi.tx_cnt == 0) {
+				stats.stall_ps += until - spi.t;
+				spi.t = until;
+				break;
+			}
+			lanes = (i < spi.stc) ? 1 : spi.lanes;
+			dur	  = spi.cycle_ps * (8 / lanes);
+			if (spi.t + dur > until)
+				break;
+
+			b = 0x00;
+			if (i < spi.mtc) {
+				b			= spi.tx[spi.tx_head];
+				spi.tx_head = (spi.tx_head + 1) % FIFO_DEPTH;
+				spi.tx_cnt--;
+			}
+			nand_model_tx(b, lanes, spi.t + dur);
+			stats.tx_bytes++;
+			stats.tx_cycles += 8 / lanes;
+		} else {
+			/* RX phase */
+			if (spi.rx_cnt == FIFO_DEPTH) {
+				dma_run(until);
+				if (spi.rx_cnt == FIFO_DEPTH) {
+					stats.stall_ps += until - spi.t;
+					spi.t = until;
+					break;
+				}
+				if (spi.t < dma.start) {
+					stats.stall_ps += dma.start - spi.t;
+					spi.t = dma.start;
+				}
+			}
+			lanes = (i < spi.stc) ? 1 : spi.lanes;
+			dur	  = spi.cycle_ps * (8 / lanes);
+			if (spi.t + dur > until)
+				break;
+
+			b = nand_model_rx(lanes, spi.t + dur);
+			if (spi.sample_bad) {
+				/* Data sampled while it is changing */
+				b ^= 0x01;
+				stats.sample_errors++;
+			}
+			i			 = (spi.rx_head + spi.rx_cnt) % FIFO_DEPTH;
+			spi.rx[i]	 = b;
+			spi.rx_ts[i] = spi.t + dur;
+			spi.rx_cnt++;
+			stats.rx_bytes++;
+			stats.rx_cycles += 8 / lanes;
+		}
+
+		spi.t += dur;
+		if (++spi.done == spi.mbc)
+			xfer_finish();
+	}
+
+	dma_run(until);
+}
+
+void sim_advance_ps(uint64_t ps)
+{
+	now += ps;
+	spi_run(now);
+
+	if (now > deadline && hang_handler)
+		hang_handler();
+}
+
+static void dma_channel_enable(int ch, uint32_t val)
+{
+	uint32_t		  *desc;
+	uint32_t		  config, src_drq, dst_drq;
+	static const int burst_len[] = {1, 4, 8, 16};
+
+	if (!(val & 1)) {
+		if (dma.active && dma.channel == ch)
+			dma.active = 0;
+		return;
+	}
+
+	desc	= (uint32_t *)(uintptr_t)*reg(HOST_DMA_BASE + DMA_CH_BASE + ch * DMA_CH_SIZE + DMA_CH_DESC);
+	config	= desc[0];
+	src_drq = config & 0x3f;
+	dst_drq = (config >> 16) & 0x3f;
+
+	if (src_drq == DMA_DRQ_SPI0 && dst_drq == DMA_DRQ_DRAM && desc[1] == HOST_SPI0_BASE + SPI_RXD) {
+		if (dma.active)
+			stats.dma_errors++;
+		dma.active	= 1;
+		dma.channel = ch;
+		dma.dst		= desc[2];
+		dma.left	= desc[3];
+		dma.burst	= burst_len[(config >> 6) & 3] * (1 << ((config >> 9) & 3));
+		dma.free_at = now;
+	} else if (src_drq == DMA_DRQ_DRAM && dst_drq == DMA_DRQ_DRAM) {
+		memmove((void *)(uintptr_t)desc[2], (void *)(uintptr_t)desc[1], desc[3]);
+	} else {
+		stats.dma_errors++;
+	}
+}
+
+static uint32_t spi_read(uint32_t off, int width)
+{
+	uint32_t val = 0;
+	int		 i;
+
+	switch (off) {
+		case SPI_FSR:
+			return spi.rx_cnt | (spi.tx_cnt << 16);
+
+		case SPI_RXD:
+			for (i = 0; i < width / 8; i++) {
+				if (spi.rx_cnt == 0) {
+					stats.fifo_errors++;
+					break;
+				}
+				val |= (uint32_t)spi.rx[spi.rx_head] << (8 * i);
+				spi.rx_head = (spi.rx_head + 1) % FIFO_DEPTH;
+				spi.rx_cnt--;
+				stats.pio_bytes++;
+			}
+			return val;
+
+		default:
+			return spi_reg(off & ~3);
+	}
+}
+
+static void spi_write(uint32_t off, uint32_t val, int width)
+{
+	int i;
+
+	switch (off) {
+		case SPI_GCR:
+			if (val & GCR_SRST) {
+				spi.active = spi.pending = 0;
+				fifo_reset(1, 1);
+				val &= ~GCR_SRST;
+			}
+			spi_reg_set(off, val);
+			break;
+
+		case SPI_TCR:
+			if ((val & TCR_XCH) && !(spi_reg(SPI_TCR) & TCR_XCH)) {
+				spi_reg_set(off, val);
+				xfer_start(now);
+			} else if ((val & TCR_XCH) && spi.active) {
+				/* The write is lost on the real controller, the driver would hang */
+				stats.busy_errors++;
+				spi.pending = 1;
+				spi_reg_set(off, val);
+			} else {
+				spi_reg_set(off, val | (spi_reg(SPI_TCR) & TCR_XCH));
+			}
+			break;
+
+		case SPI_ISR:
+			spi_reg_set(off, spi_reg(off) & ~val); /* Write 1 to clear */
+			break;
+
+		case SPI_FCR:
+			fifo_reset(!!(val & FCR_TX_RST), !!(val & FCR_RX_RST));
+			spi_reg_set(off, val & ~(FCR_TX_RST | FCR_RX_RST));
+			break;
+
+		case SPI_TXD:
+			for (i = 0; i < width / 8; i++) {
+				if (spi.tx_cnt == FIFO_DEPTH) {
+					stats.fifo_errors++;
+					break;
+				}
+				spi.tx[(spi.tx_head + spi.tx_cnt) % FIFO_DEPTH] = val >> (8 * i);
+				spi.tx_cnt++;
+			}
+			break;
+
+		default:
+			spi_reg_set(off & ~3, val);
+			break;
+	}
+}
+
+static uint32_t dma_read(uint32_t off)
+{
+	if (off == DMA_STATUS)
+		return dma.active ? (1U << dma.channel) : 0;
+
+	return *reg(HOST_DMA_BASE + (off & ~3));
+}
+
+static void dma_write(uint32_t off, uint32_t val)
+{
+	*reg(HOST_DMA_BASE + (off & ~3)) = val;
+
+	if (off >= DMA_CH_BASE && off < DMA_CH_BASE + 16 * DMA_CH_SIZE && (off - DMA_CH_BASE) % DMA_CH_SIZE == DMA_CH_ENABLE)
+		dma_channel_enable((off - DMA_CH_BASE) / DMA_CH_SIZE, val);
+}
+
+uint32_t host_mmio_read(virtual_addr_t addr, int width)
+{
+	sim_advance_ps(cfg.mmio_ns * PS_PER_NS);
+	stats.mmio_reads++;
+
+	if (addr - HOST_SPI0_BASE < 0x1000)
+		return spi_read(addr - HOST_SPI0_BASE, width);
+	if (addr - HOST_DMA_BASE < 0x1000)
+		return dma_read(addr - HOST_DMA_BASE);
+
+	switch (width) {
+		case 8:
+			return *(volatile uint8_t *)(uintptr_t)addr;
+		case 16:
+			return *(volatile uint16_t *)(uintptr_t)addr;
+		default:
+			return *reg(addr);
+	}
+}
+
+void host_mmio_write(virtual_addr_t addr, uint32_t value, int width)
+{
+	sim_advance_ps(cfg.mmio_ns * PS_PER_NS);
+	stats.mmio_writes++;
+
+	if (addr - HOST_SPI0_BASE < 0x1000) {
+		spi_write(addr - HOST_SPI0_BASE, value, width);
+		return;
+	}
+	if (addr - HOST_DMA_BASE < 0x1000) {
+		dma_write(addr - HOST_DMA_BASE, value);
+		return;
+	}
+
+	switch (width) {
+		case 8:
+			*(volatile uint8_t *)(uintptr_t)addr = value;
+			break;
+		case 16:
+			*(volatile uint16_t *)(uintptr_t)addr = value;
+			break;
+		default:
+			*reg(addr) = value;
+			break;
+	}
+}
+
+int spi_model_init(const struct spi_model_config *c)
+{
+	unsigned int i;
+	void		*p;
+
+	if (!mapped) {
+		for (i = 0; i < sizeof(regions) / sizeof(regions[0]); i++) {
+			p = mmap((void *)(uintptr_t)regions[i].base, regions[i].size, PROT_READ | PROT_WRITE,
+					 MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED_NOREPLACE | MAP_NORESERVE, -1, 0);
+			if (p != (void *)(uintptr_t)regions[i].base) {
+				fprintf(stderr, "spi_model: can't map 0x%08x\n", regions[i].base);
+				return -1;
+			}
+		}
+		mapped = 1;
+	} else {
+		for (i = 0; i < sizeof(regions) / sizeof(regions[0]) - 1; i++)
+			memset((void *)(uintptr_t)regions[i].base, 0, regions[i].size);
+	}
+
+	cfg = *c;
+	memset(&spi, 0, sizeof(spi));
+	memset(&dma, 0, sizeof(dma));
+	spi_model_reset_stats();
+	now		 = 0;
+	deadline = cfg.timeout_ms * 1000000000ULL;
+
+	/* PLL_PERI0 as sunxi_clk_init() leaves it: N = 0x63, enabled and locked */
+	*reg(CCU_BASE + CCU_PLL_PERI0_CTRL) = (1U << 31) | (1U << 28) | (0x63 << 8);
+
+	return 0;
+}
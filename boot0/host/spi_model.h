@@ -0,0 +1,70 @@
+#ifndef __SPI_MODEL_H__
+#define __SPI_MODEL_H__
+
+#include <stdint.h>
+
+/*
+ * Register level model of the T113 SPI0 controller and the DMAC channel
+ * that drains its RX FIFO, used to run boards/aw_boot_lib/sunxi_spi.c
+ * unmodified on the host (io.h routes read/write32 here when built with
+ * CONFIG_HOST_SIM).
+ *
+ * The controller shifts one byte at a time on simulated time: SCLK comes
+ * from the CCU SPI0 clock and the CCR divider the driver programmed, the
+ * exchange follows MBC/MTC/BCC, stalls on an empty TX or a full RX FIFO
+ * and hands every byte to the NAND model. Every register access costs the
+ * CPU mmio_ns, udelay() advances the same clock, so polling loops and FIFO
+ * waits show up in the counters the way they would on the board.
+ *
+ * Sampling: read data turns valid 1 / (2 * sample_limit_hz) after the
+ * launching edge and stays valid for one bit period minus eye_loss_ps. The
+ * controller samples half a period after the launch, a full period with
+ * SDC, plus tap_ps per SPI_DLY tap when the software delay is enabled.
+ * Bytes sampled outside that eye are corrupted and counted.
+ */
+
+#define HOST_SPI0_BASE 0x04025000
+#define HOST_DMA_BASE  0x03002000
+#define HOST_DRAM_BASE 0x40000000
+#define HOST_DRAM_SIZE (128 << 20)
+
+struct spi_model_config {
+	uint32_t mmio_ns;		   /* CPU time of one peripheral register access */
+	uint32_t dma_burst_ns;	   /* DMAC time to move one burst to DRAM */
+	uint32_t sample_limit_hz;  /* Highest SCLK sampled correctly without SDC or delay taps */
+	uint32_t eye_loss_ps;	   /* Setup, hold and jitter lost from each bit period */
+	uint32_t tap_ps;		   /* One SPI_DLY delay chain tap */
+	uint64_t timeout_ms;	   /* Simulated time after which the run counts as hung */
+};
+
+struct spi_model_stats {
+	uint32_t	  sclk_hz;		   /* SCLK of the last exchange */
+	unsigned long xfers;		   /* Exchanges (CS low to CS high) */
+	unsigned long tx_bytes;		   /* Command, address and dummy bytes */
+	unsigned long rx_bytes;		   /* Bytes received into the RX FIFO */
+	uint64_t	  tx_cycles;	   /* SCLK cycles of the TX phase */
+	uint64_t	  rx_cycles;	   /* SCLK cycles of the RX phase */
+	uint64_t	  stall_ps;		   /* SCLK held on an empty TX or full RX FIFO */
+	unsigned long mmio_reads;	   /* CPU register reads, all peripherals */
+	unsigned long mmio_writes;	   /* CPU register writes, all peripherals */
+	unsigned long pio_bytes;	   /* RX bytes the CPU read from RXD */
+	unsigned long dma_bursts;	   /* DMAC bursts from the RX FIFO */
+	unsigned long dma_bytes;	   /* Bytes the DMAC moved */
+	unsigned long fifo_errors;	   /* TX overflow / RX underflow */
+	unsigned long busy_errors;	   /* Exchange started or FIFO reset while busy */
+	unsigned long sample_errors;   /* RX bytes sampled outside the data eye */
+	unsigned long dma_errors;	   /* Descriptors the model does not support */
+};
+
+void	 spi_model_default_config(struct spi_model_config *cfg);
+int		 spi_model_init(const struct spi_model_config *cfg);
+void	 spi_model_reset_stats(void);
+uint32_t spi_model_sclk_hz(void);
+
+const struct spi_model_stats *spi_model_stats(void);
+
+uint64_t sim_now_ps(void);
+void	 sim_advance_ps(uint64_t ps);
+void	 sim_set_hang_handler(void (*handler)(void));
+
+#endif
@@ -11,6 +11,12 @@
 
 #define BROM_PAGE_SIZE	2048
 
+/* boot1 header, boot0/application/boot_image.h */
+#define BOOT1_MAGIC		0x12345678
+#define BOOT1_HCRC		20 /* head_crc */
+#define BOOT1_PAGE		24 /* img_page */
+#define BOOT1_HEAD		28
+
 struct boot_head_t {
 	uint32_t instruction;
 	uint8_t	 magic[8];
@@ -25,20 +31,49 @@ struct boot_head_t {
 	uint32_t string_pool[13];
 };
 
+static uint32_t crc32_calc(uint32_t crc, const uint8_t *buf, uint32_t len)
+{
+	int i;
+
+	while (len--) {
+		crc ^= *buf++;
+		for (i = 0; i < 8; i++)
+			crc = (crc >> 1) ^ (0xedb88320 & -(crc & 1));
+	}
+
+	return crc;
+}
+
+static int is_boot1(const char *buffer, int buflen)
+{
+	return buflen > BOOT1_HEAD && le32_to_cpu(*(const uint32_t *)buffer) == BOOT1_MAGIC;
+}
+
 /*
  * BUG: the bootrom assumes all SPI flashes are 2KB page size.
  * If we want to boot from a device with larger page size, we need to adjust
  * the image in flash so that only the 1st 2KB of each page is used.
+ * A boot1 image records the page size in img_page for boot0, head_crc is
+ * sealed again; img_crc does not cover the header words past it.
  */
 static char* expand_pagesize(char *buffer, int *buflen, int pagesize)
 {
 	char				 *buffer2;
 	int					offset, multiple;
+	uint32_t			*w = (uint32_t *)buffer;
+	uint32_t			crc;
 
 	multiple = pagesize / BROM_PAGE_SIZE;
 
 	if (multiple == 1) return buffer;
 
+	if (is_boot1(buffer, *buflen)) {
+		w[BOOT1_PAGE / 4] = cpu_to_le32(pagesize);
+		crc = crc32_calc(0xffffffff, (uint8_t *)buffer, BOOT1_HCRC);
+		crc = crc32_calc(crc, (uint8_t *)buffer + BOOT1_HCRC + 4, BOOT1_HEAD - BOOT1_HCRC - 4) ^ 0xffffffff;
+		w[BOOT1_HCRC / 4] = cpu_to_le32(crc);
+	}
+
 	buffer2 = malloc(*buflen * multiple);
 	memset(buffer2, 0, *buflen * multiple);
 
@@ -112,6 +147,12 @@ int main(int argc, char *argv[])
 		return -1;
 	}
 
+	/* boot1 carries its own header and CRCs, only the page layout applies */
+	if (is_boot1(buffer, filelen)) {
+		l = filelen;
+		goto expand;
+	}
+
 	h = (struct boot_head_t *)buffer;
 	p = (uint32_t *)h;
 	l = le32_to_cpu(h->length);
@@ -124,6 +165,7 @@ int main(int argc, char *argv[])
 		sum += le32_to_cpu(p[i]);
 	h->checksum = cpu_to_le32(sum);
 
+expand:
 	buffer = expand_pagesize(buffer, &buflen, pagesize);
 
 	fseek(fp, 0L, SEEK_SET);
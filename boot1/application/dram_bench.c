@@ -0,0 +1,138 @@
+#include "board.h"
+#include "handoff.h"
+#include "dram_bench.h"
+
+#include "shell/shell.h"
+
+#define DRAM_BASE       0x40000000
+#define DRAM_MAP_END    0x50000000          /* board.c platform_mem_desc */
+#define DRAM_FREE       (HANDOFF_ADDR + 0x1000) /* boot1, its heap and the hand-off page sit below */
+
+#define MIN(a, b)       (((a) < (b)) ? (a) : (b))
+
+static void bench_fail(volatile uint32_t *p, uint32_t want, uint32_t got)
+{
+    s_printf("0x%08x reads 0x%08x, wrote 0x%08x\r\n", (unsigned int)p, (unsigned int)got, (unsigned int)want);
+}
+
+/* [base, base + size) from argv, or all free DRAM; 0 when the range is usable */
+static int bench_range(int argc, char **argv, unsigned int *base, unsigned int *size)
+{
+    const struct boot_handoff *handoff = handoff_get();
+    unsigned int end = DRAM_MAP_END;
+
+    if ((handoff != U_NULL) && (handoff->flags & HANDOFF_F_DRAM))
+    {
+        end = MIN(end, DRAM_BASE + handoff->dram_size);
+    }
+
+    if (argc == 1)
+    {
+        if ((handoff == U_NULL) || !(handoff->flags & HANDOFF_F_DRAM))
+        {
+            s_printf("DRAM size unknown, give base and size\r\n");
+            return -1;
+        }
+        *base = DRAM_FREE;
+        *size = end - DRAM_FREE;
+    }
+    else if ((argc != 3) || (xstrtol(argv[1], (int *)base) != 0) || (xstrtol(argv[2], (int *)size) != 0))
+    {
+        s_printf("usage: %s [base size]\r\n", argv[0]);
+        return -1;
+    }
+
+    /* 64 byte granules for the NEON kernels */
+    *size -= (((*base + 63) & ~63) - *base);
+    *base  = (*base + 63) & ~63;
+    *size &= ~63;
+
+    if ((*base < DRAM_FREE) || (*base >= end) || (*size == 0) || (*size > end - *base))
+    {
+        s_printf("range must lie in 0x%08x - 0x%08x\r\n", DRAM_FREE, end);
+        return -1;
+    }
+
+    return 0;
+}
+
+static unsigned long long bench_clock(void)
+{
+    return get_gtimer_count();
+}
+
+static int dram_bench(int argc, char **argv)
+{
+    struct dram_bench_speed s;
+    unsigned int base = 0;
+    unsigned int size = 0;
+
+    if (bench_range(argc, argv, &base, &size) != 0)
+    {
+        return -1;
+    }
+
+    s_printf("DRAM 0x%08x - 0x%08x:\r\n", base, base + size);
+    dram_bench_speed(base, size, bench_clock, &s);
+
+    /* Copy moves every byte twice over the bus, quoted as bytes copied */
+    s_printf("NEON %dKiB read  : %d MB/s\r\n", (unsigned int)s.len >> 10, (unsigned int)s.read_mbs);
+    s_printf("NEON %dKiB write : %d MB/s\r\n", (unsigned int)s.len >> 10, (unsigned int)s.write_mbs);
+    s_printf("NEON %dKiB copy  : %d MB/s\r\n", (unsigned int)s.len >> 10, (unsigned int)s.copy_mbs);
+    s_printf("random %dKiB load: %d.%d ns\r\n", (unsigned int)s.lat_len >> 10, (unsigned int)s.lat_ps / 1000,
+             (unsigned int)s.lat_ps % 1000 / 100);
+
+    return 0;
+}
+
+static struct shell_command dram_bench_cmd =
+{
+    .name = "dram_bench",
+    .desc = "DRAM bandwidth and latency [base size]",
+    .func = dram_bench,
+    .next = SHELL_NULL,
+};
+
+static int dram_test(int argc, char **argv)
+{
+    unsigned int base = 0;
+    unsigned int size = 0;
+    unsigned int fails = 0;
+    unsigned long long t = 0;
+
+    if (bench_range(argc, argv, &base, &size) != 0)
+    {
+        return -1;
+    }
+
+    s_printf("DRAM 0x%08x - 0x%08x:\r\n", base, base + size);
+    s_flush();
+
+    t = get_count_ms();
+    fails = dram_bench_patterns(base, size, bench_fail);
+    t = get_count_ms() - t;
+
+    if (fails != 0)
+    {
+        s_printf("walk / address / march: %d words FAILED\r\n", fails);
+        return -1;
+    }
+
+    s_printf("walk / address / march: OK in %d ms\r\n", (unsigned int)t);
+
+    return 0;
+}
+
+static struct shell_command dram_test_cmd =
+{
+    .name = "dram_test",
+    .desc = "DRAM walking bit, address and march test [base size]",
+    .func = dram_test,
+    .next = SHELL_NULL,
+};
+
+void dram_bench_register(void)
+{
+    shell_register_command(&dram_bench_cmd);
+    shell_register_command(&dram_test_cmd);
+}
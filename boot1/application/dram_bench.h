@@ -0,0 +1,17 @@
+#ifndef __DRAM_BENCH_H__
+#define __DRAM_BENCH_H__
+
+/*
+ * DRAM bandwidth / latency figures and pattern tests from the shell, the
+ * suite boot0 runs behind its CONFIG_DRAM_BENCH strap (boot0/application/dram_bench.c):
+ *   dram_bench [base size]  NEON read / write / copy MB/s, random load latency
+ *   dram_test  [base size]  walking bit, own address and March C- passes
+ * The range defaults to the DRAM above the hand-off page. The passes are
+ * boot0's, built here by dram_bench_core.c and libcpu/neon_bench_gcc.S.
+ */
+
+#include "../../boot0/boards/aw_boot_lib/dram_bench_core.h"
+
+void dram_bench_register(void);
+
+#endif /* __DRAM_BENCH_H__ */
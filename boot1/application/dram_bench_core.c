@@ -0,0 +1,5 @@
+/*
+ * Bandwidth, latency and pattern passes for dram_bench.c. The source is
+ * boot0's, so both loaders qualify DRAM with the same loops.
+ */
+#include "../../boot0/boards/aw_boot_lib/dram_bench_core.c"
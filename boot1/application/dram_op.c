@@ -0,0 +1,163 @@
+#include "board.h"
+#include "handoff.h"
+#include "drv_nand.h"
+#include "partition_port.h"
+#include "dram_op.h"
+
+#include "shell/shell.h"
+#include "partition/partition.h"
+
+#define DRAM_OP_PART    "boot0"
+#define DRAM_OP_END     PARTITION_TABLE_ADDR    /* Top of the boot0 partition, the record sits in the block below */
+
+extern struct spi_nand_handle nand;
+
+static unsigned int dram_op_crc32(const void *buf, unsigned int len)
+{
+    const unsigned char *p = (const unsigned char *)buf;
+    unsigned int crc = 0xffffffff;
+    int i = 0;
+
+    while (len--)
+    {
+        crc ^= *p++;
+        for (i = 0; i < 8; i++)
+        {
+            crc = (crc >> 1) ^ (0xedb88320 & -(crc & 1));
+        }
+    }
+
+    return ~crc;
+}
+
+static unsigned int dram_op_offset(void)
+{
+    return DRAM_OP_END - nand.info.page_size * nand.info.pages_per_block;
+}
+
+/* 0 when the stored record is intact */
+static int dram_op_read(struct dram_op_rec *rec)
+{
+    if (partition_read(DRAM_OP_PART, rec, dram_op_offset(), sizeof(struct dram_op_rec)) != 0)
+    {
+        return -1;
+    }
+
+    if ((rec->magic != DRAM_OP_MAGIC) || (rec->version != DRAM_OP_VER) ||
+        (dram_op_crc32(rec, sizeof(struct dram_op_rec) - 4) != rec->crc32))
+    {
+        return -1;
+    }
+
+    return 0;
+}
+
+/*
+ * Erase the record block, then write rec unless it is U_NULL. The block is
+ * inside the boot area nand_setup() write protects, the protection is
+ * lifted for the two operations only.
+ */
+static int dram_op_store(const struct dram_op_rec *rec)
+{
+    int ret = 0;
+
+    if (nand_boot_protect(&nand, 0) != 0)
+    {
+        return -1;
+    }
+
+    ret = partition_erase(DRAM_OP_PART, dram_op_offset(), nand.info.page_size * nand.info.pages_per_block);
+    if ((ret == 0) && (rec != U_NULL))
+    {
+        ret = partition_write(DRAM_OP_PART, (void *)rec, dram_op_offset(), sizeof(struct dram_op_rec));
+    }
+
+    if (nand_boot_protect(&nand, 1) != 0)
+    {
+        return -1;
+    }
+
+    return ret;
+}
+
+int dram_op_save(void)
+{
+    const struct boot_handoff *ho = handoff_get();
+    struct dram_op_rec rec;
+    struct dram_op_rec old;
+
+    if ((ho == U_NULL) || !(ho->flags & HANDOFF_F_TUNED))
+    {
+        return 0;
+    }
+
+    rec.magic      = DRAM_OP_MAGIC;
+    rec.version    = DRAM_OP_VER;
+    rec.clk        = ho->dram_clk;
+    rec.timing_pct = ho->dram_timing_pct;
+    rec.clk_min    = ho->dram_clk_min;
+    rec.clk_max    = ho->dram_clk_max;
+    rec.pct_min    = ho->dram_pct_min;
+    rec.crc32      = dram_op_crc32(&rec, sizeof(rec) - 4);
+
+    /* A repeated characterisation with the same outcome leaves the block alone */
+    if ((dram_op_read(&old) == 0) && (old.clk == rec.clk) && (old.timing_pct == rec.timing_pct))
+    {
+        return 0;
+    }
+
+    if (dram_op_store(&rec) != 0)
+    {
+        s_printf("DRAM point save failed\r\n");
+        return -1;
+    }
+
+    s_printf("DRAM point saved: %dMHz timing %d%%\r\n", rec.clk, rec.timing_pct);
+
+    return 0;
+}
+
+static int dram_op(int argc, char **argv)
+{
+    struct dram_op_rec rec;
+
+    if ((argc == 2) && (xstrcmp(argv[1], "clear") == 0))
+    {
+        if (dram_op_store(U_NULL) != 0)
+        {
+            s_printf("erase failed\r\n");
+            return -1;
+        }
+        s_printf("DRAM point cleared, defaults from the next boot\r\n");
+        return 0;
+    }
+    else if (argc != 1)
+    {
+        s_printf("usage: dram_op [clear]\r\n");
+        return -1;
+    }
+
+    if (dram_op_read(&rec) != 0)
+    {
+        s_printf("no stored DRAM point, defaults in use\r\n");
+        return 0;
+    }
+
+    s_printf("stored : %dMHz timing %d%%\r\n", rec.clk, rec.timing_pct);
+    s_printf("window : %d - %dMHz, %d%% at %dMHz\r\n", rec.clk_min, rec.clk_max, rec.pct_min, rec.clk);
+
+    return 0;
+}
+
+static struct shell_command dram_op_cmd =
+{
+    .name = "dram_op",
+    .desc = "show or clear the stored DRAM operating point [clear]",
+    .func = dram_op,
+    .next = SHELL_NULL,
+};
+
+void dram_op_register(void)
+{
+    shell_register_command(&dram_op_cmd);
+}
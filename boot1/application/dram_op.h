@@ -0,0 +1,33 @@
+#ifndef __DRAM_OP_H__
+#define __DRAM_OP_H__
+
+/*
+ * Write side of the per-board DRAM operating point boot0 reads before DRAM
+ * init (boot0/application/dram_tune.h). After a characterisation boot
+ * (HANDOFF_F_TUNED) the chosen point goes into the last block of the boot0
+ * partition, with the boot area write protection lifted for the update;
+ * dram_op shows it, "dram_op clear" drops it and the next boot trains at
+ * the built-in defaults again.
+ */
+
+#define DRAM_OP_MAGIC   0x504f5244      /* 'DROP' */
+#define DRAM_OP_VER     1
+
+struct dram_op_rec
+{
+    unsigned int magic;
+    unsigned int version;
+    unsigned int clk;                   /* MHz */
+    unsigned int timing_pct;            /* Spec ns timings scaled to this percent */
+    unsigned int clk_min;               /* Passing window the sweep found */
+    unsigned int clk_max;
+    unsigned int pct_min;
+    unsigned int crc32;                 /* Of the words above */
+};
+
+/* Store the point of a characterisation boot, after partition_nand_register() */
+int dram_op_save(void);
+
+void dram_op_register(void);
+
+#endif /* __DRAM_OP_H__ */
@@ -0,0 +1,101 @@
+#include "handoff.h"
+#include "drv_clk.h"
+#include "shell/shell.h"
+
+static unsigned int handoff_crc32(const void *buf, unsigned int len)
+{
+    const unsigned char *p = (const unsigned char *)buf;
+    unsigned int crc = 0xffffffff;
+    int i = 0;
+
+    while (len--)
+    {
+        crc ^= *p++;
+        for (i = 0; i < 8; i++)
+        {
+            crc = (crc >> 1) ^ (0xedb88320 & -(crc & 1));
+        }
+    }
+
+    return ~crc;
+}
+
+static unsigned int handoff_seal(struct boot_handoff *ho)
+{
+    unsigned int crc = 0;
+    unsigned int saved = ho->crc;
+
+    ho->crc = 0;
+    crc = handoff_crc32(ho, sizeof(struct boot_handoff));
+    ho->crc = saved;
+
+    return crc;
+}
+
+const struct boot_handoff *handoff_get(void)
+{
+    struct boot_handoff *ho = (struct boot_handoff *)HANDOFF_ADDR;
+
+    if ((ho->magic != HANDOFF_MAGIC) || (ho->version != HANDOFF_VERSION) ||
+        (ho->size != sizeof(struct boot_handoff)))
+    {
+        return U_NULL;
+    }
+
+    if (handoff_seal(ho) != ho->crc)
+    {
+        return U_NULL;
+    }
+
+    return ho;
+}
+
+/* Called right before jumping to the app: boot1 may have changed the clock tree */
+void handoff_update(void)
+{
+    struct boot_handoff *ho = (struct boot_handoff *)HANDOFF_ADDR;
+
+    if (handoff_get() == U_NULL)
+    {
+        return;
+    }
+
+    ho->pll_cpu     = drv_clk_get_pll_cpu();
+    ho->pll_peri_1x = drv_clk_get_pll_peri_1x();
+    ho->ahb         = drv_clk_get_ahbs_clk();
+    ho->apb0        = drv_clk_get_apb0_clk();
+    ho->apb1        = drv_clk_get_apb1_clk();
+    ho->flags      |= HANDOFF_F_CLK;
+
+    ho->ts_us[HANDOFF_TS_BOOT1] = (unsigned int)get_count_us();
+
+    ho->crc = handoff_seal(ho);
+}
+
+void handoff_dump(void)
+{
+    const struct boot_handoff *ho = handoff_get();
+
+    if (ho == U_NULL)
+    {
+        s_printf("no valid hand-off block at 0x%x\r\n", HANDOFF_ADDR);
+        return;
+    }
+
+    s_printf("hand-off v%d flags 0x%x\r\n", ho->version, ho->flags);
+    s_printf("DRAM           : %dMB %dMHz timing %d%%\r\n", ho->dram_size >> 20, ho->dram_clk, ho->dram_timing_pct);
+    if (ho->flags & HANDOFF_F_TUNED)
+    {
+        s_printf("DRAM window    : %d - %dMHz, %d%% at %dMHz\r\n", ho->dram_clk_min, ho->dram_clk_max,
+                 ho->dram_pct_min, ho->dram_clk);
+    }
+    s_printf("NAND ID        : %02x %04x\r\n", ho->nand_mfr, ho->nand_dev);
+    s_printf("NAND geometry  : %d+%d x %d x %d\r\n", ho->nand_page_size, ho->nand_spare_size,
+             ho->nand_pages_per_block, ho->nand_blocks);
+    s_printf("SPI            : %dHz mode %d tcr 0x%x dly 0x%x\r\n", ho->spi_clk, ho->spi_mode,
+             ho->spi_tcr, ho->spi_dly);
+    s_printf("boot0 -> DRAM  : %dus\r\n", ho->ts_us[HANDOFF_TS_DRAM] - ho->ts_us[HANDOFF_TS_BOOT0]);
+    s_printf("DRAM -> NAND   : %dus\r\n", ho->ts_us[HANDOFF_TS_NAND] - ho->ts_us[HANDOFF_TS_DRAM]);
+    s_printf("NAND -> boot1  : %dus\r\n", ho->ts_us[HANDOFF_TS_LOAD] - ho->ts_us[HANDOFF_TS_NAND]);
+    s_printf("boot1 entry at : %dus\r\n", ho->ts_us[HANDOFF_TS_LOAD]);
+}
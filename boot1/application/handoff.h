@@ -0,0 +1,74 @@
+#ifndef __HANDOFF_H__
+#define __HANDOFF_H__
+
+#include "board.h"
+
+/*
+ * boot0 -> boot1 -> application hand-off block, see boot0/application/handoff.h.
+ * boot0 leaves it at HANDOFF_ADDR with the clock tree, DRAM size, SPI NAND ID
+ * and geometry it found; boot1 uses it to skip re-detection, then refreshes
+ * the clock tree and its timestamp and re-seals it for the application.
+ */
+#define HANDOFF_ADDR    0x400ff000
+#define HANDOFF_MAGIC   0x46464f48 /* "HOFF" */
+#define HANDOFF_VERSION 2
+
+#define HANDOFF_F_CLK    (1 << 0)
+#define HANDOFF_F_DRAM   (1 << 1)
+#define HANDOFF_F_NAND   (1 << 2)
+#define HANDOFF_F_DIRECT (1 << 3) /* boot0 started the app itself, boot1 never ran */
+#define HANDOFF_F_TUNED  (1 << 4) /* DRAM characterised this boot, boot1 stores the operating point */
+
+enum
+{
+    HANDOFF_TS_BOOT0 = 0,   /* boot0 main() */
+    HANDOFF_TS_DRAM,        /* DRAM trained */
+    HANDOFF_TS_NAND,        /* SPI NAND detected */
+    HANDOFF_TS_LOAD,        /* boot1 (or the app, F_DIRECT) loaded, jumping */
+    HANDOFF_TS_BOOT1,       /* boot1 jumping to the app */
+    HANDOFF_TS_NUM,
+};
+
+struct boot_handoff
+{
+    unsigned int magic;
+    unsigned int version;
+    unsigned int size;
+    unsigned int crc;
+    unsigned int flags;
+
+    /* clock tree, Hz */
+    unsigned int pll_cpu;
+    unsigned int pll_peri_1x;
+    unsigned int ahb;
+    unsigned int apb0;
+    unsigned int apb1;
+
+    /* DRAM */
+    unsigned int dram_size;
+    unsigned int dram_clk;          /* MHz */
+    unsigned int dram_timing_pct;   /* ns timings scaled to this percent */
+    unsigned int dram_clk_min;      /* F_TUNED: passing clocks at spec timings */
+    unsigned int dram_clk_max;
+    unsigned int dram_pct_min;      /* F_TUNED: tightest timing passing at dram_clk */
+
+    /* SPI NAND */
+    unsigned int nand_mfr;
+    unsigned int nand_dev;
+    unsigned int nand_page_size;
+    unsigned int nand_spare_size;
+    unsigned int nand_pages_per_block;
+    unsigned int nand_blocks;
+    unsigned int spi_clk;
+    unsigned int spi_mode;
+    unsigned int spi_tcr;
+    unsigned int spi_dly;
+
+    unsigned int ts_us[HANDOFF_TS_NUM];
+};
+
+const struct boot_handoff *handoff_get(void);
+void handoff_update(void);
+void handoff_dump(void);
+
+#endif /* __HANDOFF_H__ */
@@ -4,6 +4,9 @@
 #include "drv_uart.h"
 #include "drv_iomux.h"
 #include "drv_clk.h"
+#include "handoff.h"
+#include "dram_bench.h"
+#include "dram_op.h"
 #include "shell_port.h"
 #include "partition_port.h"
 #include "ymodem_port.h"
@@ -103,15 +106,35 @@ struct spi_nand_handle nand =
 
 static int memfree(int argc, char **argv)
 {
+    unsigned int i       = 0;
     unsigned int total   = 0;
     unsigned int used    = 0;
     unsigned int maxused = 0;
+    struct rt_memheap_class info = {0};
 
     rt_memheap_info(&system_heap, &total, &used, &maxused);
 
-    s_printf("memheap info:\r\n");
+    s_printf("memheap info (%s):\r\n", RT_MEMHEAP_USING_TLSF ? "tlsf" : "first fit");
     s_printf("__memheap_start : 0x%08x\r\n__memheap_end   : 0x%08x\r\n", (unsigned int)HEAP_BEGIN, (unsigned int)HEAP_END);
     s_printf("total  : 0x%08x\r\nused   : 0x%08x\r\nmaxused: 0x%08x\r\n", total, used, maxused);
+    s_printf("largest free block : 0x%08x\r\n", rt_memheap_max_free(&system_heap));
+
+    s_printf("| class >=   | free blk | free size  | used blk | used size  |\r\n");
+    for (i = 0; i < RT_MEMHEAP_CLASS_NUM; i++)
+    {
+        if (rt_memheap_class_info(&system_heap, i, &info) != 0)
+        {
+            break;
+        }
+
+        if (info.free_blocks == 0 && info.used_blocks == 0)
+        {
+            continue;
+        }
+
+        s_printf("| 0x%08x | %8d | 0x%08x | %8d | 0x%08x |\r\n",
+                 info.min_size, info.free_blocks, info.free_size, info.used_blocks, info.used_size);
+    }
 
     return 0;
 }
@@ -162,6 +185,21 @@ static struct shell_command clk_cmd =
     .next = SHELL_NULL,
 };
 
+static int bootinfo(int argc, char **argv)
+{
+    handoff_dump();
+
+    return 0;
+}
+
+static struct shell_command bootinfo_cmd =
+{
+    .name = "bootinfo",
+    .desc = "show boot0 hand-off info",
+    .func = bootinfo,
+    .next = SHELL_NULL,
+};
+
 // static lfs_file_t file;
 
 // static int lfs_test(int argc, char **argv)
@@ -234,6 +272,8 @@ static int boot_app(int argc, char **argv)
     if (entry != U_NULL)
     {
         s_printf("entry addr 0x%x\r\n", entry);
+        handoff_update();
+        s_flush();
         mmu_disable();
         dcache_disable();
         icache_disable();
@@ -324,12 +364,24 @@ int main(void)
     int ret = 0;
     int count = 5;
     app_entry_t entry = U_NULL;
+    const struct boot_handoff *handoff = U_NULL;
+    struct spi_nand_info nand_info;
 
     interrupt_disable();
     interrupt_init();
     interrupt_enable();
 
-    drv_clk_init();
+    /* boot0 already set up clocks and the NAND, trust its hand-off block when it is intact */
+    handoff = handoff_get();
+
+    if ((handoff != U_NULL) && (handoff->flags & HANDOFF_F_CLK))
+    {
+        drv_clk_resume(handoff->pll_cpu, handoff->ahb, handoff->apb0, handoff->apb1);
+    }
+    else
+    {
+        drv_clk_init();
+    }
 
     (void)shell_register();
 
@@ -345,7 +397,23 @@ int main(void)
         s_printf("memheap init failed\r\n");
     }
 
-    ret = nand_init(&nand);
+    ret = -1;
+    if ((handoff != U_NULL) && (handoff->flags & HANDOFF_F_NAND))
+    {
+        nand_info.id.mfr_id       = handoff->nand_mfr;
+        nand_info.id.dev_id       = handoff->nand_dev;
+        nand_info.page_size       = handoff->nand_page_size;
+        nand_info.spare_size      = handoff->nand_spare_size;
+        nand_info.pages_per_block = handoff->nand_pages_per_block;
+        nand_info.blocks_total    = handoff->nand_blocks;
+
+        ret = nand_attach(&nand, &nand_info);
+    }
+
+    if (ret != 0)
+    {
+        ret = nand_init(&nand);
+    }
     if (ret != 0)
     {
         s_printf("nand init failed\r\n");
@@ -356,6 +424,10 @@ int main(void)
     {
         s_printf("partition nand register failed\r\n");
     }
+    else
+    {
+        (void)dram_op_save();
+    }
 
     // ret = drv_lfs_mount();
     // if (ret != 0)
@@ -365,11 +437,14 @@ int main(void)
 
     shell_register_command(&free_cmd);
     shell_register_command(&clk_cmd);
+    shell_register_command(&bootinfo_cmd);
     // shell_register_command(&lfs_cmd);
     shell_register_command(&ota_download_cmd);
     shell_register_command(&ota_boot_cmd);
     shell_register_command(&ota_update_cmd);
     shell_register_command(&ota_backup_cmd);
+    dram_bench_register();
+    dram_op_register();
 
     s_printf("Press any key to procee shell ");
     while(count)
@@ -396,6 +471,8 @@ int main(void)
     if (entry != U_NULL)
     {
         s_printf("entry addr 0x%x\r\n", entry);
+        handoff_update();
+        s_flush();
         mmu_disable();
         dcache_disable();
         icache_disable();
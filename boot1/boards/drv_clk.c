@@ -341,3 +341,33 @@ void drv_clk_init(void)
     /* init advanced peripheral buses (APB1) 24MHz */
     init_apb1_clk(24000000);
 }
+
+/*
+ * Bring the tree to the drv_clk_init() rates when the previous stage already
+ * set part of it up: only the domains whose handed-over rate differs are
+ * reprogrammed, so PLL_CPU is not relocked and the CPU not switched to PLL_PERI.
+ */
+void drv_clk_resume(unsigned int pll_cpu, unsigned int ahb, unsigned int apb0, unsigned int apb1)
+{
+    if (pll_cpu != 1200000000)
+    {
+        init_pll_cpu(1200000000);
+    }
+
+    init_pll_peri();
+
+    if (ahb != 200000000)
+    {
+        init_ahb_clk(200000000);
+    }
+
+    if (apb0 != 200000000)
+    {
+        init_apb0_clk(200000000);
+    }
+
+    if (apb1 != 24000000)
+    {
+        init_apb1_clk(24000000);
+    }
+}
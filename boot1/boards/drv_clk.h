@@ -77,6 +77,7 @@
 #define CCU_MMC_BGR_SMHC2_RST (1 << 18)
 
 void drv_clk_init(void);
+void drv_clk_resume(unsigned int pll_cpu, unsigned int ahb, unsigned int apb0, unsigned int apb1);
 unsigned int drv_clk_get_pll_cpu(void);
 unsigned int drv_clk_get_pll_peri_1x(void);
 unsigned int drv_clk_get_pll_peri_2x(void);
@@ -270,7 +270,8 @@ static int nand_exec_program(struct spi_nand_handle *nand, unsigned int page)
     return 0;
 }
 
-int nand_init(struct spi_nand_handle *nand)
+/* Write protect blocks 0~15 (the 2M boot area), or lift it around a deliberate write there */
+int nand_boot_protect(struct spi_nand_handle *nand, int enable)
 {
     int ret = 0;
     unsigned char val;
@@ -280,43 +281,32 @@ int nand_init(struct spi_nand_handle *nand)
         return -1;
     }
 
-    ret = spi_init(&nand->nand_spi);
+    ret = nand_get_feature(nand, SR_ADDR_PROTECT, &val);
     if (ret != 0)
     {
         return ret;
     }
-
-    ret = nand_reset(nand);
-    if (ret != 0)
+    val &= ~(0x1f << 2);
+    if (enable)
     {
-        return ret;
+        val |= (1 << 2) | (0 << 6) | (1 << 5) | (0 << 4) | (1 << 3); /* protect 2M block 0~15 page 0~960 */
     }
 
-    ret = nand_wait_while_busy(nand);
-    if (ret != 0)
-    {
-        return ret;
-    }
+    return nand_set_feature(nand, SR_ADDR_PROTECT, val);
+}
 
-    ret = nand_get_id(nand);
-    if (ret != 0)
-    {
-        return ret;
-    }
+/* protect and config setup boot1 expects, on top of whatever the chip was left in */
+static int nand_setup(struct spi_nand_handle *nand)
+{
+    int ret = 0;
+    unsigned char val;
 
     if ((nand->info.id.mfr_id != 0xcd) || (nand->info.id.dev_id != 0x7272))
     {
         return -1;
     }
 
-    ret = nand_get_feature(nand, SR_ADDR_PROTECT, &val);
-    if (ret != 0)
-    {
-        return ret;
-    }
-    val &= ~(0x1f << 2);
-    val |= (1 << 2) | (0 << 6) | (1 << 5) | (0 << 4) | (1 << 3); /* protect 2M block 0~15 page 0~960 */
-    ret = nand_set_feature(nand, SR_ADDR_PROTECT, val);
+    ret = nand_boot_protect(nand, 1);
     if (ret != 0)
     {
         return ret;
@@ -344,6 +334,48 @@ int nand_init(struct spi_nand_handle *nand)
         }
     }
 
+    return 0;
+}
+
+int nand_init(struct spi_nand_handle *nand)
+{
+    int ret = 0;
+
+    if (nand == U_NULL)
+    {
+        return -1;
+    }
+
+    ret = spi_init(&nand->nand_spi);
+    if (ret != 0)
+    {
+        return ret;
+    }
+
+    ret = nand_reset(nand);
+    if (ret != 0)
+    {
+        return ret;
+    }
+
+    ret = nand_wait_while_busy(nand);
+    if (ret != 0)
+    {
+        return ret;
+    }
+
+    ret = nand_get_id(nand);
+    if (ret != 0)
+    {
+        return ret;
+    }
+
+    ret = nand_setup(nand);
+    if (ret != 0)
+    {
+        return ret;
+    }
+
     nand->info.page_size       = 2048;
     nand->info.spare_size      = 64;
     nand->info.pages_per_block = 64;
@@ -352,6 +384,44 @@ int nand_init(struct spi_nand_handle *nand)
     return 0;
 }
 
+/* Take over a chip the previous stage already reset and identified, no reset/ID round trip */
+int nand_attach(struct spi_nand_handle *nand, const struct spi_nand_info *info)
+{
+    int ret = 0;
+
+    if ((nand == U_NULL) || (info == U_NULL))
+    {
+        return -1;
+    }
+
+    if ((info->page_size == 0) || (info->pages_per_block == 0) || (info->blocks_total == 0))
+    {
+        return -1;
+    }
+
+    ret = spi_init(&nand->nand_spi);
+    if (ret != 0)
+    {
+        return ret;
+    }
+
+    ret = nand_wait_while_busy(nand);
+    if (ret != 0)
+    {
+        return ret;
+    }
+
+    nand->info = *info;
+
+    ret = nand_setup(nand);
+    if (ret != 0)
+    {
+        return ret;
+    }
+
+    return 0;
+}
+
 int nand_deinit(struct spi_nand_handle *nand)
 {
     int ret = 0;
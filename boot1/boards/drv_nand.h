@@ -28,11 +28,13 @@ struct spi_nand_handle
 };
 
 int nand_init(struct spi_nand_handle *nand);
+int nand_attach(struct spi_nand_handle *nand, const struct spi_nand_info *info);
 int nand_deinit(struct spi_nand_handle *nand);
 int nand_page_read(struct spi_nand_handle *nand, unsigned int page, unsigned int offset,
     unsigned char *data, unsigned int len);
 int nand_page_write(struct spi_nand_handle *nand, unsigned int page, unsigned int offset,
     unsigned char *data, unsigned int len);
 int nand_erase_page(struct spi_nand_handle *nand, unsigned int page);
+int nand_boot_protect(struct spi_nand_handle *nand, int enable);
 
 #endif
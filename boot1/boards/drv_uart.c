@@ -127,12 +127,31 @@ static int _uart_init(struct uart_handle *uart)
     return 0;
 }
 
+static void uart_tx_fill(struct uart_handle *uart)
+{
+    struct uart_tx_fifo *tx = &uart->tx_fifo;
+
+    /* USR bit1: transmit fifo not full */
+    while ((tx->get_index != tx->put_index) && (read32(uart->base + REG_UART_USR) & (0x1 << 1)))
+    {
+        write32(uart->base + REG_UART_THR, tx->buffer[tx->get_index & (UART_SOFT_TX_FIFO_SIZE - 1)]);
+        tx->get_index += 1;
+    }
+}
+
 static void uart_irq_handler(int irqno, void *param)
 {
     unsigned int i = 0;
     unsigned int rx_len = 0;
+    unsigned int val = 0;
     struct uart_handle *uart = (struct uart_handle *)param;
 
+    /* busy detect, read usr to clear it */
+    if ((read32(uart->base + REG_UART_IIR) & 0xf) == 0x7)
+    {
+        (void)read32(uart->base + REG_UART_USR);
+    }
+
     /* get fifo level */
     rx_len = read32(uart->base + REG_UART_RFL);
     if (rx_len > 0)
@@ -163,6 +182,19 @@ static void uart_irq_handler(int irqno, void *param)
             uart_recv_callback(param);
         }
     }
+
+    /* drain tx ring only while THRE irq is armed, uart_flush() owns it otherwise */
+    val = read32(uart->base + REG_UART_IER);
+    if (val & (0x1 << 1))
+    {
+        uart_tx_fill(uart);
+
+        if (uart->tx_fifo.get_index == uart->tx_fifo.put_index)
+        {
+            val &= ~(0x1 << 1);
+            write32(uart->base + REG_UART_IER, val);
+        }
+    }
 }
 
 int uart_init(struct uart_handle *uart)
@@ -185,6 +217,9 @@ int uart_init(struct uart_handle *uart)
     uart->fifo.get_index = 0;
     uart->fifo.is_full = 0;
 
+    uart->tx_fifo.put_index = 0;
+    uart->tx_fifo.get_index = 0;
+
     interrupt_install(uart->irq, uart_irq_handler, uart);
     interrupt_umask(uart->irq);
 
@@ -205,9 +240,11 @@ int uart_deinit(struct uart_handle *uart)
         return -1;
     }
 
+    (void)uart_flush(uart);
+
     /* disable irq */
     val = read32(uart->base + REG_UART_IER);
-    val &= ~((0x1 << 0) | (0x1 << 2));
+    val &= ~((0x1 << 0) | (0x1 << 1) | (0x1 << 2));
     write32(uart->base + REG_UART_IER, val);
     interrupt_mask(uart->irq);
 
@@ -274,3 +311,99 @@ int uart_bind_recv_callback(void (*callback)(void *param))
 
     return 0;
 }
+
+/*
+ * queue len bytes into the tx ring, the THRE irq drains it in the background.
+ * when the ring is full the caller drains it by polling, so this also works
+ * with irqs disabled. a uart that stops draining costs the queued bytes, not
+ * a hang: after a bounded wait the ring is dropped like uart_flush() does.
+ */
+int uart_write(struct uart_handle *uart, const char *buf, unsigned int len)
+{
+    unsigned int i = 0;
+    unsigned int val = 0;
+    unsigned long long start = 0;
+    struct uart_tx_fifo *tx = U_NULL;
+
+    if (uart == U_NULL || buf == U_NULL)
+    {
+        return -1;
+    }
+
+    tx = &uart->tx_fifo;
+
+    for (i = 0; i < len; i++)
+    {
+        if ((tx->put_index - tx->get_index) >= UART_SOFT_TX_FIFO_SIZE)
+        {
+            /* ring full, take it over from the irq and make room */
+            val = read32(uart->base + REG_UART_IER);
+            write32(uart->base + REG_UART_IER, val & ~(0x1 << 1));
+
+            start = get_count_us();
+            while ((tx->put_index - tx->get_index) > (UART_SOFT_TX_FIFO_SIZE - UART_HW_TX_FIFO_SIZE))
+            {
+                uart_tx_fill(uart);
+
+                /* two hw fifos worth at ~87us per byte, the uart is stuck */
+                if ((get_count_us() - start) > UART_HW_TX_FIFO_SIZE * 2 * 100)
+                {
+                    tx->get_index = tx->put_index;
+                    break;
+                }
+            }
+        }
+
+        tx->buffer[tx->put_index & (UART_SOFT_TX_FIFO_SIZE - 1)] = buf[i];
+        tx->put_index += 1;
+    }
+
+    /* arm THRE irq, it fires at once if the tx fifo is already empty */
+    val = read32(uart->base + REG_UART_IER);
+    val |= (0x1 << 1);
+    write32(uart->base + REG_UART_IER, val);
+
+    return (int)len;
+}
+
+/*
+ * synchronously drain the tx ring and wait until the last bit has left the
+ * shifter. safe with irqs disabled, use it before jumping away or in traps.
+ */
+int uart_flush(struct uart_handle *uart)
+{
+    unsigned int val = 0;
+    unsigned long long start = 0;
+
+    if (uart == U_NULL)
+    {
+        return -1;
+    }
+
+    val = read32(uart->base + REG_UART_IER);
+    write32(uart->base + REG_UART_IER, val & ~(0x1 << 1));
+
+    start = get_count_us();
+    while (uart->tx_fifo.get_index != uart->tx_fifo.put_index)
+    {
+        uart_tx_fill(uart);
+
+        /* ~87us per byte at 115200, give up if the uart is stuck */
+        if ((get_count_us() - start) > (UART_SOFT_TX_FIFO_SIZE + UART_HW_TX_FIFO_SIZE) * 100)
+        {
+            uart->tx_fifo.get_index = uart->tx_fifo.put_index;
+            return -1;
+        }
+    }
+
+    /* LSR bit6: transmitter empty */
+    while (!(read32(uart->base + REG_UART_LSR) & (0x1 << 6)))
+    {
+        if ((get_count_us() - start) > (UART_SOFT_TX_FIFO_SIZE + UART_HW_TX_FIFO_SIZE) * 100)
+        {
+            return -1;
+        }
+    }
+
+    return 0;
+}
@@ -37,6 +37,8 @@
 #define REG_UART_HALT   0X00A4
 
 #define UART_SOFT_FIFO_SIZE    2048
+#define UART_SOFT_TX_FIFO_SIZE 4096     /* must be a power of 2 */
+#define UART_HW_TX_FIFO_SIZE   64
 
 enum uart_id
 {
@@ -99,6 +101,13 @@ struct rt_uart_rx_fifo
     int          is_full;
 };
 
+struct uart_tx_fifo
+{
+    char                  buffer[UART_SOFT_TX_FIFO_SIZE];
+    volatile unsigned int put_index;    /* written by thread context only */
+    volatile unsigned int get_index;    /* written by THRE irq or flush only */
+};
+
 struct uart_handle
 {
     /* user define */
@@ -111,12 +120,15 @@ struct uart_handle
 
     /* private */
     struct rt_uart_rx_fifo fifo;
+    struct uart_tx_fifo    tx_fifo;
 };
 
 int uart_init(struct uart_handle *uart);
 int uart_deinit(struct uart_handle *uart);
 int uart_putc(struct uart_handle *uart, char c);
 int uart_getc(struct uart_handle *uart);
+int uart_write(struct uart_handle *uart, const char *buf, unsigned int len);
+int uart_flush(struct uart_handle *uart);
 int uart_bind_recv_callback(void (*callback)(void *param));
 
 #endif /* __DRV_UART_H__ */
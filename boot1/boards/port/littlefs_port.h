@@ -5,7 +5,7 @@
 #include "drv_nand.h"
 #include "lfs.h"
 
-#define PAGE_OFFSET_OF_NAND     2560    /* block_start: 40 block_end 72 */
+#define PAGE_OFFSET_OF_NAND     2624    /* block_start: 41 block_end 73, "LittleFs" partition */
 
 extern lfs_t nand_lfs;
 
@@ -328,6 +328,8 @@ int partition_nand_register(void)
 {
     char *dev_name = "nand_flash";
     int ret = 0;
+    unsigned int addr = 0;
+    unsigned int block_size = nand.info.pages_per_block * nand.info.page_size;
 
     ret = partition_device_register(dev_name, &partition_nand_ops, nand.info.blocks_total * nand.info.pages_per_block * nand.info.page_size);
     if (ret != 0)
@@ -335,17 +337,35 @@ int partition_nand_register(void)
         return -1;
     }
 
-    ret  = partition_register("boot0",    dev_name, 0 * 2048,    512 * 2048); /* 2M first boot           */
-    ret += partition_register("boot1",    dev_name, 512 * 2048,  512 * 2048); /* 2M second boot/ota      */
-    ret += partition_register("APP1",     dev_name, 1024 * 2048, 512 * 2048); /* 2M application img 1    */
-    ret += partition_register("APP2",     dev_name, 1536 * 2048, 512 * 2048); /* 2M application img 2    */
-    ret += partition_register("Download", dev_name, 2048 * 2048, 512 * 2048); /* 2M application download */
-    ret += partition_register("Param",    dev_name, 2560 * 2048,  60 * 2048); /* ota parameters */
-    // ret += partition_register("LittleFs",    dev_name, 2560 * 2048, 2024 * 2048);
+    /* Factory images carry the layout, the first valid copy wins */
+    ret = PARTITION_ERR_CHECK;
+    for (addr = PARTITION_TABLE_ADDR; addr < PARTITION_TABLE_ADDR + PARTITION_TABLE_SIZE; addr += block_size)
+    {
+        ret = partition_table_load(dev_name, addr);
+        if (ret == PARTITION_OK)
+        {
+            break;
+        }
+    }
 
-    if (ret != 0)
+    if (ret != PARTITION_OK)
     {
-        return -1;
+        s_printf("no partition table on flash, using built in layout\r\n");
+
+        ret  = partition_register("boot0",    dev_name, 0 * 2048,    256 * 2048); /* 512K first boot         */
+        ret += partition_register("ptable",   dev_name, 256 * 2048,  256 * 2048); /* 512K partition table    */
+        ret += partition_register("boot1",    dev_name, 512 * 2048,  512 * 2048); /* 1M second boot/ota      */
+        ret += partition_register("APP1",     dev_name, 1024 * 2048, 512 * 2048); /* 1M application img 1    */
+        ret += partition_register("APP2",     dev_name, 1536 * 2048, 512 * 2048); /* 1M application img 2    */
+        ret += partition_register("Download", dev_name, 2048 * 2048, 512 * 2048); /* 1M application download */
+        ret += partition_register("Param",    dev_name, 2560 * 2048,  60 * 2048); /* ota parameters          */
+        ret += partition_register("LittleFs", dev_name, 2624 * 2048, 2048 * 2048); /* 4M littlefs            */
+        ret += partition_register("Param2",   dev_name, 4672 * 2048,  60 * 2048); /* second ota parameters   */
+
+        if (ret != 0)
+        {
+            return -1;
+        }
     }
 
     show_partition_info();
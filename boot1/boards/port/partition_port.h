@@ -3,6 +3,13 @@
 
 #include "partition/partition.h"
 
+/*
+ * On-flash partition table written by tool/mk_nand.c, one copy at the start of
+ * every good block of this range. Must match the "ptable" line of tool/nand_layout.txt.
+ */
+#define PARTITION_TABLE_ADDR    (256 * 2048)    /* After boot0, block 4 */
+#define PARTITION_TABLE_SIZE    (256 * 2048)    /* 4 blocks, up to boot1 */
+
 int partition_nand_register(void);
 
 #endif
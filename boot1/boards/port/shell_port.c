@@ -16,7 +16,17 @@ static const char *start_logo =
 
 static void shell_uart_putc(char c)
 {
-    uart_putc(&uart0, c);
+    uart_write(&uart0, &c, 1);
+}
+
+static void shell_uart_write(const char *buf, unsigned int len)
+{
+    uart_write(&uart0, buf, len);
+}
+
+static void shell_uart_flush(void)
+{
+    uart_flush(&uart0);
 }
 
 static char shell_uart_getc(void)
@@ -37,6 +47,8 @@ static shell_port_t shell_port =
 {
     .shell_putchar = shell_uart_putc,
     .shell_getchar = shell_uart_getc,
+    .shell_write   = shell_uart_write,
+    .shell_flush   = shell_uart_flush,
 };
 
 int shell_register(void)
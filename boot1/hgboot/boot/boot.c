@@ -8,6 +8,7 @@
  * SPDX-License-Identifier: MIT
  **************************************************************************/
 
+#include <stdint.h>
 #include "boot.h"
 
 #define HGBOOT_NULL     0
@@ -92,6 +93,164 @@ unsigned int boot_crc32_update(unsigned int crc, const unsigned char *data, unsi
     return crc;
 }
 
+/*
+ * Function: boot_zero_fill
+ * ------------------------
+ * Clears a zero-fill range with word stores, eight per loop, the way the
+ * application startup clears .bss.
+ */
+static void boot_zero_fill(unsigned char *dst, unsigned int len)
+{
+    unsigned int *word = HGBOOT_NULL;
+
+    while ((len > 0) && (((unsigned long)dst & 0x3) != 0))
+    {
+        *dst++ = 0;
+        len--;
+    }
+
+    word = (unsigned int *)dst;
+    while (len >= 32)
+    {
+        word[0] = 0;
+        word[1] = 0;
+        word[2] = 0;
+        word[3] = 0;
+        word[4] = 0;
+        word[5] = 0;
+        word[6] = 0;
+        word[7] = 0;
+        word += 8;
+        len  -= 32;
+    }
+
+    dst = (unsigned char *)word;
+    while (len > 0)
+    {
+        *dst++ = 0;
+        len--;
+    }
+}
+
+/*
+ * Function: boot_load_flat
+ * ------------------------
+ * Loads a flat image (seg_count == 0) to header->load_addr and checks the CRC32
+ * of the loaded bytes against the one recorded for the slot.
+ *
+ * Returns:
+ *   BOOT_OK on success, BOOT_ERR_READ on read error, BOOT_ERR_CHECK on CRC mismatch.
+ */
+static int boot_load_flat(const char *part_name, const struct firmware_header *header, unsigned int expect_crc)
+{
+    int ret            = 0;
+    unsigned int crc32 = 0xffffffff;
+
+    ret = partition_read(part_name, (void *)(uintptr_t)header->load_addr, sizeof(struct firmware_header), header->size);
+    if (ret != 0)
+    {
+        BOOT_WARN("boot read partition %s from offset %d err. %d\r\n", part_name, sizeof(struct firmware_header), ret);
+        return BOOT_ERR_READ;
+    }
+
+    crc32  = boot_crc32_update(crc32, (unsigned char *)(uintptr_t)header->load_addr, header->size);
+    crc32 ^= 0xffffffff;
+
+    if (crc32 != expect_crc)
+    {
+        BOOT_WARN("boot check firmware crc32 err. 0x%x != 0x%x\r\n", crc32, expect_crc);
+        return BOOT_ERR_CHECK;
+    }
+
+    return BOOT_OK;
+}
+
+/*
+ * Function: boot_load_segments
+ * ----------------------------
+ * Loads a scatter-load image: reads the segment table, then only the file-backed
+ * bytes of each segment to its load address, checks each segment's CRC32 and
+ * clears the zero-fill tail instead of reading it from flash.
+ *
+ * Returns:
+ *   BOOT_OK on success, BOOT_ERR_READ on read error, BOOT_ERR_CHECK on a bad table or CRC mismatch.
+ */
+static int boot_load_segments(const char *part_name, const struct firmware_header *header)
+{
+    int ret                                   = 0;
+    unsigned int i                            = 0;
+    unsigned int offset                       = 0;
+    unsigned int table_size                   = 0;
+    unsigned int crc32                        = 0xffffffff;
+    struct firmware_segment seg[OTA_SEG_MAX];
+
+    if (header->seg_count > OTA_SEG_MAX)
+    {
+        BOOT_WARN("boot firmware has %d segments, max %d\r\n", header->seg_count, OTA_SEG_MAX);
+        return BOOT_ERR_CHECK;
+    }
+
+    table_size = header->seg_count * sizeof(struct firmware_segment);
+    offset     = sizeof(struct firmware_header);
+
+    ret = partition_read(part_name, (void *)seg, offset, table_size);
+    if (ret != 0)
+    {
+        BOOT_WARN("boot read partition %s from offset %d err. %d\r\n", part_name, offset, ret);
+        return BOOT_ERR_READ;
+    }
+
+    crc32  = boot_crc32_update(crc32, (unsigned char *)seg, table_size);
+    crc32 ^= 0xffffffff;
+    if (crc32 != header->seg_crc32)
+    {
+        BOOT_WARN("boot check segment table crc32 err. 0x%x != 0x%x\r\n", crc32, header->seg_crc32);
+        return BOOT_ERR_CHECK;
+    }
+
+    offset += table_size;
+    for (i = 0; i < header->seg_count; i++)
+    {
+        BOOT_INFO("boot segment %d : addr 0x%08x file 0x%08x mem 0x%08x flags 0x%x\r\n",
+                  i, seg[i].load_addr, seg[i].file_size, seg[i].mem_size, seg[i].flags);
+
+        if ((seg[i].mem_size < seg[i].file_size) ||
+            (offset - sizeof(struct firmware_header) + seg[i].file_size > header->size))
+        {
+            BOOT_WARN("boot segment %d out of range\r\n", i);
+            return BOOT_ERR_CHECK;
+        }
+
+        if (seg[i].file_size > 0)
+        {
+            ret = partition_read(part_name, (void *)(uintptr_t)seg[i].load_addr, offset, seg[i].file_size);
+            if (ret != 0)
+            {
+                BOOT_WARN("boot read partition %s from offset %d err. %d\r\n", part_name, offset, ret);
+                return BOOT_ERR_READ;
+            }
+
+            crc32  = 0xffffffff;
+            crc32  = boot_crc32_update(crc32, (unsigned char *)(uintptr_t)seg[i].load_addr, seg[i].file_size);
+            crc32 ^= 0xffffffff;
+            if (crc32 != seg[i].crc32)
+            {
+                BOOT_WARN("boot check segment %d crc32 err. 0x%x != 0x%x\r\n", i, crc32, seg[i].crc32);
+                return BOOT_ERR_CHECK;
+            }
+
+            offset += seg[i].file_size;
+        }
+
+        if (seg[i].flags & OTA_SEG_ZERO_FILL)
+        {
+            boot_zero_fill((unsigned char *)(uintptr_t)(seg[i].load_addr + seg[i].file_size), seg[i].mem_size - seg[i].file_size);
+        }
+    }
+
+    return BOOT_OK;
+}
+
 /*
  * Function: boot_firmware
  * -----------------------
@@ -100,8 +259,8 @@ unsigned int boot_crc32_update(unsigned int crc, const unsigned char *data, unsi
  * This function reads OTA parameters from the parameter partition to determine which firmware slot is active.
  * It then reads the firmware header and verifies its magic number and CRC32 checksum.
  * If verification fails, it attempts to backup/rollback the firmware and retries up to BOOT_MAX_RETRY times.
- * If all checks pass, it loads the firmware into memory, verifies the CRC32 of the loaded image,
- * and returns the firmware's execution address. If any step fails after all retries, it returns HGBOOT_NULL.
+ * If all checks pass, it loads the firmware into memory (flat, or segment by segment with zero-fill
+ * for scatter-load images), verifies the CRC32 of what was loaded, and returns the firmware's execution address. If any step fails after all retries, it returns HGBOOT_NULL.
  *
  * Returns:
  *   void* - The execution address of the firmware on success, or HGBOOT_NULL on failure.
@@ -114,29 +273,13 @@ void *boot_firmware(void)
     struct ota_paramers para      = {0};
     unsigned int retry            = BOOT_MAX_RETRY;
     unsigned int temp_crc32       = 0;
-    unsigned int crc32            = 0xffffffff;
 
     do
     {
-        ret = partition_read(PARA_PART, (void *)&para, 0, sizeof(struct ota_paramers));
+        ret = ota_param_load(&para);
         if (ret != 0)
         {
-            BOOT_WARN("boot read partition %s from offset %d err. %d\r\n", PARA_PART, 0, ret);
-            retry--;
-            continue;
-        }
-
-        BOOT_INFO("boot read partition %s info : para.magic         0x%08x\r\n", PARA_PART, para.magic);
-        BOOT_INFO("boot read partition %s info : para.active_slot   0x%08x\r\n", PARA_PART, para.active_slot);
-        BOOT_INFO("boot read partition %s info : para.can_be_back   0x%08x\r\n", PARA_PART, para.can_be_back);
-        BOOT_INFO("boot read partition %s info : para.upgrade_ready 0x%08x\r\n", PARA_PART, para.upgrade_ready);
-        BOOT_INFO("boot read partition %s info : para.app1_crc      0x%08x\r\n", PARA_PART, para.app1_crc);
-        BOOT_INFO("boot read partition %s info : para.app2_crc      0x%08x\r\n", PARA_PART, para.app2_crc);
-        BOOT_INFO("boot read partition %s info : para.download_crc  0x%08x\r\n", PARA_PART, para.download_crc);
-
-        if (para.magic != OTA_PARA_MAGIC)
-        {
-            BOOT_WARN("boot read ota parameter magic err. 0x%x != 0x%x\r\n", para.magic, OTA_PARA_MAGIC);
+            BOOT_WARN("boot read ota parameter err. %d\r\n", ret);
             retry--;
             continue;
         }
@@ -197,21 +340,23 @@ void *boot_firmware(void)
             continue;
         }
 
-        ret = partition_read(part_name, (void *)header.load_addr, sizeof(struct firmware_header), header.size);
-        if (ret != 0)
+        if (header.seg_count == 0)
+        {
+            ret = boot_load_flat(part_name, &header, temp_crc32);
+        }
+        else
+        {
+            ret = boot_load_segments(part_name, &header);
+        }
+
+        if (ret == BOOT_ERR_READ)
         {
-            BOOT_WARN("boot read partition %s from offset %d err. %d\r\n", part_name, sizeof(struct firmware_header), ret);
             retry--;
             continue;
         }
 
-        crc32  = 0xffffffff;
-        crc32  = boot_crc32_update(crc32, (unsigned char *)header.load_addr, header.size);
-        crc32 ^= 0xffffffff;
-
-        if (crc32 != temp_crc32)
+        if (ret != BOOT_OK)
         {
-            BOOT_WARN("boot check firmware crc32 err. 0x%x != 0x%x\r\n", crc32, temp_crc32);
             BOOT_TRACE("boot try to backup firmware\r\n");
             ret = ota_backup_firmware();
             if (ret != 0)
@@ -225,7 +370,7 @@ void *boot_firmware(void)
 
         BOOT_INFO("boot finish. firmware exec addr is 0x%x\r\n", header.exec_addr);
 
-        return (void *)header.exec_addr;
+        return (void *)(uintptr_t)header.exec_addr;
 
     } while(retry > 0);
 
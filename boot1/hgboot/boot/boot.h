@@ -17,6 +17,17 @@
 /* Set the current boot log level */
 #define BOOT_LOG_LEVEL    BOOT_LOG_ERROR    /* Current log level for boot process */
 
+/**
+ * @enum boot_errcode_t
+ * Boot error codes for loading the firmware image.
+ */
+typedef enum
+{
+    BOOT_OK             =  0,   /* Operation successful */
+    BOOT_ERR_READ       = -1,   /* Partition read failed, worth a retry */
+    BOOT_ERR_CHECK      = -2,   /* Image check failed (CRC, segment table), needs a rollback */
+} boot_errcode_t;
+
 void *boot_firmware(void);
 
 #endif /* __BOOT_H__ */
@@ -38,11 +38,31 @@ static char shell_getc_port(void)
     return ch;
 }
 
+/* shell_write_port: shell output buffer interface, optional. s_printf hands over a whole rendered line here (e.g. queue to a TX ring).*/
+static void shell_write_port(const char *buf, unsigned int len)
+{
+    unsigned int i = 0;
+    /* TODO: Implement buffered output, falls back to per character output here */
+    for (i = 0; i < len; i++)
+    {
+        shell_putc_port(buf[i]);
+    }
+}
+
+/* shell_flush_port: shell output flush interface, optional. Must return only after all queued output is sent, also with irqs disabled.*/
+static void shell_flush_port(void)
+{
+    /* TODO: Implement synchronous drain of buffered output */
+    return;
+}
+
 /* shell_port: shell port structure, binds input/output interfaces.*/
 static shell_port_t shell_port =
 {
     .shell_putchar = shell_putc_port,
     .shell_getchar = shell_getc_port,
+    .shell_write   = shell_write_port,
+    .shell_flush   = shell_flush_port,
 };
 
 /* ymodem_putchar_port: ymodem output single character interface, user should implement low-level output.*/
@@ -133,11 +153,12 @@ int hgboot_init(void)
         return ret;
     }
 
-    /* Register partitions: APP1, APP2, Download, Param */
+    /* Register partitions: APP1, APP2, Download, Param, Param2 */
     ret += partition_register("APP1",     dev_name, 0 * 1024 * 1024, 1 * 1024 * 1024); /* 1M for firmware 1         */
     ret += partition_register("APP2",     dev_name, 1 * 1024 * 1024, 1 * 1024 * 1024); /* 1M for firmware 2         */
     ret += partition_register("Download", dev_name, 2 * 1024 * 1024, 1 * 1024 * 1024); /* 1M for firmware download  */
     ret += partition_register("Param",    dev_name, 3 * 1024 * 1024, 64 * 1024);       /* 64K for ota parameters    */
+    ret += partition_register("Param2",   dev_name, 3 * 1024 * 1024 + 64 * 1024, 64 * 1024); /* 64K second record */
 
     if (ret != 0)
     {
@@ -0,0 +1,568 @@
+/***************************************************************************
+ * Copyright (c) 2025 HGBOOT Authors
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the MIT License which is available at
+ * https://opensource.org/licenses/MIT.
+ *
+ * SPDX-License-Identifier: MIT
+ **************************************************************************/
+
+#define _GNU_SOURCE
+
+#include "host_port.h"
+#include "drv_nand.h"
+
+#include "shell/shell.h"
+#include "ymodem/ymodem.h"
+#include "partition/partition.h"
+
+#include <fcntl.h>
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <termios.h>
+#include <unistd.h>
+
+#ifndef MAP_FIXED_NOREPLACE
+#define MAP_FIXED_NOREPLACE 0x100000
+#endif
+
+static const char *hgboot_host_logo =
+"                                                     \r\n\
+  _    _  _____        ____   ____   ____ _______     \r\n\
+ | |  | |/ ____|      |  _ \\ / __ \\ / __ \\__   __| \r\n\
+ | |__| | |  __ ______| |_) | |  | | |  | | | |       \r\n\
+ |  __  | | |_ |______|  _ <| |  | | |  | | | |       \r\n\
+ | |  | | |__| |      | |_) | |__| | |__| | | |       \r\n\
+ |_|  |_|\\_____|      |____/ \\____/ \\____/  |_|    \r\n\
+ version:V1.0.0 (host)\r\n";
+
+static struct termios stdin_saved;
+static int stdin_raw = 0;
+
+static int ymodem_fd = -1;
+static int ymodem_slave_fd = -1;
+
+static struct nand_sim *host_nand = NAND_SIM_NULL;
+static unsigned char *cache_erase = NAND_SIM_NULL;
+
+/* application/main.c's handle, the geometry is all application code reads from it */
+struct spi_nand_handle nand;
+
+/**
+ * @brief Map the board DRAM window at its physical address, so firmware
+ *        headers with absolute load_addr can be loaded unchanged.
+ * @return 0 on success, -1 on failure.
+ */
+int host_dram_map(void)
+{
+    void *addr = MAP_FAILED;
+
+    addr = mmap((void *)HOST_DRAM_BASE, HOST_DRAM_SIZE, PROT_READ | PROT_WRITE,
+                MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE | MAP_FIXED_NOREPLACE, -1, 0);
+    if (addr == MAP_FAILED)
+    {
+        perror("host dram map");
+        return -1;
+    }
+
+    if (addr != (void *)HOST_DRAM_BASE)
+    {
+        /* Kernel without MAP_FIXED_NOREPLACE took it as a hint only */
+        munmap(addr, HOST_DRAM_SIZE);
+        fprintf(stderr, "host dram map: 0x%lx is in use\n", HOST_DRAM_BASE);
+        return -1;
+    }
+
+    return 0;
+}
+
+static void host_stdin_restore(void)
+{
+    if (stdin_raw)
+    {
+        tcsetattr(STDIN_FILENO, TCSANOW, &stdin_saved);
+        stdin_raw = 0;
+    }
+}
+
+static void shell_putc_port(char ch)
+{
+    fputc(ch, stdout);
+}
+
+static char shell_getc_port(void)
+{
+    char ch = 0;
+
+    fflush(stdout);
+
+    if (read(STDIN_FILENO, &ch, 1) != 1)
+    {
+        /* End of a piped script */
+        exit(0);
+    }
+
+    return ch;
+}
+
+static void shell_write_port(const char *buf, unsigned int len)
+{
+    fwrite(buf, 1, len, stdout);
+}
+
+static void shell_flush_port(void)
+{
+    fflush(stdout);
+}
+
+static shell_port_t shell_port =
+{
+    .shell_putchar = shell_putc_port,
+    .shell_getchar = shell_getc_port,
+    .shell_write   = shell_write_port,
+    .shell_flush   = shell_flush_port,
+};
+
+/**
+ * @brief Bind the shell to stdin/stdout. A terminal is switched to raw mode
+ *        so line editing and history behave as on the board UART.
+ * @return 0 on success, -1 on failure.
+ */
+int host_shell_init(void)
+{
+    struct termios raw;
+
+    if (isatty(STDIN_FILENO) && tcgetattr(STDIN_FILENO, &stdin_saved) == 0)
+    {
+        raw = stdin_saved;
+        raw.c_lflag &= ~(ICANON | ECHO);
+        raw.c_cc[VMIN]  = 1;
+        raw.c_cc[VTIME] = 0;
+
+        if (tcsetattr(STDIN_FILENO, TCSANOW, &raw) == 0)
+        {
+            stdin_raw = 1;
+            atexit(host_stdin_restore);
+        }
+    }
+
+    return shell_init(&shell_port, hgboot_host_logo);
+}
+
+static void ymodem_putchar_port(char ch)
+{
+    if (write(ymodem_fd, &ch, 1) != 1)
+    {
+        perror("ymodem write");
+    }
+}
+
+static int ymodem_getchar_port(char *ch, unsigned int timeout)
+{
+    struct pollfd pfd = {0};
+
+    pfd.fd     = ymodem_fd;
+    pfd.events = POLLIN;
+
+    if (poll(&pfd, 1, (int)timeout) <= 0)
+    {
+        return -1;
+    }
+
+    if (read(ymodem_fd, ch, 1) != 1)
+    {
+        return -1;
+    }
+
+    return 0;
+}
+
+static ymdoem_port_t ymodem_port =
+{
+    .ymodem_putchar = ymodem_putchar_port,
+    .ymodem_getchar = ymodem_getchar_port,
+};
+
+/**
+ * @brief Create a pseudo terminal for ymodem, the slave side plays the board
+ *        UART for sz/minicom or the built in sender.
+ * @param slave_name Output buffer for the slave device path.
+ * @param name_len   Size of slave_name.
+ * @return 0 on success, -1 on failure.
+ */
+int host_ymodem_open_pty(char *slave_name, unsigned int name_len)
+{
+    struct termios tio;
+    char *name = NAND_SIM_NULL;
+
+    ymodem_fd = posix_openpt(O_RDWR | O_NOCTTY);
+    if (ymodem_fd < 0 || grantpt(ymodem_fd) != 0 || unlockpt(ymodem_fd) != 0)
+    {
+        perror("ymodem pty");
+        return -1;
+    }
+
+    name = ptsname(ymodem_fd);
+    if (name == NAND_SIM_NULL || strlen(name) >= name_len)
+    {
+        return -1;
+    }
+    strcpy(slave_name, name);
+
+    /* Keep the slave open so the master never sees a hangup between senders */
+    ymodem_slave_fd = open(slave_name, O_RDWR | O_NOCTTY);
+    if (ymodem_slave_fd < 0 || tcgetattr(ymodem_slave_fd, &tio) != 0)
+    {
+        perror(slave_name);
+        return -1;
+    }
+
+    cfmakeraw(&tio);
+    tcsetattr(ymodem_slave_fd, TCSANOW, &tio);
+
+    return ymodem_init(&ymodem_port);
+}
+
+/**
+ * @brief Close the ymodem pseudo terminal.
+ */
+void host_ymodem_close(void)
+{
+    if (ymodem_slave_fd >= 0)
+    {
+        close(ymodem_slave_fd);
+        ymodem_slave_fd = -1;
+    }
+
+    if (ymodem_fd >= 0)
+    {
+        close(ymodem_fd);
+        ymodem_fd = -1;
+    }
+}
+
+static int nand_page_read(unsigned int page, unsigned int offset, unsigned char *buf, unsigned int len)
+{
+    int ret = 0;
+
+    ret = nand_sim_read(host_nand, page, offset, buf, len);
+    if (ret == NAND_SIM_ECC_FIXED)
+    {
+        ret = NAND_SIM_OK;
+    }
+
+    return ret;
+}
+
+static int nand_page_write(unsigned int page, unsigned int offset, unsigned char *buf, unsigned int len)
+{
+    return nand_sim_program(host_nand, page, offset, buf, len);
+}
+
+static int nand_erase_page(unsigned int page)
+{
+    return nand_sim_erase(host_nand, page / host_nand->cfg.pages_per_block);
+}
+
+/**
+ * @brief boards/drv_nand.c nand_boot_protect(): the first HOST_BOOT_PROTECT_SIZE
+ *        bytes refuse program and erase while protected.
+ * @param handle Ignored, there is one simulated chip.
+ * @param enable Nonzero to protect, 0 to lift the protection.
+ * @return 0.
+ */
+int nand_boot_protect(struct spi_nand_handle *handle, int enable)
+{
+    (void)handle;
+
+    host_nand->protect_blocks = enable ? HOST_BOOT_PROTECT_SIZE / (host_nand->cfg.page_size * host_nand->cfg.pages_per_block) : 0;
+
+    return 0;
+}
+
+/*
+ * The partition ops below follow boards/port/partition_port.c one to one, so
+ * host runs exercise (and benchmark) the same page access pattern as the board.
+ */
+static int partition_nand_init(void)
+{
+    return 0;
+}
+
+static int partition_nand_read(unsigned int addr, unsigned char *buf, unsigned int size)
+{
+    int ret = 0;
+    unsigned char *read_buf = NAND_SIM_NULL;
+    unsigned int read_size = 0;
+    unsigned int page = 0;
+    unsigned int offset = 0;
+    unsigned int page_size = host_nand->cfg.page_size;
+
+    if (((addr + size) > (page_size * host_nand->cfg.pages_per_block * host_nand->cfg.blocks_total)) || (buf == NAND_SIM_NULL))
+    {
+        return -1;
+    }
+
+    page   = addr / page_size;
+    offset = addr % page_size;
+    read_size = size;
+    read_buf = buf;
+
+    while (read_size != 0)
+    {
+        if ((offset + read_size) > page_size)
+        {
+            ret = nand_page_read(page, offset, read_buf, page_size - offset);
+            if (ret != 0)
+            {
+                return ret;
+            }
+            read_size -= (page_size - offset);
+            read_buf += (page_size - offset);
+            page++;
+            offset = 0;
+        }
+        else
+        {
+            ret = nand_page_read(page, offset, read_buf, read_size);
+            if (ret != 0)
+            {
+                return ret;
+            }
+            read_size = 0;
+        }
+    }
+
+    return ret;
+}
+
+static int partition_nand_write(unsigned int addr, unsigned char  *buf, unsigned int size)
+{
+    int ret = 0;
+    unsigned char *write_buf = NAND_SIM_NULL;
+    unsigned int write_size = 0;
+    unsigned int page = 0;
+    unsigned int offset = 0;
+    unsigned int page_size = host_nand->cfg.page_size;
+
+    if (((addr + size) > (page_size * host_nand->cfg.pages_per_block * host_nand->cfg.blocks_total)) || (buf == NAND_SIM_NULL))
+    {
+        return -1;
+    }
+
+    page   = addr / page_size;
+    offset = addr % page_size;
+    write_size = size;
+    write_buf = buf;
+
+    while (write_size != 0)
+    {
+        if ((offset + write_size) > page_size)
+        {
+            ret = nand_page_write(page, offset, write_buf, page_size - offset);
+            if (ret != 0)
+            {
+                return ret;
+            }
+            write_size -= (page_size - offset);
+            write_buf += (page_size - offset);
+            page++;
+            offset = 0;
+        }
+        else
+        {
+            ret = nand_page_write(page, offset, write_buf, write_size);
+            if (ret != 0)
+            {
+                return ret;
+            }
+            write_size = 0;
+        }
+    }
+
+    return 0;
+}
+
+static int partition_nand_erase(unsigned int addr, unsigned int size)
+{
+    int ret = 0;
+    unsigned int i = 0;
+    unsigned int page_size = host_nand->cfg.page_size;
+    unsigned int pages_per_block = host_nand->cfg.pages_per_block;
+    unsigned int block_size = 0;
+    unsigned int total_size = 0;
+    unsigned int erase_start = 0;
+    unsigned int erase_end = 0;
+    unsigned int blk = 0;
+    unsigned int block_start_index = 0;
+    unsigned int block_end_index = 0;
+    unsigned int blk_start_addr = 0;
+    unsigned int blk_end_addr = 0;
+    unsigned int offset = 0;
+    unsigned int length = 0;
+    unsigned char *buffer_ptr = NAND_SIM_NULL;
+
+    block_size = pages_per_block * page_size;
+    total_size = host_nand->cfg.blocks_total * block_size;
+
+    if ((addr + size) > total_size)
+    {
+        return -1;
+    }
+
+    erase_start = addr;
+    erase_end = addr + size;
+
+    block_start_index = erase_start / block_size;
+    block_end_index   = (erase_end - 1) / block_size;
+
+    for (blk = block_start_index; blk <= block_end_index; blk++)
+    {
+        blk_start_addr = blk * block_size;
+        blk_end_addr   = blk_start_addr + block_size;
+
+        offset = (erase_start > blk_start_addr) ? (erase_start - blk_start_addr) : 0;
+
+        if (erase_end < blk_end_addr)
+        {
+            length = erase_end - (blk_start_addr + offset);
+        }
+        else
+        {
+            length = blk_end_addr - (blk_start_addr + offset);
+        }
+
+        if ((offset == 0) && (length == block_size))
+        {
+            ret = nand_erase_page(blk * pages_per_block);
+            if (ret != 0)
+            {
+                return -1;
+            }
+        }
+        else
+        {
+            buffer_ptr = cache_erase;
+
+            for (i = 0; i < pages_per_block; i++)
+            {
+                ret = nand_page_read(blk * pages_per_block + i, 0, buffer_ptr, page_size);
+                if (ret != 0)
+                {
+                    return -1;
+                }
+
+                buffer_ptr += page_size;
+            }
+
+            ret = nand_erase_page(blk * pages_per_block);
+            if (ret != 0)
+            {
+                return -1;
+            }
+
+            memset(cache_erase + offset, 0xFF, length);
+
+            buffer_ptr = cache_erase;
+
+            for (i = 0; i < pages_per_block; i++)
+            {
+                ret = nand_page_write(blk * pages_per_block + i, 0, buffer_ptr, page_size);
+                if (ret != 0)
+                {
+                    return -1;
+                }
+
+                buffer_ptr += page_size;
+            }
+        }
+    }
+
+    return 0;
+}
+
+static struct partition_dev_ops partition_nand_ops =
+{
+    .init = partition_nand_init,
+    .read = partition_nand_read,
+    .write = partition_nand_write,
+    .erase = partition_nand_erase,
+};
+
+/**
+ * @brief Register the simulated NAND and the board partition table
+ *        (boards/port/partition_port.c).
+ * @param sim Opened simulator instance, may be reopened later in place.
+ * @return 0 on success, -1 on failure.
+ */
+int host_partition_register(struct nand_sim *sim)
+{
+    char *dev_name = "nand_flash";
+    int ret = 0;
+
+    host_nand = sim;
+
+    nand.info.page_size       = sim->cfg.page_size;
+    nand.info.spare_size      = sim->cfg.spare_size;
+    nand.info.pages_per_block = sim->cfg.pages_per_block;
+    nand.info.blocks_total    = sim->cfg.blocks_total;
+
+    cache_erase = malloc((size_t)sim->cfg.page_size * sim->cfg.pages_per_block);
+    if (cache_erase == NAND_SIM_NULL)
+    {
+        return -1;
+    }
+
+    ret = partition_device_register(dev_name, &partition_nand_ops,
+                                    sim->cfg.blocks_total * sim->cfg.pages_per_block * sim->cfg.page_size);
+    if (ret != 0)
+    {
+        return -1;
+    }
+
+    return host_partition_load();
+}
+
+/**
+ * @brief Apply the on-flash partition table, or the built in layout of
+ *        boards/port/partition_port.c when the device carries none. Called
+ *        again after a factory image was written to pick up its layout.
+ * @return 0 on success, -1 on failure.
+ */
+int host_partition_load(void)
+{
+    char *dev_name = "nand_flash";
+    unsigned int block_size = host_nand->cfg.pages_per_block * host_nand->cfg.page_size;
+    unsigned int addr = 0;
+    int ret = PARTITION_ERR_CHECK;
+
+    for (addr = HOST_PARTITION_TABLE_ADDR; addr < HOST_PARTITION_TABLE_ADDR + HOST_PARTITION_TABLE_SIZE; addr += block_size)
+    {
+        ret = partition_table_load(dev_name, addr);
+        if (ret == PARTITION_OK)
+        {
+            return 0;
+        }
+    }
+
+    /* LittleFs is left out, it does not fit the small selftest geometry and nothing here mounts it, Param2 takes its place */
+    ret  = partition_register("boot0",    dev_name, 0 * 2048,    256 * 2048); /* 512K first boot         */
+    ret += partition_register("ptable",   dev_name, 256 * 2048,  256 * 2048); /* 512K partition table    */
+    ret += partition_register("boot1",    dev_name, 512 * 2048,  512 * 2048); /* 1M second boot/ota      */
+    ret += partition_register("APP1",     dev_name, 1024 * 2048, 512 * 2048); /* 1M application img 1    */
+    ret += partition_register("APP2",     dev_name, 1536 * 2048, 512 * 2048); /* 1M application img 2    */
+    ret += partition_register("Download", dev_name, 2048 * 2048, 512 * 2048); /* 1M application download */
+    ret += partition_register("Param",    dev_name, 2560 * 2048,  60 * 2048); /* ota parameters          */
+    ret += partition_register("Param2",   dev_name, 2624 * 2048,  60 * 2048); /* second ota parameters   */
+
+    if (ret != 0)
+    {
+        return -1;
+    }
+
+    return 0;
+}
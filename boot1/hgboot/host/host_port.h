@@ -0,0 +1,23 @@
+#ifndef __HOST_PORT_H__
+#define __HOST_PORT_H__
+
+#include "nand_sim.h"
+
+#define HOST_DRAM_BASE   0x40000000UL /* Board DRAM base, firmware load_addr points in here */
+#define HOST_DRAM_SIZE   0x08000000UL /* 128M, same as the board */
+
+#define HOST_PARTITION_TABLE_ADDR (256 * 2048) /* boards/port/partition_port.h PARTITION_TABLE_ADDR */
+#define HOST_PARTITION_TABLE_SIZE (256 * 2048) /* boards/port/partition_port.h PARTITION_TABLE_SIZE */
+#define HOST_BOOT_PROTECT_SIZE    (2 * 1024 * 1024) /* boards/drv_nand.c nand_boot_protect(), blocks 0~15 */
+
+int  host_dram_map(void);
+
+int  host_shell_init(void);
+
+int  host_ymodem_open_pty(char *slave_name, unsigned int name_len);
+void host_ymodem_close(void);
+
+int  host_partition_register(struct nand_sim *sim);
+int  host_partition_load(void);
+
+#endif /* __HOST_PORT_H__ */
@@ -0,0 +1,1322 @@
+/***************************************************************************
+ * Copyright (c) 2025 HGBOOT Authors
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the MIT License which is available at
+ * https://opensource.org/licenses/MIT.
+ *
+ * SPDX-License-Identifier: MIT
+ **************************************************************************/
+
+#define _GNU_SOURCE
+
+#include "host_port.h"
+#include "nand_sim.h"
+#include "ymodem_send.h"
+#include "drv_nand.h"
+#include "handoff.h"
+#include "dram_op.h"
+
+#include "shell/shell.h"
+#include "ota/ota.h"
+#include "boot/boot.h"
+
+#include <fcntl.h>
+#include <getopt.h>
+#include <setjmp.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+#define HOST_IMAGE_DEFAULT  "hgboot_nand.img"
+#define HOST_FW_LOAD_ADDR   0x40100000U   /* DRAM origin of application/link_m.lds */
+#define HOST_FW_TEST_SIZE   (200 * 1024)  /* Payload size of the selftest images */
+
+extern unsigned int boot_crc32_update(unsigned int crc, const unsigned char *data, unsigned int len);
+
+static struct nand_sim nand;
+static struct nand_sim_config nand_cfg;
+static const char *image_path = HOST_IMAGE_DEFAULT;
+static char pty_name[128];
+
+static jmp_buf power_cut_jmp;
+static int power_cut_armed = 0;
+
+static struct boot_handoff host_handoff;
+
+/* ------------------------------------------------------------------------ */
+/* helpers                                                                  */
+/* ------------------------------------------------------------------------ */
+
+/* application/handoff.c checks the block boot0 leaves in DRAM, the host hands out its own */
+const struct boot_handoff *handoff_get(void)
+{
+    return (host_handoff.magic == HANDOFF_MAGIC) ? &host_handoff : NULL;
+}
+
+static double host_now_ms(void)
+{
+    struct timespec ts = {0};
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return (double)ts.tv_sec * 1e3 + (double)ts.tv_nsec / 1e6;
+}
+
+static double host_sim_ms(void)
+{
+    return (double)(nand.stats.busy_ns + nand.stats.bus_ns) / 1e6;
+}
+
+static unsigned char *host_read_file(const char *path, unsigned int *size)
+{
+    FILE *fp = NULL;
+    unsigned char *buf = NULL;
+    long len = 0;
+
+    fp = fopen(path, "rb");
+    if (fp == NULL)
+    {
+        perror(path);
+        return NULL;
+    }
+
+    fseek(fp, 0, SEEK_END);
+    len = ftell(fp);
+    fseek(fp, 0, SEEK_SET);
+
+    buf = malloc(len > 0 ? (size_t)len : 1);
+    if (buf != NULL && fread(buf, 1, (size_t)len, fp) != (size_t)len)
+    {
+        free(buf);
+        buf = NULL;
+    }
+
+    fclose(fp);
+    *size = (unsigned int)len;
+
+    return buf;
+}
+
+/* Build a packed image in the pack.py format: header + payload. */
+static unsigned char *host_make_firmware(unsigned int version, unsigned int payload_size, unsigned int *size)
+{
+    struct firmware_header *header = NULL;
+    unsigned char *buf = NULL;
+    unsigned char *payload = NULL;
+    unsigned int i = 0;
+    unsigned int x = version * 2654435761U + 1;
+
+    buf = malloc(sizeof(struct firmware_header) + payload_size);
+    if (buf == NULL)
+    {
+        return NULL;
+    }
+
+    payload = buf + sizeof(struct firmware_header);
+    for (i = 0; i < payload_size; i++)
+    {
+        x = x * 1103515245U + 12345U;
+        payload[i] = (unsigned char)(x >> 16);
+    }
+
+    header            = (struct firmware_header *)buf;
+    memset(header, 0, sizeof(*header));
+    header->magic     = OTA_FIRMWARE_MAGIC;
+    header->size      = payload_size;
+    header->crc32     = boot_crc32_update(0xFFFFFFFF, payload, payload_size) ^ 0xFFFFFFFF;
+    header->version   = version;
+    header->load_addr = HOST_FW_LOAD_ADDR;
+    header->exec_addr = HOST_FW_LOAD_ADDR;
+
+    *size = sizeof(struct firmware_header) + payload_size;
+
+    return buf;
+}
+
+/*
+ * Build a scatter-load image the way pack.py lays out an ELF: two file backed
+ * segments with a hole between them, the second one with a zero-fill tail.
+ */
+#define HOST_SEG0_ADDR      HOST_FW_LOAD_ADDR
+#define HOST_SEG0_SIZE      (16 * 1024)
+#define HOST_SEG1_ADDR      (HOST_FW_LOAD_ADDR + 0x10000U)
+#define HOST_SEG1_SIZE      (3 * 1024 + 6)
+#define HOST_SEG1_ZERO      (40 * 1024 + 2)
+
+static unsigned char *host_make_segmented(unsigned int version, int bad_seg_crc, unsigned int *size)
+{
+    struct firmware_header *header = NULL;
+    struct firmware_segment *seg = NULL;
+    unsigned char *buf = NULL;
+    unsigned char *data = NULL;
+    unsigned int payload = 0;
+    unsigned int i = 0;
+    unsigned int x = version * 2654435761U + 1;
+
+    payload = 2 * sizeof(struct firmware_segment) + HOST_SEG0_SIZE + HOST_SEG1_SIZE;
+    buf = malloc(sizeof(struct firmware_header) + payload);
+    if (buf == NULL)
+    {
+        return NULL;
+    }
+
+    seg  = (struct firmware_segment *)(buf + sizeof(struct firmware_header));
+    data = (unsigned char *)&seg[2];
+    for (i = 0; i < HOST_SEG0_SIZE + HOST_SEG1_SIZE; i++)
+    {
+        x = x * 1103515245U + 12345U;
+        data[i] = (unsigned char)(x >> 16);
+    }
+
+    seg[0].load_addr = HOST_SEG0_ADDR;
+    seg[0].file_size = HOST_SEG0_SIZE;
+    seg[0].mem_size  = HOST_SEG0_SIZE;
+    seg[0].flags     = 0;
+    seg[0].crc32     = boot_crc32_update(0xFFFFFFFF, data, HOST_SEG0_SIZE) ^ 0xFFFFFFFF;
+    seg[1].load_addr = HOST_SEG1_ADDR;
+    seg[1].file_size = HOST_SEG1_SIZE;
+    seg[1].mem_size  = HOST_SEG1_SIZE + HOST_SEG1_ZERO;
+    seg[1].flags     = OTA_SEG_ZERO_FILL;
+    seg[1].crc32     = boot_crc32_update(0xFFFFFFFF, data + HOST_SEG0_SIZE, HOST_SEG1_SIZE) ^ 0xFFFFFFFF;
+
+    if (bad_seg_crc)
+    {
+        seg[1].crc32 ^= 1;
+    }
+
+    header            = (struct firmware_header *)buf;
+    memset(header, 0, sizeof(*header));
+    header->magic     = OTA_FIRMWARE_MAGIC;
+    header->size      = payload;
+    header->crc32     = boot_crc32_update(0xFFFFFFFF, (unsigned char *)seg, payload) ^ 0xFFFFFFFF;
+    header->version   = version;
+    header->load_addr = HOST_SEG0_ADDR;
+    header->exec_addr = HOST_SEG0_ADDR;
+    header->seg_count = 2;
+    header->seg_crc32 = boot_crc32_update(0xFFFFFFFF, (unsigned char *)seg, 2 * sizeof(struct firmware_segment)) ^ 0xFFFFFFFF;
+
+    *size = sizeof(struct firmware_header) + payload;
+
+    return buf;
+}
+
+/* Check what a boot of host_make_segmented() left in DRAM, holes must stay untouched. */
+static int host_check_segmented(const unsigned char *fw)
+{
+    const unsigned char *data = fw + sizeof(struct firmware_header) + 2 * sizeof(struct firmware_segment);
+    const unsigned char *ram = (const unsigned char *)(unsigned long)HOST_SEG0_ADDR;
+    unsigned int end = HOST_SEG1_ADDR + HOST_SEG1_SIZE + HOST_SEG1_ZERO - HOST_SEG0_ADDR;
+    unsigned int i = 0;
+
+    if (memcmp(ram, data, HOST_SEG0_SIZE) != 0 ||
+        memcmp(ram + HOST_SEG1_ADDR - HOST_SEG0_ADDR, data + HOST_SEG0_SIZE, HOST_SEG1_SIZE) != 0)
+    {
+        return 0;
+    }
+
+    for (i = HOST_SEG0_SIZE; i < HOST_SEG1_ADDR - HOST_SEG0_ADDR; i++)
+    {
+        if (ram[i] != 0xAA)
+        {
+            return 0;
+        }
+    }
+
+    for (i = HOST_SEG1_ADDR + HOST_SEG1_SIZE - HOST_SEG0_ADDR; i < end; i++)
+    {
+        if (ram[i] != 0x00)
+        {
+            return 0;
+        }
+    }
+
+    return ram[end] == 0xAA;
+}
+
+/*
+ * Stage a partition table with a good CRC whose second entry overlaps the
+ * first (overlap) or repeats its name (!overlap) at offset 0 of Download,
+ * which the factory layout places at 0x400000.
+ * Returns 0 on success, -1 on failure.
+ */
+static int host_stage_bad_ptable(int overlap)
+{
+    struct
+    {
+        partition_table_header_t header;
+        partition_table_entry_t entry[2];
+    } table;
+
+    memset(&table, 0, sizeof(table));
+    table.header.magic   = PARTITION_TABLE_MAGIC;
+    table.header.version = PARTITION_TABLE_VERSION;
+    table.header.count   = 2;
+    strcpy(table.entry[0].name, "APP1");
+    table.entry[0].start = 0x200000;
+    table.entry[0].size  = 0x100000;
+    strcpy(table.entry[1].name, overlap ? "Swap" : "APP1");
+    table.entry[1].start = overlap ? 0x280000 : 0x300000;
+    table.entry[1].size  = 0x100000;
+    table.header.crc32   = boot_crc32_update(0xFFFFFFFF, (const unsigned char *)&table, sizeof(table)) ^ 0xFFFFFFFF;
+
+    if (partition_erase("Download", 0, nand.cfg.page_size * nand.cfg.pages_per_block) != 0 ||
+        partition_write("Download", &table, 0, sizeof(table)) != 0)
+    {
+        return -1;
+    }
+
+    return 0;
+}
+
+static void host_power_cut(struct nand_sim *sim)
+{
+    (void)sim;
+
+    if (power_cut_armed)
+    {
+        power_cut_armed = 0;
+        longjmp(power_cut_jmp, 1);
+    }
+}
+
+/* Simulated reboot: reopen the image with fault injection of the cut disarmed. */
+static int host_reopen(void)
+{
+    struct nand_sim_config cfg = nand.cfg;
+
+    cfg.power_cut_after = 0;
+
+    nand_sim_close(&nand);
+    if (nand_sim_open(&nand, image_path, &cfg) != NAND_SIM_OK)
+    {
+        return -1;
+    }
+    nand.power_cut = host_power_cut;
+
+    return 0;
+}
+
+/*
+ * Receive a firmware over the pty. With data set, a forked child plays the
+ * PC side using the built in sender, otherwise an external tool (sz --ymodem,
+ * minicom, ...) is expected on the printed pty.
+ */
+static int host_download(const unsigned char *data, unsigned int size)
+{
+    pid_t pid = 0;
+    int status = 0;
+    int ret = 0;
+    int fd = -1;
+
+    if (data == NULL)
+    {
+        printf("waiting for ymodem sender on %s\n", pty_name);
+        fflush(stdout);
+        return ota_download_firmware();
+    }
+
+    fflush(stdout);
+    pid = fork();
+    if (pid < 0)
+    {
+        perror("fork");
+        return -1;
+    }
+
+    if (pid == 0)
+    {
+        fd = open(pty_name, O_RDWR | O_NOCTTY);
+        if (fd < 0)
+        {
+            _exit(2);
+        }
+        _exit(ymodem_send_fd(fd, "app.bin", data, size) == 0 ? 0 : 1);
+    }
+
+    ret = ota_download_firmware();
+
+    if (ret != 0)
+    {
+        kill(pid, SIGTERM);
+    }
+    waitpid(pid, &status, 0);
+
+    if (ret == 0 && (!WIFEXITED(status) || WEXITSTATUS(status) != 0))
+    {
+        fprintf(stderr, "ymodem sender failed\n");
+        ret = -1;
+    }
+
+    return ret;
+}
+
+/* Boot, and tell which firmware version came up (-1 if none). */
+static int host_boot_version(void)
+{
+    struct ota_paramers para = {0};
+    struct firmware_header header = {0};
+    void *entry = NULL;
+
+    entry = boot_firmware();
+    if (entry == NULL)
+    {
+        return -1;
+    }
+
+    if (ota_param_load(&para) != 0 ||
+        partition_read(para.active_slot == APP_SLOT_1 ? APP1_PART : APP2_PART, &header, 0, sizeof(header)) != 0)
+    {
+        return -1;
+    }
+
+    return (int)header.version;
+}
+
+/* ------------------------------------------------------------------------ */
+/* shell commands                                                           */
+/* ------------------------------------------------------------------------ */
+
+static int download_app(int argc, char **argv)
+{
+    unsigned char *data = NULL;
+    unsigned int size = 0;
+    int ret = 0;
+
+    if (argc > 1)
+    {
+        data = host_read_file(argv[1], &size);
+        if (data == NULL)
+        {
+            return -1;
+        }
+    }
+
+    ret = host_download(data, size);
+    if (ret != 0)
+    {
+        s_printf("ota_download err.\r\n");
+    }
+
+    free(data);
+
+    return 0;
+}
+
+static struct shell_command ota_download_cmd =
+{
+    .name = "ota_download",
+    .desc = "download app to partition with ymdoem [file]",
+    .func = download_app,
+    .next = SHELL_NULL,
+};
+
+static int update_app(int argc, char **argv)
+{
+    if (ota_update_firmware() != 0)
+    {
+        s_printf("ota_update err.\r\n");
+    }
+
+    return 0;
+}
+
+static struct shell_command ota_update_cmd =
+{
+    .name = "ota_update",
+    .desc = "update app from download partition",
+    .func = update_app,
+    .next = SHELL_NULL,
+};
+
+static int backup_app(int argc, char **argv)
+{
+    if (ota_backup_firmware() != 0)
+    {
+        s_printf("ota_backup err.\r\n");
+    }
+
+    return 0;
+}
+
+static struct shell_command ota_backup_cmd =
+{
+    .name = "ota_backup",
+    .desc = "backup app to the last",
+    .func = backup_app,
+    .next = SHELL_NULL,
+};
+
+static int boot_app(int argc, char **argv)
+{
+    void *entry = NULL;
+
+    entry = boot_firmware();
+    if (entry != NULL)
+    {
+        s_printf("entry addr 0x%x (loaded, not executed on host)\r\n", (unsigned int)(unsigned long)entry);
+    }
+    else
+    {
+        s_printf("boot err.\r\n");
+    }
+
+    return 0;
+}
+
+static struct shell_command ota_boot_cmd =
+{
+    .name = "ota_boot",
+    .desc = "boot app from partition",
+    .func = boot_app,
+    .next = SHELL_NULL,
+};
+
+static int nand_stats(int argc, char **argv)
+{
+    s_flush();
+
+    if (argc > 1 && strcmp(argv[1], "reset") == 0)
+    {
+        nand_sim_reset_stats(&nand);
+        return 0;
+    }
+
+    nand_sim_show_stats(&nand);
+
+    return 0;
+}
+
+static struct shell_command nand_cmd =
+{
+    .name = "nand",
+    .desc = "simulated nand counters [reset]",
+    .func = nand_stats,
+    .next = SHELL_NULL,
+};
+
+/* ------------------------------------------------------------------------ */
+/* bench / power cut sweep / selftest                                       */
+/* ------------------------------------------------------------------------ */
+
+static void bench_phase(const char *name, int ret, double t0_ms, double sim0_ms, unsigned int bytes)
+{
+    double wall = host_now_ms() - t0_ms;
+    double sim  = host_sim_ms() - sim0_ms;
+
+    printf("%-10s %-4s wall %9.2f ms  nand %9.2f ms", name, ret == 0 ? "ok" : "FAIL", wall, sim);
+    if (bytes && sim > 0.0)
+    {
+        printf("  %8.1f KiB/s", (double)bytes / 1024.0 / (sim / 1e3));
+    }
+    printf("\n");
+}
+
+static int host_bench(const char *path)
+{
+    unsigned char *data = NULL;
+    unsigned int size = 0;
+    double t0 = 0.0;
+    double s0 = 0.0;
+    int ret = 0;
+
+    data = host_read_file(path, &size);
+    if (data == NULL)
+    {
+        return 1;
+    }
+
+    nand_sim_reset_stats(&nand);
+
+    t0 = host_now_ms();
+    s0 = host_sim_ms();
+    ret = host_download(data, size);
+    bench_phase("download", ret, t0, s0, size);
+
+    if (ret == 0)
+    {
+        t0 = host_now_ms();
+        s0 = host_sim_ms();
+        ret = ota_update_firmware();
+        bench_phase("update", ret, t0, s0, size);
+    }
+
+    if (ret == 0)
+    {
+        t0 = host_now_ms();
+        s0 = host_sim_ms();
+        ret = (boot_firmware() == NULL) ? -1 : 0;
+        bench_phase("boot", ret, t0, s0, size);
+    }
+
+    nand_sim_show_stats(&nand);
+    free(data);
+
+    return ret == 0 ? 0 : 1;
+}
+
+
+static unsigned char *host_snapshot(void)
+{
+    unsigned char *snap = malloc(nand.map_size);
+
+    if (snap != NULL)
+    {
+        memcpy(snap, nand.map, nand.map_size);
+    }
+
+    return snap;
+}
+
+static void host_restore(const unsigned char *snap)
+{
+    memcpy(nand.map, snap, nand.map_size);
+}
+
+/*
+ * Cut the power at every step-th program/erase of a pending update and check
+ * what the next boot comes up with: the old firmware, the new one, or nothing.
+ * Needs a bootable firmware installed and a newer one downloaded.
+ */
+static int host_powercut_sweep(unsigned int step, int verbose)
+{
+    struct firmware_header header = {0};
+    unsigned char *snap = NULL;
+    unsigned long ops = 0;
+    unsigned long cut = 0;
+    unsigned int points = 0;
+    unsigned int old_cnt = 0;
+    unsigned int new_cnt = 0;
+    unsigned int bricked = 0;
+    int old_version = 0;
+    int new_version = 0;
+    int version = 0;
+
+    snap = host_snapshot();
+    if (snap == NULL)
+    {
+        return 1;
+    }
+
+    old_version = host_boot_version();
+    partition_read(DOWN_PART, &header, 0, sizeof(header));
+    new_version = (int)header.version;
+    host_restore(snap);
+
+    if (old_version < 0)
+    {
+        fprintf(stderr, "powercut: no bootable firmware installed\n");
+        free(snap);
+        return 1;
+    }
+
+    /* Dry run counts the program/erase operations of the update */
+    ops = nand.wear_ops;
+    ota_update_firmware();
+    ops = nand.wear_ops - ops;
+
+    if (host_boot_version() != new_version)
+    {
+        fprintf(stderr, "powercut: update without cut does not boot version %d\n", new_version);
+        host_restore(snap);
+        free(snap);
+        return 1;
+    }
+
+    for (cut = 1; cut <= ops; cut += (step ? step : 1))
+    {
+        host_restore(snap);
+        points++;
+
+        nand.cfg.power_cut_after = nand.wear_ops + cut;
+        power_cut_armed = 1;
+        if (setjmp(power_cut_jmp) == 0)
+        {
+            ota_update_firmware();
+        }
+        power_cut_armed = 0;
+        nand.cfg.power_cut_after = 0;
+
+        if (host_reopen() != 0)
+        {
+            free(snap);
+            return 1;
+        }
+
+        version = host_boot_version();
+        if (version == old_version)
+        {
+            old_cnt++;
+        }
+        else if (version == new_version)
+        {
+            new_cnt++;
+        }
+        else
+        {
+            bricked++;
+        }
+
+        if (verbose || version < 0)
+        {
+            printf("cut at op %4lu/%lu: %s\n", cut, ops,
+                   version < 0 ? "no bootable firmware" : (version == old_version ? "old firmware" : "new firmware"));
+        }
+    }
+
+    printf("powercut: %u cut points over %lu program/erase ops: %u old, %u new, %u bricked\n",
+           points, ops, old_cnt, new_cnt, bricked);
+
+    host_restore(snap);
+    free(snap);
+
+    return bricked == 0 ? 0 : 2;
+}
+
+static int selftest_failed = 0;
+
+static void selftest_check(const char *name, int ok)
+{
+    s_printf("\r\n");
+    s_flush();
+    printf("[%s] %s\n", ok ? "PASS" : "FAIL", name);
+    fflush(stdout);
+
+    if (!ok)
+    {
+        selftest_failed++;
+    }
+}
+
+/* Download and install one generated firmware, then boot and check RAM. */
+static int selftest_install(unsigned int version)
+{
+    unsigned char *fw = NULL;
+    unsigned int size = 0;
+    int ok = 0;
+
+    fw = host_make_firmware(version, HOST_FW_TEST_SIZE, &size);
+    if (fw == NULL)
+    {
+        return 0;
+    }
+
+    ok = (host_download(fw, size) == 0) &&
+         (ota_update_firmware() == 0) &&
+         (host_boot_version() == (int)version) &&
+         (memcmp((void *)(unsigned long)HOST_FW_LOAD_ADDR, fw + sizeof(struct firmware_header), HOST_FW_TEST_SIZE) == 0);
+
+    free(fw);
+
+    return ok;
+}
+
+/* Scatter-load: only file bytes come from flash, tails are cleared, holes are left alone. */
+static void selftest_segments(void)
+{
+    unsigned char *fw = NULL;
+    unsigned char *bad = NULL;
+    unsigned int size = 0;
+    unsigned int bad_size = 0;
+    int ok = 0;
+
+    fw = host_make_segmented(5, 0, &size);
+    memset((void *)(unsigned long)HOST_FW_LOAD_ADDR, 0xAA, 0x20000);
+    ok = (fw != NULL) && (host_download(fw, size) == 0) && (ota_update_firmware() == 0) &&
+         (host_boot_version() == 5) && host_check_segmented(fw);
+    selftest_check("scatter-load v5 places segments and zero-fills the tail", ok);
+
+    /* Whole image CRC is fine, a segment CRC is not: must roll back to v5 */
+    bad = host_make_segmented(6, 1, &bad_size);
+    memset((void *)(unsigned long)HOST_FW_LOAD_ADDR, 0xAA, 0x20000);
+    ok = (bad != NULL) && (host_download(bad, bad_size) == 0) && (ota_update_firmware() == 0) &&
+         (host_boot_version() == 5) && host_check_segmented(fw);
+    selftest_check("bad segment crc rolls back to v5", ok);
+
+    free(bad);
+    free(fw);
+}
+
+static int host_selftest(void)
+{
+    struct ota_paramers para = {0};
+    unsigned char *fw = NULL;
+    unsigned int size = 0;
+    unsigned int block = 0;
+    int ok = 0;
+
+    /* Start from a factory fresh device */
+    nand_sim_close(&nand);
+    if (truncate(image_path, 0) != 0 || nand_sim_open(&nand, image_path, &nand_cfg) != NAND_SIM_OK)
+    {
+        return 1;
+    }
+    nand.power_cut = host_power_cut;
+
+    selftest_check("blank device does not boot", host_boot_version() < 0);
+    selftest_check("download, update and boot v1", selftest_install(1));
+    selftest_check("download, update and boot v2", selftest_install(2));
+    selftest_check("rollback to v1", ota_backup_firmware() == 0 && host_boot_version() == 1);
+
+    /* Power cut while the new image is copied into the inactive slot */
+    fw = host_make_firmware(3, HOST_FW_TEST_SIZE, &size);
+    ok = (fw != NULL) && (host_download(fw, size) == 0);
+    if (ok)
+    {
+        nand.cfg.power_cut_after = nand.wear_ops + (512 * 2048) / (nand.cfg.page_size * nand.cfg.pages_per_block) + 10;
+        power_cut_armed = 1;
+        if (setjmp(power_cut_jmp) == 0)
+        {
+            ota_update_firmware();
+            ok = 0;
+        }
+        power_cut_armed = 0;
+        ok = ok && (host_reopen() == 0) && (host_boot_version() == 1);
+    }
+    selftest_check("power cut during image copy keeps v1", ok);
+    selftest_check("update resumes after power cut to v3",
+                   ota_update_firmware() == 0 && host_boot_version() == 3 &&
+                   memcmp((void *)(unsigned long)HOST_FW_LOAD_ADDR, fw + sizeof(struct firmware_header), HOST_FW_TEST_SIZE) == 0);
+    free(fw);
+
+    /* Power cut at every step of an update, the Param save included */
+    fw = host_make_firmware(4, HOST_FW_TEST_SIZE, &size);
+    ok = (fw != NULL) && (host_download(fw, size) == 0);
+    selftest_check("download v4 for power cut sweep", ok);
+    if (ok)
+    {
+        selftest_check("power cut sweep never bricks", host_powercut_sweep(1, 0) == 0);
+    }
+    free(fw);
+
+    /* A single record as written before seq and crc32 existed, the second partition blank */
+    ota_param_load(&para);
+    para.seq = 0;
+    ok = partition_erase(PARA_PART, 0, sizeof(para)) == 0 && partition_erase(PARA2_PART, 0, sizeof(para)) == 0 &&
+         partition_write(PARA_PART, &para, 0, sizeof(para) - sizeof(para.crc32)) == 0;
+    selftest_check("record from before seq still boots v3", ok && host_boot_version() == 3);
+
+    /* Grown bad block in the inactive slot, update must leave v3 running */
+    ota_param_load(&para);
+    block = ((para.active_slot == APP_SLOT_1) ? 1536 : 1024) * 2048 / (nand.cfg.page_size * nand.cfg.pages_per_block) + 1;
+    if (nand.cfg.bad_count < NAND_SIM_BAD_MAX)
+    {
+        nand.cfg.bad_blocks[nand.cfg.bad_count++] = block;
+    }
+    nand_cfg = nand.cfg;
+    host_reopen();
+    ota_update_firmware();
+    selftest_check("bad block in inactive slot keeps v3", host_boot_version() == 3 && nand.stats.erase_fails > 0);
+
+    /* Read disturb within the ECC strength is invisible */
+    nand.cfg.bitflip_rate = 0.2;
+    nand.cfg.ecc_bits     = 8;
+    selftest_check("correctable bit flips boot v3", host_boot_version() == 3 && nand.stats.bitflips_fixed > 0);
+
+    /* Uncorrectable reads must never boot a corrupted image */
+    nand.cfg.bitflip_rate = 1.0;
+    nand.cfg.ecc_bits     = 0;
+    selftest_check("uncorrectable bit flips refuse to boot", host_boot_version() < 0);
+    nand.cfg.bitflip_rate = 0.0;
+
+    /* Scatter-load images on a fresh device, away from the bad block above */
+    nand_cfg.bad_count = 0;
+    nand_sim_close(&nand);
+    if (truncate(image_path, 0) != 0 || nand_sim_open(&nand, image_path, &nand_cfg) != NAND_SIM_OK)
+    {
+        return 1;
+    }
+    nand.power_cut = host_power_cut;
+    selftest_segments();
+
+    printf("selftest: %s\n", selftest_failed ? "FAILED" : "passed");
+    nand_sim_show_stats(&nand);
+
+    return selftest_failed ? 1 : 0;
+}
+
+/*
+ * Write a raw image from offset 0 the way "xfel spinand erase/write" does:
+ * every block the image touches is erased, blank pages are not programmed.
+ * The partition table of the new image is applied afterwards.
+ */
+static int host_flash(const unsigned char *data, unsigned int size)
+{
+    unsigned int page_size = nand.cfg.page_size;
+    unsigned int block_size = page_size * nand.cfg.pages_per_block;
+    unsigned int addr = 0;
+    unsigned int i = 0;
+    unsigned int len = 0;
+
+    if (size > block_size * nand.cfg.blocks_total)
+    {
+        fprintf(stderr, "image of %u bytes larger than the device\n", size);
+        return -1;
+    }
+
+    for (addr = 0; addr < size; addr += page_size)
+    {
+        if ((addr % block_size) == 0 && nand_sim_erase(&nand, addr / block_size) != NAND_SIM_OK)
+        {
+            /* A factory image leaves bad blocks blank, only data on them is an error */
+            for (i = addr; i < addr + block_size && i < size && data[i] == 0xFF; i++)
+            {
+            }
+            if (i < addr + block_size && i < size)
+            {
+                fprintf(stderr, "image has data on bad block %u\n", addr / block_size);
+                return -1;
+            }
+            addr += block_size - page_size;
+            continue;
+        }
+
+        len = (size - addr < page_size) ? (size - addr) : page_size;
+        for (i = 0; i < len && data[addr + i] == 0xFF; i++)
+        {
+        }
+        if (i < len && nand_sim_program(&nand, addr / page_size, 0, data + addr, len) != NAND_SIM_OK)
+        {
+            fprintf(stderr, "program page %u failed\n", addr / page_size);
+            return -1;
+        }
+    }
+
+    return host_partition_load();
+}
+
+/* boot0 stand-in with an eGON header mk_nand accepts, the checksum is left to it */
+static int host_write_boot0(const char *path, unsigned int size)
+{
+    unsigned char *buf = calloc(1, size);
+    unsigned int length = size;
+    FILE *fp = NULL;
+    int ret = -1;
+
+    if (buf == NULL)
+    {
+        return -1;
+    }
+
+    buf[0] = 0x0e;
+    buf[3] = 0xea;    /* b . + 0x40 */
+    memcpy(buf + 4, "eGON.BT0", 8);
+    memcpy(buf + 16, &length, 4);
+    memset(buf + 64, 0x5a, size - 64);
+
+    fp = fopen(path, "wb");
+    if (fp != NULL)
+    {
+        ret = fwrite(buf, 1, size, fp) == size ? 0 : -1;
+        fclose(fp);
+    }
+    free(buf);
+
+    return ret;
+}
+
+static int host_write_file(const char *path, const unsigned char *data, unsigned int size)
+{
+    FILE *fp = fopen(path, "wb");
+    int ret = -1;
+
+    if (fp != NULL)
+    {
+        ret = fwrite(data, 1, size, fp) == size ? 0 : -1;
+        fclose(fp);
+    }
+
+    return ret;
+}
+
+/*
+ * Build a factory image with tool/mk_nand from generated inputs and the
+ * device's bad blocks, flash it and check what boot1 finds: the on-flash
+ * partition table, the boot0 checksum, the boot1 copies, a formatted
+ * littlefs and an OTA record that boots APP1 and rolls back to APP2.
+ */
+static int host_factory(const char *mk_nand)
+{
+    static const char *layout =
+        "boot0     0x000000  0x080000  boot0   factory_boot0.bin\n"
+        "ptable    0x080000  0x080000  ptable\n"
+        "boot1     0x100000  0x100000  boot1   factory_boot1.bin  2\n"
+        "APP1      0x200000  0x100000  app     factory_app1.bin\n"
+        "APP2      0x300000  0x100000  app     factory_app2.bin\n"
+        "Download  0x400000  0x100000  raw\n"
+        "Param     0x500000  0x01e000  param\n"
+        "LittleFs  0x520000  0x400000  lfs\n"
+        "Param2    0x920000  0x01e000  param\n";
+    struct ota_paramers para = {0};
+    unsigned char *boot1 = NULL;
+    unsigned char *app1 = NULL;
+    unsigned char *app2 = NULL;
+    unsigned char *image = NULL;
+    unsigned char buf[64];
+    struct dram_op_rec rec = {0};
+    unsigned int block_size = nand.cfg.page_size * nand.cfg.pages_per_block;
+    unsigned long erases = 0;
+    unsigned int boot1_size = 0;
+    unsigned int boot1_crc = 0;
+    unsigned int app1_size = 0;
+    unsigned int app2_size = 0;
+    unsigned int size = 0;
+    unsigned int sum = 0;
+    unsigned int word = 0;
+    unsigned int i = 0;
+    char cmd[512];
+    int ok = 0;
+    int n = 0;
+
+    /* boot1 copy 1 starts on the first bad block, so it has to move to the next one */
+    boot1 = host_make_firmware(0xb1, 96 * 1024, &boot1_size);
+    app1  = host_make_firmware(7, HOST_FW_TEST_SIZE, &app1_size);
+    app2  = host_make_segmented(6, 0, &app2_size);
+    if (boot1 != NULL)
+    {
+        /* boot1 header as in libcpu/vector_gcc.S, img_crc and head_crc left for mk_nand to seal */
+        unsigned int head[7] = {0x12345678, boot1_size, 0x40000000, 0x40000040, 0, 0, 0};
+
+        memcpy(boot1, head, sizeof(head));
+    }
+    if (boot1 == NULL || app1 == NULL || app2 == NULL ||
+        host_write_boot0("factory_boot0.bin", 24 * 1024) != 0 ||
+        host_write_file("factory_boot1.bin", boot1, boot1_size) != 0 ||
+        host_write_file("factory_app1.bin", app1, app1_size) != 0 ||
+        host_write_file("factory_app2.bin", app2, app2_size) != 0 ||
+        host_write_file("factory_layout.txt", (const unsigned char *)layout, strlen(layout)) != 0)
+    {
+        return 1;
+    }
+
+    n = snprintf(cmd, sizeof(cmd), "%s -p %u -k %u -n %u -o factory.bin", mk_nand,
+                 nand.cfg.page_size, nand.cfg.pages_per_block, nand.cfg.blocks_total);
+    for (i = 0; i < nand.cfg.bad_count; i++)
+    {
+        n += snprintf(cmd + n, sizeof(cmd) - n, "%s%u", i == 0 ? " -B " : ",", nand.cfg.bad_blocks[i]);
+    }
+    snprintf(cmd + n, sizeof(cmd) - n, " factory_layout.txt");
+    printf("%s\n", cmd);
+    fflush(stdout);
+    selftest_check("mk_nand builds the factory image", system(cmd) == 0);
+
+    image = host_read_file("factory.bin", &size);
+    selftest_check("factory image flashes in one pass", image != NULL && host_flash(image, size) == 0);
+
+    /* The built in layout has no LittleFs on the host, seeing it means the table was used */
+    ok = partition_read("LittleFs", buf, 0, sizeof(buf)) == 0 && memcmp(buf + 8, "littlefs", 8) == 0;
+    selftest_check("boot1 loads the on-flash partition table and finds littlefs", ok);
+
+    ok = partition_read("boot0", buf, 0, 32) == 0;
+    memcpy(&size, buf + 16, 4);
+    for (i = 0; ok && i < size; i += 4)
+    {
+        ok = partition_read("boot0", &word, i, 4) == 0;
+        sum += (i == 12) ? 0x5F0A6C39U : word;
+    }
+    memcpy(&word, buf + 12, 4);
+    selftest_check("boot0 carries the BROM checksum", ok && sum == word);
+
+    boot1_crc = boot_crc32_update(0xFFFFFFFF, boot1, 16);
+    boot1_crc = boot_crc32_update(boot1_crc, boot1 + 28, boot1_size - 28) ^ 0xFFFFFFFF;
+    memcpy(boot1 + 16, &boot1_crc, 4);
+    ok = partition_read("boot1", &word, 16, 4) == 0 && word == boot1_crc;
+    boot1_crc = boot_crc32_update(0xFFFFFFFF, boot1, 20);
+    boot1_crc = boot_crc32_update(boot1_crc, boot1 + 24, 4) ^ 0xFFFFFFFF;
+    memcpy(boot1 + 20, &boot1_crc, 4);
+    selftest_check("boot1 image and header CRCs sealed for boot0",
+                   ok && partition_read("boot1", &word, 20, 4) == 0 && word == boot1_crc);
+
+    ok = partition_read("boot1", buf, 0, sizeof(buf)) == 0 && memcmp(buf, boot1, sizeof(buf)) == 0 &&
+         partition_read("boot1", buf, 0x80000 + block_size, sizeof(buf)) == 0 && memcmp(buf, boot1, sizeof(buf)) == 0 &&
+         partition_read("boot1", buf, 0x80000, sizeof(buf)) == 0;
+    for (i = 0; ok && i < sizeof(buf); i++)
+    {
+        ok = buf[i] == 0xFF;
+    }
+    selftest_check("boot1 copy 0 written, copy 1 moved past its bad block", ok);
+
+    ok = ota_param_load(&para) == 0 && para.active_slot == APP_SLOT_1 &&
+         para.can_be_back == BACKUP_FLAG && host_boot_version() == 7;
+    selftest_check("factory Param boots APP1 v7", ok);
+    memset((void *)(unsigned long)HOST_FW_LOAD_ADDR, 0xAA, 0x20000);
+    selftest_check("rollback to factory APP2 v6", ota_backup_firmware() == 0 && host_boot_version() == 6 &&
+                   host_check_segmented(app2));
+
+    /* A rejected table must not cost the partitions that are already registered */
+    ok = host_stage_bad_ptable(1) == 0 && partition_table_load("nand_flash", 0x400000) == PARTITION_ERR_CHECK &&
+         host_stage_bad_ptable(0) == 0 && partition_table_load("nand_flash", 0x400000) == PARTITION_ERR_CHECK &&
+         partition_read("LittleFs", buf, 0, sizeof(buf)) == 0 && memcmp(buf + 8, "littlefs", 8) == 0 &&
+         host_boot_version() == 6;
+    selftest_check("overlapping or duplicated table entries keep the loaded layout", ok);
+
+    /* A characterisation boot stores its point in the last boot0 block, under the protection nand_setup() sets */
+    memset(&host_handoff, 0, sizeof(host_handoff));
+    host_handoff.magic           = HANDOFF_MAGIC;
+    host_handoff.flags           = HANDOFF_F_TUNED;
+    host_handoff.dram_clk        = 792;
+    host_handoff.dram_timing_pct = 90;
+    host_handoff.dram_clk_min    = 600;
+    host_handoff.dram_clk_max    = 840;
+    host_handoff.dram_pct_min    = 80;
+    nand_boot_protect(NULL, 1);
+    ok = dram_op_save() == 0 && nand.protect_blocks != 0 &&
+         partition_read("boot0", &rec, HOST_PARTITION_TABLE_ADDR - block_size, sizeof(rec)) == 0 &&
+         rec.magic == DRAM_OP_MAGIC && rec.version == DRAM_OP_VER && rec.clk == 792 && rec.timing_pct == 90 &&
+         rec.crc32 == (boot_crc32_update(0xFFFFFFFF, (const unsigned char *)&rec, sizeof(rec) - 4) ^ 0xFFFFFFFF);
+    erases = nand.stats.block_erases;
+    selftest_check("DRAM point saved through the boot area protection and read back",
+                   ok && dram_op_save() == 0 && nand.stats.block_erases == erases);
+    nand_boot_protect(NULL, 0);
+    memset(&host_handoff, 0, sizeof(host_handoff));
+
+    free(image);
+    free(app2);
+    free(app1);
+    free(boot1);
+
+    printf("factory: %s\n", selftest_failed ? "FAILED" : "passed");
+
+    return selftest_failed ? 1 : 0;
+}
+
+/* ------------------------------------------------------------------------ */
+/* main                                                                     */
+/* ------------------------------------------------------------------------ */
+
+static void usage(const char *prog)
+{
+    printf("usage: %s [options] [command]\n"
+           "\n"
+           "commands:\n"
+           "  shell              interactive hgboot shell on stdin/stdout (default)\n"
+           "  download [FILE]    ymodem receive into Download, FILE is sent by the built in\n"
+           "                     sender, otherwise attach sz/minicom to the printed pty\n"
+           "  update             install the downloaded firmware\n"
+           "  backup             roll back to the previous firmware\n"
+           "  boot               load the active firmware into simulated DRAM\n"
+           "  bench FILE         download, update and boot FILE, print NAND time per phase\n"
+           "  powercut [STEP]    cut power at every STEP-th program/erase of the pending update\n"
+           "  selftest           end to end OTA scenarios on a wiped image\n"
+           "  flash FILE         write a raw factory image from offset 0, as xfel spinand write\n"
+           "  factory MK_NAND    build a factory image with tool/mk_nand, flash it and check it\n"
+           "  stats              print the NAND geometry\n"
+           "\n"
+           "options:\n"
+           "  -i, --image PATH            NAND image file (default " HOST_IMAGE_DEFAULT ")\n"
+           "  -g, --geometry P,S,N,B      page, spare, pages per block, blocks (default %u,%u,%u,%u)\n"
+           "  -t, --timing R,P,E          tR, tPROG, tBERS in us (default %u,%u,%u)\n"
+           "  -c, --spi-hz HZ             SPI clock (default %u)\n"
+           "  -w, --bus-width 1|2|4       data lines for cache transfers (default %u)\n"
+           "  -b, --bad BLOCK             mark a factory bad block, may repeat\n"
+           "  -f, --bitflip RATE          bit flip probability per page read\n"
+           "  -e, --ecc BITS              bit flips per page corrected by on-die ECC (default 8)\n"
+           "  -p, --power-cut N           cut the power on the Nth program/erase, exit code 3\n"
+           "  -s, --seed N                fault injection seed\n"
+           "  -r, --realtime              sleep for the simulated NAND time\n",
+           prog, NAND_SIM_PAGE_SIZE, NAND_SIM_SPARE_SIZE, NAND_SIM_PAGES_PER_BLOCK, NAND_SIM_BLOCKS_TOTAL,
+           NAND_SIM_T_R_US, NAND_SIM_T_PROG_US, NAND_SIM_T_BERS_US, NAND_SIM_SPI_HZ, NAND_SIM_BUS_WIDTH);
+}
+
+int main(int argc, char **argv)
+{
+    static const struct option long_opts[] =
+    {
+        {"image",     required_argument, 0, 'i'},
+        {"geometry",  required_argument, 0, 'g'},
+        {"timing",    required_argument, 0, 't'},
+        {"spi-hz",    required_argument, 0, 'c'},
+        {"bus-width", required_argument, 0, 'w'},
+        {"bad",       required_argument, 0, 'b'},
+        {"bitflip",   required_argument, 0, 'f'},
+        {"ecc",       required_argument, 0, 'e'},
+        {"power-cut", required_argument, 0, 'p'},
+        {"seed",      required_argument, 0, 's'},
+        {"realtime",  no_argument,       0, 'r'},
+        {"help",      no_argument,       0, 'h'},
+        {0, 0, 0, 0},
+    };
+    const char *cmd = "shell";
+    unsigned char *data = NULL;
+    unsigned int size = 0;
+    int opt = 0;
+    int ret = 0;
+
+    nand_sim_default_config(&nand_cfg);
+
+    while ((opt = getopt_long(argc, argv, "i:g:t:c:w:b:f:e:p:s:rh", long_opts, NULL)) != -1)
+    {
+        switch (opt)
+        {
+        case 'i':
+            image_path = optarg;
+            break;
+        case 'g':
+            if (sscanf(optarg, "%u,%u,%u,%u", &nand_cfg.page_size, &nand_cfg.spare_size,
+                       &nand_cfg.pages_per_block, &nand_cfg.blocks_total) != 4)
+            {
+                usage(argv[0]);
+                return 1;
+            }
+            break;
+        case 't':
+            if (sscanf(optarg, "%u,%u,%u", &nand_cfg.t_r_us, &nand_cfg.t_prog_us, &nand_cfg.t_bers_us) != 3)
+            {
+                usage(argv[0]);
+                return 1;
+            }
+            break;
+        case 'c':
+            nand_cfg.spi_hz = (unsigned int)strtoul(optarg, NULL, 0);
+            break;
+        case 'w':
+            nand_cfg.bus_width = (unsigned int)strtoul(optarg, NULL, 0);
+            break;
+        case 'b':
+            if (nand_cfg.bad_count < NAND_SIM_BAD_MAX)
+            {
+                nand_cfg.bad_blocks[nand_cfg.bad_count++] = (unsigned int)strtoul(optarg, NULL, 0);
+            }
+            break;
+        case 'f':
+            nand_cfg.bitflip_rate = strtod(optarg, NULL);
+            break;
+        case 'e':
+            nand_cfg.ecc_bits = (unsigned int)strtoul(optarg, NULL, 0);
+            break;
+        case 'p':
+            nand_cfg.power_cut_after = strtoul(optarg, NULL, 0);
+            break;
+        case 's':
+            nand_cfg.seed = (unsigned int)strtoul(optarg, NULL, 0);
+            break;
+        case 'r':
+            nand_cfg.realtime = 1;
+            break;
+        default:
+            usage(argv[0]);
+            return opt == 'h' ? 0 : 1;
+        }
+    }
+
+    if (optind < argc)
+    {
+        cmd = argv[optind];
+    }
+
+    if ((unsigned long long)nand_cfg.page_size * nand_cfg.pages_per_block * nand_cfg.blocks_total < 2684ULL * 2048)
+    {
+        fprintf(stderr, "geometry too small for the partition table (needs %u bytes)\n", 2684 * 2048);
+        return 1;
+    }
+
+    if (host_dram_map() != 0)
+    {
+        return 1;
+    }
+
+    if (nand_sim_open(&nand, image_path, &nand_cfg) != NAND_SIM_OK)
+    {
+        fprintf(stderr, "cannot open nand image %s\n", image_path);
+        return 1;
+    }
+    nand.power_cut = host_power_cut;
+
+    if (host_shell_init() != 0 ||
+        host_ymodem_open_pty(pty_name, sizeof(pty_name)) != 0 ||
+        host_partition_register(&nand) != 0)
+    {
+        fprintf(stderr, "hgboot host init failed\n");
+        return 1;
+    }
+
+    shell_register_command(&ota_download_cmd);
+    shell_register_command(&ota_update_cmd);
+    shell_register_command(&ota_backup_cmd);
+    shell_register_command(&ota_boot_cmd);
+    shell_register_command(&nand_cmd);
+
+    s_printf("\r\n");
+    s_flush();
+
+    if (strcmp(cmd, "shell") == 0)
+    {
+        s_printf("ymodem port: %s\r\n", pty_name);
+        for (;;)
+        {
+            shell_servise();
+        }
+    }
+    else if (strcmp(cmd, "download") == 0)
+    {
+        if (optind + 1 < argc)
+        {
+            data = host_read_file(argv[optind + 1], &size);
+            if (data == NULL)
+            {
+                return 1;
+            }
+        }
+        ret = host_download(data, size) == 0 ? 0 : 1;
+        free(data);
+    }
+    else if (strcmp(cmd, "update") == 0)
+    {
+        ret = ota_update_firmware() == 0 ? 0 : 1;
+    }
+    else if (strcmp(cmd, "backup") == 0)
+    {
+        ret = ota_backup_firmware() == 0 ? 0 : 1;
+    }
+    else if (strcmp(cmd, "boot") == 0)
+    {
+        ret = host_boot_version();
+        if (ret >= 0)
+        {
+            printf("booted firmware version %d\n", ret);
+        }
+        ret = ret >= 0 ? 0 : 1;
+    }
+    else if (strcmp(cmd, "bench") == 0 && optind + 1 < argc)
+    {
+        ret = host_bench(argv[optind + 1]);
+    }
+    else if (strcmp(cmd, "powercut") == 0)
+    {
+        ret = host_powercut_sweep(optind + 1 < argc ? (unsigned int)strtoul(argv[optind + 1], NULL, 0) : 1, 1);
+    }
+    else if (strcmp(cmd, "selftest") == 0)
+    {
+        ret = host_selftest();
+    }
+    else if (strcmp(cmd, "flash") == 0 && optind + 1 < argc)
+    {
+        data = host_read_file(argv[optind + 1], &size);
+        ret = (data != NULL && host_flash(data, size) == 0) ? 0 : 1;
+        free(data);
+    }
+    else if (strcmp(cmd, "factory") == 0 && optind + 1 < argc)
+    {
+        ret = host_factory(argv[optind + 1]);
+    }
+    else if (strcmp(cmd, "stats") == 0)
+    {
+        nand_sim_show_stats(&nand);
+    }
+    else
+    {
+        usage(argv[0]);
+        ret = 1;
+    }
+
+    s_flush();
+    host_ymodem_close();
+    nand_sim_close(&nand);
+
+    return ret;
+}
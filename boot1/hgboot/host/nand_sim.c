@@ -0,0 +1,486 @@
+/***************************************************************************
+ * Copyright (c) 2025 HGBOOT Authors
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the MIT License which is available at
+ * https://opensource.org/licenses/MIT.
+ *
+ * SPDX-License-Identifier: MIT
+ **************************************************************************/
+
+#define _GNU_SOURCE
+
+#include "nand_sim.h"
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#define NAND_SIM_BAD_MARK_OFFSET 0 /* Factory bad block marker, first spare byte of the first page */
+
+#define NAND_SIM_READ_CMD_BYTES  8 /* 13h + 3 addr, 03h + 2 addr + 1 dummy */
+#define NAND_SIM_PROG_CMD_BYTES  8 /* 06h, 02h + 2 addr, 10h + 3 addr */
+#define NAND_SIM_ERASE_CMD_BYTES 5 /* 06h, D8h + 3 addr */
+
+static unsigned int nand_sim_raw_page_size(struct nand_sim *sim)
+{
+    return sim->cfg.page_size + sim->cfg.spare_size;
+}
+
+static unsigned int nand_sim_pages_total(struct nand_sim *sim)
+{
+    return sim->cfg.pages_per_block * sim->cfg.blocks_total;
+}
+
+static unsigned char *nand_sim_page_ptr(struct nand_sim *sim, unsigned int page)
+{
+    return sim->map + (uint64_t)page * nand_sim_raw_page_size(sim);
+}
+
+static uint64_t nand_sim_rand(struct nand_sim *sim)
+{
+    uint64_t x = sim->rand_state;
+
+    x ^= x >> 12;
+    x ^= x << 25;
+    x ^= x >> 27;
+    sim->rand_state = x;
+
+    return x * 0x2545F4914F6CDD1DULL;
+}
+
+static double nand_sim_uniform(struct nand_sim *sim)
+{
+    return (double)(nand_sim_rand(sim) >> 11) / (double)(1ULL << 53);
+}
+
+static uint64_t nand_sim_bus_ns(struct nand_sim *sim, unsigned int cmd_bytes, unsigned int data_bytes)
+{
+    uint64_t bits = 0;
+
+    bits = (uint64_t)cmd_bytes * 8 + ((uint64_t)data_bytes * 8 + sim->cfg.bus_width - 1) / sim->cfg.bus_width;
+
+    return bits * 1000000000ULL / sim->cfg.spi_hz;
+}
+
+static void nand_sim_spend(struct nand_sim *sim, uint64_t busy_ns, uint64_t bus_ns)
+{
+    struct timespec ts = {0};
+    uint64_t total = busy_ns + bus_ns;
+
+    sim->stats.busy_ns += busy_ns;
+    sim->stats.bus_ns  += bus_ns;
+
+    if (sim->cfg.realtime && total != 0)
+    {
+        ts.tv_sec  = total / 1000000000ULL;
+        ts.tv_nsec = total % 1000000000ULL;
+        nanosleep(&ts, NAND_SIM_NULL);
+    }
+}
+
+/* Count a program/erase and tell whether the power is cut during this one. */
+static int nand_sim_power_cut_due(struct nand_sim *sim)
+{
+    sim->wear_ops++;
+
+    return (sim->cfg.power_cut_after != 0) && (sim->wear_ops == sim->cfg.power_cut_after);
+}
+
+static void nand_sim_power_cut(struct nand_sim *sim)
+{
+    msync(sim->map, sim->map_size, MS_SYNC);
+
+    if (sim->power_cut)
+    {
+        sim->power_cut(sim);
+    }
+
+    fprintf(stderr, "nand_sim: power cut after %lu program/erase operations\n", sim->wear_ops);
+    exit(3);
+}
+
+/**
+ * @brief Fill a configuration with the board NAND geometry and datasheet timings.
+ * @param cfg Configuration to fill.
+ */
+void nand_sim_default_config(struct nand_sim_config *cfg)
+{
+    memset(cfg, 0, sizeof(*cfg));
+
+    cfg->page_size       = NAND_SIM_PAGE_SIZE;
+    cfg->spare_size      = NAND_SIM_SPARE_SIZE;
+    cfg->pages_per_block = NAND_SIM_PAGES_PER_BLOCK;
+    cfg->blocks_total    = NAND_SIM_BLOCKS_TOTAL;
+    cfg->t_r_us          = NAND_SIM_T_R_US;
+    cfg->t_prog_us       = NAND_SIM_T_PROG_US;
+    cfg->t_bers_us       = NAND_SIM_T_BERS_US;
+    cfg->spi_hz          = NAND_SIM_SPI_HZ;
+    cfg->bus_width       = NAND_SIM_BUS_WIDTH;
+    cfg->ecc_bits        = 8;
+    cfg->seed            = 1;
+}
+
+/**
+ * @brief Open (or create) a NAND image file.
+ *
+ * A missing or empty file is created as an erased device. Factory bad blocks
+ * listed in cfg are marked on every open, they never become good again.
+ *
+ * @param sim  Simulator instance.
+ * @param path Image file path.
+ * @param cfg  Geometry, timing and fault injection setup.
+ * @return NAND_SIM_OK on success, error code otherwise.
+ */
+int nand_sim_open(struct nand_sim *sim, const char *path, const struct nand_sim_config *cfg)
+{
+    struct stat st = {0};
+    unsigned int i = 0;
+    unsigned char *spare = NAND_SIM_NULL;
+
+    if (sim == NAND_SIM_NULL || path == NAND_SIM_NULL || cfg == NAND_SIM_NULL)
+    {
+        return NAND_SIM_ERR_PARAM;
+    }
+
+    if (cfg->page_size == 0 || cfg->spare_size == 0 || cfg->pages_per_block == 0 ||
+        cfg->blocks_total == 0 || cfg->spi_hz == 0 ||
+        (cfg->bus_width != 1 && cfg->bus_width != 2 && cfg->bus_width != 4))
+    {
+        return NAND_SIM_ERR_PARAM;
+    }
+
+    memset(sim, 0, sizeof(*sim));
+    sim->cfg        = *cfg;
+    sim->rand_state = ((uint64_t)cfg->seed << 1) | 1;
+    sim->map_size   = (uint64_t)nand_sim_pages_total(sim) * nand_sim_raw_page_size(sim);
+
+    sim->fd = open(path, O_RDWR | O_CREAT, 0644);
+    if (sim->fd < 0)
+    {
+        perror(path);
+        return NAND_SIM_ERR_IO;
+    }
+
+    if (fstat(sim->fd, &st) != 0)
+    {
+        close(sim->fd);
+        return NAND_SIM_ERR_IO;
+    }
+
+    if (st.st_size == 0)
+    {
+        /* Sparse zero file, stored inverted, is an erased device */
+        if (ftruncate(sim->fd, (off_t)sim->map_size) != 0)
+        {
+            close(sim->fd);
+            return NAND_SIM_ERR_IO;
+        }
+    }
+    else if ((uint64_t)st.st_size != sim->map_size)
+    {
+        fprintf(stderr, "nand_sim: %s is %lld bytes, geometry needs %llu\n",
+                path, (long long)st.st_size, (unsigned long long)sim->map_size);
+        close(sim->fd);
+        return NAND_SIM_ERR_PARAM;
+    }
+
+    sim->map = mmap(NAND_SIM_NULL, sim->map_size, PROT_READ | PROT_WRITE, MAP_SHARED, sim->fd, 0);
+    if (sim->map == MAP_FAILED)
+    {
+        sim->map = NAND_SIM_NULL;
+        close(sim->fd);
+        return NAND_SIM_ERR_IO;
+    }
+
+    for (i = 0; i < cfg->bad_count; i++)
+    {
+        if (cfg->bad_blocks[i] >= cfg->blocks_total)
+        {
+            nand_sim_close(sim);
+            return NAND_SIM_ERR_PARAM;
+        }
+
+        spare = nand_sim_page_ptr(sim, cfg->bad_blocks[i] * cfg->pages_per_block) + cfg->page_size;
+        spare[NAND_SIM_BAD_MARK_OFFSET] = (unsigned char)~0x00;
+    }
+
+    return NAND_SIM_OK;
+}
+
+/**
+ * @brief Flush and close a NAND image.
+ * @param sim Simulator instance.
+ */
+void nand_sim_close(struct nand_sim *sim)
+{
+    if (sim->map)
+    {
+        msync(sim->map, sim->map_size, MS_SYNC);
+        munmap(sim->map, sim->map_size);
+        sim->map = NAND_SIM_NULL;
+    }
+
+    if (sim->fd >= 0)
+    {
+        close(sim->fd);
+        sim->fd = -1;
+    }
+}
+
+/**
+ * @brief Check the factory bad block marker of a block.
+ * @param sim   Simulator instance.
+ * @param block Block index.
+ * @return 1 if bad, 0 if good, NAND_SIM_ERR_PARAM if out of range.
+ */
+int nand_sim_is_bad(struct nand_sim *sim, unsigned int block)
+{
+    unsigned char *spare = NAND_SIM_NULL;
+
+    if (block >= sim->cfg.blocks_total)
+    {
+        return NAND_SIM_ERR_PARAM;
+    }
+
+    spare = nand_sim_page_ptr(sim, block * sim->cfg.pages_per_block) + sim->cfg.page_size;
+
+    return (unsigned char)~spare[NAND_SIM_BAD_MARK_OFFSET] != 0xFF;
+}
+
+/**
+ * @brief Read data of a page, as PAGE READ to cache followed by READ FROM CACHE.
+ *
+ * Injected bit flips are transient (read disturb), the array is not changed.
+ * Flips within the ECC strength are corrected and reported, more than that
+ * return corrupted data.
+ *
+ * @param sim    Simulator instance.
+ * @param page   Page index.
+ * @param offset Column offset in the page.
+ * @param buf    Output buffer.
+ * @param len    Bytes to read, offset + len must not exceed the page size.
+ * @return NAND_SIM_OK, NAND_SIM_ECC_FIXED, or error code.
+ */
+int nand_sim_read(struct nand_sim *sim, unsigned int page, unsigned int offset, unsigned char *buf, unsigned int len)
+{
+    unsigned char *src = NAND_SIM_NULL;
+    unsigned int flips = 0;
+    unsigned int bit = 0;
+    unsigned int i = 0;
+
+    if (buf == NAND_SIM_NULL || page >= nand_sim_pages_total(sim) || offset + len > sim->cfg.page_size)
+    {
+        return NAND_SIM_ERR_PARAM;
+    }
+
+    src = nand_sim_page_ptr(sim, page) + offset;
+
+    for (i = 0; i < len; i++)
+    {
+        buf[i] = (unsigned char)~src[i];
+    }
+
+    sim->stats.page_reads++;
+    sim->stats.bytes_read += len;
+    nand_sim_spend(sim, (uint64_t)sim->cfg.t_r_us * 1000, nand_sim_bus_ns(sim, NAND_SIM_READ_CMD_BYTES, len));
+
+    if (sim->cfg.bitflip_rate <= 0.0 || len == 0 || nand_sim_uniform(sim) >= sim->cfg.bitflip_rate)
+    {
+        return NAND_SIM_OK;
+    }
+
+    flips = 1;
+    while (flips < 32 && nand_sim_uniform(sim) < 0.5)
+    {
+        flips++;
+    }
+
+    if (flips <= sim->cfg.ecc_bits)
+    {
+        sim->stats.bitflips_fixed += flips;
+        return NAND_SIM_ECC_FIXED;
+    }
+
+    for (i = 0; i < flips; i++)
+    {
+        bit = (unsigned int)(nand_sim_rand(sim) % ((uint64_t)len * 8));
+        buf[bit / 8] ^= (unsigned char)(1U << (bit % 8));
+    }
+
+    sim->stats.ecc_failures++;
+
+    return NAND_SIM_ERR_ECC;
+}
+
+/**
+ * @brief Read the spare area of a page.
+ * @param sim  Simulator instance.
+ * @param page Page index.
+ * @param buf  Output buffer.
+ * @param len  Bytes to read, at most the spare size.
+ * @return NAND_SIM_OK on success, error code otherwise.
+ */
+int nand_sim_read_spare(struct nand_sim *sim, unsigned int page, unsigned char *buf, unsigned int len)
+{
+    unsigned char *src = NAND_SIM_NULL;
+    unsigned int i = 0;
+
+    if (buf == NAND_SIM_NULL || page >= nand_sim_pages_total(sim) || len > sim->cfg.spare_size)
+    {
+        return NAND_SIM_ERR_PARAM;
+    }
+
+    src = nand_sim_page_ptr(sim, page) + sim->cfg.page_size;
+
+    for (i = 0; i < len; i++)
+    {
+        buf[i] = (unsigned char)~src[i];
+    }
+
+    sim->stats.page_reads++;
+    sim->stats.bytes_read += len;
+    nand_sim_spend(sim, (uint64_t)sim->cfg.t_r_us * 1000, nand_sim_bus_ns(sim, NAND_SIM_READ_CMD_BYTES, len));
+
+    return NAND_SIM_OK;
+}
+
+/**
+ * @brief Program data into a page, as PROGRAM LOAD followed by PROGRAM EXECUTE.
+ *
+ * Programming only clears bits, like the real array. When the power cut is
+ * due, only the first half of the data reaches the array.
+ *
+ * @param sim    Simulator instance.
+ * @param page   Page index.
+ * @param offset Column offset in the page.
+ * @param buf    Data to program.
+ * @param len    Bytes to program, offset + len must not exceed the page size.
+ * @return NAND_SIM_OK on success, error code otherwise.
+ */
+int nand_sim_program(struct nand_sim *sim, unsigned int page, unsigned int offset, const unsigned char *buf, unsigned int len)
+{
+    unsigned char *dst = NAND_SIM_NULL;
+    unsigned int count = len;
+    unsigned int i = 0;
+    int cut = 0;
+
+    if (buf == NAND_SIM_NULL || page >= nand_sim_pages_total(sim) || offset + len > sim->cfg.page_size)
+    {
+        return NAND_SIM_ERR_PARAM;
+    }
+
+    nand_sim_spend(sim, 0, nand_sim_bus_ns(sim, NAND_SIM_PROG_CMD_BYTES, len));
+
+    if (nand_sim_is_bad(sim, page / sim->cfg.pages_per_block) || page / sim->cfg.pages_per_block < sim->protect_blocks)
+    {
+        sim->stats.program_fails++;
+        return NAND_SIM_ERR_P_FAIL;
+    }
+
+    cut = nand_sim_power_cut_due(sim);
+    if (cut)
+    {
+        count = len / 2;
+    }
+
+    dst = nand_sim_page_ptr(sim, page) + offset;
+
+    for (i = 0; i < count; i++)
+    {
+        dst[i] |= (unsigned char)~buf[i];
+    }
+
+    if (cut)
+    {
+        nand_sim_power_cut(sim);
+    }
+
+    sim->stats.page_programs++;
+    sim->stats.bytes_written += len;
+    nand_sim_spend(sim, (uint64_t)sim->cfg.t_prog_us * 1000, 0);
+
+    return NAND_SIM_OK;
+}
+
+/**
+ * @brief Erase a block (data and spare) to all 0xFF.
+ *
+ * When the power cut is due, only the first half of the pages are erased.
+ *
+ * @param sim   Simulator instance.
+ * @param block Block index.
+ * @return NAND_SIM_OK on success, error code otherwise.
+ */
+int nand_sim_erase(struct nand_sim *sim, unsigned int block)
+{
+    unsigned int pages = 0;
+    int cut = 0;
+
+    if (block >= sim->cfg.blocks_total)
+    {
+        return NAND_SIM_ERR_PARAM;
+    }
+
+    nand_sim_spend(sim, 0, nand_sim_bus_ns(sim, NAND_SIM_ERASE_CMD_BYTES, 0));
+
+    if (nand_sim_is_bad(sim, block) || block < sim->protect_blocks)
+    {
+        sim->stats.erase_fails++;
+        return NAND_SIM_ERR_E_FAIL;
+    }
+
+    pages = sim->cfg.pages_per_block;
+
+    cut = nand_sim_power_cut_due(sim);
+    if (cut)
+    {
+        pages /= 2;
+    }
+
+    memset(nand_sim_page_ptr(sim, block * sim->cfg.pages_per_block), 0, (size_t)pages * nand_sim_raw_page_size(sim));
+
+    if (cut)
+    {
+        nand_sim_power_cut(sim);
+    }
+
+    sim->stats.block_erases++;
+    nand_sim_spend(sim, (uint64_t)sim->cfg.t_bers_us * 1000, 0);
+
+    return NAND_SIM_OK;
+}
+
+/**
+ * @brief Clear operation counters and simulated time.
+ * @param sim Simulator instance.
+ */
+void nand_sim_reset_stats(struct nand_sim *sim)
+{
+    memset(&sim->stats, 0, sizeof(sim->stats));
+}
+
+/**
+ * @brief Print operation counters and simulated time.
+ * @param sim Simulator instance.
+ */
+void nand_sim_show_stats(struct nand_sim *sim)
+{
+    struct nand_sim_stats *s = &sim->stats;
+
+    printf("nand: %u x %u pages of %u+%u bytes, tR %uus tPROG %uus tBERS %uus, spi %uHz x%u\n",
+           sim->cfg.blocks_total, sim->cfg.pages_per_block, sim->cfg.page_size, sim->cfg.spare_size,
+           sim->cfg.t_r_us, sim->cfg.t_prog_us, sim->cfg.t_bers_us, sim->cfg.spi_hz, sim->cfg.bus_width);
+    printf("  reads    %10lu  (%lu bytes)\n", s->page_reads, s->bytes_read);
+    printf("  programs %10lu  (%lu bytes, %lu failed)\n", s->page_programs, s->bytes_written, s->program_fails);
+    printf("  erases   %10lu  (%lu failed)\n", s->block_erases, s->erase_fails);
+    printf("  ecc      %10lu bit flips fixed, %lu uncorrectable reads\n", s->bitflips_fixed, s->ecc_failures);
+    printf("  time     %10.3f ms  (array %.3f ms, bus %.3f ms)\n",
+           (double)(s->busy_ns + s->bus_ns) / 1e6, (double)s->busy_ns / 1e6, (double)s->bus_ns / 1e6);
+    fflush(stdout);
+}
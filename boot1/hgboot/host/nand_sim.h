@@ -0,0 +1,118 @@
+#ifndef __NAND_SIM_H__
+#define __NAND_SIM_H__
+
+#include <stdint.h>
+
+#define NAND_SIM_NULL            (0)
+
+#define NAND_SIM_PAGE_SIZE       2048     /* Default page size, matches the board SPI NAND */
+#define NAND_SIM_SPARE_SIZE      64       /* Default spare (OOB) size per page */
+#define NAND_SIM_PAGES_PER_BLOCK 64       /* Default pages per block */
+#define NAND_SIM_BLOCKS_TOTAL    2048     /* Default number of blocks */
+
+#define NAND_SIM_T_R_US          60       /* Default array to cache read time (tR) in us */
+#define NAND_SIM_T_PROG_US       400      /* Default page program time (tPROG) in us */
+#define NAND_SIM_T_BERS_US       3000     /* Default block erase time (tBERS) in us */
+#define NAND_SIM_SPI_HZ          50000000 /* Default SPI clock, 50MHz as set up by boot0 */
+#define NAND_SIM_BUS_WIDTH       1        /* Default data lines used for cache transfer */
+
+#define NAND_SIM_BAD_MAX         64       /* Maximum number of factory bad blocks on the command line */
+
+/**
+ * @enum nand_sim_errcode_t
+ * NAND simulator error codes, the status a real part reports after an operation.
+ */
+typedef enum
+{
+    NAND_SIM_OK          =  0,   /* Operation successful */
+    NAND_SIM_ECC_FIXED   =  1,   /* Read successful, bit flips corrected by on-die ECC */
+    NAND_SIM_ERR_PARAM   = -1,   /* Invalid parameter or address out of range */
+    NAND_SIM_ERR_IO      = -2,   /* Backing file error */
+    NAND_SIM_ERR_ECC     = -3,   /* Read returned uncorrectable data */
+    NAND_SIM_ERR_P_FAIL  = -4,   /* Program failed (bad or protected block) */
+    NAND_SIM_ERR_E_FAIL  = -5,   /* Erase failed (bad or protected block) */
+} nand_sim_errcode_t;
+
+/**
+ * @struct nand_sim_config
+ * Geometry, timing and fault injection setup of a simulated SPI NAND.
+ */
+struct nand_sim_config
+{
+    unsigned int page_size;          /* Data bytes per page */
+    unsigned int spare_size;         /* Spare bytes per page */
+    unsigned int pages_per_block;    /* Pages per erase block */
+    unsigned int blocks_total;       /* Number of erase blocks */
+
+    unsigned int t_r_us;             /* Page read (array to cache) time */
+    unsigned int t_prog_us;          /* Page program time */
+    unsigned int t_bers_us;          /* Block erase time */
+    unsigned int spi_hz;             /* SPI clock frequency */
+    unsigned int bus_width;          /* Data lines used for cache transfers (1/2/4) */
+    int          realtime;           /* Sleep for the simulated time as well */
+
+    unsigned int bad_blocks[NAND_SIM_BAD_MAX]; /* Factory bad blocks marked on image creation */
+    unsigned int bad_count;          /* Number of entries in bad_blocks */
+
+    double       bitflip_rate;       /* Probability of a bit flip per page read */
+    unsigned int ecc_bits;           /* Bit flips per page the on-die ECC corrects */
+    unsigned long power_cut_after;   /* Cut the power on the Nth program/erase, 0 disables */
+    unsigned int seed;               /* Seed of the fault injection random generator */
+};
+
+/**
+ * @struct nand_sim_stats
+ * Operation counters and simulated time of a simulated SPI NAND.
+ */
+struct nand_sim_stats
+{
+    unsigned long page_reads;        /* Page read operations */
+    unsigned long page_programs;     /* Page program operations */
+    unsigned long block_erases;      /* Block erase operations */
+    unsigned long bytes_read;        /* Bytes moved from cache to host */
+    unsigned long bytes_written;     /* Bytes moved from host to cache */
+    unsigned long bitflips_fixed;    /* Bit flips corrected by ECC */
+    unsigned long ecc_failures;      /* Reads with uncorrectable data */
+    unsigned long program_fails;     /* Programs rejected by a bad or protected block */
+    unsigned long erase_fails;       /* Erases rejected by a bad or protected block */
+    uint64_t      busy_ns;           /* Simulated time spent in tR/tPROG/tBERS */
+    uint64_t      bus_ns;            /* Simulated time spent on the SPI bus */
+};
+
+/**
+ * @struct nand_sim
+ * Simulated SPI NAND backed by an image file.
+ *
+ * The file holds blocks_total * pages_per_block pages of (page_size + spare_size)
+ * bytes each. Bytes are stored inverted, so a freshly created sparse file reads
+ * back as an erased (all 0xFF) device.
+ */
+struct nand_sim
+{
+    struct nand_sim_config cfg;      /* Active configuration */
+    struct nand_sim_stats  stats;    /* Counters since open or last reset */
+    int            fd;               /* Backing file descriptor */
+    unsigned char *map;              /* Mapped backing file */
+    uint64_t       map_size;         /* Size of the mapping */
+    unsigned long  wear_ops;         /* Program/erase operations since open */
+    unsigned int   protect_blocks;   /* Blocks from 0 write protected (BP bits), program/erase fail */
+    uint64_t       rand_state;       /* Fault injection random generator state */
+    void         (*power_cut)(struct nand_sim *sim); /* Called after a cut, must not return */
+};
+
+void nand_sim_default_config(struct nand_sim_config *cfg);
+
+int  nand_sim_open(struct nand_sim *sim, const char *path, const struct nand_sim_config *cfg);
+void nand_sim_close(struct nand_sim *sim);
+
+int  nand_sim_read(struct nand_sim *sim, unsigned int page, unsigned int offset, unsigned char *buf, unsigned int len);
+int  nand_sim_program(struct nand_sim *sim, unsigned int page, unsigned int offset, const unsigned char *buf, unsigned int len);
+int  nand_sim_erase(struct nand_sim *sim, unsigned int block);
+int  nand_sim_is_bad(struct nand_sim *sim, unsigned int block);
+
+int  nand_sim_read_spare(struct nand_sim *sim, unsigned int page, unsigned char *buf, unsigned int len);
+
+void nand_sim_reset_stats(struct nand_sim *sim);
+void nand_sim_show_stats(struct nand_sim *sim);
+
+#endif /* __NAND_SIM_H__ */
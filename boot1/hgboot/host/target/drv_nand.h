@@ -0,0 +1,24 @@
+#ifndef __DRV_NAND_H__
+#define __DRV_NAND_H__
+
+/*
+ * Host stand-in for boards/drv_nand.h: the handle geometry and boot area
+ * protection application/dram_op.c uses, backed by host_port.c.
+ */
+
+struct spi_nand_info
+{
+    unsigned int page_size;
+    unsigned int spare_size;
+    unsigned int pages_per_block;
+    unsigned int blocks_total;
+};
+
+struct spi_nand_handle
+{
+    struct spi_nand_info info;
+};
+
+int nand_boot_protect(struct spi_nand_handle *nand, int enable);
+
+#endif
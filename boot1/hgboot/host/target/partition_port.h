@@ -0,0 +1,12 @@
+#ifndef __PARTITION_PORT_H__
+#define __PARTITION_PORT_H__
+
+/* Host stand-in for boards/port/partition_port.h */
+
+#include "partition/partition.h"
+#include "host_port.h"
+
+#define PARTITION_TABLE_ADDR    HOST_PARTITION_TABLE_ADDR
+#define PARTITION_TABLE_SIZE    HOST_PARTITION_TABLE_SIZE
+
+#endif
@@ -0,0 +1,208 @@
+/***************************************************************************
+ * Copyright (c) 2025 HGBOOT Authors
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the MIT License which is available at
+ * https://opensource.org/licenses/MIT.
+ *
+ * SPDX-License-Identifier: MIT
+ **************************************************************************/
+
+#include "ymodem_send.h"
+
+#include <poll.h>
+#include <stdio.h>
+#include <string.h>
+#include <termios.h>
+#include <unistd.h>
+
+/* Minimal YMODEM-1K sender, the counterpart of hgboot/ymodem for host tests. */
+
+#define YS_SOH  0x01
+#define YS_STX  0x02
+#define YS_EOT  0x04
+#define YS_ACK  0x06
+#define YS_NAK  0x15
+#define YS_CAN  0x18
+#define YS_C    0x43
+#define YS_END  0x4f    /* RECV_END_CHAR of the receiver */
+
+#define YS_PACKET_128 128
+#define YS_PACKET_1K  1024
+
+static unsigned short ys_crc16(const unsigned char *buf, unsigned int len)
+{
+    unsigned short crc = 0;
+    unsigned int i = 0;
+    unsigned int j = 0;
+
+    for (i = 0; i < len; i++)
+    {
+        crc ^= (unsigned short)(buf[i] << 8);
+        for (j = 0; j < 8; j++)
+        {
+            crc = (crc & 0x8000) ? (unsigned short)((crc << 1) ^ 0x1021) : (unsigned short)(crc << 1);
+        }
+    }
+
+    return crc;
+}
+
+static int ys_write(int fd, const unsigned char *buf, unsigned int len)
+{
+    ssize_t n = 0;
+
+    while (len)
+    {
+        n = write(fd, buf, len);
+        if (n <= 0)
+        {
+            return -1;
+        }
+        buf += n;
+        len -= (unsigned int)n;
+    }
+
+    return 0;
+}
+
+/* Wait for one of the two wanted characters, everything else is skipped. */
+static int ys_wait(int fd, unsigned char want1, unsigned char want2)
+{
+    struct pollfd pfd = {0};
+    unsigned char ch = 0;
+
+    pfd.fd     = fd;
+    pfd.events = POLLIN;
+
+    for (;;)
+    {
+        if (poll(&pfd, 1, YMODEM_SEND_TIMEOUT_MS) <= 0)
+        {
+            return -1;
+        }
+
+        if (read(fd, &ch, 1) != 1)
+        {
+            return -1;
+        }
+
+        if (ch == want1 || ch == want2)
+        {
+            return ch;
+        }
+
+        if (ch == YS_CAN)
+        {
+            return -1;
+        }
+    }
+}
+
+static int ys_send_packet(int fd, unsigned char num, const unsigned char *data, unsigned int len, unsigned int pkg_size)
+{
+    unsigned char frame[3 + YS_PACKET_1K + 2];
+    unsigned short crc = 0;
+    unsigned int retry = 0;
+
+    frame[0] = (pkg_size == YS_PACKET_1K) ? YS_STX : YS_SOH;
+    frame[1] = num;
+    frame[2] = (unsigned char)~num;
+    memset(&frame[3], (data != NULL && len != 0) ? 0x1A : 0x00, pkg_size);
+    if (len)
+    {
+        memcpy(&frame[3], data, len);
+    }
+    crc = ys_crc16(&frame[3], pkg_size);
+    frame[3 + pkg_size] = (unsigned char)(crc >> 8);
+    frame[4 + pkg_size] = (unsigned char)(crc & 0xFF);
+
+    for (retry = 0; retry < YMODEM_SEND_RETRY; retry++)
+    {
+        if (ys_write(fd, frame, pkg_size + 5) != 0)
+        {
+            return -1;
+        }
+
+        if (ys_wait(fd, YS_ACK, YS_NAK) == YS_ACK)
+        {
+            return 0;
+        }
+    }
+
+    return -1;
+}
+
+/**
+ * @brief Send a buffer as one YMODEM file over a file descriptor.
+ * @param fd   Descriptor connected to the receiver (pty slave).
+ * @param name File name put into block 0.
+ * @param data File data.
+ * @param size File size in bytes.
+ * @return 0 on success, -1 on failure.
+ */
+int ymodem_send_fd(int fd, const char *name, const unsigned char *data, unsigned int size)
+{
+    unsigned char block0[YS_PACKET_128] = {0};
+    unsigned int name_len = 0;
+    unsigned int offset = 0;
+    unsigned int chunk = 0;
+    unsigned char num = 1;
+
+    name_len = (unsigned int)strlen(name);
+    if (name_len + 16 > sizeof(block0))
+    {
+        return -1;
+    }
+
+    if (ys_wait(fd, YS_C, YS_C) < 0)
+    {
+        fprintf(stderr, "ymodem send: no receiver\n");
+        return -1;
+    }
+
+    /* Drop the 'C' the receiver repeated while we were not listening */
+    tcflush(fd, TCIFLUSH);
+
+    memcpy(block0, name, name_len);
+    snprintf((char *)&block0[name_len + 1], sizeof(block0) - name_len - 1, "%u ", size);
+
+    if (ys_send_packet(fd, 0, block0, sizeof(block0), YS_PACKET_128) != 0 || ys_wait(fd, YS_C, YS_C) < 0)
+    {
+        fprintf(stderr, "ymodem send: header rejected\n");
+        return -1;
+    }
+
+    while (offset < size)
+    {
+        chunk = (size - offset > YS_PACKET_1K) ? YS_PACKET_1K : (size - offset);
+
+        if (ys_send_packet(fd, num, data + offset, chunk, YS_PACKET_1K) != 0)
+        {
+            fprintf(stderr, "ymodem send: packet %u rejected\n", num);
+            return -1;
+        }
+
+        offset += chunk;
+        num++;
+    }
+
+    block0[0] = YS_EOT;
+    if (ys_write(fd, block0, 1) != 0 || ys_wait(fd, YS_NAK, YS_ACK) < 0)
+    {
+        return -1;
+    }
+
+    if (ys_write(fd, block0, 1) != 0 || ys_wait(fd, YS_ACK, YS_ACK) < 0 || ys_wait(fd, YS_C, YS_C) < 0)
+    {
+        return -1;
+    }
+
+    /* Empty block 0 closes the batch */
+    if (ys_send_packet(fd, 0, NULL, 0, YS_PACKET_128) != 0)
+    {
+        return -1;
+    }
+
+    return (ys_wait(fd, YS_END, YS_END) == YS_END) ? 0 : -1;
+}
@@ -0,0 +1,9 @@
+#ifndef __YMODEM_SEND_H__
+#define __YMODEM_SEND_H__
+
+#define YMODEM_SEND_TIMEOUT_MS  10000   /* Time to wait for each receiver answer */
+#define YMODEM_SEND_RETRY       10      /* Resends of a packet the receiver NAKs */
+
+int ymodem_send_fd(int fd, const char *name, const unsigned char *data, unsigned int size);
+
+#endif /* __YMODEM_SEND_H__ */
@@ -12,8 +12,6 @@
 
 #define OTA_NULL        0
 
-#define BACKUP_FLAG     0xbaU
-
 #if OTA_LOG_LEVEL > OTA_LOG_NONE
 #include "shell/shell.h"
 #endif
@@ -96,6 +94,127 @@ unsigned int ota_crc32_update(unsigned int crc, const unsigned char *data, unsig
     return crc;
 }
 
+static unsigned int ota_param_crc(const struct ota_paramers *para)
+{
+    return ota_crc32_update(0xFFFFFFFF, (const unsigned char *)para, sizeof(struct ota_paramers) - sizeof(para->crc32)) ^ 0xFFFFFFFF;
+}
+
+/* Read and check the record of one partition, one written before seq existed counts as seq 0 */
+static int ota_param_check(const char *part_name, struct ota_paramers *para)
+{
+    int ret = 0;
+
+    ret = partition_read(part_name, (void *)para, 0, sizeof(struct ota_paramers));
+    if (ret != 0)
+    {
+        return ret;
+    }
+
+    if (para->magic != OTA_PARA_MAGIC)
+    {
+        return OTA_ERR_CHECK;
+    }
+
+    if (para->crc32 != ota_param_crc(para) && (para->seq != 0 || para->crc32 != 0xFFFFFFFF))
+    {
+        OTA_WARN("ota parameter in %s crc32 err. 0x%x\r\n", part_name, para->crc32);
+        return OTA_ERR_CHECK;
+    }
+
+    return OTA_OK;
+}
+
+/*
+ * Function: ota_param_load
+ * ------------------------
+ * Reads the current OTA parameter record: the valid one of PARA_PART and
+ * PARA2_PART with the higher sequence number. para is cleared when neither
+ * is valid.
+ *
+ * Returns:
+ *   0 on success,
+ *   OTA_ERR_CHECK if no valid record is found.
+ */
+int ota_param_load(struct ota_paramers *para)
+{
+    struct ota_paramers second = {0};
+    int ret                    = 0;
+
+    ret = ota_param_check(PARA_PART, para);
+    if (ota_param_check(PARA2_PART, &second) == OTA_OK && (ret != OTA_OK || (int)(second.seq - para->seq) > 0))
+    {
+        *para = second;
+        ret   = OTA_OK;
+    }
+
+    if (ret != OTA_OK)
+    {
+        OTA_ERR("ota parameter check err. no valid record in %s or %s\r\n", PARA_PART, PARA2_PART);
+        *para = (struct ota_paramers){0};
+        return OTA_ERR_CHECK;
+    }
+
+    OTA_INFO("ota parameter seq %d : active_slot 0x%x can_be_back 0x%x upgrade_ready %d\r\n",
+             para->seq, para->active_slot, para->can_be_back, para->upgrade_ready);
+
+    return OTA_OK;
+}
+
+/*
+ * Function: ota_param_save
+ * ------------------------
+ * Writes para as the new current record, with the next sequence number, into
+ * the partition that does not hold the current one. The current record is
+ * never erased, a power cut before the write completes keeps it in force.
+ * A partition table without PARA2_PART only has room to rewrite in place.
+ *
+ * Returns:
+ *   0 on success,
+ *   OTA_ERR_PARTITION if partition operation fails.
+ */
+int ota_param_save(struct ota_paramers *para)
+{
+    struct ota_paramers first  = {0};
+    struct ota_paramers second = {0};
+    const char *part_name      = PARA2_PART;
+    int ret1                   = 0;
+    int ret2                   = 0;
+    int ret                    = 0;
+
+    ret1 = ota_param_check(PARA_PART, &first);
+    ret2 = ota_param_check(PARA2_PART, &second);
+
+    para->magic = OTA_PARA_MAGIC;
+    para->seq   = (ret1 == OTA_OK) ? first.seq + 1 : 1;
+    if (ret2 == OTA_OK && (ret1 != OTA_OK || (int)(second.seq - first.seq) > 0))
+    {
+        para->seq = second.seq + 1;
+        part_name = PARA_PART;
+    }
+    else if (ret2 == PARTITION_ERR_NOEXIST)
+    {
+        OTA_WARN("ota no partition %s, rewriting %s in place\r\n", PARA2_PART, PARA_PART);
+        part_name = PARA_PART;
+    }
+    para->crc32 = ota_param_crc(para);
+
+    ret = partition_erase(part_name, 0, sizeof(struct ota_paramers));
+    if (ret != 0)
+    {
+        OTA_ERR("ota erase partition %s from offset %d err. %d\r\n", part_name, 0, ret);
+        return OTA_ERR_PARTITION;
+    }
+
+    ret = partition_write(part_name, (void *)para, 0, sizeof(struct ota_paramers));
+    if (ret != 0)
+    {
+        OTA_ERR("ota write partition %s at offset %d err. %d\r\n", part_name, 0, ret);
+        return OTA_ERR_PARTITION;
+    }
+
+    return OTA_OK;
+}
+
 static void ota_ymodem_start(ymodem_head_t *head)
 {
     OTA_TRACE("ota ymdoem recv start.\r\n");
@@ -226,40 +345,13 @@ int ota_download_firmware(void)
         return OTA_ERR_CHECK;
     }
 
-    ret = partition_read(PARA_PART, (void *)&para, 0, sizeof(struct ota_paramers));
-    if (ret != 0)
-    {
-        OTA_ERR("ota read partition %s from offset %d err. %d\r\n", PARA_PART, 0, ret);
-        return OTA_ERR_PARTITION;
-    }
+    /* A blank device has no record yet, the first one starts from scratch */
+    ota_param_load(&para);
 
-    OTA_INFO("ota read partition %s info : para.magic         0x%08x\r\n", PARA_PART, para.magic);
-    OTA_INFO("ota read partition %s info : para.active_slot   0x%08x\r\n", PARA_PART, para.active_slot);
-    OTA_INFO("ota read partition %s info : para.can_be_back   0x%08x\r\n", PARA_PART, para.can_be_back);
-    OTA_INFO("ota read partition %s info : para.upgrade_ready 0x%08x\r\n", PARA_PART, para.upgrade_ready);
-    OTA_INFO("ota read partition %s info : para.app1_crc      0x%08x\r\n", PARA_PART, para.app1_crc);
-    OTA_INFO("ota read partition %s info : para.app2_crc      0x%08x\r\n", PARA_PART, para.app2_crc);
-    OTA_INFO("ota read partition %s info : para.download_crc  0x%08x\r\n", PARA_PART, para.download_crc);
-
-    para.magic         = OTA_PARA_MAGIC;
     para.download_crc  = crc32;
     para.upgrade_ready = 1;
 
-    ret = partition_erase(PARA_PART, 0, sizeof(struct ota_paramers));
-    if (ret != 0)
-    {
-        OTA_ERR("ota erase partition %s from offset %d err. %d\r\n", PARA_PART, 0, ret);
-        return OTA_ERR_PARTITION;
-    }
-
-    ret = partition_write(PARA_PART, (void *)&para, 0, sizeof(struct ota_paramers));
-    if (ret != 0)
-    {
-        OTA_ERR("ota write partition %s at offset %d err. %d\r\n", PARA_PART, 0, ret);
-        return OTA_ERR_PARTITION;
-    }
-
-    return 0;
+    return ota_param_save(&para);
 }
 
 /*
@@ -283,27 +375,10 @@ int ota_update_firmware(void)
     unsigned int remain_size      = 0;
     unsigned int offset           = 0;
 
-    ret = partition_read(PARA_PART, (void *)&para, 0, sizeof(struct ota_paramers));
-    if (ret != 0)
-    {
-        OTA_ERR("ota read partition %s from offset %d err. %d\r\n", PARA_PART, 0, ret);
-        ret = OTA_ERR_PARTITION;
-        goto exit;
-    }
-
-    OTA_INFO("ota read partition %s info : para.magic         0x%08x\r\n", PARA_PART, para.magic);
-    OTA_INFO("ota read partition %s info : para.active_slot   0x%08x\r\n", PARA_PART, para.active_slot);
-    OTA_INFO("ota read partition %s info : para.can_be_back   0x%08x\r\n", PARA_PART, para.can_be_back);
-    OTA_INFO("ota read partition %s info : para.upgrade_ready 0x%08x\r\n", PARA_PART, para.upgrade_ready);
-    OTA_INFO("ota read partition %s info : para.app1_crc      0x%08x\r\n", PARA_PART, para.app1_crc);
-    OTA_INFO("ota read partition %s info : para.app2_crc      0x%08x\r\n", PARA_PART, para.app2_crc);
-    OTA_INFO("ota read partition %s info : para.download_crc  0x%08x\r\n", PARA_PART, para.download_crc);
-
-    if (para.magic != OTA_PARA_MAGIC)
+    ret = ota_param_load(&para);
+    if (ret != OTA_OK)
     {
-        OTA_ERR("ota parameter magic err. 0x%x != 0x%x\r\n", para.magic, OTA_PARA_MAGIC);
-        ret = OTA_ERR_CHECK;
-        goto exit;
+        return ret;
     }
 
     if (para.upgrade_ready)
@@ -421,19 +496,9 @@ int ota_update_firmware(void)
     }
 
 exit:
-    para.magic         = OTA_PARA_MAGIC;
     para.upgrade_ready = 0;
-    ret = partition_erase(PARA_PART, 0, sizeof(struct ota_paramers));
-    if (ret != 0)
-    {
-        OTA_ERR("ota erase partition %s from offset %d err. %d\r\n", PARA_PART, 0, ret);
-        return OTA_ERR_PARTITION;
-    }
-
-    ret = partition_write(PARA_PART, (void *)&para, 0, sizeof(struct ota_paramers));
-    if (ret != 0)
+    if (ota_param_save(&para) != OTA_OK)
     {
-        OTA_ERR("ota write partition %s at offset %d err. %d\r\n", PARA_PART, 0, ret);
         return OTA_ERR_PARTITION;
     }
 
@@ -459,25 +524,10 @@ int ota_backup_firmware(void)
     struct ota_paramers para      = {0};
     struct firmware_header header = {0};
 
-    ret = partition_read(PARA_PART, (void *)&para, 0, sizeof(struct ota_paramers));
-    if (ret != 0)
-    {
-        OTA_ERR("ota read partition %s from offset %d err. %d\r\n", PARA_PART, 0, ret);
-        return OTA_ERR_PARTITION;
-    }
-
-    OTA_INFO("ota read partition %s info : para.magic         0x%08x\r\n", PARA_PART, para.magic);
-    OTA_INFO("ota read partition %s info : para.active_slot   0x%08x\r\n", PARA_PART, para.active_slot);
-    OTA_INFO("ota read partition %s info : para.can_be_back   0x%08x\r\n", PARA_PART, para.can_be_back);
-    OTA_INFO("ota read partition %s info : para.upgrade_ready 0x%08x\r\n", PARA_PART, para.upgrade_ready);
-    OTA_INFO("ota read partition %s info : para.app1_crc      0x%08x\r\n", PARA_PART, para.app1_crc);
-    OTA_INFO("ota read partition %s info : para.app2_crc      0x%08x\r\n", PARA_PART, para.app2_crc);
-    OTA_INFO("ota read partition %s info : para.download_crc  0x%08x\r\n", PARA_PART, para.download_crc);
-
-    if (para.magic != OTA_PARA_MAGIC)
+    ret = ota_param_load(&para);
+    if (ret != OTA_OK)
     {
-        OTA_ERR("ota parameter magic err. 0x%x != 0x%x\r\n", para.magic, OTA_PARA_MAGIC);
-        return OTA_ERR_CHECK;
+        return ret;
     }
 
     if (para.can_be_back == BACKUP_FLAG)
@@ -532,18 +582,10 @@ int ota_backup_firmware(void)
             }
         }
 
-        ret = partition_erase(PARA_PART, 0, sizeof(struct ota_paramers));
-        if (ret != 0)
-        {
-            OTA_ERR("ota erase partition %s from offset %d err. %d\r\n", PARA_PART, 0, ret);
-            return OTA_ERR_PARTITION;
-        }
-
-        ret = partition_write(PARA_PART, (void *)&para, 0, sizeof(struct ota_paramers));
-        if (ret != 0)
+        ret = ota_param_save(&para);
+        if (ret != OTA_OK)
         {
-            OTA_ERR("ota write partition %s at offset %d err. %d\r\n", PARA_PART, 0, ret);
-            return OTA_ERR_PARTITION;
+            return ret;
         }
 
         if (can_backup == 0)
@@ -13,6 +13,7 @@
 #define APP1_PART  "APP1"                /* Partition name for application slot 1 */
 #define APP2_PART  "APP2"                /* Partition name for application slot 2 */
 #define PARA_PART  "Param"               /* Partition name for OTA parameters */
+#define PARA2_PART "Param2"              /* Partition name for the second OTA parameter record */
 
 #define OTA_LOG_NONE     0               /* OTA log level: no output */
 #define OTA_LOG_ERROR    1               /* OTA log level: error output */
@@ -25,6 +26,7 @@
 
 #define APP_SLOT_1       0xa1U           /* Application slot 1 index */
 #define APP_SLOT_2       0xa2U           /* Application slot 2 index */
+#define BACKUP_FLAG      0xbaU           /* can_be_back value when the other slot holds a bootable image */
 
 /**
  * @enum ota_errcode_t
@@ -52,12 +54,33 @@ struct firmware_header
     unsigned int version;      /* Firmware version */
     unsigned int load_addr;    /* Address to load firmware */
     unsigned int exec_addr;    /* Firmware execution entry address */
-    unsigned int reseved[2];   /* Reserved for future use */
+    unsigned int seg_count;    /* Entries in the segment table after the header, 0 for a flat image */
+    unsigned int seg_crc32;    /* CRC32 checksum of the segment table */
+};
+
+#define OTA_SEG_MAX        16    /* Maximum number of segments in a scatter-load image */
+#define OTA_SEG_ZERO_FILL  0x01U /* Clear the bytes between file_size and mem_size */
+
+/**
+ * @struct firmware_segment
+ * Scatter-load segment entry. The table follows the header, the file bytes of
+ * each segment follow the table back to back in table order.
+ */
+struct firmware_segment
+{
+    unsigned int load_addr;    /* Address to load the segment */
+    unsigned int file_size;    /* Bytes stored in the image */
+    unsigned int mem_size;     /* Bytes occupied in memory, >= file_size */
+    unsigned int flags;        /* OTA_SEG_* flags */
+    unsigned int crc32;        /* CRC32 checksum of the file bytes */
 };
 
 /**
  * @struct ota_paramers
  * OTA parameter structure, stores OTA status and CRCs for slots.
+ * One record each in PARA_PART and PARA2_PART, the valid one with the higher
+ * seq is current. A save always goes to the other one, so a power cut during
+ * it leaves the current record intact.
  */
 struct ota_paramers
 {
@@ -68,9 +91,13 @@ struct ota_paramers
     unsigned int app1_crc;      /* CRC32 of APP1 slot */
     unsigned int app2_crc;      /* CRC32 of APP2 slot */
     unsigned int download_crc;  /* CRC32 of downloaded firmware */
-    unsigned int reserved;      /* Reserved for future use */
+    unsigned int seq;           /* Incremented by every save, 0 on records from before it existed */
+    unsigned int crc32;         /* CRC32 of the fields above, still erased on records from before seq */
 };
 
+int ota_param_load(struct ota_paramers *para);
+int ota_param_save(struct ota_paramers *para);
+
 int ota_download_firmware(void);
 int ota_update_firmware(void);
 int ota_backup_firmware(void);
@@ -565,7 +565,14 @@ int partition_unregister(const char *partition_name)
 
     if (part->id != (partition_num))
     {
-        partition_memmove(&partition_table[part->id], &partition_table[part->id + 1], (partition_num - part->id) * sizeof(struct partition));
+        /* part now points at the moved entry, renumber from its slot */
+        i = part->id;
+        partition_memmove(&partition_table[i], &partition_table[i + 1], (partition_num - i) * sizeof(struct partition));
+
+        for (; i < partition_num; i++)
+        {
+            partition_table[i].id = i;
+        }
     }
 
     for (i = 0; i < PARTITION_NAME_MAX; i++)
@@ -578,6 +585,181 @@ int partition_unregister(const char *partition_name)
     return PARTITION_OK;
 }
 
+static unsigned int partition_crc32(unsigned int crc, const unsigned char *data, unsigned int len)
+{
+    int i = 0;
+
+    while (len--)
+    {
+        crc ^= *data++;
+        for (i = 0; i < 8; i++)
+        {
+            crc = (crc >> 1) ^ (0xEDB88320U & (0U - (crc & 1U)));
+        }
+    }
+
+    return crc;
+}
+
+/**
+ * @brief Replace the partitions of a device with an on-flash partition table.
+ *
+ * The table is only applied when magic, version, entry count and CRC are
+ * valid and no entry overlaps another or reuses a name, otherwise the
+ * partitions registered so far are left untouched so the caller can try
+ * another copy or fall back to a built in layout.
+ *
+ * @param dev_name Name of the device holding the table and the partitions.
+ * @param addr Address of the table on the device.
+ * @return PARTITION_OK on success, PARTITION_ERR_CHECK if no valid table is found at addr, error code otherwise.
+ */
+int partition_table_load(const char *dev_name, unsigned int addr)
+{
+    static unsigned char buffer[sizeof(struct partition_table_header) + PARTITION_MAX * sizeof(struct partition_table_entry)];
+    struct partition_table_header *header = (struct partition_table_header *)buffer;
+    struct partition_table_entry *entry   = (struct partition_table_entry *)(buffer + sizeof(struct partition_table_header));
+    struct partition_device *dev          = PARTITION_NULL;
+    char name[PARTITION_NAME_MAX + 1]     = {0};
+    unsigned int crc32                    = 0;
+    unsigned int len                      = 0;
+    unsigned int kept                     = 0;
+    int ret                               = 0;
+    int i                                 = 0;
+    int j                                 = 0;
+
+    if (dev_name == PARTITION_NULL)
+    {
+        PART_ERR("partition table load err. dev_name is NULL\r\n");
+        return PARTITION_ERR_PARAM;
+    }
+
+    dev = partition_device_find(dev_name);
+    if (dev == PARTITION_NULL || dev->ops->read == PARTITION_NULL)
+    {
+        PART_ERR("partition table load err. partition device %s is not exist\r\n", dev_name);
+        return PARTITION_ERR_NOEXIST;
+    }
+
+    if ((addr + sizeof(buffer)) > dev->size)
+    {
+        return PARTITION_ERR_SIZE;
+    }
+
+    ret = dev->ops->read(addr, buffer, sizeof(struct partition_table_header));
+    if (ret != 0)
+    {
+        PART_WARN("partition table read at 0x%08x err. %d\r\n", addr, ret);
+        return ret;
+    }
+
+    if (header->magic != PARTITION_TABLE_MAGIC || header->version != PARTITION_TABLE_VERSION ||
+        header->count == 0 || header->count > PARTITION_MAX)
+    {
+        PART_WARN("partition table at 0x%08x not found\r\n", addr);
+        return PARTITION_ERR_CHECK;
+    }
+
+    len = header->count * sizeof(struct partition_table_entry);
+    ret = dev->ops->read(addr + sizeof(struct partition_table_header), (unsigned char *)entry, len);
+    if (ret != 0)
+    {
+        PART_WARN("partition table read at 0x%08x err. %d\r\n", addr, ret);
+        return ret;
+    }
+
+    crc32         = header->crc32;
+    header->crc32 = 0;
+    if ((partition_crc32(0xFFFFFFFFU, buffer, sizeof(struct partition_table_header) + len) ^ 0xFFFFFFFFU) != crc32)
+    {
+        PART_WARN("partition table at 0x%08x crc32 err.\r\n", addr);
+        return PARTITION_ERR_CHECK;
+    }
+
+    /* Everything partition_register() could refuse is checked before the old set goes away */
+    kept = 0;
+    for (j = 0; j < partition_num; j++)
+    {
+        if (partition_table[j].dev != dev)
+        {
+            kept++;
+        }
+    }
+
+    if (kept + header->count > PARTITION_MAX)
+    {
+        PART_WARN("partition table at 0x%08x has too many entries\r\n", addr);
+        return PARTITION_ERR_CHECK;
+    }
+
+    for (i = 0; i < header->count; i++)
+    {
+        if (entry[i].name[0] == 0 || (entry[i].start + entry[i].size) > dev->size || entry[i].start + entry[i].size < entry[i].start)
+        {
+            PART_WARN("partition table at 0x%08x entry %d out of range\r\n", addr, i);
+            return PARTITION_ERR_CHECK;
+        }
+
+        partition_memmove(name, entry[i].name, PARTITION_NAME_MAX);
+        name[PARTITION_NAME_MAX - 1] = 0;
+
+        /* Names are looked up by prefix, duplicates are judged the same way */
+        for (j = 0; j < partition_num; j++)
+        {
+            if (partition_table[j].dev != dev && 0 == partition_strncmp(name, partition_table[j].name, partition_strlen(name)))
+            {
+                PART_WARN("partition table at 0x%08x entry %s exists on device %s\r\n", addr, name, partition_table[j].dev->name);
+                return PARTITION_ERR_CHECK;
+            }
+        }
+
+        for (j = 0; j < i; j++)
+        {
+            if (0 == partition_strncmp(name, entry[j].name, partition_strlen(name)))
+            {
+                PART_WARN("partition table at 0x%08x entry %s duplicated\r\n", addr, name);
+                return PARTITION_ERR_CHECK;
+            }
+
+            if (entry[i].start < entry[j].start + entry[j].size && entry[j].start < entry[i].start + entry[i].size)
+            {
+                PART_WARN("partition table at 0x%08x entry %d overlaps entry %d\r\n", addr, i, j);
+                return PARTITION_ERR_CHECK;
+            }
+        }
+    }
+
+    /* The table is good, it replaces whatever the device had registered */
+    i = 0;
+    while (i < partition_num)
+    {
+        if (partition_table[i].dev == dev)
+        {
+            partition_memmove(name, partition_table[i].name, PARTITION_NAME_MAX);
+            (void)partition_unregister(name);
+        }
+        else
+        {
+            i++;
+        }
+    }
+
+    for (i = 0; i < header->count; i++)
+    {
+        partition_memmove(name, entry[i].name, PARTITION_NAME_MAX);
+        name[PARTITION_NAME_MAX - 1] = 0;
+
+        ret = partition_register(name, dev_name, entry[i].start, entry[i].size);
+        if (ret != PARTITION_OK)
+        {
+            return ret;
+        }
+    }
+
+    PART_INFO("partition table at 0x%08x loaded, %d partitions\r\n", addr, header->count);
+
+    return PARTITION_OK;
+}
+
 /**
  * @brief Print partition information to the log.
  */
@@ -6,6 +6,9 @@
 #define PARTITION_DEV_MAX         5     /* Maximum number of partition devices supported */
 #define PARTITION_MAX             20    /* Maximum number of partitions supported */
 
+#define PARTITION_TABLE_MAGIC   0x4C425450  /* Magic number of the on-flash partition table ('PTBL') */
+#define PARTITION_TABLE_VERSION 1           /* On-flash partition table layout version */
+
 #define PARTITION_LOG_NONE     0        /* Partition log level: no output */
 #define PARTITION_LOG_ERROR    1        /* Partition log level: error output */
 #define PARTITION_LOG_WARN     2        /* Partition log level: warning output */
@@ -25,6 +28,7 @@ typedef enum
     PARTITION_ERR_EXIST   = -4,  /* Partition/device already exists */
     PARTITION_ERR_NOEXIST = -5,  /* Partition/device does not exist */
     PARTITION_ERR_UNKNOWN = -6,  /* Unknown error */
+    PARTITION_ERR_CHECK   = -7,  /* On-flash partition table magic, version or CRC check failed */
 } partition_errcode_t; /* partition_errcode_t: Error codes for partition operations. */
 
 /* Device operation structure for partition device abstraction. Users should implement these low-level functions for their storage device. */
@@ -36,6 +40,37 @@ typedef struct partition_dev_ops
     int (*erase)(unsigned int addr, unsigned int size);                      /* Erase data on device */
 } partition_dev_ops_t; /* partition_dev_ops_t: Device operation structure for partition device abstraction. */
 
+/* What a factory image put into a partition (tool/mk_nand.c), informational for the runtime. */
+typedef enum
+{
+    PARTITION_TYPE_RAW    = 0,   /* Left erased */
+    PARTITION_TYPE_BOOT0  = 1,   /* boot0 with BROM checksum */
+    PARTITION_TYPE_TABLE  = 2,   /* This partition table, one copy per good block */
+    PARTITION_TYPE_BOOT1  = 3,   /* boot1, copies spaced size / copies apart */
+    PARTITION_TYPE_APP    = 4,   /* pack.py firmware image */
+    PARTITION_TYPE_PARAM  = 5,   /* OTA parameter record */
+    PARTITION_TYPE_LFS    = 6,   /* Formatted littlefs */
+} partition_type_t; /* partition_type_t: Content types of the on-flash partition table. */
+
+/* On-flash partition table header, followed by count entries. Little endian. */
+typedef struct partition_table_header
+{
+    unsigned int magic;                 /* PARTITION_TABLE_MAGIC */
+    unsigned int version;               /* PARTITION_TABLE_VERSION */
+    unsigned int count;                 /* Number of entries, at most PARTITION_MAX */
+    unsigned int crc32;                 /* CRC32 of the header with crc32 = 0 followed by the entries */
+} partition_table_header_t; /* partition_table_header_t: On-flash partition table header. */
+
+/* On-flash partition table entry. */
+typedef struct partition_table_entry
+{
+    char name[PARTITION_NAME_MAX];      /* Partition name, NUL padded */
+    unsigned int start;                 /* Start address on the device */
+    unsigned int size;                  /* Size in bytes */
+    unsigned int type;                  /* partition_type_t */
+    unsigned int copies;                /* Redundant copies of the content, 1 if not redundant */
+} partition_table_entry_t; /* partition_table_entry_t: On-flash partition table entry. */
+
 int partition_device_register(const char *dev_name, struct partition_dev_ops *ops, unsigned int size);
 int partition_device_unregister(const char *dev_name);
 int partition_device_init(const char *dev_name);
@@ -43,6 +78,8 @@ int partition_device_init(const char *dev_name);
 int partition_register(const char *partition_name, const char *dev_name, unsigned int start, unsigned int size);
 int partition_unregister(const char *partition_name);
 
+int partition_table_load(const char *dev_name, unsigned int addr);
+
 int partition_read(const char *partition_name, void *buf, unsigned int offset, unsigned int len);
 int partition_write(const char *partition_name, void *buf, unsigned int offset, unsigned int len);
 int partition_erase(const char *partition_name, unsigned int offset, unsigned int len);
@@ -8,6 +8,7 @@
  * SPDX-License-Identifier: MIT
  **************************************************************************/
 
+#include <stdint.h>
 #include "shell/shell.h"
 
 struct shell_input
@@ -43,6 +44,9 @@ static struct shell_command shell_cmd_list =
 static struct shell_input   shell_in    = {0};
 static struct shell_history shell_his   = {0};
 
+static char         printf_buf[SHELL_PRINTF_BUF] = {0};
+static unsigned int printf_len = 0;
+
 shell_port_t *s_port = SHELL_NULL;
 
 /* >>>>>>>>>>>>>>>>>cmds<<<<<<<<<<<<<<<<<<<<<<<<< */
@@ -601,7 +605,7 @@ static int hexdump(int argc, char **argv)
         {
             if (i + j < len)
             {
-                val = *((unsigned char *)(start_base + i + j));
+                val = *((unsigned char *)(uintptr_t)(start_base + i + j));
                 s_printf("%02X ", val);
                 ascii_buf[j] = (val >= 32 && val <= 126) ? val : '.';
             }
@@ -650,7 +654,7 @@ int shell_init(shell_port_t *port, const char *sheel_headtag)
 {
     int i = 0;
 
-    if (port == SHELL_NULL || s_port->shell_putchar == SHELL_NULL || s_port->shell_getchar == SHELL_NULL)
+    if (port == SHELL_NULL || port->shell_putchar == SHELL_NULL || port->shell_getchar == SHELL_NULL)
     {
         s_port = SHELL_NULL;
         return -1;
@@ -712,8 +716,44 @@ void shell_servise(void)
     }
 }
 
+static void printf_buf_flush(void)
+{
+    unsigned int i = 0;
+
+    if (printf_len == 0)
+    {
+        return;
+    }
+
+    if (s_port->shell_write)
+    {
+        s_port->shell_write(printf_buf, printf_len);
+    }
+    else
+    {
+        for (i = 0; i < printf_len; i++)
+        {
+            s_port->shell_putchar(printf_buf[i]);
+        }
+    }
+
+    printf_len = 0;
+}
+
+static void printf_buf_putc(char ch)
+{
+    printf_buf[printf_len++] = ch;
+
+    if (printf_len >= SHELL_PRINTF_BUF)
+    {
+        printf_buf_flush();
+    }
+}
+
 /**
  * @brief Print formatted output to the shell.
+ * @note  The output is rendered into a local buffer and handed to the port in
+ *        one call, not one character at a time.
  * @param fmt Format string.
  * @param ... Variable arguments for formatting.
  */
@@ -727,6 +767,21 @@ void s_printf(const char *fmt, ...)
     }
 
     va_start(args, fmt);
-    xvformat(s_port->shell_putchar, fmt, args);
+    xvformat(printf_buf_putc, fmt, args);
     va_end(args);
+
+    printf_buf_flush();
+}
+
+/**
+ * @brief Block until all pending shell output has been sent.
+ */
+void s_flush(void)
+{
+    if (s_port == SHELL_NULL || s_port->shell_flush == SHELL_NULL)
+    {
+        return;
+    }
+
+    s_port->shell_flush();
 }
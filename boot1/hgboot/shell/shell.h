@@ -11,6 +11,7 @@
 #define CMD_HISTORY_DEPTH   5                   /* Depth of command history */
 #define CMD_BUF_SIZE        128                 /* Size of the command buffer */
 #define CMD_MAX_ARGV        10                  /* Maximum number of command arguments */
+#define SHELL_PRINTF_BUF    256                 /* Size of the s_printf render buffer */
 
 /* shell_cmd_func_t: Function pointer type for shell command handlers. */
 typedef int (*shell_cmd_func_t)(int argc, char **argv); /* shell_cmd_func_t: Function pointer for shell command. */
@@ -20,6 +21,8 @@ typedef struct shell_port
 {
     void (*shell_putchar)(char ch);             /* Output a character */
     char (*shell_getchar)(void);                /* Input a character */
+    void (*shell_write)(const char *buf, unsigned int len); /* Output a buffer in one call, optional */
+    void (*shell_flush)(void);                  /* Wait until all output has been sent, optional */
 } shell_port_t; /* shell_port_t: Shell port interface for low-level input/output. */
 
 /* shell_command: Shell command structure. */
@@ -36,5 +39,6 @@ shell_port_t *shell_deinit(void);
 void shell_servise(void);
 void shell_register_command(struct shell_command *cmd);
 void s_printf(const char *fmt, ...);
+void s_flush(void);
 
 #endif /* __SHELL_H__ */
@@ -7,6 +7,7 @@ extern struct uart_handle uart0;
 
 void trap_undef(struct exp_stack *regs)
 {
+    uart_flush(&uart0);
     uart_putc(&uart0, 'u');
     uart_putc(&uart0, 'd');
     uart_putc(&uart0, 'f');
@@ -17,6 +18,7 @@ void trap_undef(struct exp_stack *regs)
 
 void trap_swi(struct exp_stack *regs)
 {
+    uart_flush(&uart0);
     uart_putc(&uart0, 's');
     uart_putc(&uart0, 'w');
     uart_putc(&uart0, 'i');
@@ -27,6 +29,7 @@ void trap_swi(struct exp_stack *regs)
 
 void trap_pabt(struct exp_stack *regs)
 {
+    uart_flush(&uart0);
     uart_putc(&uart0, 'p');
     uart_putc(&uart0, 'a');
     uart_putc(&uart0, 'b');
@@ -37,6 +40,7 @@ void trap_pabt(struct exp_stack *regs)
 
 void trap_dabt(struct exp_stack *regs)
 {
+    uart_flush(&uart0);
     uart_putc(&uart0, 'd');
     uart_putc(&uart0, 'a');
     uart_putc(&uart0, 'b');
@@ -47,6 +51,7 @@ void trap_dabt(struct exp_stack *regs)
 
 void trap_resv(struct exp_stack *regs)
 {
+    uart_flush(&uart0);
     uart_putc(&uart0, 'r');
     uart_putc(&uart0, 'e');
     uart_putc(&uart0, 'v');
@@ -57,6 +62,7 @@ void trap_resv(struct exp_stack *regs)
 
 void trap_fiq(void)
 {
+    uart_flush(&uart0);
     uart_putc(&uart0, 'f');
     uart_putc(&uart0, 'i');
     uart_putc(&uart0, 'q');
@@ -21,6 +21,8 @@
  */
 #include "memheap.h"
 
+#if !RT_MEMHEAP_USING_TLSF
+
 /* dynamic pool magic and mask */
 #define RT_MEMHEAP_MAGIC        0x1ea01ea0
 #define RT_MEMHEAP_MASK         0xFFFFFFFE
@@ -569,3 +571,88 @@ void rt_memheap_info(struct rt_memheap *heap,
     if (max_used != RT_NULL)
         *max_used = heap->max_used_size;
 }
+
+/**
+ * @brief This function will return the size of the largest free block.
+ *
+ * @param heap is a pointer to the memheap object.
+ *
+ * @return the largest size that can be allocated at once.
+ */
+unsigned int rt_memheap_max_free(struct rt_memheap *heap)
+{
+    unsigned int max_size = 0;
+    struct rt_memheap_item *item;
+
+    if (heap == RT_NULL)
+        return 0;
+
+    for (item = heap->free_list->next_free; item != heap->free_list; item = item->next_free)
+    {
+        if (MEMITEM_SIZE(item) > max_size)
+            max_size = MEMITEM_SIZE(item);
+    }
+
+    return max_size;
+}
+
+/**
+ * @brief This function will collect the statistics of one size class by
+ *        walking the block list.
+ *
+ * @param heap is a pointer to the memheap object.
+ *
+ * @param index is the size class, 0 ~ RT_MEMHEAP_CLASS_NUM - 1.
+ *
+ * @param info is a pointer to get the statistics.
+ *
+ * @return RT_EOK on success, -RT_EINVAL on bad parameters.
+ */
+int rt_memheap_class_info(struct rt_memheap *heap, unsigned int index, struct rt_memheap_class *info)
+{
+    unsigned int size;
+    unsigned int cls;
+    struct rt_memheap_item *item;
+
+    if (heap == RT_NULL || info == RT_NULL || index >= RT_MEMHEAP_CLASS_NUM)
+        return -RT_EINVAL;
+
+    info->min_size    = (index == 0) ? 0 : ((1U << (RT_MEMHEAP_CLASS_SHIFT - 1)) << index);
+    info->free_blocks = 0;
+    info->free_size   = 0;
+    info->used_blocks = 0;
+    info->used_size   = 0;
+
+    item = heap->block_list;
+    do
+    {
+        /* skip the tailer block */
+        if (item->next > item)
+        {
+            size = MEMITEM_SIZE(item);
+            cls  = (size < (1U << RT_MEMHEAP_CLASS_SHIFT)) ? 0 :
+                   (31 - __builtin_clz(size)) - (RT_MEMHEAP_CLASS_SHIFT - 1);
+            if (cls >= RT_MEMHEAP_CLASS_NUM)
+                cls = RT_MEMHEAP_CLASS_NUM - 1;
+
+            if (cls == index)
+            {
+                if (RT_MEMHEAP_IS_USED(item))
+                {
+                    info->used_blocks++;
+                    info->used_size += size;
+                }
+                else
+                {
+                    info->free_blocks++;
+                    info->free_size += size;
+                }
+            }
+        }
+        item = item->next;
+    } while (item != heap->block_list);
+
+    return RT_EOK;
+}
+
+#endif /* !RT_MEMHEAP_USING_TLSF */
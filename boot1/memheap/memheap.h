@@ -3,6 +3,15 @@
 
 #include "board.h"
 
+/*
+ * allocator selection.
+ * 1 : TLSF (two level segregated fit), O(1) alloc/free, memheap_tlsf.c
+ * 0 : RT-Thread first fit memheap, linear free list search, memheap.c
+ */
+#ifndef RT_MEMHEAP_USING_TLSF
+#define RT_MEMHEAP_USING_TLSF           1
+#endif
+
 #define RT_ALIGN_SIZE                   4
 #define RT_ALIGN(size, align)           (((size) + (align) - 1) & ~((align) - 1))
 #define RT_ALIGN_DOWN(size, align)      ((size) & ~((align) - 1))
@@ -27,6 +36,62 @@
 
 extern struct rt_memheap system_heap;
 
+/* size classes reported by rt_memheap_class_info(), class 0 is [0, 128),
+ * class n is [64 << n, 128 << n) */
+#define RT_MEMHEAP_CLASS_SHIFT          7
+#define RT_MEMHEAP_CLASS_NUM            18
+
+/**
+ * statistics of one size class
+ */
+struct rt_memheap_class
+{
+    unsigned int             min_size;                  /**< smallest block size of the class */
+    unsigned int             free_blocks;               /**< number of free blocks */
+    unsigned int             free_size;                 /**< free bytes in the class */
+    unsigned int             used_blocks;               /**< number of used blocks */
+    unsigned int             used_size;                 /**< used bytes in the class */
+};
+
+#if RT_MEMHEAP_USING_TLSF
+
+#define RT_TLSF_ALIGN_SIZE              8
+#define RT_TLSF_SL_COUNT_LOG2           4
+#define RT_TLSF_SL_COUNT                (1 << RT_TLSF_SL_COUNT_LOG2)
+#define RT_TLSF_FL_COUNT                RT_MEMHEAP_CLASS_NUM
+
+/**
+ * memory block on the heap, the free list pointers live in the payload
+ * while the block is free
+ */
+struct rt_memheap_item
+{
+    unsigned int             magic;                      /**< magic number and used flag */
+    struct rt_memheap      *pool_ptr;                   /**< point of pool */
+    struct rt_memheap_item *prev;                       /**< previous physical block */
+    unsigned int             size;                       /**< payload size */
+
+    struct rt_memheap_item *next_free;                  /**< next free block in the same class */
+    struct rt_memheap_item *prev_free;                  /**< prev free block in the same class */
+};
+
+/**
+ * Base structure of memory heap object
+ */
+struct rt_memheap
+{
+    void                   *start_addr;                 /**< pool start address and size */
+    unsigned int               pool_size;                  /**< pool size */
+    unsigned int               available_size;             /**< available size */
+    unsigned int               max_used_size;              /**< maximum allocated size */
+    unsigned int               fl_bitmap;                  /**< first level non-empty bitmap */
+    unsigned int               sl_bitmap[RT_TLSF_FL_COUNT];/**< second level non-empty bitmaps */
+    struct rt_memheap_item *blocks[RT_TLSF_FL_COUNT][RT_TLSF_SL_COUNT]; /**< free list heads */
+    int                      locked;                     /**< External lock mark */
+};
+
+#else
+
 /**
  * memory item on the heap
  */
@@ -57,11 +122,15 @@ struct rt_memheap
     int                      locked;                     /**< External lock mark */
 };
 
+#endif /* RT_MEMHEAP_USING_TLSF */
+
 int rt_memheap_init(struct rt_memheap *memheap, void *start_addr, unsigned int size);
 int rt_memheap_detach(struct rt_memheap *heap);
 void *rt_memheap_alloc(struct rt_memheap *heap, unsigned int size);
 void *rt_memheap_realloc(struct rt_memheap *heap, void *ptr, unsigned int newsize);
 void rt_memheap_free(void *ptr);
 void rt_memheap_info(struct rt_memheap *heap, unsigned int *total, unsigned int *used, unsigned int *max_used);
+unsigned int rt_memheap_max_free(struct rt_memheap *heap);
+int rt_memheap_class_info(struct rt_memheap *heap, unsigned int index, struct rt_memheap_class *info);
 
 #endif
@@ -0,0 +1,587 @@
+/*
+ * File      : memheap_tlsf.c
+ *
+ * TLSF (two level segregated fit) implementation of the rt_memheap API.
+ *
+ * Free blocks are kept in RT_TLSF_FL_COUNT x RT_TLSF_SL_COUNT segregated
+ * lists. The first level splits sizes by power of two, the second level
+ * splits each power of two range linearly. Two bitmaps record the non-empty
+ * lists, so finding a fitting block is a couple of bit scans and alloc/free
+ * are O(1) regardless of how fragmented the heap is.
+ *
+ *   +--------+---------+--------+---------+-----+--------+
+ *   | header | payload | header | payload | ... | tailer |
+ *   +--------+---------+--------+---------+-----+--------+
+ *
+ * Every block knows its previous physical neighbour, the next one is found
+ * from its size. The tailer is a used block of size 0 which stops merging.
+ */
+#include "memheap.h"
+
+#if RT_MEMHEAP_USING_TLSF
+
+/* dynamic pool magic and mask */
+#define RT_MEMHEAP_MAGIC        0x1ea01ea0
+#define RT_MEMHEAP_MASK         0xFFFFFFFE
+#define RT_MEMHEAP_USED         0x01
+#define RT_MEMHEAP_FREED        0x00
+
+#define RT_MEMHEAP_IS_USED(i)   ((i)->magic & RT_MEMHEAP_USED)
+
+/* the free list pointers are kept in the payload, so it can not be smaller */
+#define RT_MEMHEAP_MINIALLOC    (2 * sizeof(struct rt_memheap_item *))
+#define RT_MEMHEAP_SIZE         RT_ALIGN(sizeof(struct rt_memheap_item) - RT_MEMHEAP_MINIALLOC, RT_TLSF_ALIGN_SIZE)
+#define MEMITEM(ptr)            ((struct rt_memheap_item *)((unsigned char *)(ptr) - RT_MEMHEAP_SIZE))
+#define MEMITEM_DATA(item)      ((void *)((unsigned char *)(item) + RT_MEMHEAP_SIZE))
+#define MEMITEM_NEXT(item)      ((struct rt_memheap_item *)((unsigned char *)(item) + RT_MEMHEAP_SIZE + (item)->size))
+
+#define TLSF_FL_SHIFT           RT_MEMHEAP_CLASS_SHIFT
+#define TLSF_SMALL_BLOCK        (1U << TLSF_FL_SHIFT)
+#define TLSF_MAX_BLOCK          ((1U << (TLSF_FL_SHIFT + RT_TLSF_FL_COUNT - 1)) - 1)
+
+struct rt_memheap system_heap = {0};
+
+static void *rt_memcpy(void *dst, const void *src, unsigned int count)
+{
+    char *tmp = (char *)dst, *s = (char *)src;
+
+    while (count--)
+        *tmp ++ = *s ++;
+
+    return dst;
+}
+
+static int tlsf_fls(unsigned int word)
+{
+    return word ? (31 - __builtin_clz(word)) : -1;
+}
+
+static int tlsf_ffs(unsigned int word)
+{
+    return word ? __builtin_ctz(word) : -1;
+}
+
+/* size class of a free block of the given size */
+static void tlsf_mapping_insert(unsigned int size, int *fli, int *sli)
+{
+    int fl, sl;
+
+    if (size < TLSF_SMALL_BLOCK)
+    {
+        fl = 0;
+        sl = (int)size / (TLSF_SMALL_BLOCK / RT_TLSF_SL_COUNT);
+    }
+    else
+    {
+        fl = tlsf_fls(size);
+        sl = (int)(size >> (fl - RT_TLSF_SL_COUNT_LOG2)) ^ (1 << RT_TLSF_SL_COUNT_LOG2);
+        fl -= (TLSF_FL_SHIFT - 1);
+    }
+
+    *fli = fl;
+    *sli = sl;
+}
+
+/* size class whose every block satisfies the request, rounds the size up */
+static void tlsf_mapping_search(unsigned int size, int *fli, int *sli)
+{
+    if (size >= TLSF_SMALL_BLOCK)
+    {
+        size += (1U << (tlsf_fls(size) - RT_TLSF_SL_COUNT_LOG2)) - 1;
+    }
+
+    tlsf_mapping_insert(size, fli, sli);
+}
+
+static struct rt_memheap_item *tlsf_search_suitable(struct rt_memheap *heap, int *fli, int *sli)
+{
+    int fl = *fli;
+    int sl = *sli;
+    unsigned int sl_map;
+    unsigned int fl_map;
+
+    if (fl >= RT_TLSF_FL_COUNT)
+        return RT_NULL;
+
+    /* first look in the current first level for a list at least as big */
+    sl_map = heap->sl_bitmap[fl] & (~0U << sl);
+    if (!sl_map)
+    {
+        /* no block there, go to the next non-empty first level */
+        fl_map = (fl + 1 < 32) ? (heap->fl_bitmap & (~0U << (fl + 1))) : 0;
+        if (!fl_map)
+            return RT_NULL;
+
+        fl = tlsf_ffs(fl_map);
+        sl_map = heap->sl_bitmap[fl];
+    }
+    sl = tlsf_ffs(sl_map);
+
+    *fli = fl;
+    *sli = sl;
+
+    return heap->blocks[fl][sl];
+}
+
+static void tlsf_remove_free(struct rt_memheap *heap, struct rt_memheap_item *item)
+{
+    int fl, sl;
+
+    tlsf_mapping_insert(item->size, &fl, &sl);
+
+    if (item->next_free != RT_NULL)
+        item->next_free->prev_free = item->prev_free;
+    if (item->prev_free != RT_NULL)
+        item->prev_free->next_free = item->next_free;
+
+    if (heap->blocks[fl][sl] == item)
+    {
+        heap->blocks[fl][sl] = item->next_free;
+
+        if (heap->blocks[fl][sl] == RT_NULL)
+        {
+            heap->sl_bitmap[fl] &= ~(1U << sl);
+            if (!heap->sl_bitmap[fl])
+                heap->fl_bitmap &= ~(1U << fl);
+        }
+    }
+
+    item->next_free = RT_NULL;
+    item->prev_free = RT_NULL;
+}
+
+static void tlsf_insert_free(struct rt_memheap *heap, struct rt_memheap_item *item)
+{
+    int fl, sl;
+    struct rt_memheap_item *head;
+
+    tlsf_mapping_insert(item->size, &fl, &sl);
+
+    item->magic    = (RT_MEMHEAP_MAGIC | RT_MEMHEAP_FREED);
+    item->pool_ptr = heap;
+
+    head = heap->blocks[fl][sl];
+    item->next_free = head;
+    item->prev_free = RT_NULL;
+    if (head != RT_NULL)
+        head->prev_free = item;
+    heap->blocks[fl][sl] = item;
+
+    heap->fl_bitmap     |= (1U << fl);
+    heap->sl_bitmap[fl] |= (1U << sl);
+}
+
+/*
+ * cut the block down to size bytes of payload, the remainder becomes a new
+ * free block which is merged with the next neighbour when possible.
+ * returns the number of bytes given back to the free lists.
+ */
+static unsigned int tlsf_trim(struct rt_memheap *heap, struct rt_memheap_item *item, unsigned int size)
+{
+    struct rt_memheap_item *rest;
+    struct rt_memheap_item *next;
+    unsigned int freed;
+
+    if (item->size < size + RT_MEMHEAP_SIZE + RT_MEMHEAP_MINIALLOC)
+        return 0;
+
+    rest = (struct rt_memheap_item *)((unsigned char *)item + RT_MEMHEAP_SIZE + size);
+    rest->size = item->size - size - RT_MEMHEAP_SIZE;
+    rest->prev = item;
+    item->size = size;
+    freed = rest->size;
+
+    next = MEMITEM_NEXT(rest);
+    if (!RT_MEMHEAP_IS_USED(next))
+    {
+        tlsf_remove_free(heap, next);
+        rest->size += RT_MEMHEAP_SIZE + next->size;
+        freed += RT_MEMHEAP_SIZE;
+        next = MEMITEM_NEXT(rest);
+    }
+    next->prev = rest;
+
+    tlsf_insert_free(heap, rest);
+
+    return freed;
+}
+
+static void tlsf_update_max_used(struct rt_memheap *heap)
+{
+    if (heap->pool_size - heap->available_size > heap->max_used_size)
+        heap->max_used_size = heap->pool_size - heap->available_size;
+}
+
+/**
+ * @brief   This function initializes a piece of memory called memheap.
+ *
+ * @note    The initialized memory pool will be:
+ *          +-----------------------------------+--------------------------+
+ *          | whole freed memory block          | Used Memory Block Tailer |
+ *          +-----------------------------------+--------------------------+
+ *
+ * @param   memheap is a pointer of the memheap object.
+ *
+ * @param   start_addr is the start address of the memheap.
+ *
+ * @param   size is the size of the memheap.
+ *
+ * @return  RT_EOK
+ */
+int rt_memheap_init(struct rt_memheap *memheap,
+                         void              *start_addr,
+                         unsigned int         size)
+{
+    int i, j;
+    unsigned long start;
+    struct rt_memheap_item *item;
+    struct rt_memheap_item *tail;
+
+    if (memheap == RT_NULL)
+    {
+        return -RT_ERROR;
+    }
+
+    start = RT_ALIGN((unsigned long)start_addr, RT_TLSF_ALIGN_SIZE);
+    size  = RT_ALIGN_DOWN(size - (start - (unsigned long)start_addr), RT_TLSF_ALIGN_SIZE);
+
+    if (size < 2 * RT_MEMHEAP_SIZE + RT_MEMHEAP_MINIALLOC)
+    {
+        return -RT_EINVAL;
+    }
+
+    memheap->start_addr = (void *)start;
+    memheap->pool_size  = size;
+    memheap->fl_bitmap  = 0;
+    for (i = 0; i < RT_TLSF_FL_COUNT; i++)
+    {
+        memheap->sl_bitmap[i] = 0;
+        for (j = 0; j < RT_TLSF_SL_COUNT; j++)
+        {
+            memheap->blocks[i][j] = RT_NULL;
+        }
+    }
+
+    /* the whole pool is one free block */
+    item       = (struct rt_memheap_item *)start;
+    item->prev = RT_NULL;
+    item->size = size - 2 * RT_MEMHEAP_SIZE;
+    if (item->size > TLSF_MAX_BLOCK)
+    {
+        item->size = RT_ALIGN_DOWN(TLSF_MAX_BLOCK, RT_TLSF_ALIGN_SIZE);
+    }
+
+    /* tailer, a used block of size 0 which prevents merging */
+    tail            = MEMITEM_NEXT(item);
+    tail->magic     = (RT_MEMHEAP_MAGIC | RT_MEMHEAP_USED);
+    tail->pool_ptr  = memheap;
+    tail->prev      = item;
+    tail->size      = 0;
+
+    memheap->pool_size      = ((unsigned long)tail - start) + RT_MEMHEAP_SIZE;
+    memheap->available_size = item->size;
+    memheap->max_used_size  = memheap->pool_size - memheap->available_size;
+
+    tlsf_insert_free(memheap, item);
+
+    memheap->locked = RT_FALSE;
+
+    return RT_EOK;
+}
+
+/**
+ * @brief  Allocate a block of memory with a minimum of 'size' bytes on memheap.
+ *
+ * @param   heap is a pointer for memheap object.
+ *
+ * @param   size is the minimum size of the requested block in bytes.
+ *
+ * @return  the pointer to allocated memory or NULL if no free memory was found.
+ */
+void *rt_memheap_alloc(struct rt_memheap *heap, unsigned int size)
+{
+    int fl, sl;
+    struct rt_memheap_item *item;
+
+    if (heap == RT_NULL || size == 0 || size > TLSF_MAX_BLOCK)
+    {
+        return RT_NULL;
+    }
+
+    /* align allocated size */
+    size = RT_ALIGN(size, RT_TLSF_ALIGN_SIZE);
+    if (size < RT_MEMHEAP_MINIALLOC)
+        size = RT_MEMHEAP_MINIALLOC;
+
+    if (size > heap->available_size)
+    {
+        return RT_NULL;
+    }
+
+    tlsf_mapping_search(size, &fl, &sl);
+    item = tlsf_search_suitable(heap, &fl, &sl);
+    if (item == RT_NULL)
+    {
+        return RT_NULL;
+    }
+
+    tlsf_remove_free(heap, item);
+    heap->available_size -= item->size;
+
+    /* give back what is not needed */
+    heap->available_size += tlsf_trim(heap, item, size);
+
+    item->magic    = (RT_MEMHEAP_MAGIC | RT_MEMHEAP_USED);
+    item->pool_ptr = heap;
+    tlsf_update_max_used(heap);
+
+    return MEMITEM_DATA(item);
+}
+
+/**
+ * @brief This function will change the size of previously allocated memory block.
+ *
+ * @param heap is a pointer to the memheap object, which will reallocate
+ *             memory from the block
+ *
+ * @param ptr is a pointer to start address of memory.
+ *
+ * @param newsize is the required new size.
+ *
+ * @return the changed memory block address.
+ */
+void *rt_memheap_realloc(struct rt_memheap *heap, void *ptr, unsigned int newsize)
+{
+    void *new_ptr;
+    struct rt_memheap_item *item;
+    struct rt_memheap_item *next;
+
+    if (heap == RT_NULL)
+    {
+        return RT_NULL;
+    }
+
+    if (newsize == 0)
+    {
+        rt_memheap_free(ptr);
+
+        return RT_NULL;
+    }
+
+    if (ptr == RT_NULL)
+    {
+        return rt_memheap_alloc(heap, newsize);
+    }
+
+    if (newsize > TLSF_MAX_BLOCK)
+    {
+        return RT_NULL;
+    }
+
+    /* align allocated size */
+    newsize = RT_ALIGN(newsize, RT_TLSF_ALIGN_SIZE);
+    if (newsize < RT_MEMHEAP_MINIALLOC)
+        newsize = RT_MEMHEAP_MINIALLOC;
+
+    item = MEMITEM(ptr);
+    if (item->magic != (RT_MEMHEAP_MAGIC | RT_MEMHEAP_USED) || item->pool_ptr != heap)
+    {
+        return RT_NULL;
+    }
+
+    /* grow in place when the next neighbour is free and big enough */
+    if (newsize > item->size)
+    {
+        next = MEMITEM_NEXT(item);
+        if (RT_MEMHEAP_IS_USED(next) ||
+            (item->size + RT_MEMHEAP_SIZE + next->size < newsize))
+        {
+            new_ptr = rt_memheap_alloc(heap, newsize);
+            if (new_ptr != RT_NULL)
+            {
+                rt_memcpy(new_ptr, ptr, item->size);
+                rt_memheap_free(ptr);
+            }
+
+            return new_ptr;
+        }
+
+        tlsf_remove_free(heap, next);
+        heap->available_size -= next->size;
+        item->size += RT_MEMHEAP_SIZE + next->size;
+        MEMITEM_NEXT(item)->prev = item;
+    }
+
+    /* shrink, or cut what grow-in-place took too much */
+    heap->available_size += tlsf_trim(heap, item, newsize);
+    tlsf_update_max_used(heap);
+
+    return ptr;
+}
+
+/**
+ * @brief This function will release the allocated memory block by
+ *        rt_malloc. The released memory block is taken back to system heap.
+ *
+ * @param ptr the address of memory which will be released.
+ */
+void rt_memheap_free(void *ptr)
+{
+    struct rt_memheap *heap;
+    struct rt_memheap_item *item;
+    struct rt_memheap_item *neighbour;
+
+    /* NULL check */
+    if (ptr == RT_NULL) return;
+
+    item = MEMITEM(ptr);
+
+    /* check magic, and whether the next block has been over-written. */
+    if (item->magic != (RT_MEMHEAP_MAGIC | RT_MEMHEAP_USED) ||
+       (MEMITEM_NEXT(item)->magic & RT_MEMHEAP_MASK) != RT_MEMHEAP_MAGIC)
+    {
+        return;
+    }
+
+    /* get pool ptr */
+    heap = item->pool_ptr;
+    if (heap == RT_NULL)
+    {
+        return;
+    }
+
+    heap->available_size += item->size;
+
+    /* merge with previous neighbour */
+    neighbour = item->prev;
+    if (neighbour != RT_NULL && !RT_MEMHEAP_IS_USED(neighbour))
+    {
+        tlsf_remove_free(heap, neighbour);
+        neighbour->size += RT_MEMHEAP_SIZE + item->size;
+        heap->available_size += RT_MEMHEAP_SIZE;
+        item->magic = 0;
+        item = neighbour;
+    }
+
+    /* merge with next neighbour */
+    neighbour = MEMITEM_NEXT(item);
+    if (!RT_MEMHEAP_IS_USED(neighbour))
+    {
+        tlsf_remove_free(heap, neighbour);
+        item->size += RT_MEMHEAP_SIZE + neighbour->size;
+        heap->available_size += RT_MEMHEAP_SIZE;
+        neighbour->magic = 0;
+    }
+    MEMITEM_NEXT(item)->prev = item;
+
+    tlsf_insert_free(heap, item);
+}
+
+/**
+* @brief This function will caculate the total memory, the used memory, and
+*        the max used memory.
+*
+* @param heap is a pointer to the memheap object, which will reallocate
+*             memory from the block
+*
+* @param total is a pointer to get the total size of the memory.
+*
+* @param used is a pointer to get the size of memory used.
+*
+* @param max_used is a pointer to get the maximum memory used.
+*/
+void rt_memheap_info(struct rt_memheap *heap,
+                     unsigned int *total,
+                     unsigned int *used,
+                     unsigned int *max_used)
+{
+    if (total != RT_NULL)
+        *total = heap->pool_size;
+
+    if (used  != RT_NULL)
+        *used = heap->pool_size - heap->available_size;
+
+    if (max_used != RT_NULL)
+        *max_used = heap->max_used_size;
+}
+
+/**
+ * @brief This function will return the size of the largest free block.
+ *
+ * @note  Only the highest non-empty list is walked, every block in lower
+ *        lists is smaller.
+ *
+ * @param heap is a pointer to the memheap object.
+ *
+ * @return the largest size that can be allocated at once.
+ */
+unsigned int rt_memheap_max_free(struct rt_memheap *heap)
+{
+    int fl, sl;
+    unsigned int max_size = 0;
+    struct rt_memheap_item *item;
+
+    if (heap == RT_NULL || heap->fl_bitmap == 0)
+        return 0;
+
+    fl = tlsf_fls(heap->fl_bitmap);
+    sl = tlsf_fls(heap->sl_bitmap[fl]);
+
+    for (item = heap->blocks[fl][sl]; item != RT_NULL; item = item->next_free)
+    {
+        if (item->size > max_size)
+            max_size = item->size;
+    }
+
+    return max_size;
+}
+
+/**
+ * @brief This function will collect the statistics of one size class by
+ *        walking the physical blocks.
+ *
+ * @param heap is a pointer to the memheap object.
+ *
+ * @param index is the size class (the TLSF first level), 0 ~ RT_MEMHEAP_CLASS_NUM - 1.
+ *
+ * @param info is a pointer to get the statistics.
+ *
+ * @return RT_EOK on success, -RT_EINVAL on bad parameters.
+ */
+int rt_memheap_class_info(struct rt_memheap *heap, unsigned int index, struct rt_memheap_class *info)
+{
+    int fl, sl;
+    struct rt_memheap_item *item;
+
+    if (heap == RT_NULL || info == RT_NULL || index >= RT_MEMHEAP_CLASS_NUM)
+        return -RT_EINVAL;
+
+    info->min_size    = (index == 0) ? 0 : ((1U << (RT_MEMHEAP_CLASS_SHIFT - 1)) << index);
+    info->free_blocks = 0;
+    info->free_size   = 0;
+    info->used_blocks = 0;
+    info->used_size   = 0;
+
+    /* the tailer is the only block of size 0 */
+    for (item = (struct rt_memheap_item *)heap->start_addr; item->size != 0; item = MEMITEM_NEXT(item))
+    {
+        tlsf_mapping_insert(item->size, &fl, &sl);
+        if (fl != (int)index)
+            continue;
+
+        if (RT_MEMHEAP_IS_USED(item))
+        {
+            info->used_blocks++;
+            info->used_size += item->size;
+        }
+        else
+        {
+            info->free_blocks++;
+            info->free_size += item->size;
+        }
+    }
+
+    return RT_EOK;
+}
+
+#endif /* RT_MEMHEAP_USING_TLSF */
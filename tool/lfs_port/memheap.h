@@ -0,0 +1,13 @@
+#ifndef __MEMHEAP_H__
+#define __MEMHEAP_H__
+
+/*
+ * Host stand-in for boot1/memheap/memheap.h, picked up by boot1/lfs/lfs_util.h
+ * when littlefs is built into tool/mk_nand.c. littlefs only needs an allocator.
+ */
+#include <stdlib.h>
+
+#define LFS_MALLOC(sz) malloc(sz)
+#define LFS_FREE(p)	   free(p)
+
+#endif
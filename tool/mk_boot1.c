@@ -0,0 +1,106 @@
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+/*
+ * Seal a boot1 binary for boot0: fill the img_crc word of the header at
+ * the start of boot1/libcpu/vector_gcc.S with the CRC32 (zlib) of img_size
+ * bytes of the image, the words from img_crc to the end of the header left
+ * out, then head_crc with the CRC32 of the header minus the head_crc word.
+ *
+ *   gcc -O2 -o mk_boot1 tool/mk_boot1.c
+ *   mk_boot1 boot1/build/t113.bin
+ */
+
+#define BOOT1_MAGIC	0x12345678
+#define CRC_OFFSET	16
+#define HCRC_OFFSET	20
+
+struct boot1_head_t {
+	uint32_t magic;
+	uint32_t size;
+	uint32_t load;
+	uint32_t entry;
+	uint32_t crc;
+	uint32_t head_crc;
+	uint32_t page;
+};
+
+static uint32_t crc32_calc(uint32_t crc, const uint8_t *buf, uint32_t len)
+{
+	int i;
+
+	while (len--) {
+		crc ^= *buf++;
+		for (i = 0; i < 8; i++)
+			crc = (crc >> 1) ^ (0xedb88320 & -(crc & 1));
+	}
+
+	return crc;
+}
+
+int main(int argc, char *argv[])
+{
+	struct boot1_head_t *h;
+	FILE				*fp;
+	uint8_t				*buffer;
+	long				 filelen;
+	uint32_t			 crc;
+
+	if (argc != 2) {
+		printf("Usage: mk_boot1 <boot1.bin>\n");
+		return -1;
+	}
+
+	fp = fopen(argv[1], "r+b");
+	if (fp == NULL) {
+		printf("Open %s error\n", argv[1]);
+		return -1;
+	}
+	fseek(fp, 0L, SEEK_END);
+	filelen = ftell(fp);
+	fseek(fp, 0L, SEEK_SET);
+
+	if (filelen <= (long)sizeof(struct boot1_head_t)) {
+		printf("The size of boot1 too small\n");
+		fclose(fp);
+		return -1;
+	}
+
+	buffer = malloc(filelen);
+	if (buffer == NULL || fread(buffer, 1, filelen, fp) != (size_t)filelen) {
+		printf("Can't read boot1\n");
+		free(buffer);
+		fclose(fp);
+		return -1;
+	}
+
+	h = (struct boot1_head_t *)buffer;
+	if (h->magic != BOOT1_MAGIC || h->size <= sizeof(struct boot1_head_t) || h->size > filelen) {
+		printf("Bad boot1 header: magic 0x%08x size %u, file %ld bytes\n", h->magic, h->size, filelen);
+		free(buffer);
+		fclose(fp);
+		return -1;
+	}
+
+	crc	   = crc32_calc(0xffffffff, buffer, CRC_OFFSET);
+	crc	   = crc32_calc(crc, buffer + sizeof(struct boot1_head_t), h->size - sizeof(struct boot1_head_t)) ^ 0xffffffff;
+	h->crc = crc;
+
+	h->head_crc = crc32_calc(0xffffffff, buffer, HCRC_OFFSET);
+	h->head_crc = crc32_calc(h->head_crc, buffer + HCRC_OFFSET + 4, sizeof(struct boot1_head_t) - HCRC_OFFSET - 4) ^ 0xffffffff;
+
+	fseek(fp, 0L, SEEK_SET);
+	if (fwrite(buffer, 1, sizeof(struct boot1_head_t), fp) != sizeof(struct boot1_head_t)) {
+		printf("Write boot1 error\n");
+		free(buffer);
+		fclose(fp);
+		return -1;
+	}
+
+	printf("boot1 sealed: %u bytes, load 0x%08x, crc 0x%08x, header crc 0x%08x\n", h->size, h->load, crc, h->head_crc);
+	free(buffer);
+	fclose(fp);
+	return 0;
+}
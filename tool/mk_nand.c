@@ -0,0 +1,711 @@
+/*
+ * mk_nand: factory SPI NAND image builder.
+ *
+ * Reads a layout description (tool/nand_layout.txt) and emits one image that
+ * is written to the chip from offset 0 in a single pass:
+ *
+ *   xfel spinand erase 0 <image size>
+ *   xfel spinand write 0 factory.bin
+ *
+ * boot0 gets its BROM checksum (as tool/mk_image.c), boot1 is stored in
+ * several copies, APP1/APP2 take pack.py images, Param gets an OTA record
+ * that boots APP1, LittleFs is pre-formatted with the board's littlefs
+ * configuration, and the partition table boot1 loads at runtime
+ * (partition_table_load()) is written to every good block of "ptable".
+ *
+ * Known bad blocks (-B) keep content out of them: table copies on a bad
+ * block are dropped, boot1 copies continue in the next good block within
+ * their slot, anything else that would land on one is an error
+ * since the runtime reads partitions linearly.
+ *
+ * Build (host):
+ *   gcc -O2 -o mk_nand tool/mk_nand.c boot1/lfs/lfs.c boot1/lfs/lfs_util.c \
+ *       -Itool/lfs_port -Iboot1/hgboot -Iboot1/lfs
+ * or with the hgboot host build (boot1/hgboot/host), which also tests it.
+ */
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <getopt.h>
+
+#include "partition/partition.h"
+#include "ota/ota.h"
+#include "lfs.h"
+
+#define __ALIGN_MASK(x, mask) (((x) + (mask)) & ~(mask))
+#define ALIGN(x, a)			  __ALIGN_MASK((x), (typeof(x))(a)-1)
+
+#define cpu_to_le32(x) (x)
+#define le32_to_cpu(x) (x)
+
+#define BROM_PAGE_SIZE	  2048
+#define BROM_PADDING	  8192
+#define BROM_STAMP		  0x5F0A6C39
+
+#define BOOT1_HEAD_SIZE	  28 /* boot0/application/boot_image.h boot_head_t */
+
+#define LFS_BLOCK_CYCLES  500 /* boards/port/littlefs_port.c */
+
+struct boot_head_t {
+	uint32_t instruction;
+	uint8_t	 magic[8];
+	uint32_t checksum;
+	uint32_t length;
+	uint8_t	 spl_signature[4];
+	uint32_t fel_script_address;
+	uint32_t fel_uenv_length;
+	uint32_t dt_name_offset;
+	uint32_t reserved1;
+	uint32_t boot_media;
+	uint32_t string_pool[13];
+};
+
+struct layout_part {
+	char		 name[PARTITION_NAME_MAX];
+	uint32_t	 start;
+	uint32_t	 size;
+	uint32_t	 type;
+	uint32_t	 copies;
+	char		 file[256];
+	unsigned int crc; /* APP: header crc32 of the stored image */
+	int			 filled;
+};
+
+static const char *type_names[] = {
+	[PARTITION_TYPE_RAW] = "raw",	  [PARTITION_TYPE_BOOT0] = "boot0", [PARTITION_TYPE_TABLE] = "ptable",
+	[PARTITION_TYPE_BOOT1] = "boot1", [PARTITION_TYPE_APP] = "app",		[PARTITION_TYPE_PARAM] = "param",
+	[PARTITION_TYPE_LFS] = "lfs",
+};
+
+static struct layout_part parts[PARTITION_MAX];
+static int				  nparts;
+
+static uint32_t page_size		= 2048;
+static uint32_t pages_per_block = 64;
+static uint32_t blocks_total	= 1024;
+static uint32_t block_size;
+
+static uint32_t bad[64];
+static int		nbad;
+
+static uint8_t *image;
+static uint32_t image_size;
+
+/* boot1/lfs prints through the shell */
+void s_printf(const char *fmt, ...)
+{
+	va_list ap;
+
+	va_start(ap, fmt);
+	vprintf(fmt, ap);
+	va_end(ap);
+}
+
+static uint32_t crc32_calc(uint32_t crc, const void *buf, uint32_t len)
+{
+	const uint8_t *p = buf;
+	int			   i;
+
+	while (len--) {
+		crc ^= *p++;
+		for (i = 0; i < 8; i++)
+			crc = (crc >> 1) ^ (0xedb88320 & -(crc & 1));
+	}
+
+	return crc;
+}
+
+static int is_bad(uint32_t block)
+{
+	int i;
+
+	for (i = 0; i < nbad; i++) {
+		if (bad[i] == block)
+			return 1;
+	}
+
+	return 0;
+}
+
+/* First bad block in [addr, addr + len), -1 if none */
+static int find_bad(uint32_t addr, uint32_t len)
+{
+	uint32_t blk;
+
+	if (len == 0)
+		return -1;
+
+	for (blk = addr / block_size; blk <= (addr + len - 1) / block_size; blk++) {
+		if (is_bad(blk))
+			return (int)blk;
+	}
+
+	return -1;
+}
+
+static uint8_t *read_file(const char *path, uint32_t *len)
+{
+	FILE	*fp;
+	uint8_t *buf;
+	long	 n;
+
+	fp = fopen(path, "rb");
+	if (fp == NULL) {
+		printf("Open %s error\n", path);
+		return NULL;
+	}
+
+	fseek(fp, 0L, SEEK_END);
+	n = ftell(fp);
+	fseek(fp, 0L, SEEK_SET);
+
+	buf = malloc(n > 0 ? n : 1);
+	if (buf == NULL || fread(buf, 1, n, fp) != (size_t)n) {
+		printf("Read %s error\n", path);
+		free(buf);
+		fclose(fp);
+		return NULL;
+	}
+
+	fclose(fp);
+	*len = (uint32_t)n;
+
+	return buf;
+}
+
+static int place(struct layout_part *p, uint32_t offset, const uint8_t *data, uint32_t len)
+{
+	int blk;
+
+	if (offset + len > p->size) {
+		printf("%s: %u bytes do not fit at offset 0x%x of 0x%x\n", p->name, len, offset, p->size);
+		return -1;
+	}
+
+	blk = find_bad(p->start + offset, len);
+	if (blk >= 0) {
+		printf("%s: content hits bad block %d\n", p->name, blk);
+		return -1;
+	}
+
+	memcpy(image + p->start + offset, data, len);
+	p->filled = 1;
+
+	return 0;
+}
+
+static int parse_type(const char *s)
+{
+	int i;
+
+	for (i = 0; i < (int)(sizeof(type_names) / sizeof(type_names[0])); i++) {
+		if (strcmp(s, type_names[i]) == 0)
+			return i;
+	}
+
+	return -1;
+}
+
+/* name start size type [file] [copies], '#' starts a comment, "-" for no file */
+static int parse_layout(const char *path)
+{
+	FILE			   *fp;
+	char				line[512], name[64], start[32], size[32], type[32], file[256], copies[32];
+	struct layout_part *p;
+	int					n, lineno = 0;
+
+	fp = fopen(path, "r");
+	if (fp == NULL) {
+		printf("Open layout %s error\n", path);
+		return -1;
+	}
+
+	while (fgets(line, sizeof(line), fp) != NULL) {
+		lineno++;
+		if (strchr(line, '#'))
+			*strchr(line, '#') = '\0';
+
+		file[0]	  = '\0';
+		copies[0] = '\0';
+		n		  = sscanf(line, "%63s %31s %31s %31s %255s %31s", name, start, size, type, file, copies);
+		if (n <= 0)
+			continue;
+		if (n < 4) {
+			printf("%s:%d: expected name start size type [file] [copies]\n", path, lineno);
+			goto err;
+		}
+		if (nparts >= PARTITION_MAX || strlen(name) >= PARTITION_NAME_MAX) {
+			printf("%s:%d: too many partitions or name too long\n", path, lineno);
+			goto err;
+		}
+
+		p = &parts[nparts];
+		memset(p, 0, sizeof(*p));
+		strcpy(p->name, name);
+		p->start  = strtoul(start, NULL, 0);
+		p->size	  = strtoul(size, NULL, 0);
+		p->copies = copies[0] ? strtoul(copies, NULL, 0) : 1;
+		if (strcmp(file, "-") != 0)
+			strcpy(p->file, file);
+
+		n = parse_type(type);
+		if (n < 0) {
+			printf("%s:%d: unknown type %s\n", path, lineno, type);
+			goto err;
+		}
+		p->type = n;
+
+		if (p->size == 0 || p->copies == 0 || (p->start % block_size) != 0) {
+			printf("%s:%d: %s must start on a block boundary with a non zero size\n", path, lineno, name);
+			goto err;
+		}
+		if (nparts > 0 && p->start < parts[nparts - 1].start + parts[nparts - 1].size) {
+			printf("%s:%d: %s overlaps %s\n", path, lineno, name, parts[nparts - 1].name);
+			goto err;
+		}
+		if ((uint64_t)p->start + p->size > (uint64_t)blocks_total * block_size) {
+			printf("%s:%d: %s ends past the chip\n", path, lineno, name);
+			goto err;
+		}
+		nparts++;
+	}
+
+	fclose(fp);
+	return nparts > 0 ? 0 : -1;
+
+err:
+	fclose(fp);
+	return -1;
+}
+
+static struct layout_part *find_part(const char *name)
+{
+	int i;
+
+	for (i = 0; i < nparts; i++) {
+		if (strcmp(parts[i].name, name) == 0)
+			return &parts[i];
+	}
+
+	return NULL;
+}
+
+/* tool/mk_image.c: pad, BROM checksum, only the first 2KB of larger pages used */
+static int fill_boot0(struct layout_part *p)
+{
+	struct boot_head_t *h;
+	uint8_t			   *file, *buf, *out;
+	uint32_t			filelen, buflen, l, sum, i, multiple;
+	uint32_t		   *w;
+	int					ret;
+
+	file = read_file(p->file, &filelen);
+	if (file == NULL)
+		return -1;
+
+	if (filelen <= sizeof(struct boot_head_t) || memcmp(file + 4, "eGON.BT0", 8) != 0) {
+		printf("%s: %s is not a boot0 image\n", p->name, p->file);
+		free(file);
+		return -1;
+	}
+
+	buflen = ALIGN(filelen, BROM_PADDING);
+	buf	   = calloc(1, buflen);
+	memcpy(buf, file, filelen);
+	free(file);
+
+	h = (struct boot_head_t *)buf;
+	w = (uint32_t *)buf;
+	l = ALIGN(le32_to_cpu(h->length), BROM_PADDING);
+	if (l > buflen) {
+		printf("%s: header length %u larger than the file\n", p->name, l);
+		free(buf);
+		return -1;
+	}
+	h->length	= cpu_to_le32(l);
+	h->checksum = cpu_to_le32(BROM_STAMP);
+	for (i = 0, sum = 0; i < l / 4; i++)
+		sum += le32_to_cpu(w[i]);
+	h->checksum = cpu_to_le32(sum);
+
+	multiple = page_size / BROM_PAGE_SIZE;
+	out		 = calloc(multiple, buflen);
+	for (i = 0; i < buflen; i += BROM_PAGE_SIZE)
+		memcpy(out + i * multiple, buf + i, BROM_PAGE_SIZE);
+
+	ret = place(p, 0, out, buflen * multiple);
+	printf("  boot0 %u bytes, checksum 0x%08x\n", l, sum);
+
+	free(out);
+	free(buf);
+	return ret;
+}
+
+/*
+ * Copies are spaced size / copies apart. A copy continues in the next good
+ * block after a bad one, and is dropped when its slot runs out of good
+ * blocks; boot0 reads it back the same way and takes the first that loads.
+ */
+static int fill_boot1(struct layout_part *p)
+{
+	uint8_t *file;
+	uint32_t len, stride, i, written = 0, crc, addr, pos, n, skipped;
+	uint32_t *w;
+
+	file = read_file(p->file, &len);
+	if (file == NULL)
+		return -1;
+
+	stride = (p->size / p->copies) / block_size * block_size;
+	if (p->copies > 8) {
+		printf("%s: boot0 tries at most 8 copies\n", p->name);
+		free(file);
+		return -1;
+	}
+	if (stride < len) {
+		printf("%s: %u bytes do not fit %u copies\n", p->name, len, p->copies);
+		free(file);
+		return -1;
+	}
+
+	/* Seal the image and header CRCs boot0 checks, same as tool/mk_boot1.c */
+	w = (uint32_t *)file;
+	if (len > BOOT1_HEAD_SIZE && le32_to_cpu(w[0]) == 0x12345678 && le32_to_cpu(w[1]) > BOOT1_HEAD_SIZE &&
+		le32_to_cpu(w[1]) <= len) {
+		crc	 = crc32_calc(0xffffffff, file, 16);
+		crc	 = crc32_calc(crc, file + BOOT1_HEAD_SIZE, le32_to_cpu(w[1]) - BOOT1_HEAD_SIZE) ^ 0xffffffff;
+		w[4] = cpu_to_le32(crc);
+		crc	 = crc32_calc(0xffffffff, file, 20);
+		crc	 = crc32_calc(crc, file + 24, BOOT1_HEAD_SIZE - 24) ^ 0xffffffff;
+		w[5] = cpu_to_le32(crc);
+	} else {
+		printf("%s: %s has no boot1 header\n", p->name, p->file);
+		free(file);
+		return -1;
+	}
+
+	for (i = 0; i < p->copies; i++) {
+		skipped = 0;
+		for (pos = 0, addr = p->start + i * stride; pos < len && addr < p->start + (i + 1) * stride; addr += block_size) {
+			if (is_bad(addr / block_size)) {
+				skipped++;
+				continue;
+			}
+			n = len - pos < block_size ? len - pos : block_size;
+			memcpy(image + addr, file + pos, n);
+			pos += n;
+		}
+		if (pos < len) {
+			printf("  boot1 copy %u at 0x%08x dropped, %u bad blocks leave no room\n", i, p->start + i * stride, skipped);
+			for (addr = p->start + i * stride; addr < p->start + (i + 1) * stride; addr += block_size) {
+				if (!is_bad(addr / block_size))
+					memset(image + addr, 0xff, block_size);
+			}
+			continue;
+		}
+		printf("  boot1 copy %u at 0x%08x, %u bad blocks skipped\n", i, p->start + i * stride, skipped);
+		written++;
+	}
+
+	free(file);
+	if (written == 0) {
+		printf("%s: no copy fits between the bad blocks\n", p->name);
+		return -1;
+	}
+
+	p->filled = 1;
+	return 0;
+}
+
+static int fill_app(struct layout_part *p)
+{
+	struct firmware_header *hdr;
+	uint8_t				   *file;
+	uint32_t				len;
+	int						ret;
+
+	file = read_file(p->file, &len);
+	if (file == NULL)
+		return -1;
+
+	hdr = (struct firmware_header *)file;
+	if (len < sizeof(*hdr) || hdr->magic != OTA_FIRMWARE_MAGIC || hdr->size + sizeof(*hdr) != len ||
+		(crc32_calc(0xffffffff, file + sizeof(*hdr), hdr->size) ^ 0xffffffff) != hdr->crc32) {
+		printf("%s: %s is not a pack.py image\n", p->name, p->file);
+		free(file);
+		return -1;
+	}
+
+	p->crc = hdr->crc32;
+	ret	   = place(p, 0, file, len);
+	printf("  app version 0x%08x, %u bytes, crc 0x%08x\n", hdr->version, hdr->size, hdr->crc32);
+
+	free(file);
+	return ret;
+}
+
+/* Boots APP1, APP2 is the rollback image when it was given; the second record partition stays erased */
+static int fill_param(struct layout_part *p)
+{
+	struct layout_part *app1 = find_part(APP1_PART);
+	struct layout_part *app2 = find_part(APP2_PART);
+	struct ota_paramers para;
+
+	if (strcmp(p->name, PARA_PART) != 0)
+		return 0;
+
+	if (app1 == NULL || !app1->filled) {
+		printf("%s: needs an " APP1_PART " image\n", p->name);
+		return -1;
+	}
+
+	memset(&para, 0, sizeof(para));
+	para.magic		 = OTA_PARA_MAGIC;
+	para.active_slot = APP_SLOT_1;
+	para.app1_crc	 = app1->crc;
+	if (app2 != NULL && app2->filled) {
+		para.app2_crc	 = app2->crc;
+		para.can_be_back = BACKUP_FLAG;
+	}
+	para.seq   = 1;
+	para.crc32 = crc32_calc(0xffffffff, &para, sizeof(para) - sizeof(para.crc32)) ^ 0xffffffff;
+
+	printf("  param active APP1%s\n", para.can_be_back ? ", rollback to APP2" : "");
+
+	return place(p, 0, (uint8_t *)&para, sizeof(para));
+}
+
+static int lfs_bd_read(const struct lfs_config *c, lfs_block_t block, lfs_off_t off, void *buffer, lfs_size_t size)
+{
+	struct layout_part *p = c->context;
+
+	memcpy(buffer, image + p->start + block * c->block_size + off, size);
+	return LFS_ERR_OK;
+}
+
+static int lfs_bd_prog(const struct lfs_config *c, lfs_block_t block, lfs_off_t off, const void *buffer, lfs_size_t size)
+{
+	struct layout_part *p = c->context;
+
+	if (is_bad(p->start / c->block_size + block))
+		return LFS_ERR_CORRUPT;
+
+	memcpy(image + p->start + block * c->block_size + off, buffer, size);
+	return LFS_ERR_OK;
+}
+
+static int lfs_bd_erase(const struct lfs_config *c, lfs_block_t block)
+{
+	struct layout_part *p = c->context;
+
+	if (is_bad(p->start / c->block_size + block))
+		return LFS_ERR_CORRUPT;
+
+	memset(image + p->start + block * c->block_size, 0xff, c->block_size);
+	return LFS_ERR_OK;
+}
+
+static int lfs_bd_sync(const struct lfs_config *c)
+{
+	return LFS_ERR_OK;
+}
+
+/* Same geometry as boards/port/littlefs_port.c, block_count from the partition */
+static int fill_lfs(struct layout_part *p)
+{
+	struct lfs_config cfg;
+	lfs_t			  lfs;
+	int				  ret;
+
+	memset(&cfg, 0, sizeof(cfg));
+	cfg.context		   = p;
+	cfg.read		   = lfs_bd_read;
+	cfg.prog		   = lfs_bd_prog;
+	cfg.erase		   = lfs_bd_erase;
+	cfg.sync		   = lfs_bd_sync;
+	cfg.read_size	   = page_size;
+	cfg.prog_size	   = page_size;
+	cfg.block_size	   = block_size;
+	cfg.block_count	   = p->size / block_size;
+	cfg.cache_size	   = page_size;
+	cfg.lookahead_size = page_size;
+	cfg.block_cycles   = LFS_BLOCK_CYCLES;
+
+	ret = lfs_format(&lfs, &cfg);
+	if (ret == LFS_ERR_OK)
+		ret = lfs_mount(&lfs, &cfg);
+	if (ret == LFS_ERR_OK)
+		ret = lfs_unmount(&lfs);
+
+	if (ret != LFS_ERR_OK) {
+		printf("%s: littlefs format failed %d\n", p->name, ret);
+		return -1;
+	}
+
+	printf("  littlefs %u blocks\n", cfg.block_count);
+	p->filled = 1;
+	return 0;
+}
+
+/* One copy per good block of the partition */
+static int fill_table(struct layout_part *p)
+{
+	uint8_t							buf[sizeof(struct partition_table_header) + PARTITION_MAX * sizeof(struct partition_table_entry)];
+	struct partition_table_header *hdr	 = (struct partition_table_header *)buf;
+	struct partition_table_entry  *entry = (struct partition_table_entry *)(buf + sizeof(*hdr));
+	uint32_t						len, addr, written = 0;
+	int								i;
+
+	memset(buf, 0, sizeof(buf));
+	hdr->magic	 = PARTITION_TABLE_MAGIC;
+	hdr->version = PARTITION_TABLE_VERSION;
+	hdr->count	 = nparts;
+	for (i = 0; i < nparts; i++) {
+		memcpy(entry[i].name, parts[i].name, PARTITION_NAME_MAX);
+		entry[i].start	= parts[i].start;
+		entry[i].size	= parts[i].size;
+		entry[i].type	= parts[i].type;
+		entry[i].copies = parts[i].copies;
+	}
+	len		   = sizeof(*hdr) + nparts * sizeof(*entry);
+	hdr->crc32 = crc32_calc(0xffffffff, buf, len) ^ 0xffffffff;
+
+	for (addr = p->start; addr + block_size <= p->start + p->size; addr += block_size) {
+		if (is_bad(addr / block_size)) {
+			printf("  table copy at 0x%08x dropped, bad block %u\n", addr, addr / block_size);
+			continue;
+		}
+		memcpy(image + addr, buf, len);
+		written++;
+	}
+
+	if (written == 0) {
+		printf("%s: no good block for the partition table\n", p->name);
+		return -1;
+	}
+
+	printf("  partition table, %d entries, %u copies\n", nparts, written);
+	p->filled = 1;
+	return 0;
+}
+
+static int fill(struct layout_part *p)
+{
+	int blk = find_bad(p->start, p->size);
+
+	printf("%-16s 0x%08x 0x%08x %-6s %s\n", p->name, p->start, p->size, type_names[p->type], p->file);
+	if (blk >= 0 && p->type != PARTITION_TYPE_TABLE && p->type != PARTITION_TYPE_BOOT1)
+		printf("  warning: bad block %d inside %s\n", blk, p->name);
+
+	if (p->file[0] == '\0' && p->type != PARTITION_TYPE_RAW && p->type != PARTITION_TYPE_TABLE &&
+		p->type != PARTITION_TYPE_PARAM && p->type != PARTITION_TYPE_LFS) {
+		if (p->type == PARTITION_TYPE_BOOT0 || p->type == PARTITION_TYPE_BOOT1 || strcmp(p->name, APP1_PART) == 0) {
+			printf("%s: needs a file\n", p->name);
+			return -1;
+		}
+		return 0;
+	}
+
+	switch (p->type) {
+		case PARTITION_TYPE_BOOT0:
+			if (p->start != 0) {
+				printf("%s: the BROM loads boot0 from offset 0\n", p->name);
+				return -1;
+			}
+			return fill_boot0(p);
+		case PARTITION_TYPE_BOOT1:
+			return fill_boot1(p);
+		case PARTITION_TYPE_APP:
+			return fill_app(p);
+		case PARTITION_TYPE_LFS:
+			return fill_lfs(p);
+		default:
+			return 0;
+	}
+}
+
+static void usage(const char *prog)
+{
+	printf("Usage: %s [-p page] [-k pages_per_block] [-n blocks] [-B bad,bad,...] -o out.bin layout.txt\n", prog);
+}
+
+int main(int argc, char *argv[])
+{
+	const char *output = NULL;
+	char	   *tok;
+	FILE	   *fp;
+	int			opt, i;
+
+	while ((opt = getopt(argc, argv, "p:k:n:B:o:h")) != -1) {
+		switch (opt) {
+			case 'p':
+				page_size = strtoul(optarg, NULL, 0);
+				break;
+			case 'k':
+				pages_per_block = strtoul(optarg, NULL, 0);
+				break;
+			case 'n':
+				blocks_total = strtoul(optarg, NULL, 0);
+				break;
+			case 'B':
+				for (tok = strtok(optarg, ","); tok != NULL && nbad < (int)(sizeof(bad) / sizeof(bad[0]));
+					 tok = strtok(NULL, ","))
+					bad[nbad++] = strtoul(tok, NULL, 0);
+				break;
+			case 'o':
+				output = optarg;
+				break;
+			default:
+				usage(argv[0]);
+				return -1;
+		}
+	}
+
+	if (output == NULL || optind != argc - 1) {
+		usage(argv[0]);
+		return -1;
+	}
+
+	if (page_size < BROM_PAGE_SIZE || (page_size & (BROM_PAGE_SIZE - 1)) || pages_per_block == 0 || blocks_total == 0) {
+		printf("page size must be a multiple of 2048\n");
+		return -1;
+	}
+	block_size = page_size * pages_per_block;
+
+	if (parse_layout(argv[optind]) != 0)
+		return -1;
+
+	image_size = parts[nparts - 1].start + parts[nparts - 1].size;
+	image_size = ALIGN(image_size, block_size);
+	image	   = malloc(image_size);
+	memset(image, 0xff, image_size);
+
+	/* Param needs the APP crcs, the table goes last */
+	for (i = 0; i < nparts; i++) {
+		if (parts[i].type != PARTITION_TYPE_PARAM && parts[i].type != PARTITION_TYPE_TABLE && fill(&parts[i]) != 0)
+			return -1;
+	}
+	for (i = 0; i < nparts; i++) {
+		if (parts[i].type == PARTITION_TYPE_PARAM && (fill(&parts[i]) != 0 || fill_param(&parts[i]) != 0))
+			return -1;
+	}
+	for (i = 0; i < nparts; i++) {
+		if (parts[i].type == PARTITION_TYPE_TABLE && (fill(&parts[i]) != 0 || fill_table(&parts[i]) != 0))
+			return -1;
+	}
+
+	fp = fopen(output, "wb");
+	if (fp == NULL || fwrite(image, 1, image_size, fp) != image_size) {
+		printf("Write %s error\n", output);
+		return -1;
+	}
+	fclose(fp);
+
+	printf("Factory image %s, %u bytes (%u blocks)\n", output, image_size, image_size / block_size);
+	printf("xfel spinand erase 0 0x%x && xfel spinand write 0 %s\n", image_size, output);
+
+	free(image);
+	return 0;
+}
@@ -6,6 +6,12 @@ import os
 
 MAGIC = 0x46574D47  # 'FWMG' 固件魔数
 
+SEG_MAX       = 16    # 与 ota.h OTA_SEG_MAX 一致
+SEG_ZERO_FILL = 0x01  # 与 ota.h OTA_SEG_ZERO_FILL 一致
+
+# 这些NOLOAD段由运行时自己初始化（或根本不需要初始化），不计入清零范围
+NOLOAD_SKIP = ('.stack', '.heap', '.noinit')
+
 def parse_elf_addresses(elf_path):
     try:
         from elftools.elf.elffile import ELFFile
@@ -31,6 +37,62 @@ def parse_elf_addresses(elf_path):
         return load_addr, entry
 
 
+def parse_elf_segments(elf_path):
+    """
+    每个PT_LOAD生成一个分段: (加载地址, 文件字节, 内存大小, 标志)
+    内存大小只延伸到该段内最后一个需要清零的NOBITS节（.bss等），
+    .stack/.heap/.noinit这类大块NOLOAD区域不清零，也不占镜像空间
+    """
+    from elftools.elf.elffile import ELFFile
+
+    segments = []
+    with open(elf_path, 'rb') as f:
+        elf = ELFFile(f)
+        for seg in elf.iter_segments():
+            if seg['p_type'] != 'PT_LOAD' or seg['p_memsz'] == 0:
+                continue
+
+            vaddr = seg['p_vaddr']
+            data = seg.data()
+            mem_end = vaddr + seg['p_filesz']
+            for sec in elf.iter_sections():
+                if sec['sh_type'] != 'SHT_NOBITS' or sec['sh_size'] == 0:
+                    continue
+                if not seg.section_in_segment(sec):
+                    continue
+                if sec.name.startswith(NOLOAD_SKIP):
+                    continue
+                mem_end = max(mem_end, sec['sh_addr'] + sec['sh_size'])
+
+            mem_size = mem_end - vaddr
+            flags = SEG_ZERO_FILL if mem_size > len(data) else 0
+            segments.append((vaddr, data, mem_size, flags))
+
+    if not segments:
+        print("[ERROR] No PT_LOAD segment found in ELF")
+        sys.exit(1)
+
+    return segments
+
+
+def build_segment_image(segments):
+    """
+    分段镜像: 分段表(每项20字节) + 各段文件数据(按表顺序紧密排列)
+    返回 (payload, 段数, 分段表CRC32)
+    """
+    if len(segments) > SEG_MAX:
+        print(f"[ERROR] Too many segments: {len(segments)} > {SEG_MAX}")
+        sys.exit(1)
+
+    table = b''
+    body = b''
+    for load, data, mem_size, flags in segments:
+        table += struct.pack('<IIIII', load, len(data), mem_size, flags, zlib.crc32(data) & 0xFFFFFFFF)
+        body += data
+
+    return table + body, len(segments), zlib.crc32(table) & 0xFFFFFFFF
+
+
 def parse_hex_addresses(hex_path):
     try:
         from intelhex import IntelHex
@@ -63,9 +125,10 @@ def parse_hex_addresses(hex_path):
     return load_addr, entry_point
 
 
-def pack_firmware(input_path, output_path, version, load_addr=None, start_addr=None):
+def pack_firmware(input_path, output_path, version, load_addr=None, start_addr=None, flat=True):
     ext = os.path.splitext(input_path)[1].lower()
     firmware = None
+    segments = None
 
     # 解析地址（加载地址和启动地址）
     if ext == '.elf':
@@ -88,6 +151,8 @@ def pack_firmware(input_path, output_path, version, load_addr=None, start_addr=N
                     data = seg.data()
                     firmware_chunks.append(data)
             firmware = b''.join(firmware_chunks)
+        if not flat:
+            segments = parse_elf_segments(input_path)
     elif ext == '.hex':
         if load_addr is not None or start_addr is not None:
             print("[WARN] For HEX input, load/start addresses are ignored, parsed from HEX file.")
@@ -107,21 +172,34 @@ def pack_firmware(input_path, output_path, version, load_addr=None, start_addr=N
         print("[ERROR] Unsupported file format. Only .bin, .elf, .hex supported.")
         sys.exit(1)
 
-    size = len(firmware)
-    crc32 = zlib.crc32(firmware) & 0xFFFFFFFF
     version_int = int(version, 16) if version.startswith("0x") else int(version)
     load_addr_int = int(load_addr, 16) if isinstance(load_addr, str) and str(load_addr).startswith("0x") else int(load_addr)
     start_addr_int = int(start_addr, 16) if isinstance(start_addr, str) and str(start_addr).startswith("0x") else int(start_addr)
 
+    # 默认输出旧的连续镜像：不认识分段表的 boot1 会把分段镜像整体加载并跳进分段表。
+    # --segments 时 .bin/.hex 只有一段连续数据，ELF 按 PT_LOAD 分段，boot1 须已支持分段表
+    seg_count = 0
+    seg_crc32 = 0
+    if not flat:
+        if segments is None:
+            segments = [(load_addr_int, bytes(firmware), len(firmware), 0)]
+        load_addr_int = min(seg[0] for seg in segments)
+        firmware, seg_count, seg_crc32 = build_segment_image(segments)
+
+    size = len(firmware)
+    crc32 = zlib.crc32(firmware) & 0xFFFFFFFF
+
     print(f"[INFO] Magic      = 0x{MAGIC:08X} ('FWMG')")
     print(f"[INFO] Size       = {size} bytes")
     print(f"[INFO] CRC32      = 0x{crc32:08X}")
     print(f"[INFO] Version    = 0x{version_int:08X}")
     print(f"[INFO] Load Addr  = 0x{load_addr_int:08X}")
     print(f"[INFO] Start Addr = 0x{start_addr_int:08X}")
-
-    # 32字节头部结构（8字节保留字段填充）
-    reserved = b'\x00' * 8
+    print(f"[INFO] Segments   = {seg_count}" + (" (flat)" if flat else ""))
+    if segments is not None and not flat:
+        for i, (load, data, mem_size, flags) in enumerate(segments):
+            zero = f", zero-fill {mem_size - len(data)} bytes" if flags & SEG_ZERO_FILL else ""
+            print(f"[INFO]   #{i}: 0x{load:08X} file {len(data)} bytes, mem {mem_size} bytes{zero}")
 
     with open(output_path, 'wb') as f:
         f.write(struct.pack('<I', MAGIC))            # 4字节魔数
@@ -130,22 +208,25 @@ def pack_firmware(input_path, output_path, version, load_addr=None, start_addr=N
         f.write(struct.pack('<I', version_int))      # 4字节版本号
         f.write(struct.pack('<I', load_addr_int))    # 4字节加载地址
         f.write(struct.pack('<I', start_addr_int))   # 4字节启动地址
-        f.write(reserved)                             # 8字节保留
+        f.write(struct.pack('<I', seg_count))        # 4字节分段数（0为连续镜像）
+        f.write(struct.pack('<I', seg_crc32))        # 4字节分段表CRC32
         f.write(firmware)
 
     print(f"[INFO] Packed firmware saved to: {output_path}")
 
 
 if __name__ == "__main__":
-    parser = argparse.ArgumentParser(description="Pack firmware with 32-byte header (magic,size,crc,ver,load,start,reserved).")
+    parser = argparse.ArgumentParser(description="Pack firmware with 32-byte header (magic,size,crc,ver,load,start,seg_count,seg_crc), optionally followed by a scatter-load segment table.")
     parser.add_argument("input", help="Input firmware file (.bin/.elf/.hex)")
     parser.add_argument("-o", "--output", help="Output packed file name (default: input_packed.bin)")
     parser.add_argument("-v", "--version", default="0x00010001", help="Firmware version (hex or int), default 0x00010001")
     parser.add_argument("-l", "--load", help="Load address (hex or int), required for .bin only")
     parser.add_argument("-s", "--start", help="Start address (hex or int), required for .bin only")
+    parser.add_argument("--segments", action="store_true", help="Scatter-load segment table, only for a boot1 (and boot0 fast boot) that supports it")
+    parser.add_argument("--flat", action="store_true", help="Flat image without segment table (default)")
 
     args = parser.parse_args()
 
     output_file = args.output if args.output else args.input.rsplit('.', 1)[0] + "_packed.bin"
 
-    pack_firmware(args.input, output_file, args.version, args.load, args.start)
+    pack_firmware(args.input, output_file, args.version, args.load, args.start, args.flat or not args.segments)